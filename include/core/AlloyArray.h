@@ -22,6 +22,7 @@
 #define INCLUDE_ALLOYARRAY_H_
 #include <cereal/types/array.hpp>
 #include "AlloyCommon.h"
+#include "AlloySIMD.h"
 #include <cereal/cereal.hpp>
 #include "cereal/types/string.hpp"
 namespace aly {
@@ -48,20 +49,16 @@ template<class T, int C> struct Array: public std::array<T, C> {
 		set(val);
 	}
 	T max() const {
-		T tmp(std::numeric_limits<T>::min());
-		for (int i = 0; i < C; i++) {
-			if ((*this)[i] > tmp)
-				tmp = (*this)[i];
-		}
-		return tmp;
+		T minVal(std::numeric_limits<T>::max());
+		T maxVal(std::numeric_limits<T>::lowest());
+		Kernels<T>::minMax(this->data(), C, 1, &minVal, &maxVal);
+		return maxVal;
 	}
 	T min() const {
-		T tmp(std::numeric_limits<T>::max());
-		for (int i = 0; i < C; i++) {
-			if ((*this)[i] < tmp)
-				tmp = (*this)[i];
-		}
-		return tmp;
+		T minVal(std::numeric_limits<T>::max());
+		T maxVal(std::numeric_limits<T>::lowest());
+		Kernels<T>::minMax(this->data(), C, 1, &minVal, &maxVal);
+		return minVal;
 	}
 	T mean() const {
 		T tmp(0);
@@ -175,246 +172,167 @@ template<class T, class L, class R, int C> std::basic_ostream<L, R> & operator <
 }
 template<class T, int C> Array<T, C> operator+(const T& scalar,
 		const Array<T, C>& img) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = scalar + val2;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::add(out.data(), Array<T, C>(scalar).data(), img.data(), C);
 	return out;
 }
 template<class T, int C> void ScaleAdd(Array<T, C>& out, const T& scalar,
 		const Array<T, C>& in) {
-	out.resize(in.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 += scalar * val2;};
-	Transform(out, in, f);
+	Kernels<T>::multiplyAdd(out.data(), out.data(), Array<T, C>(scalar).data(), in.data(), C);
 }
 template<class T, int C> void ScaleAdd(Array<T, C>& out, const Array<T, C>& in1,
 		const T& scalar, const Array<T, C>& in2) {
-	out.resize(in1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2+scalar * val3;};
-	Transform(out, in1, in2, f);
+	Kernels<T>::multiplyAdd(out.data(), in1.data(), Array<T, C>(scalar).data(), in2.data(), C);
 }
 template<class T, int C> void ScaleAdd(Array<T, C>& out, const Array<T, C>& in1,
 		const T& scalar2, const Array<T, C>& in2, const T& scalar3,
 		const Array<T, C>& in3) {
-	out.resize(in1.size());
-	std::function<void(T&, const T&, const T&, const T&)> f = [=](T& out,
-			const T& val1,
-			const T& val2,
-			const T& val3) {
-		out = val1+scalar2*val2+scalar3 * val3;};
-	Transform(out, in1, in2, in3, f);
+	Kernels<T>::multiplyAdd(out.data(), in1.data(), Array<T, C>(scalar2).data(), in2.data(), C);
+	Kernels<T>::multiplyAdd(out.data(), out.data(), Array<T, C>(scalar3).data(), in3.data(), C);
 }
 template<class T, int C> void ScaleSubtract(Array<T, C>& out, const T& scalar,
 		const Array<T, C>& in) {
-	out.resize(in.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 -= scalar * val2;};
-	Transform(out, in, f);
+	Kernels<T>::multiplySubtract(out.data(), out.data(), Array<T, C>(scalar).data(), in.data(), C);
 }
 template<class T, int C> void ScaleSubtract(Array<T, C>& out,
 		const Array<T, C>& in1, const T& scalar, const Array<T, C>& in2) {
-	out.resize(in1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2 - scalar * val3;};
-	Transform(out, in1, in2, f);
+	Kernels<T>::multiplySubtract(out.data(), in1.data(), Array<T, C>(scalar).data(), in2.data(), C);
 }
 template<class T, int C> void Subtract(Array<T, C>& out, const Array<T, C>& v1,
 		const Array<T, C>& v2) {
-	out.resize(v1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2-val3;};
-	Transform(out, v1, v2, f);
+	Kernels<T>::subtract(out.data(), v1.data(), v2.data(), C);
 }
 template<class T, int C> void Add(Array<T, C>& out, const Array<T, C>& v1,
 		const Array<T, C>& v2) {
-	out.resize(v1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2 + val3;};
-	Transform(out, v1, v2, f);
+	Kernels<T>::add(out.data(), v1.data(), v2.data(), C);
 }
 template<class T, int C> Array<T, C> operator-(const T& scalar,
 		const Array<T, C>& img) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = scalar - val2;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::subtract(out.data(), Array<T, C>(scalar).data(), img.data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator*(const T& scalar,
 		const Array<T, C>& img) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = scalar*val2;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::multiply(out.data(), Array<T, C>(scalar).data(), img.data(), C);
 	return out;
 }
-
 template<class T, int C> Array<T, C> operator/(const T& scalar,
 		const Array<T, C>& img) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = scalar / val2;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::divide(out.data(), Array<T, C>(scalar).data(), img.data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator+(const Array<T, C>& img,
 		const T& scalar) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = val2 + scalar;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::add(out.data(), img.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator-(const Array<T, C>& img,
 		const T& scalar) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = val2 - scalar;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::subtract(out.data(), img.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator*(const Array<T, C>& img,
 		const T& scalar) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = val2*scalar;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::multiply(out.data(), img.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator/(const Array<T, C>& img,
 		const T& scalar) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = val2 / scalar;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::divide(out.data(), img.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator-(const Array<T, C>& img) {
-	Array<T, C> out(img.size());
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 = -val2;};
-	Transform(out, img, f);
+	Array<T, C> out;
+	Kernels<T>::subtract(out.data(), Array<T, C>(T(0)).data(), img.data(), C);
 	return out;
 }
-template<class T, int C> Array<T, C> operator+=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator+=(Array<T, C>& out,
 		const Array<T, C>& img) {
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 += val2;};
-	Transform(out, img, f);
+	Kernels<T>::add(out.data(), out.data(), img.data(), C);
 	return out;
 }
-template<class T, int C> Array<T, C> operator-=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator-=(Array<T, C>& out,
 		const Array<T, C>& img) {
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 -= val2;};
-	Transform(out, img, f);
+	Kernels<T>::subtract(out.data(), out.data(), img.data(), C);
 	return out;
 }
-template<class T, int C> Array<T, C> operator*=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator*=(Array<T, C>& out,
 		const Array<T, C>& img) {
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 *= val2;};
-	Transform(out, img, f);
+	Kernels<T>::multiply(out.data(), out.data(), img.data(), C);
 	return out;
 }
-template<class T, int C> Array<T, C> operator/=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator/=(Array<T, C>& out,
 		const Array<T, C>& img) {
-	std::function<void(T&, const T&)> f =
-			[=](T& val1, const T& val2) {val1 /= val2;};
-	Transform(out, img, f);
+	Kernels<T>::divide(out.data(), out.data(), img.data(), C);
 	return out;
 }
 
-template<class T, int C> Array<T, C> operator+=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator+=(Array<T, C>& out,
 		const T& scalar) {
-	std::function<void(T&)> f = [=](T& val1) {val1 += scalar;};
-	Transform(out, f);
+	Kernels<T>::add(out.data(), out.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
-template<class T, int C> Array<T, C> operator-=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator-=(Array<T, C>& out,
 		const T& scalar) {
-	std::function<void(T&)> f = [=](T& val1) {val1 -= scalar;};
-	Transform(out, f);
+	Kernels<T>::subtract(out.data(), out.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
-template<class T, int C> Array<T, C> operator*=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator*=(Array<T, C>& out,
 		const T& scalar) {
-	std::function<void(T&)> f = [=](T& val1) {val1 *= scalar;};
-	Transform(out, f);
+	Kernels<T>::multiply(out.data(), out.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
-template<class T, int C> Array<T, C> operator/=(Array<T, C>& out,
+template<class T, int C> Array<T, C>& operator/=(Array<T, C>& out,
 		const T& scalar) {
-	std::function<void(T&)> f = [=](T& val1) {val1 /= scalar;};
-	Transform(out, f);
+	Kernels<T>::divide(out.data(), out.data(), Array<T, C>(scalar).data(), C);
 	return out;
 }
 
 template<class T, int C> Array<T, C> operator+(const Array<T, C>& img1,
 		const Array<T, C>& img2) {
-	Array<T, C> out(img1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2 + val3;};
-	Transform(out, img1, img2, f);
+	Array<T, C> out;
+	Kernels<T>::add(out.data(), img1.data(), img2.data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator-(const Array<T, C>& img1,
 		const Array<T, C>& img2) {
-	Array<T, C> out(img1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2 - val3;};
-	Transform(out, img1, img2, f);
+	Array<T, C> out;
+	Kernels<T>::subtract(out.data(), img1.data(), img2.data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator*(const Array<T, C>& img1,
 		const Array<T, C>& img2) {
-	Array<T, C> out(img1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2*val3;};
-	Transform(out, img1, img2, f);
+	Array<T, C> out;
+	Kernels<T>::multiply(out.data(), img1.data(), img2.data(), C);
 	return out;
 }
 template<class T, int C> Array<T, C> operator/(const Array<T, C>& img1,
 		const Array<T, C>& img2) {
-	Array<T, C> out(img1.size());
-	std::function<void(T&, const T&, const T&)> f =
-			[=](T& val1, const T& val2, const T& val3) {val1 = val2 / val3;};
-	Transform(out, img1, img2, f);
+	Array<T, C> out;
+	Kernels<T>::divide(out.data(), img1.data(), img2.data(), C);
 	return out;
 }
 
 template<class T, int C> double dot(const Array<T, C>& a,
 		const Array<T, C>& b) {
-	double ans = 0.0;
-	if (a.size() != b.size())
-		throw std::runtime_error(
-				MakeString() << "Array dimensions do not match. " << a.size()
-						<< "!=" << b.size());
-	size_t sz = a.size();
-#pragma omp parallel for reduction(+:ans)
-	for (int i = 0; i < (int) sz; i++) {
-		ans += a[i]*b[i];
-	}
-	return ans;
+	return Kernels<T>::dot(a.data(), b.data(), C);
 }
 
 template<class T, int C> T lengthSqr(const Array<T, C>& a) {
-	T ans(0);
-	size_t sz = a.size();
-#pragma omp parallel for reduction(+:ans)
-	for (int i = 0; i < (int) sz; i++) {
-		ans += a[i]* a[i];
-	}
-	return ans;
+	return (T) Kernels<T>::dot(a.data(), a.data(), C);
 }
 template<class T, int C> T distanceSqr(const Array<T, C>& a, const Array<T, C>& b) {
 	T ans(0);
-	size_t sz = a.size();
-#pragma omp parallel for reduction(+:ans)
-	for (int i = 0; i < (int)sz; i++) {
-		ans += (a[i] - b[i])*(a[i] - b[i]);
+	for (int i = 0; i < C; i++) {
+		T diff = a[i] - b[i];
+		ans += diff * diff;
 	}
 	return ans;
 }
@@ -431,24 +349,10 @@ template<class T, int C> T distance(const Array<T, C>& a, const Array<T, C>& b)
 	return std::sqrt(distanceSqr(a,b));
 }
 template<class T, int C> T max(const Array<T, C>& a) {
-	size_t sz = a.size();
-	T tmp(std::numeric_limits<T>::min());
-//#pragma omp parallel for reduction(max:tmp)
-	for (int i = 0; i < (int) sz; i++) {
-		if (a[i] > tmp)
-			tmp = a[i];
-	}
-	return tmp;
+	return a.max();
 }
 template<class T, int C> T min(const Array<T, C>& a) {
-	size_t sz = a.size();
-	T tmp(std::numeric_limits<T>::max());
-//#pragma omp parallel for reduction(min:tmp)
-	for (int i = 0; i < (int) sz; i++) {
-		if (a[i] < tmp)
-			tmp = a[i];
-	}
-	return tmp;
+	return a.min();
 }
 template<class T, int C> T length(const Array<T, C>& a) {
 	return std::sqrt(lengthSqr(a));
@@ -0,0 +1,194 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef INCLUDE_ALLOYBINARYFILE_H_
+#define INCLUDE_ALLOYBINARYFILE_H_
+#include "AlloyVolume.h"
+#include "AlloyVector.h"
+#include <map>
+namespace aly {
+	bool SANITY_CHECK_BINARY_FILE();
+	/*
+	 Alloy binary container (.alyb). A 64 byte header is followed by the section payloads, each starting on a 64 byte
+	 boundary, and a table describing the sections at the end of the file. A section is a named array of vec<T,C>
+	 with up to three extents. Raw sections are used in place from the memory mapped file, so only the sections that
+	 are read get paged in. Compressed sections are split into 1MB blocks stored in LZ4 block format that are
+	 (de)compressed in parallel. ShuffleLZ4 first groups the bytes of each scalar by significance, which compresses
+	 float data much better. Every section records a 64-bit hash of its uncompressed bytes.
+	 */
+	enum class BinaryCompression {
+		Raw = 0, LZ4 = 1, ShuffleLZ4 = 2
+	};
+	struct BinarySection {
+		std::string name;
+		ImageType type = ImageType::UNKNOWN;
+		int channels = 0;
+		uint64_t count = 0;
+		uint64_t extents[3] = { 0, 0, 0 };
+		BinaryCompression compression = BinaryCompression::Raw;
+		uint64_t offset = 0;
+		uint64_t storedSize = 0;
+		uint64_t hash = 0;
+		size_t size() const {
+			return (size_t) count * channels * GetImageTypeSize(type);
+		}
+	};
+	template<class T> struct BinaryScalar {
+		static ImageType type() {
+			return ImageType::UNKNOWN;
+		}
+	};
+	template<> struct BinaryScalar<int8_t> {
+		static ImageType type() {
+			return ImageType::BYTE;
+		}
+	};
+	template<> struct BinaryScalar<uint8_t> {
+		static ImageType type() {
+			return ImageType::UBYTE;
+		}
+	};
+	template<> struct BinaryScalar<int16_t> {
+		static ImageType type() {
+			return ImageType::SHORT;
+		}
+	};
+	template<> struct BinaryScalar<uint16_t> {
+		static ImageType type() {
+			return ImageType::USHORT;
+		}
+	};
+	template<> struct BinaryScalar<int32_t> {
+		static ImageType type() {
+			return ImageType::INT;
+		}
+	};
+	template<> struct BinaryScalar<uint32_t> {
+		static ImageType type() {
+			return ImageType::UINT;
+		}
+	};
+	template<> struct BinaryScalar<float> {
+		static ImageType type() {
+			return ImageType::FLOAT;
+		}
+	};
+	template<> struct BinaryScalar<double> {
+		static ImageType type() {
+			return ImageType::DOUBLE;
+		}
+	};
+	//Streams sections to disk as they are added. The section table and header are written by close().
+	class BinaryFileWriter {
+	protected:
+		FILE* file;
+		std::string fileName;
+		uint64_t position;
+		std::vector<BinarySection> sections;
+		std::map<std::string, size_t> lookup;
+		void writeBytes(const void* data, size_t size);
+		void align();
+	public:
+		BinaryFileWriter();
+		BinaryFileWriter(const std::string& file);
+		BinaryFileWriter(const BinaryFileWriter&) = delete;
+		BinaryFileWriter& operator=(const BinaryFileWriter&) = delete;
+		~BinaryFileWriter();
+		void open(const std::string& file);
+		void close();
+		bool isOpen() const {
+			return (file != nullptr);
+		}
+		void write(const std::string& name, const void* data, ImageType type, int channels, size_t count,
+				BinaryCompression compression = BinaryCompression::Raw, int3 extents = int3(0, 0, 0));
+		template<class T, int C> void write(const std::string& name, const std::vector<vec<T, C>>& data,
+				BinaryCompression compression = BinaryCompression::Raw) {
+			write(name, data.data(), BinaryScalar<T>::type(), C, data.size(), compression, int3((int) data.size(), 0, 0));
+		}
+		template<class T, int C> void write(const std::string& name, const Vector<T, C>& vector,
+				BinaryCompression compression = BinaryCompression::Raw) {
+			write(name, vector.data, compression);
+		}
+		template<class T, int C, ImageType I> void write(const std::string& name, const Image<T, C, I>& img,
+				BinaryCompression compression = BinaryCompression::Raw) {
+			write(name, img.data.data(), I, C, img.data.size(), compression, int3(img.width, img.height, 0));
+		}
+		template<class T, int C, ImageType I> void write(const std::string& name, const Volume<T, C, I>& vol,
+				BinaryCompression compression = BinaryCompression::Raw) {
+			write(name, vol.data.data(), I, C, vol.data.size(), compression, int3(vol.rows, vol.cols, vol.slices));
+		}
+	};
+	//Memory maps a container and reads or views its sections on demand.
+	class MappedBinaryFile {
+	protected:
+		MemoryMappedFile file;
+		std::string fileName;
+		std::vector<BinarySection> sections;
+		std::map<std::string, size_t> lookup;
+		const BinarySection& checkSection(const std::string& name, ImageType type, int channels) const;
+	public:
+		MappedBinaryFile() {
+		}
+		MappedBinaryFile(const std::string& file) {
+			open(file);
+		}
+		void open(const std::string& file);
+		void close();
+		bool hasSection(const std::string& name) const {
+			return (lookup.find(name) != lookup.end());
+		}
+		const BinarySection& getSection(const std::string& name) const;
+		const std::vector<BinarySection>& getSections() const {
+			return sections;
+		}
+		//Payload of a raw section inside the mapped file.
+		const void* data(const std::string& name) const;
+		//Copies or decompresses a section into dest, which must hold getSection(name).size() bytes.
+		void read(const std::string& name, void* dest, ImageType type, int channels) const;
+		//Compares the hash of the section's uncompressed bytes with the one recorded in the table.
+		bool verify(const std::string& name) const;
+		template<class T, int C> const vec<T, C>* view(const std::string& name) const {
+			checkSection(name, BinaryScalar<T>::type(), C);
+			return (const vec<T, C>*) data(name);
+		}
+		template<class T, int C> void read(const std::string& name, std::vector<vec<T, C>>& data) const {
+			data.resize((size_t) checkSection(name, BinaryScalar<T>::type(), C).count);
+			read(name, data.data(), BinaryScalar<T>::type(), C);
+		}
+		template<class T, int C> void read(const std::string& name, Vector<T, C>& vector) const {
+			read(name, vector.data);
+		}
+		template<class T, int C, ImageType I> void read(const std::string& name, Image<T, C, I>& img) const {
+			const BinarySection& section = checkSection(name, I, C);
+			img.resize((int) section.extents[0], (int) section.extents[1]);
+			if (img.data.size() != section.count)
+				throw std::runtime_error(MakeString() << "Section " << name << " does not match its image dimensions.");
+			read(name, img.data.data(), I, C);
+		}
+		template<class T, int C, ImageType I> void read(const std::string& name, Volume<T, C, I>& vol) const {
+			const BinarySection& section = checkSection(name, I, C);
+			vol.resize((int) section.extents[0], (int) section.extents[1], (int) section.extents[2]);
+			if (vol.data.size() != section.count)
+				throw std::runtime_error(MakeString() << "Section " << name << " does not match its volume dimensions.");
+			read(name, vol.data.data(), I, C);
+		}
+	};
+}
+#endif
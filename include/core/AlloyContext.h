@@ -100,6 +100,25 @@ namespace aly {
 		void set(const ImageRGBAf& rgba, AlloyContext* context);
 		~ImageGlyph();
 	};
+	template<class T, int C, ImageType I> class TiledImage;
+	//Draws a tiled image pyramid, uploading only the visible tiles of the level closest to the on-screen resolution.
+	struct TiledImageGlyph: public Glyph {
+	protected:
+		struct TileTexture {
+			int handle;
+			uint64_t frame;
+		};
+		std::shared_ptr<TiledImage<uint8_t, 4, ImageType::UBYTE>> image;
+		std::map<uint64_t, TileTexture> textures;
+		size_t maxTextures;
+		uint64_t frame;
+		int getTexture(int level, int tx, int ty, AlloyContext* context);
+	public:
+		TiledImageGlyph(const std::shared_ptr<TiledImage<uint8_t, 4, ImageType::UBYTE>>& image, AlloyContext* context,
+				size_t maxTextures = 256);
+		void draw(const box2px& bounds, const Color& fgColor, const Color& bgColor, AlloyContext* context) override;
+		~TiledImageGlyph();
+	};
 	struct CheckerboardGlyph: public Glyph {
 		int handle;
 		CheckerboardGlyph(int width, int height, int horizTiles, int vertTiles, AlloyContext* context, bool mipmap = false);
@@ -384,6 +403,10 @@ namespace aly {
 		inline std::shared_ptr<ImageGlyph> createImageGlyph(const ImageRGBA& img, bool mipmap = false) {
 			return std::shared_ptr<ImageGlyph>(new ImageGlyph(img, this));
 		}
+		inline std::shared_ptr<TiledImageGlyph> createTiledImageGlyph(
+				const std::shared_ptr<TiledImage<uint8_t, 4, ImageType::UBYTE>>& image) {
+			return std::shared_ptr<TiledImageGlyph>(new TiledImageGlyph(image, this));
+		}
 		inline std::shared_ptr<AwesomeGlyph> createAwesomeGlyph(int codePoint, const FontStyle& style = FontStyle::Normal, pixel height = 32) {
 			std::shared_ptr<AwesomeGlyph> g = std::shared_ptr<AwesomeGlyph>(new AwesomeGlyph(codePoint, this, style, height));
 			return g;
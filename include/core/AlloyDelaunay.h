@@ -23,10 +23,74 @@
 #include "AlloyMath.h"
 #include "AlloyVector.h"
 #include <iostream>
+#include <vector>
 namespace aly {
+	bool SANITY_CHECK_DELAUNAY();
+	//Exact predicates. Orient2D is positive if a, b, c wind counter-clockwise, InCircle is positive if d lies inside
+	//the circle through the counter-clockwise triangle a, b, c.
+	int Orient2D(const float2& a, const float2& b, const float2& c);
+	int InCircle(const float2& a, const float2& b, const float2& c, const float2& d);
+	//Incremental Delaunay triangulation. Points are inserted in biased randomized order with Hilbert curve sorting
+	//inside each round, located by walking from the last triangle, and tested with exact orientation and in-circle
+	//predicates, so the expected cost is O(n log n) and the result does not depend on round-off.
+	//Inputs of at least two blocks are cut into vertical strips that are triangulated in parallel. Triangles whose
+	//circumcircle stays inside their strip are final, and the points of all other triangles are triangulated again
+	//to fill the gaps between strips.
+	class Delaunay {
+	protected:
+		//Half-edge 3*t+i runs from vertex i to vertex (i+1)%3 of triangle t. Triangles with the infinite vertex
+		//close the convex hull, so every half-edge has a twin.
+		std::vector<int> vertexes;
+		std::vector<int> twins;
+		std::vector<char> constrained;
+		std::vector<int> vertexEdge;
+		std::vector<int> alias;
+		std::vector<int> cavity;
+		std::vector<int> cavityMark;
+		std::vector<int3> boundary;
+		std::vector<int> fanEdge;
+		const std::vector<float2>* points;
+		int blockSize;
+		int infinite = 0;
+		int lastEdge = -1;
+		int markCounter = 0;
+		uint32_t walkSeed = 0;
+		static inline int Next(int e) {
+			return (e % 3 == 2) ? e - 2 : e + 1;
+		}
+		static inline int Prev(int e) {
+			return (e % 3 == 0) ? e + 2 : e - 1;
+		}
+		int orient(int a, int b, int c) const;
+		bool isGhost(int t) const;
+		bool inConflict(int t, int p) const;
+		int locate(int p);
+		bool insert(int p);
+		void link(int e, int f);
+		void flip(int e);
+		bool findEdge(int a, int b, int& e) const;
+		void insertConstraint(int a, int b);
+		void buildInsertionOrder(const std::vector<float2>& pts, std::vector<int>& order) const;
+		bool triangulate(const std::vector<float2>& pts);
+		bool triangulateBlocks(const std::vector<float2>& pts);
+		void closeHull();
+	public:
+		//Block size is the number of points per strip when triangulating in parallel.
+		Delaunay(int blockSize = 1 << 16) :points(nullptr), blockSize(std::max(blockSize, 16)) {
+		}
+		virtual ~Delaunay() {
+		}
+		//Triangles wind clockwise with y pointing up, which is counter-clockwise on screen. Only the first of several
+		//equal points is referenced, and input without three non-collinear points gives no triangles.
+		void solve(const std::vector<float2>& pts, std::vector<uint3>& output);
+		//Forces each constraint segment into the triangulation. Segments may pass through other points but must not
+		//cross each other.
+		void solve(const std::vector<float2>& pts, const std::vector<uint2>& constraints, std::vector<uint3>& output);
+	};
 	void Triangulate(std::vector<float2>& pxyz, std::vector<uint3>& v);
 	bool CircumCircle(float, float, float, float, float, float, float, float, float&, float&, float&);
 	void MakeDelaunay(const std::vector<float2>& vertexes, std::vector<uint3>& output);
+	void MakeDelaunay(const std::vector<float2>& vertexes, const std::vector<uint2>& constraints, std::vector<uint3>& output);
 	inline void MakeDelaunay(const Vector2f& vertexes, std::vector<uint3>& output) {
 		MakeDelaunay(vertexes.data, output);
 	}
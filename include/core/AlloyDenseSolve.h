@@ -26,6 +26,7 @@
 namespace aly {
 	bool SANITY_CHECK_DENSE_SOLVE();
 	bool SANITY_CHECK_ROBUST_SOLVE();
+	//The pyramid versions (levels > 1) run multigrid cycles. iterations bounds the number of cycles and lambda is the smoothing weight.
 	void PoissonBlend(const Image4f& in, Image4f& out, int iterations, int levels,float lambda = 0.99f, const std::function<bool(int,int)>& iterationMonitor = nullptr);
 	void PoissonBlend(const Image4f& in, Image4f& out, int iterations,float lambda = 0.99f, const std::function<bool(int)>& iterationMonitor = nullptr);
 	void PoissonBlend(const Image2f& in, Image2f& out, int iterations, int levels,float lambda = 0.99f, const std::function<bool(int,int)>& iterationMonitor = nullptr);
@@ -38,6 +39,66 @@ namespace aly {
 	void LaplaceFill(const Image4f& sourceImg, Image4f& targetImg, int iterations,float lambda = 0.99f , const std::function<bool(int)>& iterationMonitor=nullptr);
 	void LaplaceFill(const Image2f& sourceImg, Image2f& targetImg, int iterations,float lambda = 0.99f, const std::function<bool(int)>& iterationMonitor = nullptr);
 	void LaplaceFill(const Image2f& sourceImg, Image2f& targetImg, int iterations,int levels, float lambda = 0.99f, const std::function<bool(int, int)>& iterationMonitor = nullptr);
+	enum class MultigridCycle {
+		V, W, F
+	};
+	template<class C, class R> std::basic_ostream<C, R> & operator <<(
+		std::basic_ostream<C, R> & ss, const MultigridCycle& type) {
+		switch (type) {
+		case MultigridCycle::V:
+			return ss << "V-Cycle";
+		case MultigridCycle::W:
+			return ss << "W-Cycle";
+		case MultigridCycle::F:
+			return ss << "F-Cycle";
+		}
+		return ss;
+	}
+	/*
+	 * Geometric multigrid solver for u - 1/4 (sum of 4-neighbors) = rhs, the discrete Poisson equation relaxed by PoissonBlend,
+	 * PoissonInpaint and LaplaceFill. Only pixels with a non-zero mask are solved for, all other pixels keep their value in the
+	 * solution and act as boundary conditions. The iteration monitor receives the cycle index and the mean squared residual,
+	 * and can return false to stop early. solve() returns the final mean squared residual.
+	 */
+	class MultigridPoisson2D {
+	protected:
+		MultigridCycle cycle;
+		int maxLevels;
+		int preSmoothIterations;
+		int postSmoothIterations;
+		int coarseIterations;
+		float relaxation;
+	public:
+		MultigridPoisson2D(MultigridCycle cycle = MultigridCycle::V, int maxLevels = 16);
+		void setCycle(MultigridCycle c) {
+			cycle = c;
+		}
+		void setMaxLevels(int l) {
+			maxLevels = l;
+		}
+		void setSmoothIterations(int pre, int post) {
+			preSmoothIterations = pre;
+			postSmoothIterations = post;
+		}
+		void setCoarseIterations(int iter) {
+			coarseIterations = iter;
+		}
+		void setRelaxation(float omega) {
+			relaxation = omega;
+		}
+		MultigridCycle getCycle() const {
+			return cycle;
+		}
+		int getMaxLevels() const {
+			return maxLevels;
+		}
+		float getRelaxation() const {
+			return relaxation;
+		}
+		double solve(const Image1f& rhs, const Image1ub& mask, Image1f& solution, int maxCycles = 32, double tolerance = 1E-10, const std::function<bool(int, double)>& iterationMonitor = nullptr) const;
+		double solve(const Image2f& rhs, const Image1ub& mask, Image2f& solution, int maxCycles = 32, double tolerance = 1E-10, const std::function<bool(int, double)>& iterationMonitor = nullptr) const;
+		double solve(const Image4f& rhs, const Image1ub& mask, Image4f& solution, int maxCycles = 32, double tolerance = 1E-10, const std::function<bool(int, double)>& iterationMonitor = nullptr) const;
+	};
 
 	/******************************************************************************
 	 * XLISP-STAT 2.1 Copyright (c) 1990, by Luke Tierney
@@ -23,8 +23,29 @@
 #include "BinaryMinHeap.h"
 #include "AlloyMath.h"
 #include "AlloyVolume.h"
+#include "AlloySparseVolume.h"
 namespace aly {
 	bool SANITY_CHECK_DISTANCE_FIELD();
+	/*
+	 * FastMarching is the original single-threaded solver.
+	 * FastSweeping runs Gauss-Seidel sweeps in parallel over bricks of the volume.
+	 * NarrowBand sweeps only bricks within maxDistance of the interface, so memory scales with the interface area.
+	 */
+	enum class DistanceFieldMethod {
+		FastMarching = 0, FastSweeping = 1, NarrowBand = 2
+	};
+	template<class C, class R> std::basic_ostream<C, R> & operator <<(
+		std::basic_ostream<C, R> & ss, const DistanceFieldMethod& type) {
+		switch (type) {
+		case DistanceFieldMethod::FastMarching:
+			return ss << "Fast Marching";
+		case DistanceFieldMethod::FastSweeping:
+			return ss << "Fast Sweeping";
+		case DistanceFieldMethod::NarrowBand:
+			return ss << "Narrow Band";
+		}
+		return ss;
+	}
 	class DistanceField3f {
 		typedef Indexable<float, 3> VoxelIndex;
 		typedef vec<int, 3> Coord;
@@ -34,10 +55,41 @@ namespace aly {
 		static const ubyte1 FAR_AWAY;
 
 		float march(float Nv, float Sv, float Ev, float Wv, float Fv, float Bv, int Nl, int Sl, int El, int Wl, int Fl, int Bl);
+		DistanceFieldMethod method;
 	public:
 		static const float DISTANCE_UNDEFINED;
-		DistanceField3f()  {}
+		DistanceField3f(DistanceFieldMethod method = DistanceFieldMethod::FastMarching) :
+				method(method) {
+		}
+		void setMethod(DistanceFieldMethod m) {
+			method = m;
+		}
+		DistanceFieldMethod getMethod() const {
+			return method;
+		}
 		void solve(const Volume1f& vol, Volume1f& out,float maxDistance=2.5f);
+		//Sparse level sets are always solved in narrow band mode. Active input voxels seed the interface
+		//and the output is active within maxDistance of it.
+		void solve(const SparseVolume1f& vol, SparseVolume1f& out, float maxDistance = 2.5f);
+	};
+	class Mesh;
+	/*
+	 * Signed distance volume for a closed triangle mesh. Distances are exact within bandWidth voxels of the surface,
+	 * computed brick by brick from triangles rasterized into the band. Remaining voxels are filled by fast sweeping
+	 * of closest triangles. Sign comes from counting surface crossings along each row of voxels.
+	 */
+	class MeshToSignedDistanceVolume {
+	protected:
+		int bandWidth;
+		int brickSize;
+	public:
+		MeshToSignedDistanceVolume(int bandWidth = 3, int brickSize = 8) :
+				bandWidth(bandWidth), brickSize(brickSize) {
+		}
+		//Voxel (i,j,k) is centered at bbox.position+voxelSize*(i+0.5,j+0.5,k+0.5) and there are ceil(bbox.dimensions/voxelSize) voxels per axis.
+		//Distances are in voxels, negative inside and clamped to maxDistance.
+		void solve(const Mesh& mesh, const box3f& bbox, float voxelSize,
+				Volume1f& out, float maxDistance = std::numeric_limits<float>::max());
 	};
 	class DistanceField2f {
 		typedef Indexable<float, 2> PixelIndex;
@@ -48,9 +100,18 @@ namespace aly {
 		static const ubyte1 FAR_AWAY;
 
 		float march(float Nv, float Sv, float Fv, float Bv, int Nl, int Sl, int Fl, int Bl);
+		DistanceFieldMethod method;
 	public:
 		static const float DISTANCE_UNDEFINED;
-		DistanceField2f() {}
+		DistanceField2f(DistanceFieldMethod method = DistanceFieldMethod::FastMarching) :
+				method(method) {
+		}
+		void setMethod(DistanceFieldMethod m) {
+			method = m;
+		}
+		DistanceFieldMethod getMethod() const {
+			return method;
+		}
 		void solve(const Image1f& vol, Image1f& out, float maxDistance = 2.5f);
 	};
 } /* namespace imagesci */
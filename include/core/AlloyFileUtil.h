@@ -54,8 +54,9 @@ namespace aly {
 	enum class FileAttribute {
 		Compressed, Hidden
 	};
+	//XXH64 is a fast non-cryptographic 64-bit hash.
 	enum class HashMethod {
-		SHA1 = 1, SHA224 = 224, SHA256 = 256, SHA384 = 384, SHA512 = 512
+		SHA1 = 1, SHA224 = 224, SHA256 = 256, SHA384 = 384, SHA512 = 512, XXH64 = 64
 	};
 	struct FileDescription {
 		std::string fileLocation;
@@ -133,6 +134,35 @@ namespace aly {
 	std::string GetUserNameString();
 	bool MakeDirectory(const std::string& dir);
 	std::vector<std::string> GetDrives();
+	//Read-only mapping of a whole file into memory. Pages are loaded on first access by the operating system.
+	class MemoryMappedFile {
+	protected:
+		const char* ptr;
+		size_t length;
+#ifdef ALY_WINDOWS
+		void* fileHandle;
+		void* mapHandle;
+#else
+		int fileDescriptor;
+#endif
+	public:
+		MemoryMappedFile();
+		MemoryMappedFile(const std::string& file);
+		MemoryMappedFile(const MemoryMappedFile&) = delete;
+		MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+		~MemoryMappedFile();
+		void open(const std::string& file);
+		void close();
+		bool isOpen() const {
+			return (ptr != nullptr);
+		}
+		const char* data() const {
+			return ptr;
+		}
+		size_t size() const {
+			return length;
+		}
+	};
 	static inline bool is_base64(unsigned char c) {
 		return (isalnum(c) || (c == '+') || (c == '-'));
 	}
@@ -186,37 +216,56 @@ namespace aly {
 		}
 		return bufferOut.str();
 	}
-	template<class T> std::string HashCode(std::vector<T> data, HashMethod method =
-		HashMethod::SHA256) {
-		std::string str = EncodeBase64(data);
-		std::vector<unsigned char> hashOut;
-		std::string hashCode = "";
-		switch (method) {
-		case HashMethod::SHA1:
-			hashCode = sha1(str);
-			break;
-		case HashMethod::SHA224:
-			hashOut.resize(SHA224_DIGEST_SIZE);
-			sha224((unsigned char *)str.c_str(), str.size(), hashOut.data());
-			hashCode = EncodeBase64(hashOut, false);
-			break;
-		case HashMethod::SHA256:
-			hashOut.resize(SHA256_DIGEST_SIZE);
-			sha256((unsigned char *)str.c_str(), str.size(), hashOut.data());
-			hashCode = EncodeBase64(hashOut, false);
-			break;
-		case HashMethod::SHA384:
-			hashOut.resize(SHA384_DIGEST_SIZE);
-			sha384((unsigned char *)str.c_str(), str.size(), hashOut.data());
-			hashCode = EncodeBase64(hashOut, false);
-			break;
-		case HashMethod::SHA512:
-			hashOut.resize(SHA512_DIGEST_SIZE);
-			sha512((unsigned char *)str.c_str(), str.size(), hashOut.data());
-			hashCode = EncodeBase64(hashOut, false);
-			break;
+	/*
+	 Collet, Y. xxHash - Extremely fast hash algorithm. https://github.com/Cyan4973/xxHash
+
+	 Streaming XXH64.
+	 */
+	class XXHash64 {
+	protected:
+		uint64_t seed;
+		uint64_t acc[4];
+		uint64_t totalLength;
+		uint8_t buffer[32];
+		size_t bufferSize;
+	public:
+		XXHash64(uint64_t seed = 0) {
+			reset(seed);
 		}
-		return hashCode;
+		void reset(uint64_t seed = 0);
+		void update(const void* data, size_t size);
+		uint64_t final() const;
+		static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+	};
+	//Incremental hash of raw bytes. Call update() any number of times, then final() for the digest.
+	class Hasher {
+	protected:
+		HashMethod method;
+		SHA1 sha1State;
+		sha256_ctx sha256State;
+		sha512_ctx sha512State;
+		XXHash64 xxhState;
+	public:
+		Hasher(HashMethod method = HashMethod::SHA256);
+		void init();
+		void update(const void* data, size_t size);
+		std::vector<uint8_t> final();
+		HashMethod getMethod() const {
+			return method;
+		}
+	};
+	//Formats a digest the way HashCode always has, hexadecimal for SHA1 and XXH64 and base64 otherwise.
+	std::string EncodeHash(const std::vector<uint8_t>& digest, HashMethod method);
+	std::string HashCode(const void* data, size_t size, HashMethod method = HashMethod::SHA256);
+	/*
+	 Splits buffers larger than leafSize into leaves that are hashed in parallel, then hashes the concatenated leaf
+	 digests. The result only depends on the data and leafSize, and equals HashCode() for buffers of one leaf.
+	 */
+	std::string TreeHashCode(const void* data, size_t size, HashMethod method = HashMethod::SHA256,
+			size_t leafSize = ((size_t) 1 << 24));
+	template<class T> std::string HashCode(const std::vector<T>& data, HashMethod method =
+		HashMethod::SHA256) {
+		return HashCode(data.data(), data.size() * sizeof(T), method);
 	}
 	template<class T> void DecodeBase64(const std::string& encoded_string,
 		std::vector<T>& out) {
@@ -22,6 +22,7 @@
 #define ALLOYIMAGE2D_H_INCLUDE_GUARD
 #include "AlloyCommon.h"
 #include "AlloyMath.h"
+#include "AlloySIMD.h"
 #include "sha2.h"
 #include "AlloyFileUtil.h"
 #include "cereal/types/vector.hpp"
@@ -71,6 +72,17 @@ template<class L, class R> std::basic_ostream<L, R>& operator <<(
 template<class T, int C, ImageType I> struct Image;
 template<class T, int C, ImageType I> void WriteImageToRawFile(
 		const std::string& fileName, const Image<T, C, I>& img);
+template<class T, int C, ImageType I> void DownSample(const Image<T, C, I>& in,
+		Image<T, C, I>& out);
+template<class T, int C, ImageType I> void UpSample(const Image<T, C, I>& in,
+		Image<T, C, I>& out);
+//Accumulation type for separable and recursive filters. Everything except double images is filtered in single precision.
+template<class T> struct FilterAccumulator {
+	typedef float type;
+};
+template<> struct FilterAccumulator<double> {
+	typedef double type;
+};
 template<class T, int C, ImageType I> struct Image {
 protected:
 	int x, y;
@@ -397,50 +409,10 @@ public:
 		}
 	}
 	void downSample(Image<T, C, I>& out) const {
-		static const double Kernel[5][5] = { { 1, 4, 6, 4, 1 }, { 4, 16, 24, 16,
-				4 }, { 6, 24, 36, 24, 6 }, { 4, 16, 24, 16, 4 },
-				{ 1, 4, 6, 4, 1 } };
-		out.resize(width / 2, height / 2);
-#pragma omp parallel for
-		for (int i = 0; i < out.width; i++) {
-			for (int j = 0; j < out.height; j++) {
-				vec<double, C> vsum(0.0);
-				for (int ii = 0; ii < 5; ii++) {
-					for (int jj = 0; jj < 5; jj++) {
-						vsum += Kernel[ii][jj]
-								* vec<double, C>(
-										operator()(2 * i + ii - 2,
-												2 * j + jj - 2));
-					}
-				}
-				out(i, j) = vec<T, C>(vsum / 256.0);
-			}
-		}
+		DownSample(*this, out);
 	}
 	void upSample(Image<T, C, I>& out) const {
-		static const double Kernel[5][5] = { { 1, 4, 6, 4, 1 }, { 4, 16, 24, 16,
-				4 }, { 6, 24, 36, 24, 6 }, { 4, 16, 24, 16, 4 },
-				{ 1, 4, 6, 4, 1 } };
-		if (out.size() == 0)
-			out.resize(width * 2, height * 2);
-#pragma omp parallel for
-		for (int i = 0; i < out.width; i++) {
-			for (int j = 0; j < out.height; j++) {
-				vec<double, C> vsum(0.0);
-				for (int ii = 0; ii < 5; ii++) {
-					for (int jj = 0; jj < 5; jj++) {
-						int iii = i + ii - 2;
-						int jjj = j + jj - 2;
-						if (iii % 2 == 0 && jjj % 2 == 0) {
-							vsum += Kernel[ii][jj]
-									* vec<double, C>(
-											operator()(iii / 2, jjj / 2));
-						}
-					}
-				}
-				out(i, j) = vec<T, C>(vsum / 64.0);
-			}
-		}
+		UpSample(*this, out);
 	}
 	Image<T, C, I> downSample() const {
 		Image<T, C, I> out;
@@ -453,26 +425,14 @@ public:
 		return out;
 	}
 	vec<T, C> min() const {
-		vec<T, C> minVal(std::numeric_limits<T>::max());
-		for (const vec<T, C>& val : data) {
-			minVal = aly::minVec(val, minVal);
-		}
-		return minVal;
+		return range().first;
 	}
 	vec<T, C> max() const {
-		vec<T, C> maxVal(std::numeric_limits<T>::min());
-		for (const vec<T, C>& val : data) {
-			maxVal = aly::maxVec(val, maxVal);
-		}
-		return maxVal;
+		return range().second;
 	}
 	std::pair<vec<T, C>, vec<T, C>> range() const {
-		vec<T, C> maxVal(std::numeric_limits<T>::min());
-		vec<T, C> minVal(std::numeric_limits<T>::max());
-		for (const vec<T, C>& val : data) {
-			maxVal = aly::maxVec(val, maxVal);
-			minVal = aly::minVec(val, minVal);
-		}
+		vec<T, C> minVal, maxVal;
+		VecMinMax(data.data(), data.size(), minVal, maxVal);
 		return std::pair<vec<T, C>, vec<T, C>>(minVal, maxVal);
 	}
 	vec<T, C> mean() const {
@@ -577,7 +537,7 @@ public:
 template<class T, int C, ImageType I> std::string Image<T, C, I>::updateHashCode(
 		size_t MAX_SAMPLES, HashMethod method) {
 	if (MAX_SAMPLES == 0) {
-		hashCode = HashCode(data, method);
+		hashCode = TreeHashCode(data.data(), data.size() * sizeof(vec<T, C>), method);
 	} else {
 		const size_t seed = 83128921L;
 		std::mt19937 mt(seed);
@@ -694,162 +654,317 @@ template<class T, class L, class R, int C, ImageType I> std::basic_ostream<L, R>
 template<class T, int C, ImageType I> Image<T, C, I> operator+(
 		const vec<T, C>& scalar, const Image<T, C, I>& img) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=scalar+val2;};
-	Transform(out, img, f);
+	VecTransform<AddKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
-
 template<class T, int C, ImageType I> Image<T, C, I> operator-(
 		const vec<T, C>& scalar, const Image<T, C, I>& img) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=scalar-val2;};
-	Transform(out, img, f);
+	VecTransform<SubtractKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator*(
 		const vec<T, C>& scalar, const Image<T, C, I>& img) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=scalar*val2;};
-	Transform(out, img, f);
+	VecTransform<MultiplyKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator/(
 		const vec<T, C>& scalar, const Image<T, C, I>& img) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=scalar/val2;};
-	Transform(out, img, f);
+	VecTransform<DivideKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator+(
 		const Image<T, C, I>& img, const vec<T, C>& scalar) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=val2+scalar;};
-	Transform(out, img, f);
+	VecTransform<AddKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator-(
 		const Image<T, C, I>& img, const vec<T, C>& scalar) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=val2-scalar;};
-	Transform(out, img, f);
+	VecTransform<SubtractKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator*(
 		const Image<T, C, I>& img, const vec<T, C>& scalar) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=val2*scalar;};
-	Transform(out, img, f);
+	VecTransform<MultiplyKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator/(
 		const Image<T, C, I>& img, const vec<T, C>& scalar) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=val2/scalar;};
-	Transform(out, img, f);
+	VecTransform<DivideKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator-(
 		const Image<T, C, I>& img) {
 	Image<T, C, I> out(img.width, img.height, img.position());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1=-val2;};
-	Transform(out, img, f);
+	VecTransform<SubtractKernel>(out.data.data(), img.data.data(), vec<T, C>(T(0)), img.size(), true);
 	return out;
 }
-template<class T, int C, ImageType I> Image<T, C, I> operator+=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator+=(
 		Image<T, C, I>& out, const Image<T, C, I>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1+=val2;};
-	Transform(out, img, f);
+	if (out.dimensions() != img.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< out.dimensions() << "!=" << img.dimensions());
+	VecTransform<AddKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
-template<class T, int C, ImageType I> Image<T, C, I> operator-=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator-=(
 		Image<T, C, I>& out, const Image<T, C, I>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1-=val2;};
-	Transform(out, img, f);
+	if (out.dimensions() != img.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< out.dimensions() << "!=" << img.dimensions());
+	VecTransform<SubtractKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
-template<class T, int C, ImageType I> Image<T, C, I> operator*=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator*=(
 		Image<T, C, I>& out, const Image<T, C, I>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1*=val2;};
-	Transform(out, img, f);
+	if (out.dimensions() != img.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< out.dimensions() << "!=" << img.dimensions());
+	VecTransform<MultiplyKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
-template<class T, int C, ImageType I> Image<T, C, I> operator/=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator/=(
 		Image<T, C, I>& out, const Image<T, C, I>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2) {val1/=val2;};
-	Transform(out, img, f);
+	if (out.dimensions() != img.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< out.dimensions() << "!=" << img.dimensions());
+	VecTransform<DivideKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
 
-template<class T, int C, ImageType I> Image<T, C, I> operator+=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator+=(
 		Image<T, C, I>& out, const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T,C>& val1) {val1+=scalar;};
-	Transform(out, f);
+	VecTransform<AddKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
-template<class T, int C, ImageType I> Image<T, C, I> operator-=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator-=(
 		Image<T, C, I>& out, const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T,C>& val1) {val1-=scalar;};
-	Transform(out, f);
+	VecTransform<SubtractKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
-template<class T, int C, ImageType I> Image<T, C, I> operator*=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator*=(
 		Image<T, C, I>& out, const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T,C>& val1) {val1*=scalar;};
-	Transform(out, f);
+	VecTransform<MultiplyKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
-template<class T, int C, ImageType I> Image<T, C, I> operator/=(
+template<class T, int C, ImageType I> Image<T, C, I>& operator/=(
 		Image<T, C, I>& out, const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T,C>& val1) {val1/=scalar;};
-	Transform(out, f);
+	VecTransform<DivideKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
 
 template<class T, int C, ImageType I> Image<T, C, I> operator+(
 		const Image<T, C, I>& img1, const Image<T, C, I>& img2) {
+	if (img1.dimensions() != img2.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< img1.dimensions() << "!=" << img2.dimensions());
 	Image<T, C, I> out(img1.width, img1.height);
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2,const vec<T,C>& val3) {val1=val2+val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<AddKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator-(
 		const Image<T, C, I>& img1, const Image<T, C, I>& img2) {
+	if (img1.dimensions() != img2.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< img1.dimensions() << "!=" << img2.dimensions());
 	Image<T, C, I> out(img1.width, img1.height);
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2,const vec<T,C>& val3) {val1=val2-val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<SubtractKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator*(
 		const Image<T, C, I>& img1, const Image<T, C, I>& img2) {
+	if (img1.dimensions() != img2.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< img1.dimensions() << "!=" << img2.dimensions());
 	Image<T, C, I> out(img1.width, img1.height);
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2,const vec<T,C>& val3) {val1=val2*val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<MultiplyKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 	return out;
 }
 template<class T, int C, ImageType I> Image<T, C, I> operator/(
 		const Image<T, C, I>& img1, const Image<T, C, I>& img2) {
+	if (img1.dimensions() != img2.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< img1.dimensions() << "!=" << img2.dimensions());
 	Image<T, C, I> out(img1.width, img1.height);
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T,C>& val1,const vec<T,C>& val2,const vec<T,C>& val3) {val1=val2/val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<DivideKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 	return out;
 }
+//out = img1 + scalar * img2
+template<class T, int C, ImageType I> void ScaleAdd(Image<T, C, I>& out,
+		const Image<T, C, I>& img1, const vec<T, C>& scalar,
+		const Image<T, C, I>& img2) {
+	if (img1.dimensions() != img2.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< img1.dimensions() << "!=" << img2.dimensions());
+	out.resize(img1.width, img1.height);
+	VecScaleAdd(out.data.data(), img1.data.data(), scalar, img2.data.data(), out.size());
+}
+//out = img1 - scalar * img2
+template<class T, int C, ImageType I> void ScaleSubtract(Image<T, C, I>& out,
+		const Image<T, C, I>& img1, const vec<T, C>& scalar,
+		const Image<T, C, I>& img2) {
+	if (img1.dimensions() != img2.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< img1.dimensions() << "!=" << img2.dimensions());
+	out.resize(img1.width, img1.height);
+	VecScaleAdd(out.data.data(), img1.data.data(), scalar, img2.data.data(), out.size(), true);
+}
+//Sum of products over all pixels and channels.
+template<class T, int C, ImageType I> double dot(const Image<T, C, I>& img1,
+		const Image<T, C, I>& img2) {
+	if (img1.dimensions() != img2.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Image dimensions do not match. "
+						<< img1.dimensions() << "!=" << img2.dimensions());
+	return VecDot(img1.data.data(), img2.data.data(), img1.size());
+}
+template<class T, int C, ImageType I> double lengthSqr(
+		const Image<T, C, I>& img) {
+	return VecDot(img.data.data(), img.data.data(), img.size());
+}
+//Header of a MIPAV .xml/.raw pair. Extents are listed fastest axis first, with channels last.
+struct RawImageHeader {
+	ImageType type;
+	std::vector<int> extents;
+	size_t offset;
+	bool bigEndian;
+	RawImageHeader() :
+			type(ImageType::UNKNOWN), offset(0), bigEndian(false) {
+	}
+};
+size_t GetImageTypeSize(ImageType type);
+RawImageHeader ReadRawImageHeader(const std::string& file);
+//Parses the .xml header and maps the .raw payload of a MIPAV file pair.
+class MappedRawFile {
+protected:
+	MemoryMappedFile file;
+	RawImageHeader header;
+	const char* payload;
+public:
+	MappedRawFile() :
+			payload(nullptr) {
+	}
+	MappedRawFile(const std::string& file) :
+			MappedRawFile() {
+		open(file);
+	}
+	void open(const std::string& file);
+	void close() {
+		file.close();
+		payload = nullptr;
+	}
+	const RawImageHeader& getHeader() const {
+		return header;
+	}
+	const char* data() const {
+		return payload;
+	}
+	//Checks that the payload can be used in place as an array of T.
+	void checkDirectAccess(ImageType type, size_t alignment) const;
+};
+template<class T> T SwapEndian(T val) {
+	uint8_t* bytes = (uint8_t*) &val;
+	std::reverse(bytes, bytes + sizeof(T));
+	return val;
+}
+//Converts planar scalars of type S into interleaved pixels in parallel.
+template<class S, class T, int C> void DeinterleaveRaw(const char* src,
+		vec<T, C>* data, size_t count, bool swap) {
+	const size_t BLOCK = 1 << 16;
+	const int blocks = (int) ((count + BLOCK - 1) / BLOCK);
+	for (int c = 0; c < C; c++) {
+		const char* plane = src + c * count * sizeof(S);
+#pragma omp parallel for
+		for (int b = 0; b < blocks; b++) {
+			size_t end = std::min(count, (b + 1) * BLOCK);
+			for (size_t n = b * BLOCK; n < end; n++) {
+				S val;
+				std::memcpy(&val, plane + n * sizeof(S), sizeof(S));
+				if (swap)
+					val = SwapEndian(val);
+				data[n][c] = (T) val;
+			}
+		}
+	}
+}
+//Reads count pixels from a mapped raw file, converting from the file's scalar type to T.
+template<class T, int C> void ReadRawPlanes(const MappedRawFile& raw,
+		vec<T, C>* data, size_t count) {
+	const char* src = raw.data();
+	bool swap = raw.getHeader().bigEndian;
+	switch (raw.getHeader().type) {
+	case ImageType::BYTE:
+		DeinterleaveRaw<int8_t>(src, data, count, swap);
+		break;
+	case ImageType::UBYTE:
+		DeinterleaveRaw<uint8_t>(src, data, count, swap);
+		break;
+	case ImageType::SHORT:
+		DeinterleaveRaw<int16_t>(src, data, count, swap);
+		break;
+	case ImageType::USHORT:
+		DeinterleaveRaw<uint16_t>(src, data, count, swap);
+		break;
+	case ImageType::INT:
+		DeinterleaveRaw<int32_t>(src, data, count, swap);
+		break;
+	case ImageType::UINT:
+		DeinterleaveRaw<uint32_t>(src, data, count, swap);
+		break;
+	case ImageType::FLOAT:
+		DeinterleaveRaw<float>(src, data, count, swap);
+		break;
+	case ImageType::DOUBLE:
+		DeinterleaveRaw<double>(src, data, count, swap);
+		break;
+	default:
+		throw std::runtime_error("Unsupported raw data type.");
+	}
+}
+//Writes interleaved pixels as planar channels, gathering each slab of up to 16MB before a single fwrite.
+template<class T, int C> bool WriteRawPlanes(FILE* f, const vec<T, C>* data,
+		size_t count) {
+	const size_t SLAB = std::max((size_t) 1, ((size_t) 1 << 24) / sizeof(T));
+	if (C == 1) {
+		const T* ptr = (const T*) data;
+		for (size_t start = 0; start < count; start += SLAB) {
+			size_t n = std::min(SLAB, count - start);
+			if (fwrite(ptr + start, sizeof(T), n, f) != n)
+				return false;
+		}
+		return true;
+	}
+	std::vector<T> buffer(std::min(SLAB, count));
+	for (int c = 0; c < C; c++) {
+		for (size_t start = 0; start < count; start += SLAB) {
+			const int n = (int) std::min(SLAB, count - start);
+			const vec<T, C>* slab = data + start;
+#pragma omp parallel for
+			for (int i = 0; i < n; i++) {
+				buffer[i] = slab[i][c];
+			}
+			if (fwrite(buffer.data(), sizeof(T), n, f) != (size_t) n)
+				return false;
+		}
+	}
+	return true;
+}
 template<class T, int C, ImageType I> void WriteImageToRawFile(
 		const std::string& file, const Image<T, C, I>& img) {
 	std::ostringstream vstr;
@@ -861,15 +976,12 @@ template<class T, int C, ImageType I> void WriteImageToRawFile(
 				MakeString() << "Could not open " << vstr.str().c_str()
 						<< " for writing.");
 	}
-	for (int c = 0; c < img.channels; c++) {
-		for (int j = 0; j < img.height; j++) {
-			for (int i = 0; i < img.width; i++) {
-				T val = img(i, j)[c];
-				fwrite(&val, sizeof(T), 1, f);
-			}
-		}
-	}
+	bool ok = WriteRawPlanes(f, img.data.data(), img.size());
 	fclose(f);
+	if (!ok) {
+		throw std::runtime_error(
+				MakeString() << "Could not write " << vstr.str());
+	}
 	std::string typeName = "";
 	switch (img.type) {
 	case ImageType::BYTE:
@@ -948,6 +1060,58 @@ template<class T, int C, ImageType I> void WriteImageToRawFile(
 	myfile << sstr.str();
 	myfile.close();
 }
+//Reads a MIPAV .xml/.raw pair written by WriteImageToRawFile. Scalars are converted to T if the file type differs.
+template<class T, int C, ImageType I> void ReadImageFromRawFile(
+		const std::string& file, Image<T, C, I>& img) {
+	MappedRawFile raw(file);
+	const std::vector<int>& extents = raw.getHeader().extents;
+	int channels = (extents.size() > 2) ? extents[2] : 1;
+	if (channels != C) {
+		throw std::runtime_error(
+				MakeString() << "Channel count in " << file << " (" << channels
+						<< ") does not match image (" << C << ").");
+	}
+	img.resize(extents[0], (extents.size() > 1) ? extents[1] : 1);
+	ReadRawPlanes(raw, img.data.data(), img.size());
+}
+//Zero-copy view of a raw image stored with scalar type T. Each channel is a contiguous plane of the mapped file.
+template<class T, ImageType I> class MappedImage {
+protected:
+	MappedRawFile raw;
+	const T* ptr;
+public:
+	int width;
+	int height;
+	int channels;
+	MappedImage() :
+			ptr(nullptr), width(0), height(0), channels(0) {
+	}
+	MappedImage(const std::string& file) :
+			MappedImage() {
+		open(file);
+	}
+	void open(const std::string& file) {
+		raw.open(file);
+		raw.checkDirectAccess(I, alignof(T));
+		const std::vector<int>& extents = raw.getHeader().extents;
+		width = extents[0];
+		height = (extents.size() > 1) ? extents[1] : 1;
+		channels = (extents.size() > 2) ? extents[2] : 1;
+		ptr = (const T*) raw.data();
+	}
+	size_t size() const {
+		return (size_t) width * height;
+	}
+	int2 dimensions() const {
+		return int2(width, height);
+	}
+	const T* channel(int c) const {
+		return ptr + c * size();
+	}
+	const T& operator()(int i, int j, int c = 0) const {
+		return ptr[i + (size_t) j * width + c * size()];
+	}
+};
 typedef Image<uint8_t, 4, ImageType::UBYTE> ImageRGBA;
 typedef Image<int, 4, ImageType::INT> ImageRGBAi;
 typedef Image<float, 4, ImageType::FLOAT> ImageRGBAf;
@@ -1159,52 +1323,117 @@ template<class T, int C, ImageType I> void FlipHorizontal(Image<T, C, I>& in) {
 		}
 	}
 }
+/*
+ Burt, P. J., & Adelson, E. H. (1983). The Laplacian pyramid as a compact image code. IEEE Transactions on
+ Communications, 31(4), 532-540.
+
+ The binomial kernel is applied as separable passes. Input rows are first blended into a row buffer with padding on
+ both ends, so only row indices and the padding are clamped. Output rows are independent and processed in parallel.
+ */
+//Row pass of DownSample. row holds width values with two writable entries before and after.
+template<class A, class T, int C> void ReduceRow(vec<A, C>* row, int width, vec<T, C>* dest, int n) {
+	const A k0 = A(6.0 / 16.0), k1 = A(4.0 / 16.0), k2 = A(1.0 / 16.0);
+	row[-2] = row[-1] = row[0];
+	row[width] = row[width + 1] = row[width - 1];
+	for (int i = 0; i < n; i++) {
+		const vec<A, C>* s = row + 2 * i;
+		dest[i] = vec<T, C>(k2 * (s[-2] + s[2]) + k1 * (s[-1] + s[1]) + k0 * s[0]);
+	}
+}
+//Row pass of UpSample. Even outputs take taps 1,6,1 and odd outputs 4,4 from the coarse row, which has one writable
+//entry before and after.
+template<class A, class T, int C> void ExpandRow(vec<A, C>* row, int width, vec<T, C>* dest, int n) {
+	const A k0 = A(6.0 / 8.0), k1 = A(1.0 / 8.0), k2 = A(0.5);
+	row[-1] = row[0];
+	row[width] = row[width - 1];
+	//Past 2*width every tap clamps to the last coarse value.
+	const int inner = std::min(n, 2 * width);
+	for (int i = 0; i < inner; i++) {
+		const vec<A, C>* s = row + i / 2;
+		dest[i] = (i % 2 == 0) ? vec<T, C>(k1 * (s[-1] + s[1]) + k0 * s[0]) : vec<T, C>(k2 * (s[0] + s[1]));
+	}
+	for (int i = inner; i < n; i++) {
+		dest[i] = vec<T, C>(row[width - 1]);
+	}
+}
+//Column pass of DownSample, blending the five rows around 2*j.
+template<class A, class T, int C> void ReduceColumns(const vec<T, C>* data, int width, int height, int j, vec<A, C>* row) {
+	typedef vec<A, C> V;
+	const A k0 = A(6.0 / 16.0), k1 = A(4.0 / 16.0), k2 = A(1.0 / 16.0);
+	const vec<T, C>* r[5];
+	for (int jj = 0; jj < 5; jj++) {
+		r[jj] = data + (size_t) clamp(2 * j + jj - 2, 0, height - 1) * width;
+	}
+	for (int x = 0; x < width; x++) {
+		row[x] = k2 * (V(r[0][x]) + V(r[4][x])) + k1 * (V(r[1][x]) + V(r[3][x])) + k0 * V(r[2][x]);
+	}
+}
+//Column pass of UpSample for output row j.
+template<class A, class T, int C> void ExpandColumns(const vec<T, C>* data, int width, int height, int j, vec<A, C>* row) {
+	typedef vec<A, C> V;
+	const A k0 = A(6.0 / 8.0), k1 = A(1.0 / 8.0), k2 = A(0.5);
+	const int m = j / 2;
+	const vec<T, C>* r0 = data + (size_t) clamp(m - 1, 0, height - 1) * width;
+	const vec<T, C>* r1 = data + (size_t) clamp(m, 0, height - 1) * width;
+	const vec<T, C>* r2 = data + (size_t) clamp(m + 1, 0, height - 1) * width;
+	if (j % 2 == 0) {
+		for (int x = 0; x < width; x++) {
+			row[x] = k1 * (V(r0[x]) + V(r2[x])) + k0 * V(r1[x]);
+		}
+	} else {
+		for (int x = 0; x < width; x++) {
+			row[x] = k2 * (V(r1[x]) + V(r2[x]));
+		}
+	}
+}
 template<class T, int C, ImageType I> void DownSample(const Image<T, C, I>& in,
 		Image<T, C, I>& out) {
-	static const double Kernel[5][5] = { { 1, 4, 6, 4, 1 },
-			{ 4, 16, 24, 16, 4 }, { 6, 24, 36, 24, 6 }, { 4, 16, 24, 16, 4 }, {
-					1, 4, 6, 4, 1 } };
+	typedef typename FilterAccumulator<T>::type A;
 	out.resize(in.width / 2, in.height / 2);
-#pragma omp parallel for
-	for (int i = 0; i < out.width; i++) {
+	if (out.width == 0 || out.height == 0)
+		return;
+#pragma omp parallel
+	{
+		std::vector<vec<A, C>> buffer(in.width + 4);
+#pragma omp for
 		for (int j = 0; j < out.height; j++) {
-			vec<double, C> vsum(0.0);
-			for (int ii = 0; ii < 5; ii++) {
-				for (int jj = 0; jj < 5; jj++) {
-					vsum += Kernel[ii][jj]
-							* vec<double, C>(
-									in(2 * i + ii - 2, 2 * j + jj - 2));
-				}
-			}
-			out(i, j) = vec<T, C>(vsum / 256.0);
+			ReduceColumns(in.data.data(), in.width, in.height, j, buffer.data() + 2);
+			ReduceRow(buffer.data() + 2, in.width, &out.data[(size_t) j * out.width], out.width);
 		}
 	}
 }
 template<class T, int C, ImageType I> void UpSample(const Image<T, C, I>& in,
 		Image<T, C, I>& out) {
-	static const double Kernel[5][5] = { { 1, 4, 6, 4, 1 },
-			{ 4, 16, 24, 16, 4 }, { 6, 24, 36, 24, 6 }, { 4, 16, 24, 16, 4 }, {
-					1, 4, 6, 4, 1 } };
+	typedef typename FilterAccumulator<T>::type A;
 	if (out.size() == 0)
 		out.resize(in.width * 2, in.height * 2);
-#pragma omp parallel for
-	for (int i = 0; i < out.width; i++) {
+	if (in.width == 0 || in.height == 0)
+		return;
+#pragma omp parallel
+	{
+		std::vector<vec<A, C>> buffer(in.width + 2);
+#pragma omp for
 		for (int j = 0; j < out.height; j++) {
-			vec<double, C> vsum(0.0);
-			for (int ii = 0; ii < 5; ii++) {
-				for (int jj = 0; jj < 5; jj++) {
-					int iii = i + ii - 2;
-					int jjj = j + jj - 2;
-					if (iii % 2 == 0 && jjj % 2 == 0) {
-						vsum += Kernel[ii][jj]
-								* vec<double, C>(in(iii / 2, jjj / 2));
-					}
-				}
-			}
-			out(i, j) = vec<T, C>(vsum / 64.0);
+			ExpandColumns(in.data.data(), in.width, in.height, j, buffer.data() + 1);
+			ExpandRow(buffer.data() + 1, in.width, &out.data[(size_t) j * out.width], out.width);
 		}
 	}
 }
+//Level 0 is a copy of the input and each following level is DownSample() of the previous one. Stops early when a level
+//would be narrower or shorter than minSize.
+template<class T, int C, ImageType I> void GaussianPyramid(const Image<T, C, I>& in,
+		std::vector<Image<T, C, I>>& pyramid, int levels, int minSize = 1) {
+	pyramid.resize(1);
+	pyramid[0] = in;
+	while ((int) pyramid.size() < levels) {
+		const Image<T, C, I>& last = pyramid.back();
+		if (last.width / 2 < minSize || last.height / 2 < minSize)
+			break;
+		Image<T, C, I> next;
+		DownSample(last, next);
+		pyramid.push_back(std::move(next));
+	}
+}
 template<class T, int C, ImageType I> void Set(const Image<T, C, I>& in,
 		Image<T, C, I>& out, int2 pos) {
 	for (int i = 0; i < in.width; i++) {
@@ -4,6 +4,7 @@
 #include <AlloyImage.h>
 #include <array>
 namespace aly {
+	bool SANITY_CHECK_DAISY();
 	namespace daisy {
 		inline void point_transform_via_homography(float* H, float x, float y, float &u, float &v)
 		{
@@ -226,6 +227,67 @@ namespace aly {
 				return out;
 			}
 		};
+		//Descriptors for every pixel stored back to back in one aligned array. Each descriptor starts on a cache line and
+		//is padded with zeros to a multiple of 16 floats.
+		class DenseDescriptorField {
+		protected:
+			std::vector<float, AlignedAllocator<float>> data;
+		public:
+			int width, height;
+			int descriptorSize;
+			int stride;
+			DenseDescriptorField(int w = 0, int h = 0, int sz = 0) :width(0), height(0), descriptorSize(0), stride(0) {
+				resize(w, h, sz);
+			}
+			size_t size() const {
+				return (size_t)width * height;
+			}
+			void resize(int w, int h, int sz) {
+				width = w;
+				height = h;
+				descriptorSize = sz;
+				stride = (sz + 15) / 16 * 16;
+				data.assign((size_t)w * h * stride, 0.0f);
+				data.shrink_to_fit();
+			}
+			inline void clear() {
+				data.clear();
+				data.shrink_to_fit();
+				width = 0;
+				height = 0;
+				descriptorSize = 0;
+				stride = 0;
+			}
+			float* ptr() {
+				if (data.size() == 0)
+					return nullptr;
+				return data.data();
+			}
+			const float* ptr() const {
+				if (data.size() == 0)
+					return nullptr;
+				return data.data();
+			}
+			float* operator[](const size_t i) {
+				return &data[i * stride];
+			}
+			const float* operator[](const size_t i) const {
+				return &data[i * stride];
+			}
+			float* operator()(int i, int j) {
+				return &data[((size_t)clamp(i, 0, width - 1) + (size_t)clamp(j, 0, height - 1) * width) * stride];
+			}
+			const float* operator()(int i, int j) const {
+				return &data[((size_t)clamp(i, 0, width - 1) + (size_t)clamp(j, 0, height - 1) * width) * stride];
+			}
+			void get(int i, int j, Descriptor& out) const {
+				const float* desc = operator()(i, j);
+				out.assign(desc, desc + descriptorSize);
+			}
+		};
+		inline double dot(const DenseDescriptorField& a, int2 pa, const DenseDescriptorField& b, int2 pb) {
+			return SIMDDot(a(pa.x, pa.y), b(pb.x, pb.y), std::min(a.descriptorSize, b.descriptorSize));
+		}
 		class Daisy {
 		protected:
 			static const float sigma_0;
@@ -269,6 +331,10 @@ namespace aly {
 			void normalizePartial(Descriptor& desc);
 			void normalizeFull(Descriptor& desc);
 			void normalizeDescriptor(Descriptor& desc, Normalization nrm_type);
+			void normalizeSiftWay(float* desc, int size);
+			void normalizePartial(float* desc);
+			void normalizeFull(float* desc, int size);
+			void normalizeDescriptor(float* desc, int size, Normalization nrm_type);
 			void computeHistogram(const LayeredImage& hcube, int x, int y, std::vector<float>& histogram);
 			void i_get_descriptor(float x,float y, int orientation, Descriptor& descriptor);
 			void i_get_histogram(std::vector<float>& histogram, float x, float y, float shift, const std::vector<OrientationLayer >& cube);
@@ -276,12 +342,20 @@ namespace aly {
 			void ti_get_histogram(std::vector<float>& histogram, float x, float y, float shift, const std::vector<OrientationLayer >& cube);
 			void ni_get_histogram(std::vector<float>& histogram, int x, int y, int shift, const std::vector<OrientationLayer >& hcube);
 			void ni_get_descriptor(float x, float y, int orientation, Descriptor& descriptor);
+			void computeOrientationMap(Image1i& orientMap, bool scaleInvariant, bool rotationInvariant);
+			void interleaveLayers(const LayeredImage& layers, std::vector<float>& out);
+			void sampleHistogram(const float* cube, float x, float y, float shift, float* histogram, float* buffer);
+			void sampleNearestHistogram(const float* cube, int x, int y, int shift, float* histogram);
+			void getDenseDescriptor(int x, int y, int orientation, const std::vector<const float*>& cubes, float* descriptor, float* buffer, bool disableInterpolation);
 			void initialize();
 
 		public:
 			Daisy(int orientationResolutions=8);
 			void initialize(const ImageRGBAf& image, float descriptorRadius=15.0f, int radiusBins=3, int angleBins=8, int histogramBins=8);
 			void getDescriptors(DescriptorField& descriptorField, Normalization  normalizationType = Normalization::Sift, bool scaleInvariant=false, bool rotationInartiant=true, bool disableInterpolation=false);
+			//Dense extraction into one contiguous array. Layers are interleaved so each histogram is a contiguous load,
+			//and the image is processed in tiles across threads.
+			void getDescriptors(DenseDescriptorField& descriptorField, Normalization  normalizationType = Normalization::Sift, bool scaleInvariant = false, bool rotationInartiant = true, bool disableInterpolation = false);
 			void getDescriptor(float i, float j,Descriptor& out, int orientation=0, Normalization normalizationType=Normalization::Sift,bool disableInterpolation = false);
 		};
 	}
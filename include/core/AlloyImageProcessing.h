@@ -21,6 +21,7 @@
 #ifndef INCLUDE_ALLOYIMAGEPROCESSING_H_
 #define INCLUDE_ALLOYIMAGEPROCESSING_H_
 #include "AlloyImage.h"
+#include <limits>
 namespace aly {
 bool SANITY_CHECK_IMAGE_PROCESSING();
 template<class T, size_t M, size_t N> void GaussianKernel(T (&kernel)[M][N],
@@ -138,32 +139,325 @@ template<class T, size_t M, size_t N> struct GaussianOperators {
 		}
 	}
 };
-template<size_t M, size_t N, class T, int C, ImageType I> void Gradient(
-		const Image<T, C, I>& image, Image<T, C, I>& gX, Image<T, C, I>& gY, double sigmaX = (0.607902736 * (M - 1) * 0.5),
-	double sigmaY = (0.607902736 * (N - 1) * 0.5)) {
-
-	double filterX[M][N], filterY[M][N];
-	GaussianKernelDerivative(filterX, filterY,sigmaX,sigmaY);
-
-	gX.resize(image.width, image.height);
-	gY.resize(image.width, image.height);
-#pragma omp parallel for
-	for (int j = 0; j < image.height; j++) {
-		for (int i = 0; i < image.width; i++) {
-			vec<double, C> vsumX(0.0);
-			vec<double, C> vsumY(0.0);
-			for (int ii = 0; ii < (int)M; ii++) {
-				for (int jj = 0; jj < (int)N; jj++) {
-					vec<T, C> val = image(i + ii - (int)M / 2, j + jj - (int)N / 2);
-					vsumX += filterX[ii][jj] * vec<double, C>(val);
-					vsumY += filterY[ii][jj] * vec<double, C>(val);
+inline int GaussianRadius(double sigma) {
+	return std::max(1, (int)std::ceil(3.0 * sigma));
+}
+//1D kernels are indexed by offset + radius and sampled at integer offsets, like the 2D kernels above.
+template<class T> void GaussianKernel1D(std::vector<T>& kernel, double sigma, int radius) {
+	kernel.resize(2 * radius + 1);
+	double sum = 0;
+	for (int k = -radius; k <= radius; k++) {
+		double xn = k / sigma;
+		double w = std::exp(-0.5 * xn * xn);
+		kernel[k + radius] = T(w);
+		sum += w;
+	}
+	for (T& w : kernel) {
+		w = T(w / sum);
+	}
+}
+template<class T> void GaussianKernelDerivative1D(std::vector<T>& kernel, double sigma, int radius) {
+	kernel.resize(2 * radius + 1);
+	double sum = 0;
+	for (int k = -radius; k <= radius; k++) {
+		double xn = k / sigma;
+		double w = std::exp(-0.5 * xn * xn);
+		kernel[k + radius] = T(w * xn / sigma);
+		sum += w;
+	}
+	for (T& w : kernel) {
+		w = T(w / sum);
+	}
+}
+//Second derivative of a Gaussian with its DC component removed, so constant regions have zero response.
+template<class T> void GaussianKernelLaplacian1D(std::vector<T>& kernel, double sigma, int radius) {
+	kernel.resize(2 * radius + 1);
+	std::vector<double> g(2 * radius + 1), gxx(2 * radius + 1);
+	double sum = 0, sum2 = 0;
+	for (int k = -radius; k <= radius; k++) {
+		double xn = k / sigma;
+		double w = std::exp(-0.5 * xn * xn);
+		g[k + radius] = w;
+		gxx[k + radius] = w * (xn * xn - 1.0) / (sigma * sigma);
+		sum += w;
+		sum2 += gxx[k + radius];
+	}
+	for (int k = 0; k < (int)kernel.size(); k++) {
+		kernel[k] = T((gxx[k] - sum2 * g[k] / sum) / sum);
+	}
+}
+//Correlates every row with kernel. Each row is copied into a border-padded buffer so the inner loop does not clamp.
+template<class A, class S, int C> void FilterRows(const vec<S, C>* in, int width, int height, const std::vector<A>& kernel, vec<A, C>* out) {
+	const int radius = (int)kernel.size() / 2;
+	const int ksize = (int)kernel.size();
+#pragma omp parallel
+	{
+		std::vector<vec<A, C>> padded(width + 2 * radius);
+#pragma omp for
+		for (int j = 0; j < height; j++) {
+			const vec<S, C>* row = in + (size_t)j * width;
+			for (int i = -radius; i < width + radius; i++) {
+				padded[i + radius] = vec<A, C>(row[clamp(i, 0, width - 1)]);
+			}
+			vec<A, C>* dest = out + (size_t)j * width;
+			for (int i = 0; i < width; i++) {
+				const vec<A, C>* src = &padded[i];
+				vec<A, C> sum = kernel[0] * src[0];
+				for (int k = 1; k < ksize; k++) {
+					sum += kernel[k] * src[k];
 				}
+				dest[i] = sum;
 			}
-			gX(i, j) = vec<T, C>(vsumX);
-			gY(i, j) = vec<T, C>(vsumY);
 		}
 	}
 }
+//Correlates every column with kernel by accumulating whole rows, which keeps memory access contiguous.
+template<class A, class D, int C> void FilterColumns(const vec<A, C>* in, int width, int height, const std::vector<A>& kernel, vec<D, C>* out) {
+	const int radius = (int)kernel.size() / 2;
+	const int ksize = (int)kernel.size();
+#pragma omp parallel
+	{
+		std::vector<vec<A, C>> sum(width);
+#pragma omp for
+		for (int j = 0; j < height; j++) {
+			const vec<A, C>* row = in + (size_t)clamp(j - radius, 0, height - 1) * width;
+			for (int i = 0; i < width; i++) {
+				sum[i] = kernel[0] * row[i];
+			}
+			for (int k = 1; k < ksize; k++) {
+				row = in + (size_t)clamp(j + k - radius, 0, height - 1) * width;
+				const A w = kernel[k];
+				for (int i = 0; i < width; i++) {
+					sum[i] += w * row[i];
+				}
+			}
+			vec<D, C>* dest = out + (size_t)j * width;
+			for (int i = 0; i < width; i++) {
+				dest[i] = vec<D, C>(sum[i]);
+			}
+		}
+	}
+}
+template<class T, int C, ImageType I> void SeparableFilter(const Image<T, C, I>& image, Image<T, C, I>& out,
+		const std::vector<typename FilterAccumulator<T>::type>& rowKernel, const std::vector<typename FilterAccumulator<T>::type>& columnKernel) {
+	typedef typename FilterAccumulator<T>::type A;
+	std::vector<vec<A, C>> tmp(image.size());
+	FilterRows(image.data.data(), image.width, image.height, rowKernel, tmp.data());
+	out.resize(image.width, image.height);
+	FilterColumns(tmp.data(), image.width, image.height, columnKernel, out.data.data());
+}
+/*
+ * Recursive Gaussian filter from I. T. Young and L. J. van Vliet, "Recursive implementation of the Gaussian filter",
+ * Signal Processing 44, 1995, with the boundary conditions of B. Triggs and M. Sdika, "Boundary conditions for
+ * Young-van Vliet recursive filtering", IEEE Trans. Signal Processing 54, 2006. Cost per pixel is independent of sigma.
+ * The image is extended by replicating its border. Valid for sigma >= 0.5.
+ */
+struct RecursiveGaussianCoefficients {
+	double a1, a2, a3;
+	double scale;
+	double M[9];
+	RecursiveGaussianCoefficients(double sigma) {
+		sigma = std::max(sigma, 0.5);
+		double q = (sigma >= 2.5) ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+		double q2 = q * q, q3 = q2 * q;
+		double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+		a1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+		a2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+		a3 = (0.422205 * q3) / b0;
+		double B = 1.0 - (a1 + a2 + a3);
+		scale = B * B;
+		double s = 1.0 / ((1.0 + a1 - a2 + a3) * (1.0 - a1 - a2 - a3) * (1.0 + a2 + (a1 - a3) * a3));
+		M[0] = s * (-a3 * a1 + 1.0 - a3 * a3 - a2);
+		M[1] = s * (a3 + a1) * (a2 + a3 * a1);
+		M[2] = s * a3 * (a1 + a3 * a2);
+		M[3] = s * (a1 + a3 * a2);
+		M[4] = -s * (a2 - 1.0) * (a2 + a3 * a1);
+		M[5] = -s * (a3 * a1 + a3 * a3 + a2 - 1.0) * a3;
+		M[6] = s * (a3 * a1 + a2 + a1 * a1 - a2 * a2);
+		M[7] = s * (a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3);
+		M[8] = s * a3 * (a1 + a3 * a2);
+	}
+	//Steady state of the causal pass for a constant signal.
+	template<class A, int C> vec<A, C> causalInit(const vec<A, C>& x) const {
+		return x / A(1.0 - a1 - a2 - a3);
+	}
+	//Anti-causal values just past the end of the line, given the last input and the last three causal outputs.
+	template<class A, int C> void anticausalInit(const vec<A, C>& xLast, const vec<A, C>& u0, const vec<A, C>& u1, const vec<A, C>& u2,
+			vec<A, C>& v0, vec<A, C>& v1, vec<A, C>& v2) const {
+		typedef vec<A, C> V;
+		const V uplus = xLast / A(1.0 - a1 - a2 - a3);
+		const V vplus = uplus / A(1.0 - a1 - a2 - a3);
+		const V d0 = u0 - uplus, d1 = u1 - uplus, d2 = u2 - uplus;
+		v0 = A(M[0]) * d0 + A(M[1]) * d1 + A(M[2]) * d2 + vplus;
+		v1 = A(M[3]) * d0 + A(M[4]) * d1 + A(M[5]) * d2 + vplus;
+		v2 = A(M[6]) * d0 + A(M[7]) * d1 + A(M[8]) * d2 + vplus;
+	}
+};
+//Filters a line of n samples in place. Lines shorter than three samples are left unfiltered.
+template<class A, int C> void RecursiveGaussianLine(vec<A, C>* line, int n, const RecursiveGaussianCoefficients& coeff) {
+	typedef vec<A, C> V;
+	if (n < 3)
+		return;
+	const A a1 = A(coeff.a1), a2 = A(coeff.a2), a3 = A(coeff.a3);
+	const V xLast = line[n - 1];
+	V u1 = coeff.causalInit(line[0]), u2 = u1, u3 = u1;
+	for (int i = 0; i < n; i++) {
+		V u = line[i] + a1 * u1 + a2 * u2 + a3 * u3;
+		u3 = u2;
+		u2 = u1;
+		u1 = u;
+		line[i] = u;
+	}
+	V v1, v2, v3;
+	coeff.anticausalInit(xLast, line[n - 1], line[n - 2], line[n - 3], v1, v2, v3);
+	line[n - 1] = v1;
+	for (int i = n - 2; i >= 0; i--) {
+		V v = line[i] + a1 * v1 + a2 * v2 + a3 * v3;
+		v3 = v2;
+		v2 = v1;
+		v1 = v;
+		line[i] = v;
+	}
+	const A scale = A(coeff.scale);
+	for (int i = 0; i < n; i++) {
+		line[i] *= scale;
+	}
+}
+//The recursion runs in double precision because its poles approach 1 as sigma grows.
+template<class T, int C, ImageType I> void SmoothRecursive(const Image<T, C, I>& image, Image<T, C, I>& B, double sigmaX, double sigmaY) {
+	typedef typename FilterAccumulator<T>::type A;
+	typedef vec<double, C> V;
+	const int width = image.width;
+	const int height = image.height;
+	std::vector<vec<A, C>> tmp(image.size());
+	RecursiveGaussianCoefficients coeffX(sigmaX), coeffY(sigmaY);
+#pragma omp parallel
+	{
+		std::vector<V> line(width);
+#pragma omp for
+		for (int j = 0; j < height; j++) {
+			const vec<T, C>* row = &image.data[(size_t)j * width];
+			for (int i = 0; i < width; i++) {
+				line[i] = V(row[i]);
+			}
+			RecursiveGaussianLine(line.data(), width, coeffX);
+			vec<A, C>* dest = &tmp[(size_t)j * width];
+			for (int i = 0; i < width; i++) {
+				dest[i] = vec<A, C>(line[i]);
+			}
+		}
+	}
+	B.resize(width, height);
+	//Columns are filtered in blocks so each step of the recursion reads contiguous memory.
+	const int BLOCK = 32;
+	const int blocks = (width + BLOCK - 1) / BLOCK;
+	const double a1 = coeffY.a1, a2 = coeffY.a2, a3 = coeffY.a3;
+#pragma omp parallel
+	{
+		std::vector<V> block((size_t)BLOCK * height);
+		std::vector<V> w1(BLOCK), w2(BLOCK), w3(BLOCK), x(BLOCK);
+#pragma omp for
+		for (int b = 0; b < blocks; b++) {
+			const int start = b * BLOCK;
+			const int bw = std::min(start + BLOCK, width) - start;
+			for (int j = 0; j < height; j++) {
+				for (int k = 0; k < bw; k++) {
+					block[(size_t)j * bw + k] = V(tmp[(size_t)j * width + start + k]);
+				}
+			}
+			if (height >= 3) {
+				for (int k = 0; k < bw; k++) {
+					x[k] = block[(size_t)(height - 1) * bw + k];
+					w1[k] = w2[k] = w3[k] = coeffY.causalInit(block[k]);
+				}
+				for (int j = 0; j < height; j++) {
+					V* row = &block[(size_t)j * bw];
+					for (int k = 0; k < bw; k++) {
+						V w = row[k] + a1 * w1[k] + a2 * w2[k] + a3 * w3[k];
+						w3[k] = w2[k];
+						w2[k] = w1[k];
+						w1[k] = w;
+						row[k] = w;
+					}
+				}
+				V* last = &block[(size_t)(height - 1) * bw];
+				const V* last1 = &block[(size_t)(height - 2) * bw];
+				const V* last2 = &block[(size_t)(height - 3) * bw];
+				for (int k = 0; k < bw; k++) {
+					coeffY.anticausalInit(x[k], last[k], last1[k], last2[k], w1[k], w2[k], w3[k]);
+					last[k] = w1[k];
+				}
+				for (int j = height - 2; j >= 0; j--) {
+					V* row = &block[(size_t)j * bw];
+					for (int k = 0; k < bw; k++) {
+						V w = row[k] + a1 * w1[k] + a2 * w2[k] + a3 * w3[k];
+						w3[k] = w2[k];
+						w2[k] = w1[k];
+						w1[k] = w;
+						row[k] = w;
+					}
+				}
+			}
+			const double scale = (height >= 3) ? coeffY.scale : 1.0;
+			for (int j = 0; j < height; j++) {
+				for (int k = 0; k < bw; k++) {
+					B.data[(size_t)j * width + start + k] = vec<T, C>(scale * block[(size_t)j * bw + k]);
+				}
+			}
+		}
+	}
+}
+template<class T, int C, ImageType I> void SmoothSeparable(const Image<T, C, I>& image, Image<T, C, I>& B, double sigmaX, double sigmaY) {
+	std::vector<typename FilterAccumulator<T>::type> kernelX, kernelY;
+	GaussianKernel1D(kernelX, sigmaX, GaussianRadius(sigmaX));
+	GaussianKernel1D(kernelY, sigmaY, GaussianRadius(sigmaY));
+	SeparableFilter(image, B, kernelX, kernelY);
+}
+template<class T, int C, ImageType I> void GradientSeparable(const Image<T, C, I>& image, Image<T, C, I>& gX, Image<T, C, I>& gY,
+		double sigmaX, double sigmaY) {
+	std::vector<typename FilterAccumulator<T>::type> kernelX, kernelY, derivX, derivY;
+	GaussianKernel1D(kernelX, sigmaX, GaussianRadius(sigmaX));
+	GaussianKernel1D(kernelY, sigmaY, GaussianRadius(sigmaY));
+	GaussianKernelDerivative1D(derivX, sigmaX, GaussianRadius(sigmaX));
+	GaussianKernelDerivative1D(derivY, sigmaY, GaussianRadius(sigmaY));
+	SeparableFilter(image, gX, derivX, kernelY);
+	SeparableFilter(image, gY, kernelX, derivY);
+}
+template<class T, int C, ImageType I> void LaplacianSeparable(const Image<T, C, I>& image, Image<T, C, I>& L, double sigmaX, double sigmaY) {
+	typedef typename FilterAccumulator<T>::type A;
+	std::vector<A> kernelX, kernelY, laplaceX, laplaceY;
+	GaussianKernel1D(kernelX, sigmaX, GaussianRadius(sigmaX));
+	GaussianKernel1D(kernelY, sigmaY, GaussianRadius(sigmaY));
+	GaussianKernelLaplacian1D(laplaceX, sigmaX, GaussianRadius(sigmaX));
+	GaussianKernelLaplacian1D(laplaceY, sigmaY, GaussianRadius(sigmaY));
+	const int width = image.width;
+	const int height = image.height;
+	std::vector<vec<A, C>> tmp(image.size()), Lxx(image.size()), Lyy(image.size());
+	FilterRows(image.data.data(), width, height, laplaceX, tmp.data());
+	FilterColumns(tmp.data(), width, height, kernelY, Lxx.data());
+	FilterRows(image.data.data(), width, height, kernelX, tmp.data());
+	FilterColumns(tmp.data(), width, height, laplaceY, Lyy.data());
+	L.resize(width, height);
+#pragma omp parallel for
+	for (int j = 0; j < height; j++) {
+		for (int i = 0; i < width; i++) {
+			size_t idx = (size_t)j * width + i;
+			L.data[idx] = vec<T, C>(Lxx[idx] + Lyy[idx]);
+		}
+	}
+}
+template<size_t M, size_t N, class T, int C, ImageType I> void Gradient(
+		const Image<T, C, I>& image, Image<T, C, I>& gX, Image<T, C, I>& gY, double sigmaX = (0.607902736 * (M - 1) * 0.5),
+	double sigmaY = (0.607902736 * (N - 1) * 0.5)) {
+	//The Gaussian derivative kernel is separable, so it is applied as a row pass followed by a column pass.
+	std::vector<typename FilterAccumulator<T>::type> kernelX, kernelY, derivX, derivY;
+	GaussianKernel1D(kernelX, sigmaX, (int)M / 2);
+	GaussianKernel1D(kernelY, sigmaY, (int)N / 2);
+	GaussianKernelDerivative1D(derivX, sigmaX, (int)M / 2);
+	GaussianKernelDerivative1D(derivY, sigmaY, (int)N / 2);
+	SeparableFilter(image, gX, derivX, kernelY);
+	SeparableFilter(image, gY, kernelX, derivY);
+}
 template<size_t M, size_t N, class T, int C, ImageType I> void Laplacian(
 		const Image<T, C, I>& image, Image<T, C, I>& L, double sigmaX = (0.607902736 * (M - 1) * 0.5),
 	double sigmaY = (0.607902736 * (N - 1) * 0.5)) {
@@ -187,57 +481,19 @@ template<size_t M, size_t N, class T, int C, ImageType I> void Laplacian(
 template<size_t M, size_t N, class T, int C, ImageType I> void Smooth(
 		const Image<T, C, I>& image, Image<T, C, I>& B, double sigmaX = (0.607902736 * (M - 1) * 0.5),
 	double sigmaY = (0.607902736 * (N - 1) * 0.5)) {
-	double filter[M][N];
-	GaussianKernel(filter,sigmaX,sigmaY);
-	B.resize(image.width, image.height);
-#pragma omp parallel for
-	for (int j = 0; j < image.height; j++) {
-		for (int i = 0; i < image.width; i++) {
-			vec<double, C> vsum(0.0);
-			for (int ii = 0; ii < (int)M; ii++) {
-				for (int jj = 0; jj < (int)N; jj++) {
-					vec<T, C> val = image(i + ii - (int)M / 2, j + jj - (int)N / 2);
-					vsum += filter[ii][jj] * vec<double, C>(val);
-				}
-			}
-			B(i, j) = vec<T, C>(vsum);
-		}
-	}
+	std::vector<typename FilterAccumulator<T>::type> kernelX, kernelY;
+	GaussianKernel1D(kernelX, sigmaX, (int)M / 2);
+	GaussianKernel1D(kernelY, sigmaY, (int)N / 2);
+	SeparableFilter(image, B, kernelX, kernelY);
 }
+//Separable convolution for small sigma, constant cost recursive filtering for large sigma.
 template<class T, int C, ImageType I> void Smooth(const Image<T, C, I>& image, Image<T, C, I>& B,double sigmaX,double sigmaY) {
 	double sigma = std::max(sigmaX, sigmaY);
-	if (sigma < 1.5f) {
-		Smooth<3, 3>(image, B,sigmaX, sigmaY);
-	}
-	else if (sigma < 2.5f) {
-		Smooth<5, 5>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 3.5f) {
-		Smooth<7, 7>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 5.5f) {
-		Smooth<11, 11>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 6.5f) {
-		Smooth<13, 13>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 7.5f) {
-		Smooth<15, 15>(image, B, sigmaX, sigmaY);
+	if (sigma < 3.0) {
+		SmoothSeparable(image, B, sigmaX, sigmaY);
 	}
-	else if (sigma < 8.5f) {
-		Smooth<17, 17>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 9.5f) {
-		Smooth<19, 19>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 10.5f) {
-		Smooth<21, 21>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 11.5f) {
-		Smooth<23, 23>(image, B, sigmaX, sigmaY);
-	}
-	else if (sigma < 12.5f) {
-		Smooth<25, 25>(image, B, sigmaX, sigmaY);
+	else {
+		SmoothRecursive(image, B, sigmaX, sigmaY);
 	}
 }
 template<class T, int C, ImageType I> void Smooth3x3(
@@ -291,6 +547,185 @@ template<class T, int C, ImageType I> void Gradient11x11(
 	Gradient<11, 11>(image, gX, gY);
 }
 
+/*
+ Burt, P. J., & Adelson, E. H. (1983). A multiresolution spline with application to image mosaics. ACM Transactions
+ on Graphics, 2(4), 217-236.
+
+ Band-pass levels are stored in FilterAccumulator precision so pyramids of integer images can hold negative details.
+ The last level is the low-pass residual.
+ */
+template<class T, int C, ImageType I> struct LaplacianPyramid {
+	typedef typename FilterAccumulator<T>::type A;
+	typedef Image<A, C, (sizeof(A) == sizeof(double)) ? ImageType::DOUBLE : ImageType::FLOAT> LevelType;
+	std::vector<LevelType> levels;
+	LaplacianPyramid() {
+	}
+	LaplacianPyramid(const Image<T, C, I>& in, int levelCount, int minSize = 8) {
+		build(in, levelCount, minSize);
+	}
+	size_t size() const {
+		return levels.size();
+	}
+	LevelType& operator[](size_t l) {
+		return levels[l];
+	}
+	const LevelType& operator[](size_t l) const {
+		return levels[l];
+	}
+	//Number of levels that fit before the coarsest side drops below minSize.
+	static int maxLevels(int width, int height, int minSize = 8) {
+		minSize = std::max(minSize, 1);
+		int count = 1;
+		while (width / 2 >= minSize && height / 2 >= minSize) {
+			width /= 2;
+			height /= 2;
+			count++;
+		}
+		return count;
+	}
+	//Stores each Gaussian level minus the up sampled next one. levelCount <= 0 uses as many levels as fit.
+	void build(const Image<T, C, I>& in, int levelCount, int minSize = 8) {
+		int count = maxLevels(in.width, in.height, minSize);
+		if (levelCount > 0)
+			count = std::min(count, levelCount);
+		levels.resize(count);
+		LevelType& base = levels[0];
+		base.resize(in.width, in.height);
+#pragma omp parallel for
+		for (int idx = 0; idx < (int) in.size(); idx++) {
+			base.data[idx] = vec<A, C>(in.data[idx]);
+		}
+		LevelType up;
+		for (int l = 0; l < count - 1; l++) {
+			DownSample(levels[l], levels[l + 1]);
+			up.resize(levels[l].width, levels[l].height);
+			UpSample(levels[l + 1], up);
+			LevelType& band = levels[l];
+#pragma omp parallel for
+			for (int idx = 0; idx < (int) band.size(); idx++) {
+				band.data[idx] -= up.data[idx];
+			}
+		}
+	}
+	//Up samples from the residual and adds each band back in. Integer images are rounded and clamped to their range.
+	void collapse(Image<T, C, I>& out) const {
+		if (levels.size() == 0) {
+			out.clear();
+			return;
+		}
+		LevelType current = levels.back();
+		LevelType up;
+		for (int l = (int) levels.size() - 2; l >= 0; l--) {
+			const LevelType& band = levels[l];
+			up.resize(band.width, band.height);
+			UpSample(current, up);
+#pragma omp parallel for
+			for (int idx = 0; idx < (int) band.size(); idx++) {
+				up.data[idx] += band.data[idx];
+			}
+			std::swap(current, up);
+		}
+		out.resize(current.width, current.height);
+		const bool integral = std::numeric_limits<T>::is_integer;
+		const A lo = A(std::numeric_limits<T>::lowest());
+		const A hi = A(std::numeric_limits<T>::max());
+#pragma omp parallel for
+		for (int idx = 0; idx < (int) out.size(); idx++) {
+			vec<A, C> val = current.data[idx];
+			if (integral) {
+				for (int c = 0; c < C; c++) {
+					val[c] = clamp(std::floor(val[c] + A(0.5)), lo, hi);
+				}
+			}
+			out.data[idx] = vec<T, C>(val);
+		}
+	}
+};
+/*
+ Burt, P. J., & Adelson, E. H. (1983). A multiresolution spline with application to image mosaics. ACM Transactions
+ on Graphics, 2(4), 217-236.
+
+ Each band of the output is the average of the corresponding image bands weighted by the Gaussian pyramid of the
+ masks, so seams are blended over a width proportional to the scale of each band. Weights are normalized per pixel and
+ need not sum to one; pixels no image covers come out as zero. Images are accumulated one at a time, so memory stays at
+ two pyramids plus the accumulator regardless of how many images are blended.
+ */
+template<class T, int C, ImageType I> void MultibandBlend(const std::vector<const Image<T, C, I>*>& images,
+		const std::vector<const Image1f*>& masks, Image<T, C, I>& out, int levels = 0, int minSize = 8) {
+	typedef LaplacianPyramid<T, C, I> Pyramid;
+	typedef typename Pyramid::A A;
+	if (images.size() == 0 || images.size() != masks.size())
+		throw std::runtime_error(MakeString() << "Multiband blend needs one mask per image, but got " << images.size()
+				<< " images and " << masks.size() << " masks.");
+	const int width = images[0]->width;
+	const int height = images[0]->height;
+	for (size_t n = 0; n < images.size(); n++) {
+		if (images[n]->width != width || images[n]->height != height || masks[n]->width != width || masks[n]->height != height)
+			throw std::runtime_error(MakeString() << "Image " << n << " or its mask does not match the blend dimensions " << width
+					<< "x" << height);
+	}
+	Pyramid blend, pyramid;
+	std::vector<Image1f> weights, totals;
+	for (size_t n = 0; n < images.size(); n++) {
+		pyramid.build(*images[n], levels, minSize);
+		GaussianPyramid(*masks[n], weights, (int) pyramid.size());
+		if (n == 0) {
+			blend.levels.resize(pyramid.size());
+			totals.resize(pyramid.size());
+			for (size_t l = 0; l < pyramid.size(); l++) {
+				blend[l].resize(pyramid[l].width, pyramid[l].height);
+				blend[l].set(vec<A, C>(A(0)));
+				totals[l].resize(pyramid[l].width, pyramid[l].height);
+				totals[l].set(float1(0.0f));
+			}
+		}
+		for (size_t l = 0; l < pyramid.size(); l++) {
+			const typename Pyramid::LevelType& band = pyramid[l];
+			typename Pyramid::LevelType& sum = blend[l];
+			const Image1f& weight = weights[l];
+			Image1f& total = totals[l];
+#pragma omp parallel for
+			for (int idx = 0; idx < (int) band.size(); idx++) {
+				A w = A(weight.data[idx].x);
+				sum.data[idx] += w * band.data[idx];
+				total.data[idx].x += weight.data[idx].x;
+			}
+		}
+	}
+	for (size_t l = 0; l < blend.size(); l++) {
+		typename Pyramid::LevelType& sum = blend[l];
+		const Image1f& total = totals[l];
+#pragma omp parallel for
+		for (int idx = 0; idx < (int) sum.size(); idx++) {
+			float w = total.data[idx].x;
+			sum.data[idx] = (w > 1E-6f) ? sum.data[idx] / A(w) : vec<A, C>(A(0));
+		}
+	}
+	blend.collapse(out);
+}
+template<class T, int C, ImageType I> void MultibandBlend(const std::vector<Image<T, C, I>>& images,
+		const std::vector<Image1f>& masks, Image<T, C, I>& out, int levels = 0, int minSize = 8) {
+	std::vector<const Image<T, C, I>*> imagePtrs;
+	std::vector<const Image1f*> maskPtrs;
+	for (const Image<T, C, I>& img : images) {
+		imagePtrs.push_back(&img);
+	}
+	for (const Image1f& mask : masks) {
+		maskPtrs.push_back(&mask);
+	}
+	MultibandBlend(imagePtrs, maskPtrs, out, levels, minSize);
+}
+//Two image blend where mask is the weight of a and 1-mask the weight of b.
+template<class T, int C, ImageType I> void MultibandBlend(const Image<T, C, I>& a, const Image<T, C, I>& b, const Image1f& mask,
+		Image<T, C, I>& out, int levels = 0, int minSize = 8) {
+	Image1f inverse(mask.width, mask.height);
+#pragma omp parallel for
+	for (int idx = 0; idx < (int) mask.size(); idx++) {
+		inverse.data[idx].x = 1.0f - mask.data[idx].x;
+	}
+	MultibandBlend(std::vector<const Image<T, C, I>*> { &a, &b }, std::vector<const Image1f*> { &mask, &inverse }, out, levels,
+			minSize);
+}
 }
 
 #endif /* INCLUDE_CORE_IMAGEPROCESSING_H_ */
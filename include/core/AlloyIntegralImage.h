@@ -0,0 +1,347 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef INCLUDE_ALLOYINTEGRALIMAGE_H_
+#define INCLUDE_ALLOYINTEGRALIMAGE_H_
+#include "AlloyVolume.h"
+namespace aly {
+	bool SANITY_CHECK_INTEGRAL_IMAGE();
+	//Integral images of 8 and 16-bit integer data are accumulated exactly in 64-bit integers, everything else in double.
+	//Sums of squared 32-bit values would overflow 64-bit integers, so 32-bit data uses double as well.
+	template<class T> struct IntegralAccumulator {
+		typedef double type;
+	};
+	template<> struct IntegralAccumulator<int8_t> {
+		typedef int64_t type;
+	};
+	template<> struct IntegralAccumulator<uint8_t> {
+		typedef int64_t type;
+	};
+	template<> struct IntegralAccumulator<int16_t> {
+		typedef int64_t type;
+	};
+	template<> struct IntegralAccumulator<uint16_t> {
+		typedef int64_t type;
+	};
+	/*
+	 Crow, F. C. (1984). Summed-area tables for texture mapping. ACM SIGGRAPH Computer Graphics, 18(3), 207-212.
+
+	 Stores the sum of every value above and to the left of each pixel, with an extra row and column of zeros, so the
+	 sum over any box takes four lookups. Rows are scanned in parallel, then columns in parallel blocks of rows.
+	 */
+	template<class A, int C> struct IntegralImage {
+		int width = 0;
+		int height = 0;
+		std::vector<vec<A, C>> data;
+		vec<A, C>& operator()(int i, int j) {
+			return data[(size_t) j * (width + 1) + i];
+		}
+		const vec<A, C>& operator()(int i, int j) const {
+			return data[(size_t) j * (width + 1) + i];
+		}
+		//Builds the table from value(i,j), which is evaluated once per pixel.
+		template<class F> void build(int w, int h, const F& value) {
+			width = w;
+			height = h;
+			const int stride = width + 1;
+			data.assign((size_t) stride * (height + 1), vec<A, C>(A(0)));
+#pragma omp parallel for
+			for (int j = 0; j < height; j++) {
+				vec<A, C>* row = &data[(size_t) (j + 1) * stride];
+				vec<A, C> sum(A(0));
+				for (int i = 0; i < width; i++) {
+					sum += value(i, j);
+					row[i + 1] = sum;
+				}
+			}
+			const int BLOCK = 256;
+			const int blocks = (stride + BLOCK - 1) / BLOCK;
+#pragma omp parallel for
+			for (int b = 0; b < blocks; b++) {
+				const int start = b * BLOCK;
+				const int end = std::min(start + BLOCK, stride);
+				for (int j = 1; j <= height; j++) {
+					vec<A, C>* row = &data[(size_t) j * stride];
+					const vec<A, C>* prev = row - stride;
+					for (int i = start; i < end; i++) {
+						row[i] += prev[i];
+					}
+				}
+			}
+		}
+		template<class T, ImageType I> void build(const Image<T, C, I>& img) {
+			build(img.width, img.height, [&](int i, int j) {
+				return vec<A, C>(img(i, j));
+			});
+		}
+		//Table of squared values, used for local variance.
+		template<class T, ImageType I> void buildSquared(const Image<T, C, I>& img) {
+			build(img.width, img.height, [&](int i, int j) {
+				vec<A, C> v(img(i, j));
+				return v * v;
+			});
+		}
+		//Table of per-channel products of two images, used for cross-correlation.
+		template<class T, ImageType I> void buildProduct(const Image<T, C, I>& a, const Image<T, C, I>& b) {
+			if (a.dimensions() != b.dimensions())
+				throw std::runtime_error(MakeString() << "Image dimensions do not match " << a.dimensions() << " " << b.dimensions());
+			build(a.width, a.height, [&](int i, int j) {
+				return vec<A, C>(a(i, j)) * vec<A, C>(b(i, j));
+			});
+		}
+		//Sum over pixels [x0,x1) x [y0,y1). The box must lie inside the image.
+		vec<A, C> sum(int x0, int y0, int x1, int y1) const {
+			const int stride = width + 1;
+			const vec<A, C>* r0 = &data[(size_t) y0 * stride];
+			const vec<A, C>* r1 = &data[(size_t) y1 * stride];
+			return r1[x1] - r1[x0] - r0[x1] + r0[x0];
+		}
+	};
+	//Three dimensional summed-area table with one layer of zeros on the low side of each axis.
+	template<class A, int C> struct IntegralVolume {
+		int rows = 0;
+		int cols = 0;
+		int slices = 0;
+		std::vector<vec<A, C>> data;
+		vec<A, C>& operator()(int i, int j, int k) {
+			return data[((size_t) k * (cols + 1) + j) * (rows + 1) + i];
+		}
+		const vec<A, C>& operator()(int i, int j, int k) const {
+			return data[((size_t) k * (cols + 1) + j) * (rows + 1) + i];
+		}
+		template<class F> void build(int r, int c, int s, const F& value) {
+			rows = r;
+			cols = c;
+			slices = s;
+			const size_t stride = rows + 1;
+			const size_t plane = stride * (cols + 1);
+			data.assign(plane * (slices + 1), vec<A, C>(A(0)));
+			//Each slice is a 2D integral image, then slices are accumulated front to back in parallel row blocks.
+#pragma omp parallel for
+			for (int k = 0; k < slices; k++) {
+				vec<A, C>* slice = &data[(k + 1) * plane];
+				for (int j = 0; j < cols; j++) {
+					vec<A, C>* row = slice + (j + 1) * stride;
+					const vec<A, C>* prev = row - stride;
+					vec<A, C> sum(A(0));
+					for (int i = 0; i < rows; i++) {
+						sum += value(i, j, k);
+						row[i + 1] = sum + prev[i + 1];
+					}
+				}
+			}
+#pragma omp parallel for
+			for (int j = 1; j <= cols; j++) {
+				for (int k = 1; k <= slices; k++) {
+					vec<A, C>* row = &data[k * plane + j * stride];
+					const vec<A, C>* prev = row - plane;
+					for (size_t i = 0; i < stride; i++) {
+						row[i] += prev[i];
+					}
+				}
+			}
+		}
+		template<class T, ImageType I> void build(const Volume<T, C, I>& vol) {
+			build(vol.rows, vol.cols, vol.slices, [&](int i, int j, int k) {
+				return vec<A, C>(vol(i, j, k));
+			});
+		}
+		template<class T, ImageType I> void buildSquared(const Volume<T, C, I>& vol) {
+			build(vol.rows, vol.cols, vol.slices, [&](int i, int j, int k) {
+				vec<A, C> v(vol(i, j, k));
+				return v * v;
+			});
+		}
+		template<class T, ImageType I> void buildProduct(const Volume<T, C, I>& a, const Volume<T, C, I>& b) {
+			if (a.dimensions() != b.dimensions())
+				throw std::runtime_error(MakeString() << "Volume dimensions do not match " << a.dimensions() << " " << b.dimensions());
+			build(a.rows, a.cols, a.slices, [&](int i, int j, int k) {
+				return vec<A, C>(a(i, j, k)) * vec<A, C>(b(i, j, k));
+			});
+		}
+		//Sum over voxels [x0,x1) x [y0,y1) x [z0,z1). The box must lie inside the volume.
+		vec<A, C> sum(int x0, int y0, int z0, int x1, int y1, int z1) const {
+			const IntegralVolume& v = *this;
+			return v(x1, y1, z1) - v(x0, y1, z1) - v(x1, y0, z1) - v(x1, y1, z0) + v(x0, y0, z1) + v(x0, y1, z0) + v(x1, y0, z0)
+				- v(x0, y0, z0);
+		}
+	};
+	//Calls func(i, j, n, x0, y0, x1, y1) with the box [x0,x1) x [y0,y1) of the window around pixel (i,j) that lies inside
+	//the image, and n the number of pixels in it. Windows shrink at the border rather than repeating edge pixels.
+	template<class A, int C, class F> void ForEachWindow(const IntegralImage<A, C>& table, int radiusX, int radiusY,
+		const F& func) {
+		const int width = table.width;
+		const int height = table.height;
+#pragma omp parallel for
+		for (int j = 0; j < height; j++) {
+			const int y0 = std::max(j - radiusY, 0);
+			const int y1 = std::min(j + radiusY + 1, height);
+			for (int i = 0; i < width; i++) {
+				const int x0 = std::max(i - radiusX, 0);
+				const int x1 = std::min(i + radiusX + 1, width);
+				func(i, j, (x1 - x0) * (y1 - y0), x0, y0, x1, y1);
+			}
+		}
+	}
+	template<class A, int C, class F> void ForEachWindow(const IntegralVolume<A, C>& table, int radiusX, int radiusY, int radiusZ,
+		const F& func) {
+#pragma omp parallel for
+		for (int k = 0; k < table.slices; k++) {
+			const int z0 = std::max(k - radiusZ, 0);
+			const int z1 = std::min(k + radiusZ + 1, table.slices);
+			for (int j = 0; j < table.cols; j++) {
+				const int y0 = std::max(j - radiusY, 0);
+				const int y1 = std::min(j + radiusY + 1, table.cols);
+				for (int i = 0; i < table.rows; i++) {
+					const int x0 = std::max(i - radiusX, 0);
+					const int x1 = std::min(i + radiusX + 1, table.rows);
+					func(i, j, k, (x1 - x0) * (y1 - y0) * (z1 - z0), x0, y0, z0, x1, y1, z1);
+				}
+			}
+		}
+	}
+	//Converts a window statistic to the output type, rounding for integer outputs.
+	template<class R, int C> vec<R, C> IntegralResult(const vec<double, C>& val) {
+		if (std::numeric_limits<R>::is_integer) {
+			vec<R, C> out;
+			for (int c = 0; c < C; c++) {
+				out[c] = (R) clamp(std::floor(val[c] + 0.5), (double) std::numeric_limits<R>::lowest(),
+					(double) std::numeric_limits<R>::max());
+			}
+			return out;
+		}
+		return vec<R, C>(val);
+	}
+	//Mean over a (2*radiusX+1) x (2*radiusY+1) window in constant time per pixel, for any window size.
+	template<class T, int C, ImageType I, class R, ImageType J> void LocalMean(const Image<T, C, I>& in, Image<R, C, J>& mean,
+		int radiusX, int radiusY) {
+		IntegralImage<typename IntegralAccumulator<T>::type, C> table;
+		table.build(in);
+		mean.resize(in.width, in.height);
+		ForEachWindow(table, radiusX, radiusY, [&](int i, int j, int n, int x0, int y0, int x1, int y1) {
+			mean(i, j) = IntegralResult<R, C>(vec<double, C>(table.sum(x0, y0, x1, y1)) / (double) n);
+		});
+	}
+	template<class T, int C, ImageType I> void BoxFilter(const Image<T, C, I>& in, Image<T, C, I>& out, int radiusX, int radiusY) {
+		LocalMean(in, out, radiusX, radiusY);
+	}
+	template<class T, int C, ImageType I> void BoxFilter(const Image<T, C, I>& in, Image<T, C, I>& out, int radius) {
+		LocalMean(in, out, radius, radius);
+	}
+	template<class T, int C, ImageType I, class R, ImageType J> void LocalVariance(const Image<T, C, I>& in, Image<R, C, J>& mean,
+		Image<R, C, J>& variance, int radiusX, int radiusY) {
+		typedef typename IntegralAccumulator<T>::type A;
+		IntegralImage<A, C> table, squared;
+		table.build(in);
+		squared.buildSquared(in);
+		mean.resize(in.width, in.height);
+		variance.resize(in.width, in.height);
+		ForEachWindow(table, radiusX, radiusY, [&](int i, int j, int n, int x0, int y0, int x1, int y1) {
+			vec<double, C> mu = vec<double, C>(table.sum(x0, y0, x1, y1)) / (double) n;
+			vec<double, C> var = vec<double, C>(squared.sum(x0, y0, x1, y1)) / (double) n - mu * mu;
+			mean(i, j) = IntegralResult<R, C>(mu);
+			variance(i, j) = IntegralResult<R, C>(aly::max(var, vec<double, C>(0.0)));
+		});
+	}
+	/*
+	 Lewis, J. P. (1995). Fast normalized cross-correlation. Vision Interface, 120-123.
+
+	 Per channel zero-mean normalized cross-correlation of a and b over the window around each pixel, in [-1,1]. Windows
+	 where either image is constant give zero.
+	 */
+	template<class T, int C, ImageType I, class R, ImageType J> void NormalizedCrossCorrelation(const Image<T, C, I>& a,
+		const Image<T, C, I>& b, Image<R, C, J>& ncc, int radiusX, int radiusY) {
+		typedef typename IntegralAccumulator<T>::type A;
+		IntegralImage<A, C> sumA, sumB, sumAA, sumBB, sumAB;
+		sumA.build(a);
+		sumB.build(b);
+		sumAA.buildSquared(a);
+		sumBB.buildSquared(b);
+		sumAB.buildProduct(a, b);
+		ncc.resize(a.width, a.height);
+		ForEachWindow(sumA, radiusX, radiusY, [&](int i, int j, int n, int x0, int y0, int x1, int y1) {
+			vec<double, C> sa(sumA.sum(x0, y0, x1, y1)), sb(sumB.sum(x0, y0, x1, y1));
+			vec<double, C> varA = vec<double, C>(sumAA.sum(x0, y0, x1, y1)) - sa * sa / (double) n;
+			vec<double, C> varB = vec<double, C>(sumBB.sum(x0, y0, x1, y1)) - sb * sb / (double) n;
+			vec<double, C> cov = vec<double, C>(sumAB.sum(x0, y0, x1, y1)) - sa * sb / (double) n;
+			vec<double, C> result;
+			for (int c = 0; c < C; c++) {
+				double denom = varA[c] * varB[c];
+				result[c] = (denom > 1E-12) ? clamp(cov[c] / std::sqrt(denom), -1.0, 1.0) : 0.0;
+			}
+			ncc(i, j) = vec<R, C>(result);
+		});
+	}
+	template<class T, int C, ImageType I, class R, ImageType J> void LocalMean(const Volume<T, C, I>& in, Volume<R, C, J>& mean,
+		int radiusX, int radiusY, int radiusZ) {
+		IntegralVolume<typename IntegralAccumulator<T>::type, C> table;
+		table.build(in);
+		mean.resize(in.rows, in.cols, in.slices);
+		ForEachWindow(table, radiusX, radiusY, radiusZ, [&](int i, int j, int k, int n, int x0, int y0, int z0, int x1, int y1, int z1) {
+			mean(i, j, k) = IntegralResult<R, C>(vec<double, C>(table.sum(x0, y0, z0, x1, y1, z1)) / (double) n);
+		});
+	}
+	template<class T, int C, ImageType I> void BoxFilter(const Volume<T, C, I>& in, Volume<T, C, I>& out, int radiusX, int radiusY,
+		int radiusZ) {
+		LocalMean(in, out, radiusX, radiusY, radiusZ);
+	}
+	template<class T, int C, ImageType I> void BoxFilter(const Volume<T, C, I>& in, Volume<T, C, I>& out, int radius) {
+		LocalMean(in, out, radius, radius, radius);
+	}
+	template<class T, int C, ImageType I, class R, ImageType J> void LocalVariance(const Volume<T, C, I>& in, Volume<R, C, J>& mean,
+		Volume<R, C, J>& variance, int radiusX, int radiusY, int radiusZ) {
+		typedef typename IntegralAccumulator<T>::type A;
+		IntegralVolume<A, C> table, squared;
+		table.build(in);
+		squared.buildSquared(in);
+		mean.resize(in.rows, in.cols, in.slices);
+		variance.resize(in.rows, in.cols, in.slices);
+		ForEachWindow(table, radiusX, radiusY, radiusZ, [&](int i, int j, int k, int n, int x0, int y0, int z0, int x1, int y1, int z1) {
+			vec<double, C> mu = vec<double, C>(table.sum(x0, y0, z0, x1, y1, z1)) / (double) n;
+			vec<double, C> var = vec<double, C>(squared.sum(x0, y0, z0, x1, y1, z1)) / (double) n - mu * mu;
+			mean(i, j, k) = IntegralResult<R, C>(mu);
+			variance(i, j, k) = IntegralResult<R, C>(aly::max(var, vec<double, C>(0.0)));
+		});
+	}
+	template<class T, int C, ImageType I, class R, ImageType J> void NormalizedCrossCorrelation(const Volume<T, C, I>& a,
+		const Volume<T, C, I>& b, Volume<R, C, J>& ncc, int radiusX, int radiusY, int radiusZ) {
+		typedef typename IntegralAccumulator<T>::type A;
+		IntegralVolume<A, C> sumA, sumB, sumAA, sumBB, sumAB;
+		sumA.build(a);
+		sumB.build(b);
+		sumAA.buildSquared(a);
+		sumBB.buildSquared(b);
+		sumAB.buildProduct(a, b);
+		ncc.resize(a.rows, a.cols, a.slices);
+		ForEachWindow(sumA, radiusX, radiusY, radiusZ, [&](int i, int j, int k, int n, int x0, int y0, int z0, int x1, int y1, int z1) {
+			vec<double, C> sa(sumA.sum(x0, y0, z0, x1, y1, z1)), sb(sumB.sum(x0, y0, z0, x1, y1, z1));
+			vec<double, C> varA = vec<double, C>(sumAA.sum(x0, y0, z0, x1, y1, z1)) - sa * sa / (double) n;
+			vec<double, C> varB = vec<double, C>(sumBB.sum(x0, y0, z0, x1, y1, z1)) - sb * sb / (double) n;
+			vec<double, C> cov = vec<double, C>(sumAB.sum(x0, y0, z0, x1, y1, z1)) - sa * sb / (double) n;
+			vec<double, C> result;
+			for (int c = 0; c < C; c++) {
+				double denom = varA[c] * varB[c];
+				result[c] = (denom > 1E-12) ? clamp(cov[c] / std::sqrt(denom), -1.0, 1.0) : 0.0;
+			}
+			ncc(i, j, k) = vec<R, C>(result);
+		});
+	}
+}
+#endif
@@ -22,12 +22,14 @@
 #ifndef ALLOYMESHKDTREE_H_
 #define ALLOYMESHKDTREE_H_
 #include "AlloyMath.h"
+#include "AlloyVector.h"
 
-//Mesh intersection implemented with a KD-tree of triangles.
-//The term "Intersector" is used to disambiguate this KD-tree from the one used for points.
+//Mesh intersection implemented with a bounding volume hierarchy of triangles.
+//The term "Intersector" is used to disambiguate this tree from the KD-tree used for points.
 
 namespace aly {
 	bool SANITY_CHECK_KDTREE();
+	bool SANITY_CHECK_KDTREE_PLANES();
 	class Mesh;
 	static const float3 NO_HIT_POINT = float3(
 		std::numeric_limits<float>::infinity());
@@ -158,6 +160,9 @@ namespace aly {
 		float3 getCentroid() const {
 			return 0.3333333f * (pts[0] + pts[1] + pts[2]);
 		}
+		const float3& getPoint(int i) const {
+			return pts[i];
+		}
 		float3 fromBary(const double3& b) const {
 			return float3(
 				(float)(pts[0].x * b.x + pts[1].x * b.y + pts[2].x * b.z),
@@ -168,6 +173,66 @@ namespace aly {
 		float3 intersectionPointSegment(const float3& p1, const float3& p2) const;
 		float3 intersectionPointRay(const float3& org, const float3& v) const;
 		double distance(const float3& p, float3& lastIntersect) const;
+		static double distance(const float3& p, const float3& p1,
+			const float3& p2, const float3& p3, float3& lastIntersect);
+	};
+	//Flattened BVH node. The first child of an interior node immediately follows it and the second child is at offset.
+	//Leaves store the index of their first triangle in offset and a non-zero triangle count.
+	struct BVHNode {
+		float3 minPoint;
+		int32_t offset;
+		float3 maxPoint;
+		uint16_t count;
+		uint16_t axis;
+		bool isLeaf() const {
+			return (count > 0);
+		}
+	};
+	//Triangle vertices in BVH leaf order, stored as structure of arrays.
+	struct BVHTriangles {
+		std::vector<float> x[3], y[3], z[3];
+		std::vector<KDTriangle*> triangles;
+		size_t size() const {
+			return triangles.size();
+		}
+		float3 getPoint(size_t i, int k) const {
+			return float3(x[k][i], y[k][i], z[k][i]);
+		}
+		void clear() {
+			for (int k = 0; k < 3; k++) {
+				x[k].clear();
+				y[k].clear();
+				z[k].clear();
+			}
+			triangles.clear();
+		}
+	};
+
+	//Structure of arrays returned by batched queries. Misses have id -1, a null triangle and NO_HIT_DISTANCE.
+	//Barycentric weights are for the triangle's points in order.
+	struct IntersectorHits {
+		std::vector<float> distances;
+		std::vector<int64_t> ids;
+		std::vector<float3> points;
+		std::vector<float3> barycentrics;
+		std::vector<KDTriangle*> triangles;
+		size_t size() const {
+			return distances.size();
+		}
+		void resize(size_t sz) {
+			distances.resize(sz);
+			ids.resize(sz);
+			points.resize(sz);
+			barycentrics.resize(sz);
+			triangles.resize(sz);
+		}
+		void clear() {
+			distances.clear();
+			ids.clear();
+			points.clear();
+			barycentrics.clear();
+			triangles.clear();
+		}
 	};
 
 	struct KDBoxDistance {
@@ -196,22 +261,41 @@ namespace aly {
 	protected:
 		std::shared_ptr<KDBox> root;
 		std::vector<std::shared_ptr<KDBox>> storage;
-		const double intersectCost = 80;
+		std::vector<BVHNode> nodes;
+		BVHTriangles bvhTriangles;
+		const double intersectCost = 1;
 		const double traversalCost = 1;
-		const double emptyBonus = 0.2;
-		int splitPosition(std::vector<KDBox*>& children,
-			std::vector<KDBoxEdge>& edges, KDBox* box);
-		void buildTree(int maxDepth);
+		void buildTree();
+		int intersectRay(const float3& org, const float3& dir, float tMax,
+			float& tHit) const;
+		int closestTriangle(const float3& pt, double maxDistance,
+			const float3* halfSpace, float3& lastPoint, double& dist) const;
+		void intersectPacket(const float3* org, const float3* dir, int count,
+			float tMax, float* tHit, int* hit) const;
+		void intersectRays(const float3* org, const float3* dir, size_t N,
+			float tMax, IntersectorHits& hits) const;
+		void closestPoints(const float3* pts, size_t N, float maxDistance,
+			bool signedDistance, IntersectorHits& hits) const;
 	public:
+		static const int MAX_LEAF_SIZE = 4;
+		static const int MAX_DEPTH = 64;
+		static const int PACKET_SIZE = 4;
 		void reset() {
 			root.reset();
 			storage.clear();
 			storage.shrink_to_fit();
+			nodes.clear();
+			nodes.shrink_to_fit();
+			bvhTriangles.clear();
 		}
+		//Root box whose children are all triangles in the mesh.
 		KDBox* getRoot() const {
 			return root.get();
 		}
-
+		const std::vector<BVHNode>& getNodes() const {
+			return nodes;
+		}
+		//maxDepth is retained for compatibility. Tree depth is chosen by the surface area heuristic.
 		void build(const Mesh& mesh, int maxDepth = 16);
 		Intersector(const Mesh& mesh, int maxDepth = 16) {
 			build(mesh, maxDepth);
@@ -231,6 +315,26 @@ namespace aly {
 		double closestPointSignedDistance(const float3& r, const float& maxDistance, float3& lastPoint, KDTriangle*& lastTriangle) const;
 		double closestPointOutside(const float3& r, const float3& v,
 			float3& lastPoint, KDTriangle*& lastTriangle) const;
+		//Batched queries run in parallel. Consecutive rays are traced together as packets, so coherent rays such as
+		//neighboring pixels should be adjacent.
+		void intersectRays(const std::vector<float3>& org,
+			const std::vector<float3>& dir, IntersectorHits& hits) const;
+		void intersectRays(const Vector3f& org, const Vector3f& dir,
+			IntersectorHits& hits) const;
+		void intersectSegments(const std::vector<float3>& p1,
+			const std::vector<float3>& p2, IntersectorHits& hits) const;
+		void intersectSegments(const Vector3f& p1, const Vector3f& p2,
+			IntersectorHits& hits) const;
+		void closestPoints(const std::vector<float3>& pts, IntersectorHits& hits,
+			float maxDistance = std::numeric_limits<float>::infinity()) const;
+		void closestPoints(const Vector3f& pts, IntersectorHits& hits,
+			float maxDistance = std::numeric_limits<float>::infinity()) const;
+		void closestPointsSignedDistance(const std::vector<float3>& pts,
+			IntersectorHits& hits,
+			float maxDistance = std::numeric_limits<float>::infinity()) const;
+		void closestPointsSignedDistance(const Vector3f& pts,
+			IntersectorHits& hits,
+			float maxDistance = std::numeric_limits<float>::infinity()) const;
 
 		double intersectRayDistance(const float3& p1, const float3& v,
 			float3& lastPoint) const {
@@ -23,66 +23,19 @@
 #define ALLOYISOCONTOUR_H_
 #include "AlloyImage.h"
 #include "AlloyVector.h"
-#include <memory>
 #include <list>
-#include <map>
+#include <vector>
+#include <algorithm>
 namespace aly {
+bool SANITY_CHECK_ISOCONTOUR();
 enum class TopologyRule2D {
 	Unconstrained, Connect4, Connect8
 };
 enum class Winding {
 	Clockwise, CounterClockwise
 };
-struct Edge: public uint2 {
-	Edge(uint32_t x, uint32_t y) :
-			uint2(x, y) {
-
-	}
-	Edge(uint32_t x) :
-			uint2(x) {
-
-	}
-};
-typedef std::shared_ptr<Edge> EdgePtr;
-struct EdgeSplit {
-	EdgePtr e1, e2;
-	uint2 pt1;
-	uint2 pt2;
-	float2 pt2d;
-	uint vid;
-public:
-	EdgeSplit(uint2 pt1 = uint2(std::numeric_limits<uint32_t>::max()),
-			uint2 pt2 = uint2(std::numeric_limits<uint32_t>::max())) :
-			pt1(pt1), pt2(pt2), vid(std::numeric_limits<uint32_t>::max()) {
-	}
-	inline uint64_t hashValue(uint2 pt, int w) const {
-		return pt.x + w * pt.y;
-	}
-	inline uint64_t hashValue(int w, int h) const {
-		uint64_t h1 = hashValue(pt1, w);
-		uint64_t h2 = hashValue(pt2, w);
-		uint64_t offset = w * h;
-		if (h1 < h2) {
-			return h1 + h2 * offset;
-		} else {
-			return h2 + h1 * offset;
-		}
-
-	}
-
-};
-typedef std::shared_ptr<EdgeSplit> EdgeSplitPtr;
-inline bool operator==(const Edge& e1, const Edge e2) {
-	return ((e1.x == e2.x && e1.y == e2.y) || (e1.x == e2.y && e1.y == e2.x));
-}
-inline bool operator==(const EdgeSplit& split1, const EdgeSplit& split2) {
-	return ((split1.pt1 == split2.pt1 && split1.pt2 == split2.pt2)
-			|| (split1.pt1 == split2.pt2 && split1.pt2 == split2.pt1));
-}
-
 class IsoContour {
 protected:
-	uint32_t vertCount = 0;
 	const int a2fVertex1Offset[4][2] =
 			{ { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
 	const int a2fVertex2Offset[4][2] =
@@ -127,33 +80,51 @@ protected:
 	TopologyRule2D rule = TopologyRule2D::Unconstrained;
 	int rows=0, cols=0;
 	const Image1f* img;
-	float getValue(int x, int y);
-	float fGetOffset(uint2 v1, uint2 v2);
-	EdgeSplitPtr createSplit(std::map<uint64_t, EdgeSplitPtr>& splits, int p1x,
-			int p1y, int p2x, int p2y);
-	void addEdge(std::map<uint64_t, EdgeSplitPtr>& splits,
-			std::list<EdgePtr>& edges, int p1x, int p1y, int p2x, int p2y,
-			int p3x, int p3y, int p4x, int p4y);
-	void processSquare2(int x, int y, std::map<uint64_t, EdgeSplitPtr>& splits,
-			std::list<EdgePtr>& edges);
-	void processSquare1(int x, int y, std::map<uint64_t, EdgeSplitPtr>& splits,
-			std::list<EdgePtr>& edges);
-	void processSquare(int x, int y, std::map<uint64_t, EdgeSplitPtr>& splits,
-			std::list<EdgePtr>& edges);
-	bool orient(const Image1f& img, const EdgeSplit& split1,
-			const EdgeSplit& split2, Edge& edge);
+	//Crossings and edges found in a range of square columns, numbered in the order a serial scan creates them.
+	//Crossings on the first column may belong to the previous stripe, seams holds their slot in its last column.
+	struct Stripe {
+		int begin = 0, end = 0;
+		std::vector<float2> points;
+		std::vector<int> seams;
+		std::vector<uint2> edges;
+		std::vector<float> values;
+		std::vector<int> columns[2];
+		std::vector<int> lastColumn;
+		std::vector<uint32_t> ids;
+		uint32_t vertexOffset = 0;
+		uint32_t edgeOffset = 0;
+	};
+	const int STRIPE_WIDTH;
+	void loadValues(Stripe& stripe);
+	float getValue(const Stripe& stripe, int x, int y) const;
+	float fGetOffset(const Stripe& stripe, uint2 v1, uint2 v2) const;
+	void extract(const Image1f& levelset, std::vector<Stripe>& stripes,
+			Vector2f& points);
+	uint32_t createSplit(Stripe& stripe, int p1x, int p1y, int p2x, int p2y);
+	void addEdge(Stripe& stripe, int p1x, int p1y, int p2x, int p2y, int p3x,
+			int p3y, int p4x, int p4y);
+	void processSquare2(int x, int y, Stripe& stripe);
+	void processSquare1(int x, int y, Stripe& stripe);
+	void processSquare(int x, int y, Stripe& stripe);
 public:
-	IsoContour(bool nudgeLevelSet = true, float levelSetTolerance = 1E-3f) :
+	//Stripe width is the number of square columns scanned by one task.
+	IsoContour(bool nudgeLevelSet = true, float levelSetTolerance = 1E-3f, int stripeWidth = 128) :
 			nudgeLevelSet(nudgeLevelSet), LEVEL_SET_TOLERANCE(
-					levelSetTolerance), img(nullptr) {
+					levelSetTolerance), img(nullptr), STRIPE_WIDTH(std::max(stripeWidth, 1)) {
 
 	}
 	virtual ~IsoContour() {
 	}
+	//Segments are oriented so that values above the iso-level lie to their left (positive cross product in image
+	//coordinates) for Clockwise and to their right for CounterClockwise. Earlier versions emitted segments in table
+	//order without a consistent orientation.
 	void solve(const Image1f& levelset, Vector2f& points, Vector2ui& indexes,
 			float isoLevel = 0.0f, const TopologyRule2D& rule =
 					TopologyRule2D::Unconstrained, const Winding& winding =
 					Winding::CounterClockwise);
+	//Traces the same oriented segments into curves, so every curve runs in the segment direction. Closed curves repeat
+	//their first crossing at the end and curves cut by the image border start at the border. Earlier versions traced
+	//curves from arbitrary crossings in either direction.
 	void solve(const Image1f& levelset, Vector2f& points,
 			std::vector<std::list<uint32_t>>& indexes, float isoLevel = 0.0f,
 			const TopologyRule2D& rule = TopologyRule2D::Unconstrained,
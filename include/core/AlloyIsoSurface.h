@@ -0,0 +1,88 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ALLOYISOSURFACE_H_
+#define ALLOYISOSURFACE_H_
+#include "AlloyVolume.h"
+#include "AlloyMesh.h"
+#include <vector>
+namespace aly {
+bool SANITY_CHECK_ISOSURFACE();
+//Connectivity of the region below the iso-level. Connect6 separates inside voxels that only touch along a face
+//or body diagonal, Connect26 joins them. Both rules resolve ambiguous faces the same way from either side, so the
+//surface is always closed.
+enum class TopologyRule3D {
+	Connect6, Connect26
+};
+enum class IsoSurfaceMethod {
+	MarchingCubes, DualContouring
+};
+class IsoSurface {
+protected:
+	//Region of brickSize^3 voxels. Keys are local voxel indexes (times 3 plus axis for edges), sorted so a vertex id
+	//is the brick's vertex offset plus the rank of its key.
+	struct Brick {
+		int3 origin;
+		std::vector<uint32_t> vertexKeys;
+		std::vector<uint32_t> faceKeys;
+		std::vector<uint8_t> faceCodes;
+		uint32_t vertexOffset = 0;
+		uint32_t faceOffset = 0;
+		uint32_t faceCount = 0;
+	};
+	static const int triangleTable[256][16];
+	float isoLevel = 0.0f;
+	bool nudgeLevelSet;
+	const float LEVEL_SET_TOLERANCE;
+	const int BRICK_SIZE;
+	TopologyRule3D rule = TopologyRule3D::Connect6;
+	int rows = 0, cols = 0, slices = 0;
+	int3 brickDims;
+	const Volume1f* vol;
+	std::vector<Brick> bricks;
+	std::vector<int> brickLookup;
+	float getValue(int i, int j, int k) const;
+	bool isInside(int i, int j, int k) const;
+	float3 getGradient(int i, int j, int k) const;
+	float fGetOffset(int3 v1, int3 v2) const;
+	void findActiveBricks();
+	uint32_t findVertex(int3 voxel, int axis, int stride) const;
+	uint32_t findVertex(const Brick& brick, const std::vector<uint32_t>& localIds, int3 voxel, int axis, int stride) const;
+	void classifyBrick(Brick& brick, const IsoSurfaceMethod& method);
+	void processCubes(Brick& brick, Mesh& mesh);
+	void processDualCells(Brick& brick, Mesh& mesh);
+	float3 solveDualVertex(int3 cell) const;
+public:
+	IsoSurface(bool nudgeLevelSet = true, float levelSetTolerance = 1E-3f, int brickSize = 16) :
+			nudgeLevelSet(nudgeLevelSet), LEVEL_SET_TOLERANCE(levelSetTolerance), BRICK_SIZE(brickSize), vol(nullptr) {
+	}
+	virtual ~IsoSurface() {
+	}
+	//Extracts the iso-surface in voxel coordinates. Marching cubes emits closed triangle meshes. Dual contouring emits
+	//one vertex per cell and one quad per crossing edge, so cells crossed by several sheets give non-manifold edges,
+	//and the topology rule does not apply. Faces wind counter-clockwise seen from above the iso-level, and the output
+	//is identical for any thread count.
+	void solve(const Volume1f& levelset, Mesh& mesh, float isoLevel = 0.0f,
+			const TopologyRule3D& rule = TopologyRule3D::Connect6,
+			const IsoSurfaceMethod& method = IsoSurfaceMethod::MarchingCubes);
+};
+}
+#endif
@@ -26,16 +26,23 @@
 #include "AlloyMath.h"
 #include "AlloyVector.h"
 #include "AlloyImage.h"
+#include "AlloyBinaryFile.h"
 #include "AlloyContext.h"
 #include <vector>
 #include <set>
 #include <list>
 namespace aly {
 	bool SANITY_CHECK_SUBDIVIDE();
+	bool SANITY_CHECK_MESH_ADJACENCY();
 class Mesh;
 enum class SubDivisionScheme {
 	CatmullClark,Loop
 };
+//How face normals are weighted when averaged at a vertex. Area uses unnormalized cross products, Angle weights unit
+//normals by the corner angle.
+enum class NormalWeighting {
+	Area, Angle
+};
 struct GLMesh: public GLComponent {
 public:
 	enum class PrimitiveType {
@@ -69,10 +76,69 @@ public:
 			AlloyDefaultContext());
 	virtual ~GLMesh();
 };
+/*
+ Compressed sparse row connectivity for a mesh. Faces are numbered triangles first, then quads. Every face corner
+ owns the half-edge that leaves it, numbered 3*f+k for triangles and 3*T+4*(f-T)+k for quads. Rings are sorted by
+ index, and the half-edges of an edge are listed in face order.
+ */
+struct MeshAdjacency {
+	static const uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+	uint32_t vertexCount = 0;
+	uint32_t triCount = 0;
+	uint32_t quadCount = 0;
+	//Neighbors of vertex v are vertexNeighbors[vertexOffsets[v]] to vertexNeighbors[vertexOffsets[v+1]-1].
+	std::vector<uint32_t> vertexOffsets;
+	std::vector<uint32_t> vertexNeighbors;
+	//Faces that touch vertex v, indexed the same way with faceOffsets.
+	std::vector<uint32_t> faceOffsets;
+	std::vector<uint32_t> vertexFaces;
+	//Undirected edges (min,max) in lexicographic order.
+	std::vector<uint2> edges;
+	//Half-edges of edge e are edgeHalfEdges[edgeOffsets[e]] to edgeHalfEdges[edgeOffsets[e+1]-1].
+	std::vector<uint32_t> edgeOffsets;
+	std::vector<uint32_t> edgeHalfEdges;
+	std::vector<uint32_t> halfEdgeToEdge;
+	//Twin half-edge in the adjacent face, or NO_EDGE on boundary and non-manifold edges.
+	std::vector<uint32_t> opposite;
+	void build(const Mesh& mesh);
+	void clear();
+	bool matches(const Mesh& mesh) const;
+	inline uint32_t getHalfEdgeCount() const {
+		return 3 * triCount + 4 * quadCount;
+	}
+	inline uint32_t getFaceCount() const {
+		return triCount + quadCount;
+	}
+	inline uint32_t getFace(uint32_t he) const {
+		return (he < 3 * triCount) ? he / 3 : triCount + (he - 3 * triCount) / 4;
+	}
+	inline uint32_t getFaceHalfEdge(uint32_t f) const {
+		return (f < triCount) ? 3 * f : 3 * triCount + 4 * (f - triCount);
+	}
+	inline uint32_t getFaceSize(uint32_t f) const {
+		return (f < triCount) ? 3 : 4;
+	}
+	inline uint32_t next(uint32_t he) const {
+		uint32_t start = getFaceHalfEdge(getFace(he));
+		uint32_t sz = getFaceSize(getFace(he));
+		return start + (he - start + 1) % sz;
+	}
+	inline uint32_t getVertexValence(uint32_t v) const {
+		return vertexOffsets[v + 1] - vertexOffsets[v];
+	}
+	inline const uint32_t* getVertexNeighbors(uint32_t v) const {
+		return vertexNeighbors.data() + vertexOffsets[v];
+	}
+	inline uint32_t getEdgeFaceCount(uint32_t e) const {
+		return edgeOffsets[e + 1] - edgeOffsets[e];
+	}
+};
 class Mesh {
 private:
 	bool dirtyOnScreen = false;
 	bool dirtyOffScreen = false;
+	mutable bool dirtyTopology = true;
+	mutable std::shared_ptr<MeshAdjacency> adjacency;
 protected:
 	box3f boundingBox;
 public:
@@ -106,6 +172,8 @@ public:
 		mesh.pose = pose;
 		mesh.dirtyOnScreen = true;
 		mesh.dirtyOffScreen = true;
+		mesh.dirtyTopology = dirtyTopology;
+		mesh.adjacency = adjacency;
 
 	}
 	bool isEmpty()const {
@@ -145,9 +213,18 @@ public:
 	inline bool isDirty(bool onScreen) const {
 		return (onScreen)?dirtyOnScreen:dirtyOffScreen;
 	}
+	//Call after editing face indexes in place. Changes to face or vertex counts are detected automatically.
+	void setTopologyDirty() {
+		dirtyTopology = true;
+	}
+	//Cached connectivity, rebuilt when the topology changed. Not thread safe.
+	const MeshAdjacency& getAdjacency() const;
 	bool load(const std::string& file);
 	void updateVertexNormals(int SMOOTH_ITERATIONS = 0, float DOT_TOLERANCE =
-			0.75f);
+			0.75f, NormalWeighting weighting = NormalWeighting::Area);
+	//Recomputes only the normals of vertexes that share a face with a moved vertex. Faces must not have changed since
+	//the last full update.
+	void updateVertexNormals(const std::vector<uint32_t>& movedVertexes, NormalWeighting weighting = NormalWeighting::Area);
 	bool convertQuadsToTriangles();
 	void mapIntoBoundingBox(float voxelSize);
 	void mapOutOfBoundingBox(float voxelSize);
@@ -170,12 +247,22 @@ template<class C, class R> std::basic_ostream<C, R> & operator <<(
 }
 void ReadMeshFromFile(const std::string& file, Mesh& mesh);
 void ReadPlyMeshFromFile(const std::string& file, Mesh& mesh);
+//Reads any PLY layout through PLYReaderWriter. ReadPlyMeshFromFile uses it when the bulk binary reader does not apply.
+void ReadGenericPlyMeshFromFile(const std::string& file, Mesh& mesh);
 void ReadObjMeshFromFile(const std::string& file, std::vector<Mesh>& mesh);
 void ReadObjMeshFromFile(const std::string& file, Mesh& mesh);
+//Reads every section of an Alloy binary (.alyb) mesh. To load only some attributes, open the file with
+//MappedBinaryFile and read or view the sections named after the Mesh members.
+void ReadBinaryMeshFromFile(const std::string& file, Mesh& mesh);
 void WritePlyMeshToFile(const std::string& file, const Mesh& mesh, bool binary =
 		true);
+//Writes through PLYReaderWriter. WritePlyMeshToFile uses it for ASCII and textured meshes.
+void WriteGenericPlyMeshToFile(const std::string& file, const Mesh& mesh, bool binary =
+		true);
 void WriteMeshToFile(const std::string& file, const Mesh& mesh);
 void WriteObjMeshToFile(const std::string& file,const Mesh& mesh);
+void WriteBinaryMeshToFile(const std::string& file, const Mesh& mesh,
+		BinaryCompression compression = BinaryCompression::Raw);
 typedef std::vector<std::set<uint32_t>> MeshSetNeighborTable;
 typedef std::vector<std::list<uint32_t>> MeshListNeighborTable;
 void CreateVertexNeighborTable(const Mesh& mesh, MeshSetNeighborTable& vertNbrs);
@@ -22,6 +22,7 @@
 #ifndef INCLUDE_CORE_ALLOYOPTIMIZATION_H_
 #define INCLUDE_CORE_ALLOYOPTIMIZATION_H_
 #include <AlloyOptimizationMath.h>
+#include <AlloySparseSolve.h>
 namespace aly {
 
 	template<class T> struct SparseProblem {
@@ -35,12 +36,13 @@ namespace aly {
 
 		void differentiate(const Vec<T>& input, SparseMat<T>& J) {
 			J.resize(getOutputSize(), getInputSize());
+			std::vector<std::map<size_t, T>>& jRows = J.getRows();
 #pragma omp parallel for
 			for (int r = 0; r < (int)J.rows; r++) {
 				std::vector<std::pair<size_t, T>> row;
 				differentiate(r, input, row);
 				for (auto pr : row) {
-					J.set(r, pr.first, pr.second);
+					jRows[r][pr.first] = pr.second;
 				}
 			}
 		}
@@ -67,6 +69,14 @@ namespace aly {
 			const std::function<bool(int, double)>& iterationMonitor = nullptr);
 	void SolveBICGStab(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, int iters = 100, double tolerance = 1E-6,
 			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveCG(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, const Preconditioner<float>& M, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveBICGStab(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, const Preconditioner<float>& M, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveCG(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, PreconditionerType type, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveBICGStab(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, PreconditionerType type, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
 	void SolveLevenbergMarquardt(SparseProblem<float>& problem, Vec<float>& p, int maxIterations = 100, double errorTolerance = 1E-9,
 			const std::function<bool(int, double)>& monitor = nullptr);
 	void SolveDogLeg(SparseProblem<float>& problem, Vec<float>& p, int maxIterations = 100, double errorTolerance = 1E-9, float trust = 1E3f,
@@ -76,6 +86,14 @@ namespace aly {
 			const std::function<bool(int, double)>& iterationMonitor = nullptr);
 	void SolveBICGStab(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, int iters = 100, double tolerance = 1E-6,
 			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveCG(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, const Preconditioner<double>& M, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveBICGStab(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, const Preconditioner<double>& M, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveCG(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, PreconditionerType type, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
+	void SolveBICGStab(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, PreconditionerType type, int iters = 100, double tolerance = 1E-6,
+			const std::function<bool(int, double)>& iterationMonitor = nullptr);
 	void SolveLevenbergMarquardt(SparseProblem<double>& problem, Vec<double>& p, int maxIterations = 100, double errorTolerance = 1E-9,
 			const std::function<bool(int, double)>& monitor = nullptr);
 	void SolveDogLeg(SparseProblem<double>& problem, Vec<double>& p, int maxIterations = 100, double errorTolerance = 1E-9, double trust = 1E3f,
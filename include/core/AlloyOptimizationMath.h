@@ -23,6 +23,7 @@
 #define INCLUDE_CORE_ALLOYOPTIMIZATIONMATH_H_
 #include <cereal/types/list.hpp>
 #include "AlloyVector.h"
+#include "AlloySparseMatrix.h"
 #include "cereal/types/vector.hpp"
 #include "cereal/types/tuple.hpp"
 #include "cereal/types/map.hpp"
@@ -753,18 +754,80 @@ namespace aly {
 	template<class T> struct SparseMat {
 	private:
 		std::vector<std::map<size_t, T>> storage;
+		mutable CompressedRows<T> compressedRows;
+		mutable CompressedRows<T> compressedColumns;
+		mutable std::atomic<bool> rowsValid { false };
+		mutable std::atomic<bool> columnsValid { false };
+		mutable std::mutex compressLock;
+		void invalidate() {
+			rowsValid.store(false, std::memory_order_relaxed);
+			columnsValid.store(false, std::memory_order_relaxed);
+		}
+		//Caller holds compressLock.
+		void buildRows() const {
+			if (!rowsValid.load(std::memory_order_relaxed)) {
+				compressedRows.build(storage, rows, cols);
+				rowsValid.store(true, std::memory_order_release);
+			}
+		}
 	public:
 		size_t rows, cols;
 		SparseMat() :
 				rows(0), cols(0) {
 
 		}
+		SparseMat(const SparseMat<T>& M) :
+				storage(M.storage), rows(M.rows), cols(M.cols) {
+		}
+		SparseMat(SparseMat<T> && M) :
+				storage(std::move(M.storage)), rows(M.rows), cols(M.cols) {
+		}
+		SparseMat<T>& operator=(const SparseMat<T>& M) {
+			storage = M.storage;
+			rows = M.rows;
+			cols = M.cols;
+			invalidate();
+			return *this;
+		}
+		SparseMat<T>& operator=(SparseMat<T> && M) {
+			storage = std::move(M.storage);
+			rows = M.rows;
+			cols = M.cols;
+			invalidate();
+			return *this;
+		}
 		template<class Archive> void serialize(Archive & archive) {
 			archive(CEREAL_NVP(rows), CEREAL_NVP(cols), cereal::make_nvp(MakeString() << "matrix", storage));
+			invalidate();
+		}
+		//Compressed row copy used by matrix-vector products, rebuilt under a lock after any non-const access.
+		const CompressedRows<T>& compress() const {
+			if (!rowsValid.load(std::memory_order_acquire)) {
+				std::lock_guard<std::mutex> lockMe(compressLock);
+				buildRows();
+			}
+			return compressedRows;
+		}
+		const CompressedRows<T>& compressTranspose() const {
+			if (!columnsValid.load(std::memory_order_acquire)) {
+				std::lock_guard<std::mutex> lockMe(compressLock);
+				if (!columnsValid.load(std::memory_order_relaxed)) {
+					buildRows();
+					compressedRows.transpose(compressedColumns);
+					columnsValid.store(true, std::memory_order_release);
+				}
+			}
+			return compressedColumns;
+		}
+		//All rows for bulk edits, invalidating the compressed copies once for the whole edit.
+		std::vector<std::map<size_t, T>>& getRows() {
+			invalidate();
+			return storage;
 		}
 		std::map<size_t, T>& operator[](size_t i) {
 			if (i >= rows || i < 0)
 				throw std::runtime_error(MakeString() << "Index (" << i << ",*) exceeds matrix bounds [" << rows << "," << cols << "]");
+			invalidate();
 			return storage[i];
 		}
 		const std::map<size_t, T>& operator[](size_t i) const {
@@ -786,15 +849,18 @@ namespace aly {
 			this->rows = rows;
 			this->cols = cols;
 			storage.resize(rows);
+			invalidate();
 		}
 		void set(size_t i, size_t j, const T& value) {
 			if (i >= rows || j >= cols || i < 0 || j < 0)
 				throw std::runtime_error(MakeString() << "Index (" << i << "," << j << ") exceeds matrix bounds [" << rows << "," << cols << "]");
+			invalidate();
 			storage[i][j] = value;
 		}
 		T& operator()(size_t i, size_t j) {
 			if (i >= rows || j >= cols || i < 0 || j < 0)
 				throw std::runtime_error(MakeString() << "Index (" << i << "," << j << ") exceeds matrix bounds [" << rows << "," << cols << "]");
+			invalidate();
 			return storage[i][j];
 		}
 
@@ -824,7 +890,7 @@ namespace aly {
 			int K = (int) aly::min(M, N);
 #pragma omp parallel for
 			for (int k = 0; k < K; k++) {
-				A[k][k] = T(T(1));
+				A.storage[k][k] = T(T(1));
 			}
 			return A;
 		}
@@ -832,7 +898,7 @@ namespace aly {
 			SparseMat<T> A(v.size(), v.size());
 #pragma omp parallel for
 			for (int k = 0; k < (int) v.size(); k++) {
-				A[k][k] = v[k];
+				A.storage[k][k] = v[k];
 			}
 			return A;
 		}
@@ -849,10 +915,11 @@ namespace aly {
 	}
 
 	template<class T> SparseMat<T>& operator*=(SparseMat<T>& A, const T& v) {
+		std::vector<std::map<size_t, T>>& aRows = A.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) A.rows; i++) {
-			for (std::pair<size_t, T>& pr : A[i]) {
-				A[i][pr.first] = pr.second * v;
+			for (std::pair<const size_t, T>& pr : aRows[i]) {
+				aRows[i][pr.first] = pr.second * v;
 			}
 		}
 		return A;
@@ -867,29 +934,32 @@ namespace aly {
 		return A;
 	}
 	template<class T> SparseMat<T>& operator+=(SparseMat<T>& A, const T& v) {
+		std::vector<std::map<size_t, T>>& aRows = A.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) A.rows; i++) {
-			for (std::pair<size_t, T>& pr : A[i]) {
-				A[i][pr.first] = pr.second + v;
+			for (std::pair<const size_t, T>& pr : aRows[i]) {
+				aRows[i][pr.first] = pr.second + v;
 			}
 		}
 		return A;
 	}
 	template<class T> SparseMat<T>& operator-=(SparseMat<T>& A, const T& v) {
+		std::vector<std::map<size_t, T>>& aRows = A.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) A.rows; i++) {
-			for (std::pair<size_t, T>& pr : A[i]) {
-				A[i][pr.first] = pr.second - v;
+			for (std::pair<const size_t, T>& pr : aRows[i]) {
+				aRows[i][pr.first] = pr.second - v;
 			}
 		}
 		return A;
 	}
 
 	template<class T> SparseMat<T>& operator/=(SparseMat<T>& A, const T& v) {
+		std::vector<std::map<size_t, T>>& aRows = A.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) A.rows; i++) {
-			for (std::pair<size_t, T>& pr : A[i]) {
-				A[i][pr.first] = pr.second / v;
+			for (std::pair<const size_t, T>& pr : aRows[i]) {
+				aRows[i][pr.first] = pr.second / v;
 			}
 		}
 		return A;
@@ -901,13 +971,14 @@ namespace aly {
 					MakeString() << "Cannot multiply matrices. Inner dimensions do not match. " << "[" << A.rows << "," << A.cols << "] * [" << B.rows << ","
 							<< B.cols << "]");
 		SparseMat<T> out(A.rows, B.cols);
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) { //a[i,*]
 			for (std::pair<size_t, T> pr1 : A[i]) { //a[i,k]
 				int k = (int) pr1.first;
 				for (std::pair<size_t, T> pr2 : B[k]) { //b[k,j]
 					int j = (int) pr2.first;
-					out[i][j] += pr1.second * pr2.second;
+					outRows[i][j] += pr1.second * pr2.second;
 				}
 			}
 		}
@@ -916,40 +987,44 @@ namespace aly {
 
 	template<class T> SparseMat<T> operator*(const T& v, const SparseMat<T>& A) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = v * pr.second;
+				outRows[i][pr.first] = v * pr.second;
 			}
 		}
 		return out;
 	}
 	template<class T> SparseMat<T> operator/(const T& v, const SparseMat<T>& A) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = v / pr.second;
+				outRows[i][pr.first] = v / pr.second;
 			}
 		}
 		return out;
 	}
 	template<class T> SparseMat<T> operator+(const T& v, const SparseMat<T>& A) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = T(v) + pr.second;
+				outRows[i][pr.first] = T(v) + pr.second;
 			}
 		}
 		return out;
 	}
 	template<class T> SparseMat<T> operator-(const T& v, const SparseMat<T>& A) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = T(v) - pr.second;
+				outRows[i][pr.first] = T(v) - pr.second;
 			}
 		}
 		return out;
@@ -957,30 +1032,33 @@ namespace aly {
 
 	template<class T> SparseMat<T> operator-(const SparseMat<T>& A, const T& v) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = pr.second - v;
+				outRows[i][pr.first] = pr.second - v;
 			}
 		}
 		return out;
 	}
 	template<class T> SparseMat<T> operator+(const SparseMat<T>& A, const T& v) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = pr.second + v;
+				outRows[i][pr.first] = pr.second + v;
 			}
 		}
 		return out;
 	}
 	template<class T> SparseMat<T> operator*(const SparseMat<T>& A, const T& v) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = pr.second * v;
+				outRows[i][pr.first] = pr.second * v;
 			}
 		}
 		return out;
@@ -988,10 +1066,11 @@ namespace aly {
 
 	template<class T> SparseMat<T> operator/(const SparseMat<T>& A, const T& v) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = pr.second / v;
+				outRows[i][pr.first] = pr.second / v;
 			}
 		}
 		return out;
@@ -999,10 +1078,11 @@ namespace aly {
 
 	template<class T> SparseMat<T> operator-(const SparseMat<T>& A) {
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : A[i]) {
-				out[i][pr.first] = -pr.second;
+				outRows[i][pr.first] = -pr.second;
 			}
 		}
 		return out;
@@ -1013,10 +1093,11 @@ namespace aly {
 					MakeString() << "Cannot add matrices. Dimensions do not match. " << "[" << A.rows << "," << A.cols << "] * [" << B.rows << "," << B.cols
 							<< "]");
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : B[i]) {
-				out[i][pr.first] += pr.second;
+				outRows[i][pr.first] += pr.second;
 			}
 		}
 		return out;
@@ -1027,10 +1108,11 @@ namespace aly {
 					MakeString() << "Cannot subtract matrices. Dimensions do not match. " << "[" << A.rows << "," << A.cols << "] * [" << B.rows << ","
 							<< B.cols << "]");
 		SparseMat<T> out = A;
+		std::vector<std::map<size_t, T>>& outRows = out.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) out.rows; i++) {
 			for (std::pair<size_t, T> pr : B[i]) {
-				out[i][pr.first] -= pr.second;
+				outRows[i][pr.first] -= pr.second;
 			}
 		}
 		return out;
@@ -1040,10 +1122,11 @@ namespace aly {
 			throw std::runtime_error(
 					MakeString() << "Cannot add matrices. Dimensions do not match. " << "[" << A.rows << "," << A.cols << "] * [" << B.rows << "," << B.cols
 							<< "]");
+		std::vector<std::map<size_t, T>>& aRows = A.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) A.rows; i++) {
 			for (std::pair<size_t, T> pr : B[i]) {
-				A[i][pr.first] += pr.second;
+				aRows[i][pr.first] += pr.second;
 			}
 		}
 		return A;
@@ -1053,92 +1136,72 @@ namespace aly {
 			throw std::runtime_error(
 					MakeString() << "Cannot subtract matrices. Dimensions do not match. " << "[" << A.rows << "," << A.cols << "] * [" << B.rows << ","
 							<< B.cols << "]");
+		std::vector<std::map<size_t, T>>& aRows = A.getRows();
 #pragma omp parallel for
 		for (int i = 0; i < (int) A.rows; i++) {
 			for (std::pair<size_t, T> pr : B[i]) {
-				A[i][pr.first] -= pr.second;
+				aRows[i][pr.first] -= pr.second;
 			}
 		}
 		return A;
 	}
-	template<class T> void Multiply(Vec<T>& out, const SparseMat<T>& A, const Vec<T>& v) {
-		out.resize(A.rows);
-#pragma omp parallel for
-		for (int i = 0; i < (int) A.rows; i++) {
-			double sum = (0.0);
-			for (const std::pair<size_t, T>& pr : A[i]) {
-				sum += double(v[pr.first]) * (double) pr.second;
+	//Row-parallel product of compressed rows against a vector. The functor receives each row index and its sum.
+	template<class T, class F> void CompressedMultiply(const CompressedRows<T>& M, const Vec<T>& v, const F& store) {
+		if (v.size() < M.cols)
+			throw std::runtime_error(MakeString() << "Cannot multiply matrix and vector. Dimensions do not match. [" << M.rows << "," << M.cols << "] * [" << v.size() << "]");
+		const size_t* offsets = M.offsets.data();
+		const uint32_t* columns = M.columns.data();
+		const T* values = M.values.data();
+		const T* in = v.data.data();
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < (int) M.rows; i++) {
+			double sum = 0.0;
+			const size_t end = offsets[i + 1];
+			for (size_t k = offsets[i]; k < end; k++) {
+				sum += double(in[columns[k]]) * double(values[k]);
 			}
-			out[i] = T(sum);
+			store(i, sum);
 		}
 	}
+	template<class T> void Multiply(Vec<T>& out, const SparseMat<T>& A, const Vec<T>& v) {
+		out.resize(A.rows);
+		CompressedMultiply(A.compress(), v, [&](int i, double sum) {
+			out.data[i] = T(sum);
+		});
+	}
+	template<class T> void MultiplyTranspose(Vec<T>& out, const SparseMat<T>& A, const Vec<T>& v) {
+		out.resize(A.cols);
+		CompressedMultiply(A.compressTranspose(), v, [&](int i, double sum) {
+			out.data[i] = T(sum);
+		});
+	}
 	template<class T> void AddMultiply(Vec<T>& out, const Vec<T>& b, const SparseMat<T>& A, const Vec<T>& v) {
 		out.resize(A.rows);
-#pragma omp parallel for
-		for (int i = 0; i < (int) A.rows; i++) {
-			double sum = 0.0;
-			for (const std::pair<size_t, T>& pr : A[i]) {
-				sum += double(v[pr.first]) * (double) pr.second;
-			}
-			out[i] = b[i] + T(sum);
-		}
+		CompressedMultiply(A.compress(), v, [&](int i, double sum) {
+			out.data[i] = b.data[i] + T(sum);
+		});
 	}
 	template<class T> void SubtractMultiply(Vec<T>& out, const Vec<T>& b, const SparseMat<T>& A, const Vec<T>& v) {
 		out.resize(A.rows);
-#pragma omp parallel for
-		for (int i = 0; i < (int) A.rows; i++) {
-			double sum = 0.0;
-			for (const std::pair<size_t, T>& pr : A[i]) {
-				sum += double(v[pr.first]) * (double) pr.second;
-			}
-			out[i] = b[i] - T(sum);
-		}
+		CompressedMultiply(A.compress(), v, [&](int i, double sum) {
+			out.data[i] = b.data[i] - T(sum);
+		});
 	}
 	template<class T> Vec<T> operator*(const SparseMat<T>& A, const Vec<T>& v) {
 		Vec<T> out(A.rows);
-#pragma omp parallel for
-		for (int i = 0; i < (int) A.rows; i++) {
-			double sum = 0.0;
-			for (const std::pair<size_t, T>& pr : A[i]) {
-				sum += double(v[pr.first]) * double(pr.second);
-			}
-			out[i] = T(sum);
-		}
+		CompressedMultiply(A.compress(), v, [&](int i, double sum) {
+			out.data[i] = T(sum);
+		});
 		return out;
 	}
 	template<class T> void MultiplyVec(Vec<T>& out, const SparseMat<T>& A, const Vec<T>& v) {
-		out.resize(A.rows);
-#pragma omp parallel for
-		for (int i = 0; i < (int) A.rows; i++) {
-			double sum = 0.0;
-			for (const std::pair<size_t, T>& pr : A[i]) {
-				sum += double(v[pr.first]) * double(pr.second);
-			}
-			out[i] = T(sum);
-		}
+		Multiply(out, A, v);
 	}
-
 	template<class T> void AddMultiplyVec(Vec<T>& out, const Vec<T>& b, const SparseMat<T>& A, const Vec<T>& v) {
-		out.resize(A.rows);
-#pragma omp parallel for
-		for (int i = 0; i < A.rows; i++) {
-			double sum = 0.0;
-			for (const std::pair<size_t, T>& pr : A[i]) {
-				sum += double(v[pr.first]) * double(pr.second);
-			}
-			out[i] = b[i] + T(sum);
-		}
+		AddMultiply(out, b, A, v);
 	}
 	template<class T> void SubtractMultiplyVec(Vec<T>& out, const Vec<T>& b, const SparseMat<T>& A, const Vec<T>& v) {
-		out.resize(A.rows);
-#pragma omp parallel for
-		for (int i = 0; i < (int) A.rows; i++) {
-			double sum = 0.0;
-			for (const std::pair<size_t, T>& pr : A[i]) {
-				sum += double(v[pr.first]) * double(pr.second);
-			}
-			out[i] = b[i] - T(sum);
-		}
+		SubtractMultiply(out, b, A, v);
 	}
 	template<class T> void WriteSparseMatToFile(const std::string& file, const SparseMat<T>& matrix) {
 		std::ofstream os(file);
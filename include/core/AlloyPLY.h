@@ -35,6 +35,7 @@
 namespace aly
 {
 	bool SANITY_CHECK_MESH_IO();
+	bool SANITY_CHECK_PLY_IO();
 namespace ply
 {
 enum class FileFormat
@@ -0,0 +1,336 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef INCLUDE_ALLOYSIMD_H_
+#define INCLUDE_ALLOYSIMD_H_
+#include "AlloyMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+namespace aly {
+bool SANITY_CHECK_SIMD();
+enum class SIMDInstructionSet {
+	Scalar = 0, SSE2 = 1, AVX2 = 2
+};
+template<class C, class R> std::basic_ostream<C, R> & operator <<(
+	std::basic_ostream<C, R> & ss, const SIMDInstructionSet& type) {
+	switch (type) {
+	case SIMDInstructionSet::Scalar:
+		return ss << "Scalar";
+	case SIMDInstructionSet::SSE2:
+		return ss << "SSE2";
+	case SIMDInstructionSet::AVX2:
+		return ss << "AVX2";
+	}
+	return ss;
+}
+//Best instruction set supported by this CPU.
+SIMDInstructionSet GetSupportedSIMDInstructionSet();
+//Instruction set used by the kernels below.
+SIMDInstructionSet GetSIMDInstructionSet();
+//Restricts kernels to an instruction set no better than what the CPU supports. Not thread safe.
+void SetSIMDInstructionSet(SIMDInstructionSet set);
+
+/*
+ * Element-wise kernels on flat arrays of n scalars, dispatched at runtime. Integer arithmetic wraps around like the
+ * scalar vec<uint8_t,C> operators. Min/max reductions are per channel for interleaved data with the given number of
+ * channels, and fold into the values already stored in minVal and maxVal.
+ */
+void SIMDAdd(float* out, const float* a, const float* b, size_t n);
+void SIMDSubtract(float* out, const float* a, const float* b, size_t n);
+void SIMDMultiply(float* out, const float* a, const float* b, size_t n);
+void SIMDDivide(float* out, const float* a, const float* b, size_t n);
+//out = a + b * c
+void SIMDMultiplyAdd(float* out, const float* a, const float* b, const float* c, size_t n);
+//out = a - b * c
+void SIMDMultiplySubtract(float* out, const float* a, const float* b, const float* c, size_t n);
+double SIMDDot(const float* a, const float* b, size_t n);
+void SIMDMinMax(const float* a, size_t n, int channels, float* minVal, float* maxVal);
+void SIMDAdd(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n);
+void SIMDSubtract(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n);
+void SIMDMultiply(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n);
+double SIMDDot(const uint8_t* a, const uint8_t* b, size_t n);
+void SIMDMinMax(const uint8_t* a, size_t n, int channels, uint8_t* minVal, uint8_t* maxVal);
+
+//Inlined loops for types without explicit SIMD paths. Compilers can auto-vectorize these.
+template<class T> struct ScalarKernels {
+	static void add(T* out, const T* a, const T* b, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			out[i] = a[i] + b[i];
+	}
+	static void subtract(T* out, const T* a, const T* b, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			out[i] = a[i] - b[i];
+	}
+	static void multiply(T* out, const T* a, const T* b, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			out[i] = a[i] * b[i];
+	}
+	static void divide(T* out, const T* a, const T* b, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			out[i] = a[i] / b[i];
+	}
+	static void multiplyAdd(T* out, const T* a, const T* b, const T* c, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			out[i] = a[i] + b[i] * c[i];
+	}
+	static void multiplySubtract(T* out, const T* a, const T* b, const T* c, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			out[i] = a[i] - b[i] * c[i];
+	}
+	static double dot(const T* a, const T* b, size_t n) {
+		double sum = 0.0;
+		for (size_t i = 0; i < n; i++)
+			sum += (double) a[i] * (double) b[i];
+		return sum;
+	}
+	static void minMax(const T* a, size_t n, int channels, T* minVal, T* maxVal) {
+		for (size_t i = 0; i < n; i += channels) {
+			for (int c = 0; c < channels && i + c < n; c++) {
+				minVal[c] = std::min(minVal[c], a[i + c]);
+				maxVal[c] = std::max(maxVal[c], a[i + c]);
+			}
+		}
+	}
+};
+template<class T> struct Kernels: public ScalarKernels<T> {
+};
+template<> struct Kernels<float> {
+	static void add(float* out, const float* a, const float* b, size_t n) {
+		SIMDAdd(out, a, b, n);
+	}
+	static void subtract(float* out, const float* a, const float* b, size_t n) {
+		SIMDSubtract(out, a, b, n);
+	}
+	static void multiply(float* out, const float* a, const float* b, size_t n) {
+		SIMDMultiply(out, a, b, n);
+	}
+	static void divide(float* out, const float* a, const float* b, size_t n) {
+		SIMDDivide(out, a, b, n);
+	}
+	static void multiplyAdd(float* out, const float* a, const float* b, const float* c, size_t n) {
+		SIMDMultiplyAdd(out, a, b, c, n);
+	}
+	static void multiplySubtract(float* out, const float* a, const float* b, const float* c, size_t n) {
+		SIMDMultiplySubtract(out, a, b, c, n);
+	}
+	static double dot(const float* a, const float* b, size_t n) {
+		return SIMDDot(a, b, n);
+	}
+	static void minMax(const float* a, size_t n, int channels, float* minVal, float* maxVal) {
+		SIMDMinMax(a, n, channels, minVal, maxVal);
+	}
+};
+template<> struct Kernels<uint8_t> : public ScalarKernels<uint8_t> {
+	static void add(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+		SIMDAdd(out, a, b, n);
+	}
+	static void subtract(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+		SIMDSubtract(out, a, b, n);
+	}
+	static void multiply(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+		SIMDMultiply(out, a, b, n);
+	}
+	static double dot(const uint8_t* a, const uint8_t* b, size_t n) {
+		return SIMDDot(a, b, n);
+	}
+	static void minMax(const uint8_t* a, size_t n, int channels, uint8_t* minVal, uint8_t* maxVal) {
+		SIMDMinMax(a, n, channels, minVal, maxVal);
+	}
+};
+struct AddKernel {
+	template<class T> static void apply(T* out, const T* a, const T* b, size_t n) {
+		Kernels<T>::add(out, a, b, n);
+	}
+};
+struct SubtractKernel {
+	template<class T> static void apply(T* out, const T* a, const T* b, size_t n) {
+		Kernels<T>::subtract(out, a, b, n);
+	}
+};
+struct MultiplyKernel {
+	template<class T> static void apply(T* out, const T* a, const T* b, size_t n) {
+		Kernels<T>::multiply(out, a, b, n);
+	}
+};
+struct DivideKernel {
+	template<class T> static void apply(T* out, const T* a, const T* b, size_t n) {
+		Kernels<T>::divide(out, a, b, n);
+	}
+};
+//Allocator for std::vector storage that starts on an ALIGN byte boundary, so SIMD loads never straddle cache lines.
+template<class T, size_t ALIGN = 64> struct AlignedAllocator {
+	typedef T value_type;
+	template<class U> struct rebind {
+		typedef AlignedAllocator<U, ALIGN> other;
+	};
+	AlignedAllocator() {
+	}
+	template<class U> AlignedAllocator(const AlignedAllocator<U, ALIGN>&) {
+	}
+	T* allocate(size_t n) {
+		if (n == 0)
+			return nullptr;
+		void* ptr = nullptr;
+#if defined(_MSC_VER)
+		ptr = _aligned_malloc(n * sizeof(T), ALIGN);
+#else
+		if (posix_memalign(&ptr, ALIGN, n * sizeof(T)) != 0)
+			ptr = nullptr;
+#endif
+		if (ptr == nullptr)
+			throw std::bad_alloc();
+		return static_cast<T*>(ptr);
+	}
+	void deallocate(T* ptr, size_t) {
+#if defined(_MSC_VER)
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+};
+template<class T, class U, size_t ALIGN> bool operator==(const AlignedAllocator<T, ALIGN>&, const AlignedAllocator<U, ALIGN>&) {
+	return true;
+}
+template<class T, class U, size_t ALIGN> bool operator!=(const AlignedAllocator<T, ALIGN>&, const AlignedAllocator<U, ALIGN>&) {
+	return false;
+}
+//Scalars per parallel task. Small inputs run on the calling thread.
+const size_t SIMD_BLOCK_SIZE = 1 << 16;
+template<class F> void ParallelBlocks(size_t n, size_t block, const F& func) {
+	if (n <= block) {
+		func((size_t) 0, n);
+		return;
+	}
+	const int64_t blocks = (int64_t) ((n + block - 1) / block);
+#pragma omp parallel for
+	for (int64_t b = 0; b < blocks; b++) {
+		size_t start = (size_t) b * block;
+		func(start, std::min(start + block, n));
+	}
+}
+//Repeats a per-channel scalar so it can be streamed through the flat kernels. Its length is a multiple of C.
+template<class T, int C> std::vector<T> MakeSIMDPattern(const vec<T, C>& scalar) {
+	std::vector<T> pattern(256 * C);
+	for (size_t i = 0; i < pattern.size(); i++) {
+		pattern[i] = scalar[(int) (i % C)];
+	}
+	return pattern;
+}
+//out = a op b
+template<class K, class T, int C> void VecTransform(vec<T, C>* out, const vec<T, C>* a, const vec<T, C>* b, size_t n) {
+	if (n == 0)
+		return;
+	T* o = &out[0][0];
+	const T* pa = &a[0][0];
+	const T* pb = &b[0][0];
+	ParallelBlocks(n * C, SIMD_BLOCK_SIZE, [=](size_t start, size_t end) {
+		K::apply(o + start, pa + start, pb + start, end - start);
+	});
+}
+//out = a op scalar, or out = scalar op a when scalarFirst is set.
+template<class K, class T, int C> void VecTransform(vec<T, C>* out, const vec<T, C>* a, const vec<T, C>& scalar, size_t n, bool scalarFirst = false) {
+	if (n == 0)
+		return;
+	const std::vector<T> pattern = MakeSIMDPattern(scalar);
+	const size_t len = pattern.size();
+	T* o = &out[0][0];
+	const T* pa = &a[0][0];
+	const T* ps = pattern.data();
+	ParallelBlocks(n * C, len * 64, [=](size_t start, size_t end) {
+		for (size_t i = start; i < end; i += len) {
+			size_t count = std::min(len, end - i);
+			if (scalarFirst) {
+				K::apply(o + i, ps, pa + i, count);
+			} else {
+				K::apply(o + i, pa + i, ps, count);
+			}
+		}
+	});
+}
+//out = a + scalar * b, or out = a - scalar * b when subtract is set.
+template<class T, int C> void VecScaleAdd(vec<T, C>* out, const vec<T, C>* a, const vec<T, C>& scalar, const vec<T, C>* b, size_t n, bool subtract = false) {
+	if (n == 0)
+		return;
+	const std::vector<T> pattern = MakeSIMDPattern(scalar);
+	const size_t len = pattern.size();
+	T* o = &out[0][0];
+	const T* pa = &a[0][0];
+	const T* pb = &b[0][0];
+	const T* ps = pattern.data();
+	ParallelBlocks(n * C, len * 64, [=](size_t start, size_t end) {
+		for (size_t i = start; i < end; i += len) {
+			size_t count = std::min(len, end - i);
+			if (subtract) {
+				Kernels<T>::multiplySubtract(o + i, pa + i, ps, pb + i, count);
+			} else {
+				Kernels<T>::multiplyAdd(o + i, pa + i, ps, pb + i, count);
+			}
+		}
+	});
+}
+template<class T, int C> double VecDot(const vec<T, C>* a, const vec<T, C>* b, size_t n) {
+	if (n == 0)
+		return 0.0;
+	const T* pa = &a[0][0];
+	const T* pb = &b[0][0];
+	const size_t total = n * C;
+	const size_t blocks = (total + SIMD_BLOCK_SIZE - 1) / SIMD_BLOCK_SIZE;
+	//Partial sums are combined in a fixed order so results do not depend on thread count.
+	std::vector<double> partial(blocks, 0.0);
+	ParallelBlocks(total, SIMD_BLOCK_SIZE, [&](size_t start, size_t end) {
+		partial[start / SIMD_BLOCK_SIZE] = Kernels<T>::dot(pa + start, pb + start, end - start);
+	});
+	double sum = 0.0;
+	for (double p : partial) {
+		sum += p;
+	}
+	return sum;
+}
+template<class T, int C> void VecMinMax(const vec<T, C>* a, size_t n, vec<T, C>& minVal, vec<T, C>& maxVal) {
+	minVal = vec<T, C>(std::numeric_limits<T>::max());
+	maxVal = vec<T, C>(std::numeric_limits<T>::lowest());
+	if (n == 0)
+		return;
+	const T* pa = &a[0][0];
+	const size_t total = n * C;
+	const size_t block = (SIMD_BLOCK_SIZE / C) * C;
+	const size_t blocks = (total + block - 1) / block;
+	std::vector<vec<T, C>> minVals(blocks, vec<T, C>(std::numeric_limits<T>::max()));
+	std::vector<vec<T, C>> maxVals(blocks, vec<T, C>(std::numeric_limits<T>::lowest()));
+	ParallelBlocks(total, block, [&](size_t start, size_t end) {
+		size_t b = start / block;
+		Kernels<T>::minMax(pa + start, end - start, C, &minVals[b][0], &maxVals[b][0]);
+	});
+	for (size_t b = 0; b < blocks; b++) {
+		minVal = minVec(minVal, minVals[b]);
+		maxVal = maxVec(maxVal, maxVals[b]);
+	}
+}
+}
+#endif /* INCLUDE_ALLOYSIMD_H_ */
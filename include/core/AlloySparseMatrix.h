@@ -30,24 +30,158 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <atomic>
+#include <mutex>
 namespace aly {
-
+/*
+ * Compressed sparse row (CSR) copy of a map based sparse matrix. Column indexes and values of each row
+ * are packed contiguously and addressed through row offsets, so matrix-vector products stream through
+ * memory instead of walking tree nodes. For vec<T,C> values this doubles as a block layout with C
+ * independent channels per non-zero.
+ */
+template<class V> struct CompressedRows {
+	size_t rows, cols;
+	std::vector<size_t> offsets;
+	std::vector<uint32_t> columns;
+	std::vector<V> values;
+	CompressedRows() :rows(0), cols(0)
+	{
+	}
+	size_t size() const {
+		return values.size();
+	}
+	void clear() {
+		rows = 0;
+		cols = 0;
+		offsets.clear();
+		columns.clear();
+		values.clear();
+	}
+	void build(const std::vector<std::map<size_t, V>>& storage, size_t rows, size_t cols) {
+		if (cols > (size_t)std::numeric_limits<uint32_t>::max())throw std::runtime_error(MakeString() << "Column count " << cols << " exceeds compressed row index range.");
+		this->rows = rows;
+		this->cols = cols;
+		offsets.resize(rows + 1);
+		offsets[0] = 0;
+		for (size_t i = 0;i < rows;i++) {
+			offsets[i + 1] = offsets[i] + storage[i].size();
+		}
+		columns.resize(offsets[rows]);
+		values.resize(offsets[rows]);
+#pragma omp parallel for
+		for (int i = 0;i < (int)rows;i++) {
+			size_t k = offsets[i];
+			for (const std::pair<const size_t, V>& pr : storage[i]) {
+				columns[k] = (uint32_t)pr.first;
+				values[k] = pr.second;
+				k++;
+			}
+		}
+	}
+	//Counting sort by column, so rows of the transpose come out sorted like the source.
+	void transpose(CompressedRows<V>& out) const {
+		out.rows = cols;
+		out.cols = rows;
+		out.offsets.assign(cols + 1, 0);
+		for (size_t k = 0;k < columns.size();k++) {
+			out.offsets[columns[k] + 1]++;
+		}
+		for (size_t j = 0;j < cols;j++) {
+			out.offsets[j + 1] += out.offsets[j];
+		}
+		out.columns.resize(size());
+		out.values.resize(size());
+		std::vector<size_t> next(out.offsets.begin(), out.offsets.end() - 1);
+		for (size_t i = 0;i < rows;i++) {
+			for (size_t k = offsets[i];k < offsets[i + 1];k++) {
+				size_t dest = next[columns[k]]++;
+				out.columns[dest] = (uint32_t)i;
+				out.values[dest] = values[k];
+			}
+		}
+	}
+};
 template<class T, int C> struct SparseMatrix {
 private:
 	std::vector<std::map<size_t, vec<T, C>>>storage;
+	mutable CompressedRows<vec<T, C>> compressedRows;
+	mutable CompressedRows<vec<T, C>> compressedColumns;
+	mutable std::atomic<bool> rowsValid { false };
+	mutable std::atomic<bool> columnsValid { false };
+	mutable std::mutex compressLock;
+	void invalidate() {
+		rowsValid.store(false, std::memory_order_relaxed);
+		columnsValid.store(false, std::memory_order_relaxed);
+	}
+	//Caller holds compressLock.
+	void buildRows() const {
+		if (!rowsValid.load(std::memory_order_relaxed)) {
+			compressedRows.build(storage, rows, cols);
+			rowsValid.store(true, std::memory_order_release);
+		}
+	}
 public:
 	size_t rows, cols;
 	SparseMatrix() :rows(0), cols(0)
 	{
 
+	}
+	SparseMatrix(const SparseMatrix<T, C>& M) :storage(M.storage), rows(M.rows), cols(M.cols)
+	{
+	}
+	SparseMatrix(SparseMatrix<T, C>&& M) :storage(std::move(M.storage)), rows(M.rows), cols(M.cols)
+	{
+	}
+	SparseMatrix<T, C>& operator=(const SparseMatrix<T, C>& M) {
+		storage = M.storage;
+		rows = M.rows;
+		cols = M.cols;
+		invalidate();
+		return *this;
+	}
+	SparseMatrix<T, C>& operator=(SparseMatrix<T, C>&& M) {
+		storage = std::move(M.storage);
+		rows = M.rows;
+		cols = M.cols;
+		invalidate();
+		return *this;
 	}
 	template<class Archive> void serialize(Archive & archive)
 	{
 		archive(CEREAL_NVP(rows), CEREAL_NVP(cols), cereal::make_nvp(MakeString() << "matrix" << C, storage));
+		invalidate();
+	}
+	//Compressed row copy used by matrix-vector products. It is rebuilt after any non-const access, under a lock so
+	//concurrent products on the same matrix build it once.
+	const CompressedRows<vec<T, C>>& compress() const {
+		if (!rowsValid.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lockMe(compressLock);
+			buildRows();
+		}
+		return compressedRows;
+	}
+	//Compressed row copy of the transpose, used by transpose-vector products.
+	const CompressedRows<vec<T, C>>& compressTranspose() const {
+		if (!columnsValid.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lockMe(compressLock);
+			if (!columnsValid.load(std::memory_order_relaxed)) {
+				buildRows();
+				compressedRows.transpose(compressedColumns);
+				columnsValid.store(true, std::memory_order_release);
+			}
+		}
+		return compressedColumns;
+	}
+	//All rows for bulk edits. The compressed copies are invalidated once here, so parallel loops can index rows
+	//without touching the cache state.
+	std::vector<std::map<size_t, vec<T, C>>>& getRows() {
+		invalidate();
+		return storage;
 	}
 	std::map<size_t, vec<T, C>>& operator[](size_t i)
 	{
 		if (i >= rows || i < 0)throw std::runtime_error(MakeString() << "Index (" << i << ",*) exceeds matrix bounds [" << rows << "," << cols << "]");
+		invalidate();
 		return storage[i];
 	}
 	const std::map<size_t, vec<T, C>>& operator[](size_t i) const
@@ -69,20 +203,24 @@ public:
 	    this->rows=rows;
 	    this->cols=cols;
 	    storage.resize(rows);
+	    invalidate();
 	}
 	void set(size_t i, size_t j, const vec<T, C>& value)
 	{
 		if (i >= rows || j >= cols || i < 0 || j < 0)throw std::runtime_error(MakeString() << "Index (" << i << "," << j << ") exceeds matrix bounds [" << rows << "," << cols << "]");
+		invalidate();
 		storage[i][j] = value;
 	}
 	void set(size_t i, size_t j, const T& value)
 	{
 		if (i >= rows || j >= cols || i < 0 || j < 0)throw std::runtime_error(MakeString() << "Index (" << i << "," << j << ") exceeds matrix bounds [" << rows << "," << cols << "]");
+		invalidate();
 		storage[i][j] = vec<T, C>(value);
 	}
 	vec<T, C>& operator()(size_t i, size_t j)
 	{
 		if (i >= rows || j >= cols || i < 0 || j < 0)throw std::runtime_error(MakeString() << "Index (" << i << "," << j << ") exceeds matrix bounds [" << rows << "," << cols << "]");
+		invalidate();
 		return storage[i][j];
 	}
 
@@ -121,7 +259,7 @@ public:
 #pragma omp parallel for
 		for (int k=0;k<K;k++)
 		{
-			A[k][k]=vec<T,C>(T(1));
+			A.storage[k][k]=vec<T,C>(T(1));
 		}
 		return A;
 	}
@@ -131,7 +269,7 @@ public:
 #pragma omp parallel for
 		for (int k = 0;k<(int)v.size();k++)
 		{
-			A[k][k] = v[k];
+			A.storage[k][k] = v[k];
 		}
 		return A;
 	}
@@ -150,10 +288,11 @@ template<class A, class B, class T, int C> std::basic_ostream<A, B> & operator <
 
 template<class T, int C> SparseMatrix<T, C>& operator*=(
 		SparseMatrix<T, C>& A, const vec<T, C>& v) {
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
-		for (std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			A[i][pr.first] = pr.second * v;
+		for (std::pair<const size_t, vec<T, C>>& pr : aRows[i]) {
+			aRows[i][pr.first] = pr.second * v;
 		}
 	}
 	return A;
@@ -170,60 +309,66 @@ template<class T, int C> SparseMatrix<T, C>& operator/=(
 }
 template<class T, int C> SparseMatrix<T, C>& operator+=(
 		SparseMatrix<T, C>& A, const vec<T, C>& v) {
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
-		for (std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			A[i][pr.first] = pr.second + v;
+		for (std::pair<const size_t, vec<T, C>>& pr : aRows[i]) {
+			aRows[i][pr.first] = pr.second + v;
 		}
 	}
 	return A;
 }
 template<class T, int C> SparseMatrix<T, C>& operator-=(
 		SparseMatrix<T, C>& A, const vec<T, C>& v) {
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
-		for (std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			A[i][pr.first] = pr.second - v;
+		for (std::pair<const size_t, vec<T, C>>& pr : aRows[i]) {
+			aRows[i][pr.first] = pr.second - v;
 		}
 	}
 	return A;
 }
 template<class T, int C> SparseMatrix<T, C>& operator*=(
 		SparseMatrix<T, C>& A, const T& v) {
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
-		for (std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			A[i][pr.first] = pr.second * v;
+		for (std::pair<const size_t, vec<T, C>>& pr : aRows[i]) {
+			aRows[i][pr.first] = pr.second * v;
 		}
 	}
 	return A;
 }
 template<class T, int C> SparseMatrix<T, C>& operator/=(
 		SparseMatrix<T, C>& A, const T& v) {
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
-		for (std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			A[i][pr.first] = pr.second / v;
+		for (std::pair<const size_t, vec<T, C>>& pr : aRows[i]) {
+			aRows[i][pr.first] = pr.second / v;
 		}
 	}
 	return A;
 }
 template<class T, int C> SparseMatrix<T, C>& operator+=(
 		SparseMatrix<T, C>& A, const T& v) {
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
-		for (std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			A[i][pr.first] = pr.second + v;
+		for (std::pair<const size_t, vec<T, C>>& pr : aRows[i]) {
+			aRows[i][pr.first] = pr.second + v;
 		}
 	}
 	return A;
 }
 template<class T, int C> SparseMatrix<T, C>& operator-=(
 		SparseMatrix<T, C>& A, const T& v) {
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
-		for (std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			A[i][pr.first] = pr.second - v;
+		for (std::pair<const size_t, vec<T, C>>& pr : aRows[i]) {
+			aRows[i][pr.first] = pr.second - v;
 		}
 	}
 	return A;
@@ -237,13 +382,14 @@ template<class T, int C> SparseMatrix<T, C> operator*(
 						<< "[" << A.rows << "," << A.cols << "] * [" << B.rows
 						<< "," << B.cols << "]");
 	SparseMatrix<T, C> out(A.rows, B.cols);
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) { //a[i,*]
 		for (std::pair<size_t, vec<T, C>> pr1 : A[i]) { //a[i,k]
 			int k = (int)pr1.first;
 			for (std::pair<size_t, vec<T, C>> pr2 : B[k]) { //b[k,j]
 				int j = (int)pr2.first;
-				out[i][j] += pr1.second * pr2.second;
+				outRows[i][j] += pr1.second * pr2.second;
 			}
 		}
 	}
@@ -253,10 +399,11 @@ template<class T, int C> SparseMatrix<T, C> operator*(
 template<class T, int C> SparseMatrix<T, C> operator*(const T& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = v * pr.second;
+			outRows[i][pr.first] = v * pr.second;
 		}
 	}
 	return out;
@@ -264,10 +411,11 @@ template<class T, int C> SparseMatrix<T, C> operator*(const T& v,
 template<class T, int C> SparseMatrix<T, C> operator/(const T& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = v / pr.second;
+			outRows[i][pr.first] = v / pr.second;
 		}
 	}
 	return out;
@@ -275,10 +423,11 @@ template<class T, int C> SparseMatrix<T, C> operator/(const T& v,
 template<class T, int C> SparseMatrix<T, C> operator+(const T& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = vec<T, C>(v) + pr.second;
+			outRows[i][pr.first] = vec<T, C>(v) + pr.second;
 		}
 	}
 	return out;
@@ -286,10 +435,11 @@ template<class T, int C> SparseMatrix<T, C> operator+(const T& v,
 template<class T, int C> SparseMatrix<T, C> operator-(const T& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = vec<T, C>(v) - pr.second;
+			outRows[i][pr.first] = vec<T, C>(v) - pr.second;
 		}
 	}
 	return out;
@@ -297,10 +447,11 @@ template<class T, int C> SparseMatrix<T, C> operator-(const T& v,
 template<class T, int C> SparseMatrix<T, C> operator*(const vec<T, C>& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = v * pr.second;
+			outRows[i][pr.first] = v * pr.second;
 		}
 	}
 	return out;
@@ -308,10 +459,11 @@ template<class T, int C> SparseMatrix<T, C> operator*(const vec<T, C>& v,
 template<class T, int C> SparseMatrix<T, C> operator/(const vec<T, C>& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = v / pr.second;
+			outRows[i][pr.first] = v / pr.second;
 		}
 	}
 	return out;
@@ -319,10 +471,11 @@ template<class T, int C> SparseMatrix<T, C> operator/(const vec<T, C>& v,
 template<class T, int C> SparseMatrix<T, C> operator+(const vec<T, C>& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = v + pr.second;
+			outRows[i][pr.first] = v + pr.second;
 		}
 	}
 	return out;
@@ -330,10 +483,11 @@ template<class T, int C> SparseMatrix<T, C> operator+(const vec<T, C>& v,
 template<class T, int C> SparseMatrix<T, C> operator-(const vec<T, C>& v,
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = v - pr.second;
+			outRows[i][pr.first] = v - pr.second;
 		}
 	}
 	return out;
@@ -342,10 +496,11 @@ template<class T, int C> SparseMatrix<T, C> operator-(const vec<T, C>& v,
 template<class T, int C> SparseMatrix<T, C> operator-(
 		const SparseMatrix<T, C>& A, const vec<T, C>& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second - v;
+			outRows[i][pr.first] = pr.second - v;
 		}
 	}
 	return out;
@@ -353,10 +508,11 @@ template<class T, int C> SparseMatrix<T, C> operator-(
 template<class T, int C> SparseMatrix<T, C> operator+(
 		const SparseMatrix<T, C>& A, const vec<T, C>& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second + v;
+			outRows[i][pr.first] = pr.second + v;
 		}
 	}
 	return out;
@@ -364,10 +520,11 @@ template<class T, int C> SparseMatrix<T, C> operator+(
 template<class T, int C> SparseMatrix<T, C> operator*(
 		const SparseMatrix<T, C>& A, const vec<T, C>& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second * v;
+			outRows[i][pr.first] = pr.second * v;
 		}
 	}
 	return out;
@@ -376,10 +533,11 @@ template<class T, int C> SparseMatrix<T, C> operator*(
 template<class T, int C> SparseMatrix<T, C> operator/(
 		const SparseMatrix<T, C>& A, const vec<T, C>& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second / v;
+			outRows[i][pr.first] = pr.second / v;
 		}
 	}
 	return out;
@@ -388,10 +546,11 @@ template<class T, int C> SparseMatrix<T, C> operator/(
 template<class T, int C> SparseMatrix<T, C> operator-(
 		const SparseMatrix<T, C>& A, const T& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second - vec<T, C>(v);
+			outRows[i][pr.first] = pr.second - vec<T, C>(v);
 		}
 	}
 	return out;
@@ -399,10 +558,11 @@ template<class T, int C> SparseMatrix<T, C> operator-(
 template<class T, int C> SparseMatrix<T, C> operator+(
 		const SparseMatrix<T, C>& A, const T& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second + vec<T, C>(v);
+			outRows[i][pr.first] = pr.second + vec<T, C>(v);
 		}
 	}
 	return out;
@@ -410,10 +570,11 @@ template<class T, int C> SparseMatrix<T, C> operator+(
 template<class T, int C> SparseMatrix<T, C> operator*(
 		const SparseMatrix<T, C>& A, const T& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second * v;
+			outRows[i][pr.first] = pr.second * v;
 		}
 	}
 	return out;
@@ -422,10 +583,11 @@ template<class T, int C> SparseMatrix<T, C> operator*(
 template<class T, int C> SparseMatrix<T, C> operator/(
 		const SparseMatrix<T, C>& A, const T& v) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = pr.second / v;
+			outRows[i][pr.first] = pr.second / v;
 		}
 	}
 	return out;
@@ -433,10 +595,11 @@ template<class T, int C> SparseMatrix<T, C> operator/(
 template<class T, int C> SparseMatrix<T, C> operator-(
 		const SparseMatrix<T, C>& A) {
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : A[i]) {
-			out[i][pr.first] = -pr.second;
+			outRows[i][pr.first] = -pr.second;
 		}
 	}
 	return out;
@@ -449,10 +612,11 @@ template<class T, int C> SparseMatrix<T, C> operator+(
 						<< "[" << A.rows << "," << A.cols << "] * [" << B.rows
 						<< "," << B.cols << "]");
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : B[i]) {
-			out[i][pr.first] += pr.second;
+			outRows[i][pr.first] += pr.second;
 		}
 	}
 	return out;
@@ -466,10 +630,11 @@ template<class T, int C> SparseMatrix<T, C> operator-(
 						<< "[" << A.rows << "," << A.cols << "] * [" << B.rows
 						<< "," << B.cols << "]");
 	SparseMatrix<T, C> out = A;
+	std::vector<std::map<size_t, vec<T, C>>>& outRows = out.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) out.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : B[i]) {
-			out[i][pr.first] -= pr.second;
+			outRows[i][pr.first] -= pr.second;
 		}
 	}
 	return out;
@@ -481,10 +646,11 @@ template<class T, int C> SparseMatrix<T, C>& operator+=(
 				MakeString() << "Cannot add matrices. Dimensions do not match. "
 						<< "[" << A.rows << "," << A.cols << "] * [" << B.rows
 						<< "," << B.cols << "]");
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : B[i]) {
-			A[i][pr.first] += pr.second;
+			aRows[i][pr.first] += pr.second;
 		}
 	}
 	return A;
@@ -497,103 +663,125 @@ template<class T, int C> SparseMatrix<T, C>& operator-=(
 						<< "Cannot subtract matrices. Dimensions do not match. "
 						<< "[" << A.rows << "," << A.cols << "] * [" << B.rows
 						<< "," << B.cols << "]");
+	std::vector<std::map<size_t, vec<T, C>>>& aRows = A.getRows();
 #pragma omp parallel for
 	for (int i = 0; i < (int) A.rows; i++) {
 		for (std::pair<size_t, vec<T, C>> pr : B[i]) {
-			A[i][pr.first] -= pr.second;
+			aRows[i][pr.first] -= pr.second;
 		}
 	}
 	return A;
 }
-template<class T, int C> void Multiply(Vector<T, C>& out,
-		const SparseMatrix<T, 1>& A, const Vector<T, C>& v) {
-	out.resize(A.rows);
-#pragma omp parallel for
-	for (int i = 0; i < (int) A.rows; i++) {
+//Row-parallel product of compressed rows with scalar values against a vector with C channels.
+//The functor receives each row index and its accumulated sum.
+template<class T, int C, class F> void CompressedMultiply(
+		const CompressedRows<vec<T, 1>>& M, const Vector<T, C>& v, const F& store) {
+	const size_t* offsets = M.offsets.data();
+	const uint32_t* columns = M.columns.data();
+	const vec<T, 1>* values = M.values.data();
+	if (v.size() < M.cols)
+		throw std::runtime_error(
+				MakeString() << "Cannot multiply matrix and vector. Dimensions do not match. "
+						<< "[" << M.rows << "," << M.cols << "] * [" << v.size() << "]");
+	const vec<T, C>* in = v.data.data();
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) M.rows; i++) {
+		vec<double, C> sum(0.0);
+		const size_t end = offsets[i + 1];
+		for (size_t k = offsets[i]; k < end; k++) {
+			sum += vec<double, C>(in[columns[k]]) * (double) values[k].x;
+		}
+		store(i, sum);
+	}
+}
+//Row-parallel product of compressed rows with channel-wise values against a vector with C channels.
+template<class T, int C, class F> void CompressedMultiplyVec(
+		const CompressedRows<vec<T, C>>& M, const Vector<T, C>& v, const F& store) {
+	const size_t* offsets = M.offsets.data();
+	const uint32_t* columns = M.columns.data();
+	const vec<T, C>* values = M.values.data();
+	if (v.size() < M.cols)
+		throw std::runtime_error(
+				MakeString() << "Cannot multiply matrix and vector. Dimensions do not match. "
+						<< "[" << M.rows << "," << M.cols << "] * [" << v.size() << "]");
+	const vec<T, C>* in = v.data.data();
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) M.rows; i++) {
 		vec<double, C> sum(0.0);
-		for (const std::pair<size_t, vec<T, 1>>& pr : A[i]) {
-			sum += vec<double, C>(v[pr.first]) * (double) pr.second.x;
+		const size_t end = offsets[i + 1];
+		for (size_t k = offsets[i]; k < end; k++) {
+			sum += vec<double, C>(in[columns[k]]) * vec<double, C>(values[k]);
 		}
-		out[i] = vec<T, C>(sum);
+		store(i, sum);
 	}
 }
+template<class T, int C> void Multiply(Vector<T, C>& out,
+		const SparseMatrix<T, 1>& A, const Vector<T, C>& v) {
+	out.resize(A.rows);
+	CompressedMultiply(A.compress(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = vec<T, C>(sum);
+	});
+}
+template<class T, int C> void MultiplyTranspose(Vector<T, C>& out,
+		const SparseMatrix<T, 1>& A, const Vector<T, C>& v) {
+	out.resize(A.cols);
+	CompressedMultiply(A.compressTranspose(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = vec<T, C>(sum);
+	});
+}
 template<class T, int C> void AddMultiply(Vector<T, C>& out,
 		const Vector<T, C>& b, const SparseMatrix<T, 1>& A,
 		const Vector<T, C>& v) {
 	out.resize(A.rows);
-#pragma omp parallel for
-	for (int i = 0; i < (int) A.rows; i++) {
-		vec<double, C> sum(0.0);
-		for (const std::pair<size_t, vec<T, 1>>& pr : A[i]) {
-			sum += vec<double, C>(v[pr.first]) * (double) pr.second.x;
-		}
-		out[i] = b[i] + vec<T, C>(sum);
-	}
+	CompressedMultiply(A.compress(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = b.data[i] + vec<T, C>(sum);
+	});
 }
 template<class T, int C> void SubtractMultiply(Vector<T, C>& out,
 		const Vector<T, C>& b, const SparseMatrix<T, 1>& A,
 		const Vector<T, C>& v) {
 	out.resize(A.rows);
-#pragma omp parallel for
-	for (int i = 0; i < (int) A.rows; i++) {
-		vec<double, C> sum(0.0);
-		for (const std::pair<size_t, vec<T, 1>>& pr : A[i]) {
-			sum += vec<double, C>(v[pr.first]) * (double) pr.second.x;
-		}
-		out[i] = b[i] - vec<T, C>(sum);
-	}
+	CompressedMultiply(A.compress(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = b.data[i] - vec<T, C>(sum);
+	});
 }
 template<class T, int C> Vector<T, C> operator*(const SparseMatrix<T, C>& A,
 		const Vector<T, C>& v) {
 	Vector<T, C> out(A.rows);
-#pragma omp parallel for
-	for (int i = 0; i < (int) A.rows; i++) {
-		vec<double, C> sum(0.0);
-		for (const std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			sum += vec<double, C>(v[pr.first]) * vec<double, C>(pr.second);
-		}
-		out[i] = vec<T, C>(sum);
-	}
+	CompressedMultiplyVec(A.compress(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = vec<T, C>(sum);
+	});
 	return out;
 }
 template<class T, int C> void MultiplyVec(Vector<T, C>& out,
 		const SparseMatrix<T, C>& A, const Vector<T, C>& v) {
 	out.resize(A.rows);
-#pragma omp parallel for
-	for (int i = 0; i < (int) A.rows; i++) {
-		vec<double, C> sum(0.0);
-		for (const std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			sum += vec<double, C>(v[pr.first]) * vec<double, C>(pr.second);
-		}
-		out[i] = vec<T, C>(sum);
-	}
+	CompressedMultiplyVec(A.compress(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = vec<T, C>(sum);
+	});
+}
+template<class T, int C> void MultiplyVecTranspose(Vector<T, C>& out,
+		const SparseMatrix<T, C>& A, const Vector<T, C>& v) {
+	out.resize(A.cols);
+	CompressedMultiplyVec(A.compressTranspose(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = vec<T, C>(sum);
+	});
 }
-
 template<class T, int C> void AddMultiplyVec(Vector<T, C>& out,
 		const Vector<T, C>& b, const SparseMatrix<T, C>& A,
 		const Vector<T, C>& v) {
 	out.resize(A.rows);
-#pragma omp parallel for
-	for (int i = 0; i < A.rows; i++) {
-		vec<double, C> sum(0.0);
-		for (const std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			sum += vec<double, C>(v[pr.first]) * vec<double, C>(pr.second);
-		}
-		out[i] = b[i] + vec<T, C>(sum);
-	}
+	CompressedMultiplyVec(A.compress(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = b.data[i] + vec<T, C>(sum);
+	});
 }
 template<class T, int C> void SubtractMultiplyVec(Vector<T, C>& out,
 		const Vector<T, C>& b, const SparseMatrix<T, C>& A,
 		const Vector<T, C>& v) {
 	out.resize(A.rows);
-#pragma omp parallel for
-	for (int i = 0; i < (int) A.rows; i++) {
-		vec<double, C> sum(0.0);
-		for (const std::pair<size_t, vec<T, C>>& pr : A[i]) {
-			sum += vec<double, C>(v[pr.first]) * vec<double, C>(pr.second);
-		}
-		out[i] = b[i] - vec<T, C>(sum);
-	}
+	CompressedMultiplyVec(A.compress(), v, [&](int i, const vec<double, C>& sum) {
+		out.data[i] = b.data[i] - vec<T, C>(sum);
+	});
 }
 template<class T, int C> void WriteSparseMatrixToFile(const std::string& file, const SparseMatrix<T, C>& matrix) {
 	std::ofstream os(file);
@@ -23,9 +23,347 @@
 #include "AlloyMath.h"
 #include "AlloyVector.h"
 #include "AlloySparseMatrix.h"
+#include <memory>
 namespace aly {
 bool SANITY_CHECK_ALGO();
 bool SANITY_CHECK_SPARSE_SOLVE();
+enum class PreconditionerType {
+	Identity, Jacobi, SSOR, IncompleteCholesky, IncompleteLU
+};
+template<class C, class R> std::basic_ostream<C, R> & operator <<(
+		std::basic_ostream<C, R> & ss, const PreconditionerType& type) {
+	switch (type) {
+	case PreconditionerType::Identity:
+		return ss << "Identity";
+	case PreconditionerType::Jacobi:
+		return ss << "Jacobi";
+	case PreconditionerType::SSOR:
+		return ss << "SSOR";
+	case PreconditionerType::IncompleteCholesky:
+		return ss << "IncompleteCholesky";
+	case PreconditionerType::IncompleteLU:
+		return ss << "IncompleteLU";
+	}
+	return ss;
+}
+//Inverse of a pivot, falling back to identity for (near) zero pivots.
+template<class T> inline T SafeReciprocal(const T& d) {
+	return (std::abs((double) d) > 1E-16) ? T(1) / d : T(1);
+}
+template<class T, int C> inline vec<T, C> SafeReciprocal(const vec<T, C>& d) {
+	vec<T, C> out;
+	for (int c = 0; c < C; c++) {
+		out[c] = SafeReciprocal(d[c]);
+	}
+	return out;
+}
+//Incomplete Cholesky pivots can turn non-positive for matrices that are not M-matrices. Fall back to the original diagonal.
+template<class T> inline T PositivePivot(const T& d, const T& a) {
+	T mag = std::abs(a);
+	if ((double) d > 1E-16 * (double) mag) {
+		return d;
+	}
+	return (mag > T(0)) ? mag : T(1);
+}
+template<class T, int C> inline vec<T, C> PositivePivot(const vec<T, C>& d,
+		const vec<T, C>& a) {
+	vec<T, C> out;
+	for (int c = 0; c < C; c++) {
+		out[c] = PositivePivot(d[c], a[c]);
+	}
+	return out;
+}
+template<class T> inline T ScaleValue(const T& v, double s) {
+	return T(v * s);
+}
+template<class T, int C> inline vec<T, C> ScaleValue(const vec<T, C>& v, double s) {
+	return v * T(s);
+}
+template<class T, int C> inline vec<double, C> SafeDenominator(vec<double, C> denom) {
+	const double ZERO_TOLERANCE = 1E-16;
+	for (int c = 0; c < C; c++) {
+		if (std::abs(denom[c]) < ZERO_TOLERANCE) {
+			denom[c] = (denom[c] < 0) ? -ZERO_TOLERANCE : ZERO_TOLERANCE;
+		}
+	}
+	return denom;
+}
+//Position of the diagonal entry in each compressed row.
+template<class V> std::vector<size_t> FindDiagonal(const CompressedRows<V>& A,
+		bool required) {
+	std::vector<size_t> diag(A.rows);
+	for (size_t i = 0; i < A.rows; i++) {
+		diag[i] = A.offsets[i + 1];
+		for (size_t k = A.offsets[i]; k < A.offsets[i + 1]; k++) {
+			if (A.columns[k] == i) {
+				diag[i] = k;
+				break;
+			}
+		}
+		if (required && diag[i] == A.offsets[i + 1])
+			throw std::runtime_error(
+					MakeString() << "Matrix has no diagonal entry in row " << i
+							<< ".");
+	}
+	return diag;
+}
+/*
+ * Approximate inverse M^-1 of a system matrix, applied once per Krylov iteration. V is the element type
+ * of the solution vector, so the same preconditioners serve Vector<T,C> and Vec<T> solvers.
+ */
+template<class V> class Preconditioner {
+public:
+	//out = M^-1 in
+	virtual void apply(std::vector<V>& out, const std::vector<V>& in) const = 0;
+	virtual ~Preconditioner() {
+	}
+};
+template<class V> class JacobiPreconditioner: public Preconditioner<V> {
+protected:
+	std::vector<V> invDiagonal;
+public:
+	JacobiPreconditioner(const CompressedRows<V>& A) :
+			invDiagonal(A.rows) {
+		std::vector<size_t> diag = FindDiagonal(A, false);
+#pragma omp parallel for
+		for (int i = 0; i < (int) A.rows; i++) {
+			invDiagonal[i] =
+					(diag[i] < A.offsets[i + 1]) ?
+							SafeReciprocal(A.values[diag[i]]) :
+							SafeReciprocal(V());
+		}
+	}
+	virtual void apply(std::vector<V>& out, const std::vector<V>& in) const
+			override {
+		out.resize(in.size());
+#pragma omp parallel for
+		for (int i = 0; i < (int) invDiagonal.size(); i++) {
+			out[i] = invDiagonal[i] * in[i];
+		}
+	}
+};
+//Symmetric successive over-relaxation. Symmetric for symmetric A, so it can be used with CG.
+template<class V> class SSORPreconditioner: public Preconditioner<V> {
+protected:
+	CompressedRows<V> A;
+	std::vector<size_t> diag;
+	std::vector<V> invDiagonal;
+	double omega;
+public:
+	SSORPreconditioner(const CompressedRows<V>& A, double omega = 1.0) :
+			A(A), diag(FindDiagonal(A, false)), invDiagonal(A.rows), omega(
+					omega) {
+		for (size_t i = 0; i < A.rows; i++) {
+			invDiagonal[i] =
+					(diag[i] < A.offsets[i + 1]) ?
+							SafeReciprocal(A.values[diag[i]]) :
+							SafeReciprocal(V());
+		}
+	}
+	virtual void apply(std::vector<V>& out, const std::vector<V>& in) const
+			override {
+		size_t N = A.rows;
+		out.resize(N);
+		//(D + w L) y = r
+		for (size_t i = 0; i < N; i++) {
+			V sum = V();
+			for (size_t k = A.offsets[i]; k < A.offsets[i + 1]; k++) {
+				if (A.columns[k] >= i)
+					break;
+				sum += A.values[k] * out[A.columns[k]];
+			}
+			out[i] = invDiagonal[i] * (in[i] - ScaleValue(sum, omega));
+		}
+		//(D + w U) z = D y, scaled by w(2-w)
+		for (size_t ii = N; ii > 0; ii--) {
+			size_t i = ii - 1;
+			V sum = V();
+			for (size_t k = A.offsets[i + 1]; k > A.offsets[i]; k--) {
+				if (A.columns[k - 1] <= i)
+					break;
+				sum += A.values[k - 1] * out[A.columns[k - 1]];
+			}
+			V d = (diag[i] < A.offsets[i + 1]) ? A.values[diag[i]] : SafeReciprocal(V());
+			out[i] = invDiagonal[i] * (d * out[i] - ScaleValue(sum, omega));
+		}
+		double scale = omega * (2.0 - omega);
+#pragma omp parallel for
+		for (int i = 0; i < (int) N; i++) {
+			out[i] = ScaleValue(out[i], scale);
+		}
+	}
+};
+//Incomplete LU factorization restricted to the sparsity pattern of A.
+template<class V> class IncompleteLUPreconditioner: public Preconditioner<V> {
+protected:
+	CompressedRows<V> LU;
+	std::vector<size_t> diag;
+	std::vector<V> invDiagonal;
+public:
+	IncompleteLUPreconditioner(const CompressedRows<V>& A) :
+			LU(A), diag(FindDiagonal(A, true)), invDiagonal(A.rows) {
+		const size_t NONE = std::numeric_limits<size_t>::max();
+		std::vector<size_t> marker(A.cols, NONE);
+		for (size_t i = 0; i < LU.rows; i++) {
+			for (size_t k = LU.offsets[i]; k < LU.offsets[i + 1]; k++) {
+				marker[LU.columns[k]] = k;
+			}
+			for (size_t k = LU.offsets[i]; k < diag[i]; k++) {
+				size_t j = LU.columns[k];
+				LU.values[k] = LU.values[k] * invDiagonal[j];
+				for (size_t m = diag[j] + 1; m < LU.offsets[j + 1]; m++) {
+					size_t pos = marker[LU.columns[m]];
+					if (pos != NONE) {
+						LU.values[pos] -= LU.values[k] * LU.values[m];
+					}
+				}
+			}
+			invDiagonal[i] = SafeReciprocal(LU.values[diag[i]]);
+			for (size_t k = LU.offsets[i]; k < LU.offsets[i + 1]; k++) {
+				marker[LU.columns[k]] = NONE;
+			}
+		}
+	}
+	virtual void apply(std::vector<V>& out, const std::vector<V>& in) const
+			override {
+		size_t N = LU.rows;
+		out.resize(N);
+		for (size_t i = 0; i < N; i++) {
+			V sum = in[i];
+			for (size_t k = LU.offsets[i]; k < diag[i]; k++) {
+				sum -= LU.values[k] * out[LU.columns[k]];
+			}
+			out[i] = sum;
+		}
+		for (size_t ii = N; ii > 0; ii--) {
+			size_t i = ii - 1;
+			V sum = out[i];
+			for (size_t k = diag[i] + 1; k < LU.offsets[i + 1]; k++) {
+				sum -= LU.values[k] * out[LU.columns[k]];
+			}
+			out[i] = invDiagonal[i] * sum;
+		}
+	}
+};
+/*
+ * Incomplete Cholesky factorization A ~ L D L^T on the lower triangle of A. Only meaningful for symmetric positive
+ * definite matrices, where it keeps the preconditioned system symmetric for CG.
+ */
+template<class V> class IncompleteCholeskyPreconditioner: public Preconditioner<V> {
+protected:
+	CompressedRows<V> L;
+	std::vector<V> invDiagonal;
+public:
+	IncompleteCholeskyPreconditioner(const CompressedRows<V>& A) :
+			invDiagonal(A.rows) {
+		std::vector<size_t> diag = FindDiagonal(A, true);
+		L.rows = A.rows;
+		L.cols = A.cols;
+		L.offsets.resize(A.rows + 1);
+		L.offsets[0] = 0;
+		for (size_t i = 0; i < A.rows; i++) {
+			L.offsets[i + 1] = L.offsets[i] + (diag[i] - A.offsets[i]);
+		}
+		L.columns.resize(L.offsets[A.rows]);
+		L.values.resize(L.offsets[A.rows]);
+		for (size_t i = 0; i < A.rows; i++) {
+			std::copy(A.columns.begin() + A.offsets[i],
+					A.columns.begin() + diag[i],
+					L.columns.begin() + L.offsets[i]);
+			std::copy(A.values.begin() + A.offsets[i],
+					A.values.begin() + diag[i],
+					L.values.begin() + L.offsets[i]);
+		}
+		const size_t NONE = std::numeric_limits<size_t>::max();
+		std::vector<size_t> marker(A.rows, NONE);
+		std::vector<V> D(A.rows);
+		for (size_t i = 0; i < L.rows; i++) {
+			for (size_t k = L.offsets[i]; k < L.offsets[i + 1]; k++) {
+				marker[L.columns[k]] = k;
+			}
+			V d = A.values[diag[i]];
+			for (size_t k = L.offsets[i]; k < L.offsets[i + 1]; k++) {
+				size_t j = L.columns[k];
+				V sum = L.values[k];
+				for (size_t m = L.offsets[j]; m < L.offsets[j + 1]; m++) {
+					size_t pos = marker[L.columns[m]];
+					if (pos != NONE) {
+						sum -= L.values[pos] * D[L.columns[m]] * L.values[m];
+					}
+				}
+				L.values[k] = sum * invDiagonal[j];
+				d -= L.values[k] * L.values[k] * D[j];
+			}
+			D[i] = PositivePivot(d, A.values[diag[i]]);
+			invDiagonal[i] = SafeReciprocal(D[i]);
+			for (size_t k = L.offsets[i]; k < L.offsets[i + 1]; k++) {
+				marker[L.columns[k]] = NONE;
+			}
+		}
+	}
+	virtual void apply(std::vector<V>& out, const std::vector<V>& in) const
+			override {
+		size_t N = L.rows;
+		out.resize(N);
+		for (size_t i = 0; i < N; i++) {
+			V sum = in[i];
+			for (size_t k = L.offsets[i]; k < L.offsets[i + 1]; k++) {
+				sum -= L.values[k] * out[L.columns[k]];
+			}
+			out[i] = sum;
+		}
+		for (size_t i = 0; i < N; i++) {
+			out[i] = invDiagonal[i] * out[i];
+		}
+		//L^T is traversed by scattering each finished row into the rows above it.
+		for (size_t ii = N; ii > 0; ii--) {
+			size_t i = ii - 1;
+			for (size_t k = L.offsets[i]; k < L.offsets[i + 1]; k++) {
+				out[L.columns[k]] -= L.values[k] * out[i];
+			}
+		}
+	}
+};
+template<class V> std::shared_ptr<Preconditioner<V>> MakePreconditioner(
+		const CompressedRows<V>& A, PreconditionerType type) {
+	switch (type) {
+	case PreconditionerType::Jacobi:
+		return std::shared_ptr<Preconditioner<V>>(
+				new JacobiPreconditioner<V>(A));
+	case PreconditionerType::SSOR:
+		return std::shared_ptr<Preconditioner<V>>(
+				new SSORPreconditioner<V>(A));
+	case PreconditionerType::IncompleteCholesky:
+		return std::shared_ptr<Preconditioner<V>>(
+				new IncompleteCholeskyPreconditioner<V>(A));
+	case PreconditionerType::IncompleteLU:
+		return std::shared_ptr<Preconditioner<V>>(
+				new IncompleteLUPreconditioner<V>(A));
+	case PreconditionerType::Identity:
+	default:
+		return std::shared_ptr<Preconditioner<V>>();
+	}
+}
+template<class T, int C> std::shared_ptr<Preconditioner<vec<T, C>>> MakePreconditioner(
+		const SparseMatrix<T, C>& A, PreconditionerType type) {
+	return MakePreconditioner(A.compress(), type);
+}
+//Preconditioner for a scalar matrix applied to a vector with C channels. Matrix values are replicated across channels.
+template<int C, class T> std::shared_ptr<Preconditioner<vec<T, C>>> MakeChannelPreconditioner(
+		const SparseMatrix<T, 1>& A, PreconditionerType type) {
+	const CompressedRows<vec<T, 1>>& M = A.compress();
+	CompressedRows<vec<T, C>> MC;
+	MC.rows = M.rows;
+	MC.cols = M.cols;
+	MC.offsets = M.offsets;
+	MC.columns = M.columns;
+	MC.values.resize(M.values.size());
+#pragma omp parallel for
+	for (int k = 0; k < (int) M.values.size(); k++) {
+		MC.values[k] = vec<T, C>(M.values[k].x);
+	}
+	return MakePreconditioner(MC, type);
+}
 template<class T, int C> void SolveVecCG(const Vector<T, C>& b,
 		const SparseMatrix<T, C>& A, Vector<T, C>& x, int iters = 100,
 		T tolerance = 1E-6f,
@@ -246,5 +584,164 @@ template<class T, int C> void SolveBICGStab(const Vector<T, C>& b,
 
 	}
 }
+template<class T, int C, class F> void SolvePreconditionedCG(
+		const Vector<T, C>& b, const F& multiply,
+		const Preconditioner<vec<T, C>>& M, Vector<T, C>& x, int iters,
+		T tolerance, const std::function<bool(int, double)>& iterationMonitor) {
+	size_t N = b.size();
+	Vector<T, C> r(N), z(N), p(N), Ap(N);
+	multiply(Ap, x);
+	Subtract(r, b, Ap);
+	double e = lengthL1(lengthVecSqr(r)) / N;
+	if (iterationMonitor) {
+		if (!iterationMonitor(0, e))return;
+	}
+	M.apply(z.data, r.data);
+	p = z;
+	vec<double, C> rz = dotVec(r, z);
+	for (int iter = 0; iter < iters; iter++) {
+		multiply(Ap, p);
+		vec<double, C> alpha = rz / SafeDenominator<T, C>(dotVec(p, Ap));
+		ScaleAdd(x, vec<T, C>(alpha), p);
+		ScaleSubtract(r, vec<T, C>(alpha), Ap);
+		double e = lengthL1(lengthVecSqr(r)) / N;
+		if (iterationMonitor) {
+			if (!iterationMonitor(iter + 1, e))return;
+		}
+		if (e < tolerance)
+			break;
+		M.apply(z.data, r.data);
+		vec<double, C> rzNext = dotVec(r, z);
+		vec<double, C> beta = rzNext / SafeDenominator<T, C>(rz);
+		ScaleAdd(p, z, vec<T, C>(beta), p);
+		rz = rzNext;
+	}
+}
+template<class T, int C, class F> void SolvePreconditionedBICGStab(
+		const Vector<T, C>& b, const F& multiply,
+		const Preconditioner<vec<T, C>>& M, Vector<T, C>& x, int iters,
+		T tolerance, const std::function<bool(int, double)>& iterationMonitor) {
+	const double ZERO_TOLERANCE = 1E-16;
+	size_t N = b.size();
+	Vector<T, C> r(N), rinit, p(N), v(N), s(N), t(N), y(N), z(N);
+	v.set(vec<T, C>(T(0)));
+	p.set(vec<T, C>(T(0)));
+	vec<double, C> rho(1.0), rhoNext;
+	vec<T, C> alpha(1), beta, omega(1);
+	multiply(t, x);
+	Subtract(r, b, t);
+	rinit = r;
+	double e = lengthL1(lengthVecSqr(r)) / N;
+	if (iterationMonitor) {
+		if (!iterationMonitor(0, e))return;
+	}
+	for (int iter = 0; iter < iters; iter++) {
+		rhoNext = dotVec(rinit, r);
+		beta = vec<T, C>(rhoNext / SafeDenominator<T, C>(rho)) * (alpha / omega);
+		ScaleAdd(p, r, beta, p, -beta * omega, v);
+		M.apply(y.data, p.data);
+		multiply(v, y);
+		alpha = vec<T, C>(rhoNext / SafeDenominator<T, C>(dotVec(rinit, v)));
+		ScaleSubtract(s, r, alpha, v);
+		if (lengthL1(s) < N * ZERO_TOLERANCE) {
+			ScaleAdd(x, alpha, y);
+			break;
+		}
+		M.apply(z.data, s.data);
+		multiply(t, z);
+		omega = vec<T, C>(dotVec(t, s) / SafeDenominator<T, C>(dotVec(t, t)));
+		ScaleAdd(x, x, alpha, y, omega, z);
+		ScaleSubtract(r, s, omega, t);
+		rho = rhoNext;
+		double e = lengthL1(lengthVecSqr(r)) / N;
+		if (iterationMonitor) {
+			if (!iterationMonitor(iter + 1, e))return;
+		}
+		if (e < tolerance)
+			break;
+	}
+}
+template<class T, int C> void SolveVecCG(const Vector<T, C>& b,
+		const SparseMatrix<T, C>& A, Vector<T, C>& x,
+		const Preconditioner<vec<T, C>>& M, int iters = 100,
+		T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	SolvePreconditionedCG(b, [&](Vector<T, C>& out, const Vector<T, C>& in) {
+		MultiplyVec(out, A, in);
+	}, M, x, iters, tolerance, iterationMonitor);
+}
+template<class T, int C> void SolveCG(const Vector<T, C>& b,
+		const SparseMatrix<T, 1>& A, Vector<T, C>& x,
+		const Preconditioner<vec<T, C>>& M, int iters = 100,
+		T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	SolvePreconditionedCG(b, [&](Vector<T, C>& out, const Vector<T, C>& in) {
+		Multiply(out, A, in);
+	}, M, x, iters, tolerance, iterationMonitor);
+}
+template<class T, int C> void SolveVecBICGStab(const Vector<T, C>& b,
+		const SparseMatrix<T, C>& A, Vector<T, C>& x,
+		const Preconditioner<vec<T, C>>& M, int iters = 100,
+		T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	SolvePreconditionedBICGStab(b,
+			[&](Vector<T, C>& out, const Vector<T, C>& in) {
+				MultiplyVec(out, A, in);
+			}, M, x, iters, tolerance, iterationMonitor);
+}
+template<class T, int C> void SolveBICGStab(const Vector<T, C>& b,
+		const SparseMatrix<T, 1>& A, Vector<T, C>& x,
+		const Preconditioner<vec<T, C>>& M, int iters = 100,
+		T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	SolvePreconditionedBICGStab(b,
+			[&](Vector<T, C>& out, const Vector<T, C>& in) {
+				Multiply(out, A, in);
+			}, M, x, iters, tolerance, iterationMonitor);
+}
+template<class T, int C> void SolveVecCG(const Vector<T, C>& b,
+		const SparseMatrix<T, C>& A, Vector<T, C>& x, PreconditionerType type,
+		int iters = 100, T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	std::shared_ptr<Preconditioner<vec<T, C>>> M = MakePreconditioner(A, type);
+	if (M.get() == nullptr) {
+		SolveVecCG(b, A, x, iters, tolerance, iterationMonitor);
+	} else {
+		SolveVecCG(b, A, x, *M, iters, tolerance, iterationMonitor);
+	}
+}
+template<class T, int C> void SolveCG(const Vector<T, C>& b,
+		const SparseMatrix<T, 1>& A, Vector<T, C>& x, PreconditionerType type,
+		int iters = 100, T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	std::shared_ptr<Preconditioner<vec<T, C>>> M = MakeChannelPreconditioner<C>(A, type);
+	if (M.get() == nullptr) {
+		SolveCG(b, A, x, iters, tolerance, iterationMonitor);
+	} else {
+		SolveCG(b, A, x, *M, iters, tolerance, iterationMonitor);
+	}
+}
+template<class T, int C> void SolveVecBICGStab(const Vector<T, C>& b,
+		const SparseMatrix<T, C>& A, Vector<T, C>& x, PreconditionerType type,
+		int iters = 100, T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	std::shared_ptr<Preconditioner<vec<T, C>>> M = MakePreconditioner(A, type);
+	if (M.get() == nullptr) {
+		SolveVecBICGStab(b, A, x, iters, tolerance, iterationMonitor);
+	} else {
+		SolveVecBICGStab(b, A, x, *M, iters, tolerance, iterationMonitor);
+	}
+}
+template<class T, int C> void SolveBICGStab(const Vector<T, C>& b,
+		const SparseMatrix<T, 1>& A, Vector<T, C>& x, PreconditionerType type,
+		int iters = 100, T tolerance = 1E-6f,
+		const std::function<bool(int, double)>& iterationMonitor = nullptr) {
+	std::shared_ptr<Preconditioner<vec<T, C>>> M = MakeChannelPreconditioner<C>(A, type);
+	if (M.get() == nullptr) {
+		SolveBICGStab(b, A, x, iters, tolerance, iterationMonitor);
+	} else {
+		SolveBICGStab(b, A, x, *M, iters, tolerance, iterationMonitor);
+	}
+}
 }
 #endif
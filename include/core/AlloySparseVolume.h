@@ -0,0 +1,715 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef INCLUDE_ALLOYSPARSEVOLUME_H_
+#define INCLUDE_ALLOYSPARSEVOLUME_H_
+#include "AlloyVolume.h"
+#include <bitset>
+#include <memory>
+#include <unordered_map>
+namespace aly {
+	bool SANITY_CHECK_SPARSE_VOLUME();
+	/*
+	 Museth, K. (2013). VDB: High-resolution sparse volumes with dynamic topology. ACM Transactions on Graphics, 32(3), 27.
+
+	 Two level variant of VDB. Voxels live in 8x8x8 leaf bricks found through a hash table keyed by brick coordinate.
+	 A table entry without a leaf is a tile, a whole brick with one inactive value. Bricks missing from the table take
+	 the background value, so memory scales with the number of active voxels rather than the volume dimensions.
+	 */
+	template<class T, int C, ImageType I> class SparseVolume {
+	public:
+		typedef vec<T, C> ValueType;
+		static const int LEAF_SHIFT = 3;
+		static const int LEAF_SIZE = 1 << LEAF_SHIFT;
+		static const int LEAF_MASK = LEAF_SIZE - 1;
+		static const int LEAF_VOXELS = LEAF_SIZE * LEAF_SIZE * LEAF_SIZE;
+		struct Leaf {
+			int3 origin;
+			std::bitset<LEAF_VOXELS> active;
+			ValueType values[LEAF_VOXELS];
+		};
+		//Position of voxel (i,j,k) inside its leaf.
+		static int leafOffset(int i, int j, int k) {
+			return (i & LEAF_MASK) | ((j & LEAF_MASK) << LEAF_SHIFT)
+				| ((k & LEAF_MASK) << (2 * LEAF_SHIFT));
+		}
+		//Hash key of the brick containing voxel (i,j,k). Supports up to 2^24 voxels per axis.
+		static uint64_t leafKey(int i, int j, int k) {
+			return (uint64_t)(i >> LEAF_SHIFT)
+				| ((uint64_t)(j >> LEAF_SHIFT) << 21)
+				| ((uint64_t)(k >> LEAF_SHIFT) << 42);
+		}
+		//First voxel of the brick with the given key.
+		static int3 keyOrigin(uint64_t key) {
+			return int3((int)(key & 0x1FFFFF), (int)((key >> 21) & 0x1FFFFF),
+				(int)(key >> 42)) * LEAF_SIZE;
+		}
+		static bool isClose(const ValueType& a, const ValueType& b, T tolerance) {
+			for (int c = 0; c < C; c++) {
+				if (std::abs((double)a[c] - (double)b[c]) > (double)tolerance)
+					return false;
+			}
+			return true;
+		}
+	protected:
+		struct Node {
+			int leaf;
+			ValueType tile;
+			Node(int leaf = -1, const ValueType& tile = ValueType()) :
+				leaf(leaf), tile(tile) {
+			}
+		};
+		static const uint64_t INVALID_KEY = ~0ULL;
+		std::unordered_map<uint64_t, Node> table;
+		std::vector<std::unique_ptr<Leaf>> leaves;
+		ValueType background;
+		const Node* findNode(uint64_t key) const {
+			auto iter = table.find(key);
+			return (iter != table.end()) ? &iter->second : nullptr;
+		}
+		//Leaf pointer or constant value of the brick with the given key.
+		const Leaf* findBrick(uint64_t key, ValueType& value) const {
+			const Node* node = findNode(key);
+			if (node == nullptr) {
+				value = background;
+				return nullptr;
+			}
+			value = node->tile;
+			return (node->leaf >= 0) ? leaves[node->leaf].get() : nullptr;
+		}
+		Leaf* addLeaf(uint64_t key, const int3& origin, const ValueType& value) {
+			Leaf* leaf = new Leaf();
+			leaf->origin = origin;
+			std::fill(leaf->values, leaf->values + LEAF_VOXELS, value);
+			table[key] = Node((int)leaves.size(), value);
+			leaves.push_back(std::unique_ptr<Leaf>(leaf));
+			return leaf;
+		}
+		//Drops flagged leaves and renumbers the table entries of the ones that remain.
+		void compact(const std::vector<uint8_t>& remove) {
+			size_t n = 0;
+			for (size_t l = 0; l < leaves.size(); l++) {
+				if (remove[l])
+					continue;
+				if (n != l)
+					leaves[n] = std::move(leaves[l]);
+				const int3& o = leaves[n]->origin;
+				table[leafKey(o.x, o.y, o.z)].leaf = (int)n;
+				n++;
+			}
+			leaves.resize(n);
+		}
+	public:
+		int rows;
+		int cols;
+		int slices;
+		static const int channels = C;
+		static const ImageType type = I;
+		//Caches the last brick visited, so coherent traversals only touch the hash table once per brick.
+		//Accessors are invalidated by setTile(), prune() and clear().
+		class Accessor {
+		protected:
+			SparseVolume* volume;
+			uint64_t key;
+			Leaf* leaf;
+			ValueType tile;
+			void fetch(uint64_t k) {
+				key = k;
+				leaf = const_cast<Leaf*>(volume->findBrick(k, tile));
+			}
+		public:
+			Accessor(SparseVolume& volume) :
+				volume(&volume), key(INVALID_KEY), leaf(nullptr) {
+			}
+			ValueType getValue(int i, int j, int k) {
+				uint64_t bk = leafKey(i, j, k);
+				if (bk != key)
+					fetch(bk);
+				return (leaf != nullptr) ? leaf->values[leafOffset(i, j, k)] : tile;
+			}
+			bool isActive(int i, int j, int k) {
+				uint64_t bk = leafKey(i, j, k);
+				if (bk != key)
+					fetch(bk);
+				return (leaf != nullptr) && leaf->active[leafOffset(i, j, k)];
+			}
+			void setValue(int i, int j, int k, const ValueType& value,
+				bool active = true) {
+				uint64_t bk = leafKey(i, j, k);
+				if (bk != key || leaf == nullptr) {
+					key = bk;
+					leaf = volume->touchLeaf(i, j, k);
+				}
+				int off = leafOffset(i, j, k);
+				leaf->values[off] = value;
+				leaf->active[off] = active;
+			}
+		};
+		class ConstAccessor {
+		protected:
+			const SparseVolume* volume;
+			uint64_t key;
+			const Leaf* leaf;
+			ValueType tile;
+		public:
+			ConstAccessor(const SparseVolume& volume) :
+				volume(&volume), key(INVALID_KEY), leaf(nullptr) {
+			}
+			ValueType getValue(int i, int j, int k) {
+				uint64_t bk = leafKey(i, j, k);
+				if (bk != key) {
+					key = bk;
+					leaf = volume->findBrick(bk, tile);
+				}
+				return (leaf != nullptr) ? leaf->values[leafOffset(i, j, k)] : tile;
+			}
+			bool isActive(int i, int j, int k) {
+				uint64_t bk = leafKey(i, j, k);
+				if (bk != key) {
+					key = bk;
+					leaf = volume->findBrick(bk, tile);
+				}
+				return (leaf != nullptr) && leaf->active[leafOffset(i, j, k)];
+			}
+		};
+		//Visits active voxels leaf by leaf: for(auto iter=vol.beginActive();iter;++iter)
+		class ActiveIterator {
+		protected:
+			const SparseVolume* volume;
+			size_t leaf;
+			int offset;
+			void advance() {
+				while (leaf < volume->leaves.size()) {
+					const std::bitset<LEAF_VOXELS>& bits = volume->leaves[leaf]->active;
+					if (bits.any()) {
+						while (offset < LEAF_VOXELS && !bits[offset])
+							offset++;
+						if (offset < LEAF_VOXELS)
+							return;
+					}
+					leaf++;
+					offset = 0;
+				}
+			}
+		public:
+			ActiveIterator(const SparseVolume& volume) :
+				volume(&volume), leaf(0), offset(0) {
+				advance();
+			}
+			explicit operator bool() const {
+				return (leaf < volume->leaves.size());
+			}
+			ActiveIterator& operator++() {
+				offset++;
+				advance();
+				return *this;
+			}
+			int3 coord() const {
+				return volume->leaves[leaf]->origin
+					+ int3(offset & LEAF_MASK, (offset >> LEAF_SHIFT) & LEAF_MASK,
+						offset >> (2 * LEAF_SHIFT));
+			}
+			const ValueType& value() const {
+				return volume->leaves[leaf]->values[offset];
+			}
+		};
+		SparseVolume(int r, int c, int s,
+			const ValueType& background = ValueType((T)0)) :
+			background(background), rows(r), cols(c), slices(s) {
+		}
+		SparseVolume() :
+			SparseVolume(0, 0, 0) {
+		}
+		SparseVolume(const SparseVolume& vol) :
+			table(vol.table), background(vol.background), rows(vol.rows), cols(
+				vol.cols), slices(vol.slices) {
+			leaves.reserve(vol.leaves.size());
+			for (const std::unique_ptr<Leaf>& leaf : vol.leaves) {
+				leaves.push_back(std::unique_ptr<Leaf>(new Leaf(*leaf)));
+			}
+		}
+		SparseVolume(SparseVolume&& vol) = default;
+		SparseVolume& operator=(const SparseVolume& vol) {
+			if (this != &vol) {
+				SparseVolume tmp(vol);
+				*this = std::move(tmp);
+			}
+			return *this;
+		}
+		SparseVolume& operator=(SparseVolume&& vol) = default;
+		int3 dimensions() const {
+			return int3(rows, cols, slices);
+		}
+		//Number of voxels in the equivalent dense volume.
+		size_t size() const {
+			return (size_t)rows * cols * slices;
+		}
+		void resize(int r, int c, int s) {
+			clear();
+			rows = r;
+			cols = c;
+			slices = s;
+		}
+		void clear() {
+			table.clear();
+			leaves.clear();
+		}
+		const ValueType& getBackground() const {
+			return background;
+		}
+		//Changes the value of every brick that is not stored.
+		void setBackground(const ValueType& value) {
+			background = value;
+		}
+		size_t leafCount() const {
+			return leaves.size();
+		}
+		size_t tileCount() const {
+			return table.size() - leaves.size();
+		}
+		size_t activeCount() const {
+			size_t count = 0;
+			for (const std::unique_ptr<Leaf>& leaf : leaves) {
+				count += leaf->active.count();
+			}
+			return count;
+		}
+		const Leaf& getLeaf(size_t n) const {
+			return *leaves[n];
+		}
+		Leaf& getLeaf(size_t n) {
+			return *leaves[n];
+		}
+		Accessor getAccessor() {
+			return Accessor(*this);
+		}
+		ConstAccessor getConstAccessor() const {
+			return ConstAccessor(*this);
+		}
+		ActiveIterator beginActive() const {
+			return ActiveIterator(*this);
+		}
+		//Coordinates must lie inside the volume.
+		ValueType getValue(int i, int j, int k) const {
+			ValueType value;
+			const Leaf* leaf = findBrick(leafKey(i, j, k), value);
+			return (leaf != nullptr) ? leaf->values[leafOffset(i, j, k)] : value;
+		}
+		//Clamps to the volume boundary like Volume::operator().
+		ValueType operator()(int i, int j, int k) const {
+			return getValue(aly::clamp(i, 0, rows - 1), aly::clamp(j, 0, cols - 1),
+				aly::clamp(k, 0, slices - 1));
+		}
+		bool isActive(int i, int j, int k) const {
+			const Node* node = findNode(leafKey(i, j, k));
+			return (node != nullptr && node->leaf >= 0
+				&& leaves[node->leaf]->active[leafOffset(i, j, k)]);
+		}
+		void setValue(int i, int j, int k, const ValueType& value, bool active =
+			true) {
+			Leaf* leaf = touchLeaf(i, j, k);
+			int off = leafOffset(i, j, k);
+			leaf->values[off] = value;
+			leaf->active[off] = active;
+		}
+		void setActive(int i, int j, int k, bool active) {
+			touchLeaf(i, j, k)->active[leafOffset(i, j, k)] = active;
+		}
+		//Leaf containing voxel (i,j,k), created from the tile or background value if necessary.
+		Leaf* touchLeaf(int i, int j, int k) {
+			uint64_t key = leafKey(i, j, k);
+			auto iter = table.find(key);
+			if (iter != table.end() && iter->second.leaf >= 0)
+				return leaves[iter->second.leaf].get();
+			ValueType value = (iter != table.end()) ? iter->second.tile : background;
+			return addLeaf(key,
+				int3(i & ~LEAF_MASK, j & ~LEAF_MASK, k & ~LEAF_MASK), value);
+		}
+		//Replaces the brick containing voxel (i,j,k) with a constant inactive value.
+		void setTile(int i, int j, int k, const ValueType& value) {
+			uint64_t key = leafKey(i, j, k);
+			auto iter = table.find(key);
+			if (iter != table.end() && iter->second.leaf >= 0) {
+				std::vector<uint8_t> remove(leaves.size(), 0);
+				remove[iter->second.leaf] = 1;
+				compact(remove);
+			}
+			table[key] = Node(-1, value);
+		}
+		//Collapses leaves without active voxels whose values agree within tolerance into tiles,
+		//and removes tiles equal to the background.
+		void prune(T tolerance = T(0)) {
+			const int N = (int)leaves.size();
+			std::vector<uint8_t> remove(N, 0);
+#pragma omp parallel for
+			for (int n = 0; n < N; n++) {
+				const Leaf& leaf = *leaves[n];
+				if (leaf.active.any())
+					continue;
+				bool uniform = true;
+				for (int v = 1; v < LEAF_VOXELS && uniform; v++) {
+					uniform = isClose(leaf.values[v], leaf.values[0], tolerance);
+				}
+				remove[n] = uniform;
+			}
+			for (int n = 0; n < N; n++) {
+				if (remove[n]) {
+					const int3& o = leaves[n]->origin;
+					table[leafKey(o.x, o.y, o.z)] = Node(-1, leaves[n]->values[0]);
+				}
+			}
+			compact(remove);
+			for (auto iter = table.begin(); iter != table.end();) {
+				if (iter->second.leaf < 0
+					&& isClose(iter->second.tile, background, tolerance)) {
+					iter = table.erase(iter);
+				}
+				else {
+					iter++;
+				}
+			}
+		}
+		//Calls func(origin,value) for every tile.
+		template<class F> void forEachTile(const F& func) const {
+			for (const std::pair<const uint64_t, Node>& entry : table) {
+				if (entry.second.leaf < 0)
+					func(keyOrigin(entry.first), entry.second.tile);
+			}
+		}
+		//Calls func(coord,value) for every active voxel. Leaves are processed in parallel.
+		template<class F> void forEachActive(const F& func) {
+			const int N = (int)leaves.size();
+#pragma omp parallel for
+			for (int n = 0; n < N; n++) {
+				Leaf& leaf = *leaves[n];
+				for (int v = 0; v < LEAF_VOXELS; v++) {
+					if (leaf.active[v]) {
+						func(leaf.origin + int3(v & LEAF_MASK,
+							(v >> LEAF_SHIFT) & LEAF_MASK, v >> (2 * LEAF_SHIFT)),
+							leaf.values[v]);
+					}
+				}
+			}
+		}
+		void toDense(Volume<T, C, I>& out) const {
+			out.resize(rows, cols, slices);
+			out.set(background);
+			std::vector<std::pair<int3, const Node*>> bricks;
+			bricks.reserve(table.size());
+			for (const std::pair<const uint64_t, Node>& entry : table) {
+				bricks.push_back(std::pair<int3, const Node*>(keyOrigin(entry.first), &entry.second));
+			}
+			const int N = (int)bricks.size();
+			const size_t sliceSize = (size_t)rows * cols;
+#pragma omp parallel for
+			for (int n = 0; n < N; n++) {
+				const int3& lo = bricks[n].first;
+				const Node* node = bricks[n].second;
+				const Leaf* leaf = (node->leaf >= 0) ? leaves[node->leaf].get() : nullptr;
+				int3 hi = aly::minVec(lo + int3(LEAF_SIZE), dimensions());
+				for (int k = lo.z; k < hi.z; k++) {
+					for (int j = lo.y; j < hi.y; j++) {
+						for (int i = lo.x; i < hi.x; i++) {
+							out.data[i + (size_t)j * rows + k * sliceSize] =
+								(leaf != nullptr) ? leaf->values[leafOffset(i, j, k)] : node->tile;
+						}
+					}
+				}
+			}
+		}
+		//Voxels that differ from the background by more than tolerance become active. Bricks that are constant
+		//within tolerance are stored as tiles.
+		void fromDense(const Volume<T, C, I>& in, T tolerance = T(0)) {
+			resize(in.rows, in.cols, in.slices);
+			const int3 count = (dimensions() + int3(LEAF_MASK)) / LEAF_SIZE;
+			const int N = count.x * count.y * count.z;
+			const size_t sliceSize = (size_t)rows * cols;
+			//0 for background, 1 for tile, 2 for leaf
+			std::vector<uint8_t> kind(N, 0);
+#pragma omp parallel for
+			for (int n = 0; n < N; n++) {
+				int3 lo = int3(n % count.x, (n / count.x) % count.y,
+					n / (count.x * count.y)) * LEAF_SIZE;
+				int3 hi = aly::minVec(lo + int3(LEAF_SIZE), dimensions());
+				const ValueType& first = in.data[lo.x + (size_t)lo.y * rows + lo.z * sliceSize];
+				bool uniform = true;
+				bool empty = isClose(first, background, tolerance);
+				for (int k = lo.z; k < hi.z; k++) {
+					for (int j = lo.y; j < hi.y; j++) {
+						for (int i = lo.x; i < hi.x; i++) {
+							const ValueType& val = in.data[i + (size_t)j * rows + k * sliceSize];
+							if (uniform && !isClose(val, first, tolerance))
+								uniform = false;
+							if (empty && !isClose(val, background, tolerance))
+								empty = false;
+						}
+					}
+				}
+				kind[n] = (empty) ? 0 : ((uniform) ? 1 : 2);
+			}
+			for (int n = 0; n < N; n++) {
+				if (kind[n] == 0)
+					continue;
+				int3 lo = int3(n % count.x, (n / count.x) % count.y,
+					n / (count.x * count.y)) * LEAF_SIZE;
+				uint64_t key = leafKey(lo.x, lo.y, lo.z);
+				if (kind[n] == 1) {
+					table[key] = Node(-1, in.data[lo.x + (size_t)lo.y * rows + lo.z * sliceSize]);
+				}
+				else {
+					addLeaf(key, lo, background);
+				}
+			}
+			const int L = (int)leaves.size();
+#pragma omp parallel for
+			for (int n = 0; n < L; n++) {
+				Leaf& leaf = *leaves[n];
+				int3 hi = aly::minVec(leaf.origin + int3(LEAF_SIZE), dimensions());
+				for (int k = leaf.origin.z; k < hi.z; k++) {
+					for (int j = leaf.origin.y; j < hi.y; j++) {
+						for (int i = leaf.origin.x; i < hi.x; i++) {
+							int off = leafOffset(i, j, k);
+							const ValueType& val = in.data[i + (size_t)j * rows + k * sliceSize];
+							leaf.values[off] = val;
+							leaf.active[off] = !isClose(val, background, tolerance);
+						}
+					}
+				}
+			}
+		}
+		//Applies op to every stored value and the background. Topology is unchanged.
+		template<class F> SparseVolume transform(const F& op) const {
+			SparseVolume out(*this);
+			out.background = op(background);
+			for (std::pair<const uint64_t, Node>& entry : out.table) {
+				if (entry.second.leaf < 0)
+					entry.second.tile = op(entry.second.tile);
+			}
+			const int N = (int)out.leaves.size();
+#pragma omp parallel for
+			for (int n = 0; n < N; n++) {
+				ValueType* values = out.leaves[n]->values;
+				for (int v = 0; v < LEAF_VOXELS; v++) {
+					values[v] = op(values[v]);
+				}
+			}
+			return out;
+		}
+		//Applies op voxel by voxel to two volumes of the same dimensions. The result has the union of both
+		//topologies and a voxel is active if it is active in either input.
+		template<class F> SparseVolume combine(const SparseVolume& other,
+			const F& op) const {
+			if (dimensions() != other.dimensions())
+				throw std::runtime_error(
+					MakeString() << "Volume dimensions do not match. "
+					<< dimensions() << "!=" << other.dimensions());
+			SparseVolume out(rows, cols, slices, op(background, other.background));
+			struct Job {
+				Leaf* out;
+				const Leaf* a;
+				const Leaf* b;
+				ValueType aValue;
+				ValueType bValue;
+			};
+			std::vector<Job> jobs;
+			auto visit = [&](uint64_t key) {
+				if (out.table.find(key) != out.table.end())
+					return;
+				Job job;
+				job.a = findBrick(key, job.aValue);
+				job.b = other.findBrick(key, job.bValue);
+				if (job.a == nullptr && job.b == nullptr) {
+					ValueType value = op(job.aValue, job.bValue);
+					if (value != out.background)
+						out.table[key] = Node(-1, value);
+					return;
+				}
+				job.out = out.addLeaf(key, keyOrigin(key), out.background);
+				jobs.push_back(job);
+			};
+			for (const std::pair<const uint64_t, Node>& entry : table) {
+				visit(entry.first);
+			}
+			for (const std::pair<const uint64_t, Node>& entry : other.table) {
+				visit(entry.first);
+			}
+			const int N = (int)jobs.size();
+#pragma omp parallel for
+			for (int n = 0; n < N; n++) {
+				const Job& job = jobs[n];
+				for (int v = 0; v < LEAF_VOXELS; v++) {
+					job.out->values[v] = op(
+						(job.a != nullptr) ? job.a->values[v] : job.aValue,
+						(job.b != nullptr) ? job.b->values[v] : job.bValue);
+				}
+				if (job.a != nullptr)
+					job.out->active |= job.a->active;
+				if (job.b != nullptr)
+					job.out->active |= job.b->active;
+			}
+			return out;
+		}
+		void writeToXML(const std::string& fileName) const {
+			WriteImageToRawFile(fileName, *this);
+		}
+	};
+	template<class T, int C, ImageType I> const int SparseVolume<T, C, I>::LEAF_SHIFT;
+	template<class T, int C, ImageType I> const int SparseVolume<T, C, I>::LEAF_SIZE;
+	template<class T, int C, ImageType I> const int SparseVolume<T, C, I>::LEAF_MASK;
+	template<class T, int C, ImageType I> const int SparseVolume<T, C, I>::LEAF_VOXELS;
+	template<class T, int C, ImageType I> const uint64_t SparseVolume<T, C, I>::INVALID_KEY;
+	template<class T, int C, ImageType I> const int SparseVolume<T, C, I>::channels;
+	template<class T, int C, ImageType I> const ImageType SparseVolume<T, C, I>::type;
+
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator+(
+		const SparseVolume<T, C, I>& img1, const SparseVolume<T, C, I>& img2) {
+		return img1.combine(img2, [](const vec<T, C>& a, const vec<T, C>& b) {return a + b;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator-(
+		const SparseVolume<T, C, I>& img1, const SparseVolume<T, C, I>& img2) {
+		return img1.combine(img2, [](const vec<T, C>& a, const vec<T, C>& b) {return a - b;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator*(
+		const SparseVolume<T, C, I>& img1, const SparseVolume<T, C, I>& img2) {
+		return img1.combine(img2, [](const vec<T, C>& a, const vec<T, C>& b) {return a * b;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator/(
+		const SparseVolume<T, C, I>& img1, const SparseVolume<T, C, I>& img2) {
+		return img1.combine(img2, [](const vec<T, C>& a, const vec<T, C>& b) {return a / b;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator+(
+		const SparseVolume<T, C, I>& img, const vec<T, C>& scalar) {
+		return img.transform([=](const vec<T, C>& a) {return a + scalar;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator-(
+		const SparseVolume<T, C, I>& img, const vec<T, C>& scalar) {
+		return img.transform([=](const vec<T, C>& a) {return a - scalar;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator*(
+		const SparseVolume<T, C, I>& img, const vec<T, C>& scalar) {
+		return img.transform([=](const vec<T, C>& a) {return a * scalar;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator/(
+		const SparseVolume<T, C, I>& img, const vec<T, C>& scalar) {
+		return img.transform([=](const vec<T, C>& a) {return a / scalar;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator+(
+		const vec<T, C>& scalar, const SparseVolume<T, C, I>& img) {
+		return img.transform([=](const vec<T, C>& a) {return scalar + a;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator-(
+		const vec<T, C>& scalar, const SparseVolume<T, C, I>& img) {
+		return img.transform([=](const vec<T, C>& a) {return scalar - a;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator*(
+		const vec<T, C>& scalar, const SparseVolume<T, C, I>& img) {
+		return img.transform([=](const vec<T, C>& a) {return scalar * a;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator/(
+		const vec<T, C>& scalar, const SparseVolume<T, C, I>& img) {
+		return img.transform([=](const vec<T, C>& a) {return scalar / a;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I> operator-(
+		const SparseVolume<T, C, I>& img) {
+		return img.transform([](const vec<T, C>& a) {return -a;});
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator+=(
+		SparseVolume<T, C, I>& out, const SparseVolume<T, C, I>& img) {
+		out = out + img;
+		return out;
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator-=(
+		SparseVolume<T, C, I>& out, const SparseVolume<T, C, I>& img) {
+		out = out - img;
+		return out;
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator*=(
+		SparseVolume<T, C, I>& out, const SparseVolume<T, C, I>& img) {
+		out = out * img;
+		return out;
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator/=(
+		SparseVolume<T, C, I>& out, const SparseVolume<T, C, I>& img) {
+		out = out / img;
+		return out;
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator+=(
+		SparseVolume<T, C, I>& out, const vec<T, C>& scalar) {
+		out = out + scalar;
+		return out;
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator-=(
+		SparseVolume<T, C, I>& out, const vec<T, C>& scalar) {
+		out = out - scalar;
+		return out;
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator*=(
+		SparseVolume<T, C, I>& out, const vec<T, C>& scalar) {
+		out = out * scalar;
+		return out;
+	}
+	template<class T, int C, ImageType I> SparseVolume<T, C, I>& operator/=(
+		SparseVolume<T, C, I>& out, const vec<T, C>& scalar) {
+		out = out / scalar;
+		return out;
+	}
+	//Streams one slice at a time so the dense volume is never allocated.
+	template<class T, int C, ImageType I> void WriteImageToRawFile(
+		const std::string& file, const SparseVolume<T, C, I>& img) {
+		std::ostringstream vstr;
+		std::string fileName = GetFileWithoutExtension(file);
+		vstr << fileName << ".raw";
+		FILE* f = fopen(vstr.str().c_str(), "wb");
+		if (f == NULL) {
+			throw std::runtime_error(
+				MakeString() << "Could not open " << vstr.str().c_str()
+				<< " for writing.");
+		}
+		std::vector<T> slice((size_t)img.rows * img.cols);
+		typename SparseVolume<T, C, I>::ConstAccessor accessor = img.getConstAccessor();
+		for (int c = 0; c < C; c++) {
+			for (int k = 0; k < img.slices; k++) {
+				for (int j = 0; j < img.cols; j++) {
+					for (int i = 0; i < img.rows; i++) {
+						slice[i + (size_t)j * img.rows] = accessor.getValue(i, j, k)[c];
+					}
+				}
+				fwrite(slice.data(), sizeof(T), slice.size(), f);
+			}
+		}
+		fclose(f);
+		WriteVolumeHeaderToXML(file, I, img.rows, img.cols, img.slices, C);
+	}
+	typedef SparseVolume<float, 4, ImageType::FLOAT> SparseVolume4f;
+	typedef SparseVolume<float, 3, ImageType::FLOAT> SparseVolume3f;
+	typedef SparseVolume<float, 2, ImageType::FLOAT> SparseVolume2f;
+	typedef SparseVolume<float, 1, ImageType::FLOAT> SparseVolume1f;
+
+	typedef SparseVolume<int, 4, ImageType::INT> SparseVolume4i;
+	typedef SparseVolume<int, 3, ImageType::INT> SparseVolume3i;
+	typedef SparseVolume<int, 2, ImageType::INT> SparseVolume2i;
+	typedef SparseVolume<int, 1, ImageType::INT> SparseVolume1i;
+
+	typedef SparseVolume<uint8_t, 4, ImageType::UBYTE> SparseVolume4ub;
+	typedef SparseVolume<uint8_t, 3, ImageType::UBYTE> SparseVolume3ub;
+	typedef SparseVolume<uint8_t, 2, ImageType::UBYTE> SparseVolume2ub;
+	typedef SparseVolume<uint8_t, 1, ImageType::UBYTE> SparseVolume1ub;
+}
+#endif /* INCLUDE_ALLOYSPARSEVOLUME_H_ */
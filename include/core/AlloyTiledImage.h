@@ -0,0 +1,424 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef INCLUDE_ALLOYTILEDIMAGE_H_
+#define INCLUDE_ALLOYTILEDIMAGE_H_
+#include "AlloyBinaryFile.h"
+#include "AlloyImageProcessing.h"
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+namespace aly {
+	bool SANITY_CHECK_TILED_IMAGE();
+	/*
+	 Tiled image pyramid stored in an Alloy binary container. Level 0 is the full resolution image, and each following
+	 level halves the previous one with a 2x2 box filter until the whole level fits in one tile. Every tile is its own
+	 section, so a reader only maps and decompresses the tiles it touches.
+	 */
+	struct TiledImageLayout {
+		int width = 0;
+		int height = 0;
+		int tileSize = 0;
+		int levels = 0;
+		ImageType type = ImageType::UNKNOWN;
+		int channels = 0;
+		TiledImageLayout() {
+		}
+		TiledImageLayout(int width, int height, int tileSize, ImageType type, int channels);
+		int getWidth(int level) const;
+		int getHeight(int level) const;
+		int getTilesX(int level) const;
+		int getTilesY(int level) const;
+		//Dimensions of tile (tx,ty) in the given level. Tiles on the right and bottom edges may be smaller.
+		int2 getTileDimensions(int level, int tx, int ty) const;
+		void write(BinaryFileWriter& writer) const;
+		void read(const MappedBinaryFile& file);
+		static std::string getTileName(int level, int tx, int ty);
+	};
+	//Writes a tiled pyramid from full resolution tiles supplied in row major order. Coarser levels are built as
+	//each row of tiles completes, so memory is bounded by one row of tiles per level.
+	template<class T, int C, ImageType I> class TiledImageWriter {
+	protected:
+		BinaryFileWriter writer;
+		TiledImageLayout layout;
+		BinaryCompression compression;
+		//Row of tiles under construction for each coarser level.
+		std::vector<Image<T, C, I>> rows;
+		int nextTile;
+		void emit(int level, int tx, int ty, const Image<T, C, I>& tile) {
+			int2 dims = layout.getTileDimensions(level, tx, ty);
+			if (tile.width != dims.x || tile.height != dims.y)
+				throw std::runtime_error(MakeString() << "Tile (" << tx << "," << ty << ") of level " << level << " should be "
+					<< dims.x << "x" << dims.y << " but was " << tile.width << "x" << tile.height);
+			writer.write(TiledImageLayout::getTileName(level, tx, ty), tile, compression);
+			if (level + 1 >= layout.levels)
+				return;
+			const int half = layout.tileSize / 2;
+			const int py = ty / 2;
+			Image<T, C, I>& row = rows[level + 1];
+			if (ty % 2 == 0 && tx == 0) {
+				row.resize(layout.getWidth(level + 1), layout.getTileDimensions(level + 1, 0, py).y);
+			}
+			const int ox = tx * half;
+			const int oy = (ty % 2) * half;
+			const int w = (tile.width + 1) / 2;
+			const int h = (tile.height + 1) / 2;
+#pragma omp parallel for
+			for (int j = 0; j < h; j++) {
+				for (int i = 0; i < w; i++) {
+					vec<double, C> sum = vec<double, C>(tile(2 * i, 2 * j)) + vec<double, C>(tile(2 * i + 1, 2 * j))
+						+ vec<double, C>(tile(2 * i, 2 * j + 1)) + vec<double, C>(tile(2 * i + 1, 2 * j + 1));
+					row(ox + i, oy + j) = vec<T, C>(0.25 * sum);
+				}
+			}
+			if (tx == layout.getTilesX(level) - 1 && (ty % 2 == 1 || ty == layout.getTilesY(level) - 1)) {
+				Image<T, C, I> parent;
+				for (int ptx = 0; ptx < layout.getTilesX(level + 1); ptx++) {
+					Crop(row, parent, int2(ptx * layout.tileSize, 0), layout.getTileDimensions(level + 1, ptx, py));
+					emit(level + 1, ptx, py, parent);
+				}
+			}
+		}
+	public:
+		TiledImageWriter() :
+			compression(BinaryCompression::LZ4), nextTile(0) {
+		}
+		TiledImageWriter(const std::string& file, int width, int height, int tileSize = 256,
+			BinaryCompression compression = BinaryCompression::LZ4) {
+			open(file, width, height, tileSize, compression);
+		}
+		~TiledImageWriter() {
+			if (writer.isOpen()) {
+				try {
+					close();
+				} catch (...) {
+				}
+			}
+		}
+		void open(const std::string& file, int width, int height, int tileSize = 256,
+			BinaryCompression compression = BinaryCompression::LZ4) {
+			layout = TiledImageLayout(width, height, tileSize, I, C);
+			this->compression = compression;
+			rows.clear();
+			rows.resize(layout.levels);
+			nextTile = 0;
+			writer.open(file);
+		}
+		const TiledImageLayout& getLayout() const {
+			return layout;
+		}
+		//Adds full resolution tile (tx,ty). Tiles must arrive in row major order.
+		void writeTile(int tx, int ty, const Image<T, C, I>& tile) {
+			if (ty * layout.getTilesX(0) + tx != nextTile || tx < 0 || tx >= layout.getTilesX(0))
+				throw std::runtime_error(MakeString() << "Tile (" << tx << "," << ty << ") was written out of order.");
+			emit(0, tx, ty, tile);
+			nextTile++;
+		}
+		void close() {
+			if (!writer.isOpen())
+				return;
+			if (nextTile != layout.getTilesX(0) * layout.getTilesY(0)) {
+				writer.close();
+				throw std::runtime_error(MakeString() << "Tiled image closed after " << nextTile << " of "
+					<< layout.getTilesX(0) * layout.getTilesY(0) << " tiles.");
+			}
+			layout.write(writer);
+			writer.close();
+			rows.clear();
+		}
+	};
+	/*
+	 Reads a tiled pyramid on demand. Decoded tiles are kept in a least recently used cache that stays within a memory
+	 budget, and tiles handed out remain valid after they are evicted. Reads are thread safe.
+	 */
+	template<class T, int C, ImageType I> class TiledImage {
+	public:
+		typedef std::shared_ptr<const Image<T, C, I>> TilePtr;
+	protected:
+		typedef std::list<uint64_t>::iterator UsageIterator;
+		MappedBinaryFile file;
+		TiledImageLayout layout;
+		size_t cacheBudget;
+		mutable size_t cacheSize;
+		mutable std::list<uint64_t> usage;
+		mutable std::unordered_map<uint64_t, std::pair<TilePtr, UsageIterator>> cache;
+		mutable std::mutex cacheLock;
+		static uint64_t tileKey(int level, int tx, int ty) {
+			return ((uint64_t) level << 56) | ((uint64_t) ty << 28) | (uint64_t) tx;
+		}
+		void evict() const {
+			while (cacheSize > cacheBudget && usage.size() > 1) {
+				auto iter = cache.find(usage.back());
+				cacheSize -= iter->second.first->size() * sizeof(vec<T, C>);
+				cache.erase(iter);
+				usage.pop_back();
+			}
+		}
+	public:
+		TiledImage() :
+			cacheBudget(256 * 1024 * 1024), cacheSize(0) {
+		}
+		TiledImage(const std::string& file, size_t cacheBudget = 256 * 1024 * 1024) :
+			cacheBudget(cacheBudget), cacheSize(0) {
+			open(file);
+		}
+		TiledImage(const TiledImage&) = delete;
+		TiledImage& operator=(const TiledImage&) = delete;
+		void open(const std::string& fileName) {
+			close();
+			file.open(fileName);
+			layout.read(file);
+			if (layout.type != I || layout.channels != C)
+				throw std::runtime_error(MakeString() << fileName << " holds " << layout.type << layout.channels
+					<< " tiles, not " << I << C);
+		}
+		void close() {
+			std::lock_guard<std::mutex> lockMe(cacheLock);
+			cache.clear();
+			usage.clear();
+			cacheSize = 0;
+			file.close();
+			layout = TiledImageLayout();
+		}
+		const TiledImageLayout& getLayout() const {
+			return layout;
+		}
+		int getWidth(int level = 0) const {
+			return layout.getWidth(level);
+		}
+		int getHeight(int level = 0) const {
+			return layout.getHeight(level);
+		}
+		int getLevels() const {
+			return layout.levels;
+		}
+		int getTileSize() const {
+			return layout.tileSize;
+		}
+		int getTilesX(int level = 0) const {
+			return layout.getTilesX(level);
+		}
+		int getTilesY(int level = 0) const {
+			return layout.getTilesY(level);
+		}
+		size_t getCacheSize() const {
+			std::lock_guard<std::mutex> lockMe(cacheLock);
+			return cacheSize;
+		}
+		void setCacheBudget(size_t bytes) {
+			std::lock_guard<std::mutex> lockMe(cacheLock);
+			cacheBudget = bytes;
+			evict();
+		}
+		TilePtr getTile(int level, int tx, int ty) const {
+			if (level < 0 || level >= layout.levels || tx < 0 || ty < 0 || tx >= layout.getTilesX(level)
+				|| ty >= layout.getTilesY(level))
+				throw std::runtime_error(MakeString() << "Tile (" << tx << "," << ty << ") of level " << level << " is out of bounds.");
+			const uint64_t key = tileKey(level, tx, ty);
+			{
+				std::lock_guard<std::mutex> lockMe(cacheLock);
+				auto iter = cache.find(key);
+				if (iter != cache.end()) {
+					usage.splice(usage.begin(), usage, iter->second.second);
+					return iter->second.first;
+				}
+			}
+			//Decompress outside the lock so threads can load different tiles at the same time.
+			Image<T, C, I>* tile = new Image<T, C, I>();
+			TilePtr ptr(tile);
+			file.read(TiledImageLayout::getTileName(level, tx, ty), *tile);
+			std::lock_guard<std::mutex> lockMe(cacheLock);
+			auto iter = cache.find(key);
+			if (iter != cache.end())
+				return iter->second.first;
+			usage.push_front(key);
+			cache[key] = std::pair<TilePtr, UsageIterator>(ptr, usage.begin());
+			cacheSize += tile->size() * sizeof(vec<T, C>);
+			evict();
+			return ptr;
+		}
+		vec<T, C> operator()(int i, int j, int level = 0) const {
+			i = clamp(i, 0, layout.getWidth(level) - 1);
+			j = clamp(j, 0, layout.getHeight(level) - 1);
+			TilePtr tile = getTile(level, i / layout.tileSize, j / layout.tileSize);
+			return (*tile)(i % layout.tileSize, j % layout.tileSize);
+		}
+		//Copies a region of a level into out. Pixels outside the level repeat the nearest edge pixel, like Image.
+		void read(Image<T, C, I>& out, int2 pos, int2 dims, int level = 0) const {
+			out.resize(dims.x, dims.y);
+			if (dims.x <= 0 || dims.y <= 0)
+				return;
+			const int w = layout.getWidth(level);
+			const int h = layout.getHeight(level);
+			const int ts = layout.tileSize;
+			const int tx0 = clamp(pos.x, 0, w - 1) / ts, tx1 = clamp(pos.x + dims.x - 1, 0, w - 1) / ts;
+			const int ty0 = clamp(pos.y, 0, h - 1) / ts, ty1 = clamp(pos.y + dims.y - 1, 0, h - 1) / ts;
+			const int nx = tx1 - tx0 + 1;
+			const int tiles = nx * (ty1 - ty0 + 1);
+			//Exceptions cannot leave a parallel region, so the first one is rethrown after it.
+			std::exception_ptr error;
+			std::mutex errorLock;
+#pragma omp parallel for schedule(dynamic)
+			for (int t = 0; t < tiles; t++) {
+				const int tx = tx0 + t % nx;
+				const int ty = ty0 + t / nx;
+				TilePtr tile;
+				try {
+					tile = getTile(level, tx, ty);
+				} catch (...) {
+					std::lock_guard<std::mutex> lockMe(errorLock);
+					if (!error)
+						error = std::current_exception();
+					continue;
+				}
+				//Output columns and rows whose clamped source lies in this tile.
+				int i0 = (tx == 0) ? 0 : tx * ts - pos.x;
+				int i1 = (tx == layout.getTilesX(level) - 1) ? dims.x : (tx + 1) * ts - pos.x;
+				int j0 = (ty == 0) ? 0 : ty * ts - pos.y;
+				int j1 = (ty == layout.getTilesY(level) - 1) ? dims.y : (ty + 1) * ts - pos.y;
+				i0 = std::max(i0, 0);
+				j0 = std::max(j0, 0);
+				i1 = std::min(i1, dims.x);
+				j1 = std::min(j1, dims.y);
+				for (int j = j0; j < j1; j++) {
+					const int y = clamp(pos.y + j, 0, h - 1) - ty * ts;
+					for (int i = i0; i < i1; i++) {
+						out(i, j) = (*tile)(clamp(pos.x + i, 0, w - 1) - tx * ts, y);
+					}
+				}
+			}
+			if (error)
+				std::rethrow_exception(error);
+		}
+	};
+	//Tiles an in-memory image into a pyramid file.
+	template<class T, int C, ImageType I> void WriteTiledImageToFile(const std::string& file, const Image<T, C, I>& img,
+		int tileSize = 256, BinaryCompression compression = BinaryCompression::LZ4) {
+		TiledImageWriter<T, C, I> writer(file, img.width, img.height, tileSize, compression);
+		const TiledImageLayout& layout = writer.getLayout();
+		Image<T, C, I> tile;
+		for (int ty = 0; ty < layout.getTilesY(0); ty++) {
+			for (int tx = 0; tx < layout.getTilesX(0); tx++) {
+				Crop(img, tile, int2(tx, ty) * tileSize, layout.getTileDimensions(0, tx, ty));
+				writer.writeTile(tx, ty, tile);
+			}
+		}
+		writer.close();
+	}
+	//Writes a width x height pyramid whose full resolution tiles come from makeTile(tile, position, dimensions).
+	//Each row of tiles is generated in parallel before it is written.
+	template<class T, int C, ImageType I, class F> void WriteTiledImageToFile(const std::string& file, int width, int height,
+		const F& makeTile, int tileSize = 256, BinaryCompression compression = BinaryCompression::LZ4) {
+		TiledImageWriter<T, C, I> writer(file, width, height, tileSize, compression);
+		const TiledImageLayout& layout = writer.getLayout();
+		const int nx = layout.getTilesX(0);
+		std::vector<Image<T, C, I>> row(nx);
+		std::exception_ptr error;
+		std::mutex errorLock;
+		for (int ty = 0; ty < layout.getTilesY(0); ty++) {
+#pragma omp parallel for schedule(dynamic)
+			for (int tx = 0; tx < nx; tx++) {
+				try {
+					makeTile(row[tx], int2(tx, ty) * tileSize, layout.getTileDimensions(0, tx, ty));
+				} catch (...) {
+					std::lock_guard<std::mutex> lockMe(errorLock);
+					if (!error)
+						error = std::current_exception();
+				}
+			}
+			if (error)
+				std::rethrow_exception(error);
+			for (int tx = 0; tx < nx; tx++) {
+				writer.writeTile(tx, ty, row[tx]);
+			}
+		}
+		writer.close();
+	}
+	template<class T, int C, ImageType I> void Crop(const TiledImage<T, C, I>& in, Image<T, C, I>& out, int2 pos, int2 dims,
+		int level = 0) {
+		out.setPosition(pos);
+		in.read(out, pos, dims, level);
+	}
+	template<class T, int C, ImageType I> void Crop(const TiledImage<T, C, I>& in, const std::string& outFile, int2 pos,
+		int2 dims, int level = 0, BinaryCompression compression = BinaryCompression::LZ4) {
+		WriteTiledImageToFile<T, C, I>(outFile, dims.x, dims.y, [&](Image<T, C, I>& tile, int2 p, int2 d) {
+			in.read(tile, pos + p, d, level);
+		}, in.getTileSize(), compression);
+	}
+	//Same result as DownSample() of the whole level restricted to the region, which should start at even coordinates.
+	//out is dims/2 in size and positioned at pos/2.
+	template<class T, int C, ImageType I> void DownSample(const TiledImage<T, C, I>& in, Image<T, C, I>& out, int2 pos,
+		int2 dims, int level = 0) {
+		static const double Kernel[5][5] = { { 1, 4, 6, 4, 1 }, { 4, 16, 24, 16, 4 }, { 6, 24, 36, 24, 6 }, { 4, 16, 24, 16, 4 }, {
+				1, 4, 6, 4, 1 } };
+		Image<T, C, I> region;
+		in.read(region, pos - int2(2), dims + int2(4), level);
+		out.resize(dims.x / 2, dims.y / 2);
+		out.setPosition(pos / 2);
+#pragma omp parallel for
+		for (int j = 0; j < out.height; j++) {
+			for (int i = 0; i < out.width; i++) {
+				vec<double, C> vsum(0.0);
+				for (int ii = 0; ii < 5; ii++) {
+					for (int jj = 0; jj < 5; jj++) {
+						vsum += Kernel[ii][jj] * vec<double, C>(region(2 * i + ii, 2 * j + jj));
+					}
+				}
+				out(i, j) = vec<T, C>(vsum / 256.0);
+			}
+		}
+	}
+	template<class T, int C, ImageType I> void DownSample(const TiledImage<T, C, I>& in, const std::string& outFile,
+		int level = 0, BinaryCompression compression = BinaryCompression::LZ4) {
+		WriteTiledImageToFile<T, C, I>(outFile, in.getWidth(level) / 2, in.getHeight(level) / 2,
+			[&](Image<T, C, I>& tile, int2 p, int2 d) {
+			DownSample(in, tile, 2 * p, 2 * d, level);
+		}, in.getTileSize(), compression);
+	}
+	//Reads the region with enough margin that the result matches Smooth() of the whole level. The recursive filter
+	//used for large sigma has infinite support, so there the margin is six sigma and the match is approximate.
+	template<class T, int C, ImageType I> void Smooth(const TiledImage<T, C, I>& in, Image<T, C, I>& out, int2 pos, int2 dims,
+		double sigmaX, double sigmaY, int level = 0) {
+		const bool recursive = (std::max(sigmaX, sigmaY) >= 3.0);
+		int2 margin(recursive ? (int) std::ceil(6.0 * sigmaX) : GaussianRadius(sigmaX),
+			recursive ? (int) std::ceil(6.0 * sigmaY) : GaussianRadius(sigmaY));
+		Image<T, C, I> region, smoothed;
+		in.read(region, pos - margin, dims + 2 * margin, level);
+		Smooth(region, smoothed, sigmaX, sigmaY);
+		Crop(smoothed, out, margin, dims);
+		out.setPosition(pos);
+	}
+	template<class T, int C, ImageType I> void Smooth(const TiledImage<T, C, I>& in, const std::string& outFile, double sigmaX,
+		double sigmaY, int level = 0, BinaryCompression compression = BinaryCompression::LZ4) {
+		WriteTiledImageToFile<T, C, I>(outFile, in.getWidth(level), in.getHeight(level), [&](Image<T, C, I>& tile, int2 p, int2 d) {
+			Smooth(in, tile, p, d, sigmaX, sigmaY, level);
+		}, in.getTileSize(), compression);
+	}
+	typedef TiledImage<uint8_t, 4, ImageType::UBYTE> TiledImageRGBA;
+	typedef TiledImage<uint8_t, 3, ImageType::UBYTE> TiledImageRGB;
+	typedef TiledImage<uint8_t, 1, ImageType::UBYTE> TiledImage1ub;
+	typedef TiledImage<float, 4, ImageType::FLOAT> TiledImageRGBAf;
+	typedef TiledImage<float, 3, ImageType::FLOAT> TiledImageRGBf;
+	typedef TiledImage<float, 1, ImageType::FLOAT> TiledImage1f;
+	typedef TiledImage<uint16_t, 1, ImageType::USHORT> TiledImage1us;
+}
+#endif
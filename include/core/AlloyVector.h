@@ -23,6 +23,7 @@
 #define ALLOYLINEARALGEBRA_H_
 
 #include "AlloyMath.h"
+#include "AlloySIMD.h"
 #include <vector>
 #include <functional>
 #include <iomanip>
@@ -198,26 +199,14 @@ public:
 		data.shrink_to_fit();
 	}
 	vec<T, C> min() const {
-		vec<T, C> minVal(std::numeric_limits<T>::max());
-		for (const vec<T, C>& val : data) {
-			minVal = aly::minVec(val, minVal);
-		}
-		return minVal;
+		return range().first;
 	}
 	vec<T, C> max() const {
-		vec<T, C> maxVal(std::numeric_limits<T>::min());
-		for (const vec<T, C>& val : data) {
-			maxVal = aly::maxVec(val, maxVal);
-		}
-		return maxVal;
+		return range().second;
 	}
 	std::pair<vec<T, C>, vec<T, C>> range() const {
-		vec<T, C> maxVal(std::numeric_limits<T>::min());
-		vec<T, C> minVal(std::numeric_limits<T>::max());
-		for (const vec<T, C>& val : data) {
-			maxVal = aly::maxVec(val, maxVal);
-			minVal = aly::minVec(val, minVal);
-		}
+		vec<T, C> minVal, maxVal;
+		VecMinMax(data.data(), data.size(), minVal, maxVal);
 		return std::pair<vec<T, C>, vec<T, C>>(minVal, maxVal);
 	}
 	vec<T, C> mean() const {
@@ -441,231 +430,227 @@ template<class T, class L, class R, int C> std::basic_ostream<L, R> & operator <
 template<class T, int C> Vector<T, C> operator+(const vec<T, C>& scalar,
 		const Vector<T, C>& img) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar + val2;};
-	Transform(out, img, f);
+	VecTransform<AddKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
 template<class T, int C> void ScaleAdd(Vector<T, C>& out,
 		const vec<T, C>& scalar, const Vector<T, C>& in) {
 	out.resize(in.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 += scalar * val2;};
-	Transform(out, in, f);
+	VecScaleAdd(out.data.data(), out.data.data(), scalar, in.data.data(), in.size());
 }
 template<class T, int C> void ScaleAdd(Vector<T, C>& out,
 		const T& scalar, const Vector<T, C>& in) {
 	out.resize(in.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 += scalar * val2;};
-	Transform(out, in, f);
+	VecScaleAdd(out.data.data(), out.data.data(), vec<T, C>(scalar), in.data.data(), in.size());
 }
 template<class T, int C> void ScaleAdd(Vector<T, C>& out,
 		const Vector<T, C>& in1, const vec<T, C>& scalar,
 		const Vector<T, C>& in2) {
+	if (in1.size() != in2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << in1.size()
+						<< "!=" << in2.size());
 	out.resize(in1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2+scalar * val3;};
-	Transform(out, in1, in2, f);
+	VecScaleAdd(out.data.data(), in1.data.data(), scalar, in2.data.data(), in1.size());
 }
 template<class T, int C> void ScaleAdd(Vector<T, C>& out,
 		const Vector<T, C>& in1, const vec<T, C>& scalar2,
 		const Vector<T, C>& in2, const vec<T, C>& scalar3,
 		const Vector<T, C>& in3) {
+	if (in1.size() != in2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << in1.size()
+						<< "!=" << in2.size());
+	if (in1.size() != in3.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << in1.size()
+						<< "!=" << in3.size());
 	out.resize(in1.size());
-	std::function<
-			void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&,
-					const vec<T, C>&)> f = [=](vec<T, C>& out,
-			const vec<T, C>& val1,
-			const vec<T, C>& val2,
-			const vec<T, C>& val3) {
-		out = val1+scalar2*val2+scalar3 * val3;};
-	Transform(out, in1, in2, in3, f);
+	VecScaleAdd(out.data.data(), in1.data.data(), scalar2, in2.data.data(), in1.size());
+	VecScaleAdd(out.data.data(), out.data.data(), scalar3, in3.data.data(), in1.size());
 }
 template<class T, int C> void ScaleSubtract(Vector<T, C>& out,
 		const vec<T, C>& scalar, const Vector<T, C>& in) {
 	out.resize(in.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 -= scalar * val2;};
-	Transform(out, in, f);
+	VecScaleAdd(out.data.data(), out.data.data(), scalar, in.data.data(), in.size(), true);
 }
 template<class T, int C> void ScaleSubtract(Vector<T, C>& out,
 		const Vector<T, C>& in1, const vec<T, C>& scalar,
 		const Vector<T, C>& in2) {
+	if (in1.size() != in2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << in1.size()
+						<< "!=" << in2.size());
 	out.resize(in1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 - scalar * val3;};
-	Transform(out, in1, in2, f);
+	VecScaleAdd(out.data.data(), in1.data.data(), scalar, in2.data.data(), in1.size(), true);
 }
 template<class T, int C> void Subtract(Vector<T, C>& out,
 		const Vector<T, C>& v1, const Vector<T, C>& v2) {
+	if (v1.size() != v2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << v1.size()
+						<< "!=" << v2.size());
 	out.resize(v1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2-val3;};
-	Transform(out, v1, v2, f);
+	VecTransform<SubtractKernel>(out.data.data(), v1.data.data(), v2.data.data(), v1.size());
 }
 template<class T, int C> void Add(Vector<T, C>& out, const Vector<T, C>& v1,
 		const Vector<T, C>& v2) {
+	if (v1.size() != v2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << v1.size()
+						<< "!=" << v2.size());
 	out.resize(v1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 + val3;};
-	Transform(out, v1, v2, f);
+	VecTransform<AddKernel>(out.data.data(), v1.data.data(), v2.data.data(), v1.size());
 }
 template<class T, int C> Vector<T, C> operator-(const vec<T, C>& scalar,
 		const Vector<T, C>& img) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar - val2;};
-	Transform(out, img, f);
+	VecTransform<SubtractKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
 template<class T, int C> Vector<T, C> operator*(const vec<T, C>& scalar,
 		const Vector<T, C>& img) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar*val2;};
-	Transform(out, img, f);
+	VecTransform<MultiplyKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
 template<class T, int C> Vector<T, C> operator*(const T& scalar,
 		const Vector<T, C>& img) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar*val2;};
-	Transform(out, img, f);
+	VecTransform<MultiplyKernel>(out.data.data(), img.data.data(), vec<T, C>(scalar), img.size(), true);
 	return out;
 }
 template<class T, int C> Vector<T, C> operator/(const vec<T, C>& scalar,
 		const Vector<T, C>& img) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar / val2;};
-	Transform(out, img, f);
+	VecTransform<DivideKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 	return out;
 }
 template<class T, int C> Vector<T, C> operator+(const Vector<T, C>& img,
 		const vec<T, C>& scalar) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2 + scalar;};
-	Transform(out, img, f);
+	VecTransform<AddKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C> Vector<T, C> operator-(const Vector<T, C>& img,
 		const vec<T, C>& scalar) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2 - scalar;};
-	Transform(out, img, f);
+	VecTransform<SubtractKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C> Vector<T, C> operator*(const Vector<T, C>& img,
 		const vec<T, C>& scalar) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2*scalar;};
-	Transform(out, img, f);
+	VecTransform<MultiplyKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C> Vector<T, C> operator/(const Vector<T, C>& img,
 		const vec<T, C>& scalar) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2 / scalar;};
-	Transform(out, img, f);
+	VecTransform<DivideKernel>(out.data.data(), img.data.data(), scalar, img.size());
 	return out;
 }
 template<class T, int C> Vector<T, C> operator-(const Vector<T, C>& img) {
 	Vector<T, C> out(img.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = -val2;};
-	Transform(out, img, f);
+	VecTransform<SubtractKernel>(out.data.data(), img.data.data(), vec<T, C>(T(0)), img.size(), true);
 	return out;
 }
-template<class T, int C> Vector<T, C> operator+=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator+=(Vector<T, C>& out,
 		const Vector<T, C>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 += val2;};
-	Transform(out, img, f);
+	if (out.size() != img.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << out.size()
+						<< "!=" << img.size());
+	VecTransform<AddKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
-template<class T, int C> Vector<T, C> operator-=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator-=(Vector<T, C>& out,
 		const Vector<T, C>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 -= val2;};
-	Transform(out, img, f);
+	if (out.size() != img.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << out.size()
+						<< "!=" << img.size());
+	VecTransform<SubtractKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
-template<class T, int C> Vector<T, C> operator*=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator*=(Vector<T, C>& out,
 		const Vector<T, C>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 *= val2;};
-	Transform(out, img, f);
+	if (out.size() != img.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << out.size()
+						<< "!=" << img.size());
+	VecTransform<MultiplyKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
-template<class T, int C> Vector<T, C> operator/=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator/=(Vector<T, C>& out,
 		const Vector<T, C>& img) {
-	std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 /= val2;};
-	Transform(out, img, f);
+	if (out.size() != img.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << out.size()
+						<< "!=" << img.size());
+	VecTransform<DivideKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 	return out;
 }
 
-template<class T, int C> Vector<T, C> operator+=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator+=(Vector<T, C>& out,
 		const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 += scalar;};
-	Transform(out, f);
+	VecTransform<AddKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
-template<class T, int C> Vector<T, C> operator-=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator-=(Vector<T, C>& out,
 		const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 -= scalar;};
-	Transform(out, f);
+	VecTransform<SubtractKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
-template<class T, int C> Vector<T, C> operator*=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator*=(Vector<T, C>& out,
 		const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 *= scalar;};
-	Transform(out, f);
+	VecTransform<MultiplyKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
-template<class T, int C> Vector<T, C> operator/=(Vector<T, C>& out,
+template<class T, int C> Vector<T, C>& operator/=(Vector<T, C>& out,
 		const vec<T, C>& scalar) {
-	std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 /= scalar;};
-	Transform(out, f);
+	VecTransform<DivideKernel>(out.data.data(), out.data.data(), scalar, out.size());
 	return out;
 }
 
 template<class T, int C> Vector<T, C> operator+(const Vector<T, C>& img1,
 		const Vector<T, C>& img2) {
+	if (img1.size() != img2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << img1.size()
+						<< "!=" << img2.size());
 	Vector<T, C> out(img1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 + val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<AddKernel>(out.data.data(), img1.data.data(), img2.data.data(), img1.size());
 	return out;
 }
 template<class T, int C> Vector<T, C> operator-(const Vector<T, C>& img1,
 		const Vector<T, C>& img2) {
+	if (img1.size() != img2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << img1.size()
+						<< "!=" << img2.size());
 	Vector<T, C> out(img1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 - val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<SubtractKernel>(out.data.data(), img1.data.data(), img2.data.data(), img1.size());
 	return out;
 }
 template<class T, int C> Vector<T, C> operator*(const Vector<T, C>& img1,
 		const Vector<T, C>& img2) {
+	if (img1.size() != img2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << img1.size()
+						<< "!=" << img2.size());
 	Vector<T, C> out(img1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2*val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<MultiplyKernel>(out.data.data(), img1.data.data(), img2.data.data(), img1.size());
 	return out;
 }
 template<class T, int C> Vector<T, C> operator/(const Vector<T, C>& img1,
 		const Vector<T, C>& img2) {
+	if (img1.size() != img2.size())
+		throw std::runtime_error(
+				MakeString() << "Vector dimensions do not match. " << img1.size()
+						<< "!=" << img2.size());
 	Vector<T, C> out(img1.size());
-	std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 / val3;};
-	Transform(out, img1, img2, f);
+	VecTransform<DivideKernel>(out.data.data(), img1.data.data(), img2.data.data(), img1.size());
 	return out;
 }
 template<class T, int C> vec<double, C> dotVec(const Vector<T, C>& a,
@@ -689,27 +674,15 @@ template<class T, int C> vec<double, C> dotVec(const Vector<T, C>& a,
 }
 template<class T, int C> double dot(const Vector<T, C>& a,
 		const Vector<T, C>& b) {
-	double ans = 0.0;
 	if (a.size() != b.size())
 		throw std::runtime_error(
 				MakeString() << "Vector dimensions do not match. " << a.size()
 						<< "!=" << b.size());
-	size_t sz = a.size();
-#pragma omp parallel for reduction(+:ans)
-	for (int i = 0; i < (int) sz; i++) {
-		ans += dot(vec<double, C>(a[i]), vec<double, C>(b[i]));
-	}
-	return ans;
+	return VecDot(a.data.data(), b.data.data(), a.size());
 }
 
 template<class T, int C> T lengthSqr(const Vector<T, C>& a) {
-	T ans(0);
-	size_t sz = a.size();
-#pragma omp parallel for reduction(+:ans)
-	for (int i = 0; i < (int) sz; i++) {
-		ans += dot(a[i], a[i]);
-	}
-	return ans;
+	return (T) VecDot(a.data.data(), a.data.data(), a.size());
 }
 template<class T, int C> T lengthL1(const Vector<T, C>& a) {
 	T ans(0);
@@ -758,56 +731,24 @@ template<class T, int C> vec<T, C> lengthVecL1(const Vector<T, C>& a) {
 	return ans;
 }
 template<class T, int C> vec<T, C> maxVec(const Vector<T, C>& a) {
-	vec<T, C> ans((T) 0);
-	size_t sz = a.size();
-#pragma omp parallel for
-	for (int c = 0; c < C; c++) {
-		T tmp(std::numeric_limits<T>::min());
-//#pragma omp parallel for reduction(max:tmp)
-		for (int i = 0; i < (int) sz; i++) {
-			if (a[i][c] > tmp)
-				tmp = a[i][c];
-		}
-		ans[c] = tmp;
-	}
-	return ans;
+	return a.max();
 }
 template<class T, int C> vec<T, C> minVec(const Vector<T, C>& a) {
-	vec<T, C> ans((T) 0);
-	size_t sz = a.size();
-#pragma omp parallel for
-	for (int c = 0; c < C; c++) {
-		T tmp(std::numeric_limits<T>::max());
-//#pragma omp parallel for reduction(min:tmp)
-		for (int i = 0; i < (int) sz; i++) {
-			if (a[i][c] < tmp)
-				tmp = a[i][c];
-		}
-		ans[c] = tmp;
-	}
-	return ans;
+	return a.min();
 }
 template<class T, int C> T max(const Vector<T, C>& a) {
-	size_t sz = a.size();
-	T tmp(std::numeric_limits<T>::min());
-//#pragma omp parallel for reduction(max:tmp)
-	for (int i = 0; i < (int) sz; i++) {
-		for (int c = 0; c < C; c++) {
-			if (a[i][c] > tmp)
-				tmp = a[i][c];
-		}
+	vec<T, C> maxVal = a.max();
+	T tmp = maxVal[0];
+	for (int c = 1; c < C; c++) {
+		tmp = std::max(tmp, maxVal[c]);
 	}
 	return tmp;
 }
 template<class T, int C> T min(const Vector<T, C>& a) {
-	size_t sz = a.size();
-	T tmp(std::numeric_limits<T>::max());
-//#pragma omp parallel for reduction(min:tmp)
-	for (int i = 0; i < (int) sz; i++) {
-		for (int c = 0; c < C; c++) {
-			if (a[i][c] < tmp)
-				tmp = a[i][c];
-		}
+	vec<T, C> minVal = a.min();
+	T tmp = minVal[0];
+	for (int c = 1; c < C; c++) {
+		tmp = std::min(tmp, minVal[c]);
 	}
 	return tmp;
 }
@@ -22,6 +22,7 @@
 #define ALLOYIMAGE3D_H_INCLUDE_GUARD
 #include "AlloyCommon.h"
 #include "AlloyMath.h"
+#include "AlloySIMD.h"
 #include "sha2.h"
 #include "AlloyFileUtil.h"
 #include "AlloyImage.h"
@@ -31,6 +32,9 @@
 #include <fstream>
 #include <random>
 namespace aly {
+	template<class T, int C, ImageType I> struct Volume;
+	template<class T, int C, ImageType I> void DownSample(const Volume<T, C, I>& in, Volume<T, C, I>& out);
+	template<class T, int C, ImageType I> void UpSample(const Volume<T, C, I>& in, Volume<T, C, I>& out);
 	template<class T, int C, ImageType I> struct Volume {
 	private:
 		std::string hashCode;
@@ -287,62 +291,10 @@ namespace aly {
 			}
 		}
 		void downSample(Volume<T, C, I>& out) const {
-			static const double Kernel[3][3][3] = { { { 0, 1, 0 }, { 1, 4, 1 }, { 0,
-					1, 0 } }, { { 1, 4, 1 }, { 4, 12, 4 }, { 1, 4, 1 } }, { { 0, 1,
-					0 }, { 1, 4, 1 }, { 0, 1, 0 } } };
-			out.resize(rows / 2, cols / 2, slices / 2);
-#pragma omp parallel for
-			for (int i = 0; i < out.rows; i++) {
-				for (int j = 0; j < out.cols; j++) {
-					for (int k = 0; k < out.slices; k++) {
-						vec<double, C> vsum(0.0);
-						for (int ii = 0; ii < 3; ii++) {
-							for (int jj = 0; jj < 3; jj++) {
-								for (int kk = 0; kk < 3; kk++) {
-									vsum += Kernel[ii][jj][kk]
-										* vec<double, C>(
-											operator()(2 * i + ii - 1,
-												2 * j + jj - 1,
-												2 * k + kk - 1));
-								}
-							}
-						}
-						out(i, j, k) = vec<T, C>(vsum / 48.0);
-					}
-				}
-			}
+			DownSample(*this, out);
 		}
 		void upSample(Volume<T, C, I>& out) const {
-			static const double Kernel[3][3][3] = { { { 0, 1, 0 }, { 1, 4, 1 }, { 0,
-					1, 0 } }, { { 1, 4, 1 }, { 4, 12, 4 }, { 1, 4, 1 } }, { { 0, 1,
-					0 }, { 1, 4, 1 }, { 0, 1, 0 } } };
-			if (out.size() == 0)
-				out.resize(rows * 2, cols * 2, slices * 2);
-#pragma omp parallel for
-			for (int i = 0; i < out.rows; i++) {
-				for (int j = 0; j < out.cols; j++) {
-					for (int k = 0; k < out.slices; k++) {
-						vec<double, C> vsum(0.0);
-						for (int ii = 0; ii < 3; ii++) {
-							for (int jj = 0; jj < 3; jj++) {
-								for (int kk = 0; kk < 3; kk++) {
-									int iii = i + ii - 1;
-									int jjj = j + jj - 1;
-									int kkk = k + kk - 1;
-									if (iii % 2 == 0 && jjj % 2 == 0
-										&& kkk % 2 == 0) {
-										vsum += Kernel[ii][jj][kk]
-											* vec<double, C>(
-												operator()(iii / 2, jjj / 2,
-													kkk / 2));
-									}
-								}
-							}
-							out(i, j, k) = vec<T, C>(vsum / 6.0);
-						}
-					}
-				}
-			}
+			UpSample(*this, out);
 		}
 		Volume<T, C, I> downSample() const {
 			Volume<T, C, I> out;
@@ -355,26 +307,14 @@ namespace aly {
 			return out;
 		}
 		vec<T, C> min() const {
-			vec<T, C> minVal(std::numeric_limits<T>::max());
-			for (vec<T, C>& val : data) {
-				minVal = aly::minVec(val, minVal);
-			}
-			return minVal;
+			return range().first;
 		}
 		vec<T, C> max() const {
-			vec<T, C> maxVal(std::numeric_limits<T>::min());
-			for (vec<T, C>& val : data) {
-				maxVal = aly::maxVec(val, maxVal);
-			}
-			return maxVal;
+			return range().second;
 		}
 		std::pair<vec<T, C>, vec<T, C>> range() const {
-			vec<T, C> maxVal(std::numeric_limits<T>::min());
-			vec<T, C> minVal(std::numeric_limits<T>::max());
-			for (vec<T, C>& val : data) {
-				maxVal = aly::maxVec(val, maxVal);
-				minVal = aly::minVec(val, minVal);
-			}
+			vec<T, C> minVal, maxVal;
+			VecMinMax(data.data(), data.size(), minVal, maxVal);
 			return std::pair<vec<T, C>, vec<T, C>>(minVal, maxVal);
 		}
 		vec<T, C> mean() const {
@@ -474,7 +414,7 @@ namespace aly {
 	template<class T, int C, ImageType I> std::string Volume<T, C, I>::updateHashCode(
 		size_t MAX_SAMPLES, HashMethod method) {
 		if (MAX_SAMPLES == 0) {
-			hashCode = HashCode(data, method);
+			hashCode = TreeHashCode(data.data(), data.size() * sizeof(vec<T, C>), method);
 		}
 		else {
 			const size_t seed = 8743128921;
@@ -491,6 +431,85 @@ namespace aly {
 		}
 		return hashCode;
 	}
+	//Separable binomial reduce, the 3D counterpart of DownSample() for images. Each output slice first blends five
+	//input slices, then reduces that slab row by row.
+	template<class T, int C, ImageType I> void DownSample(const Volume<T, C, I>& in, Volume<T, C, I>& out) {
+		typedef typename FilterAccumulator<T>::type A;
+		typedef vec<A, C> V;
+		const A k0 = A(6.0 / 16.0), k1 = A(4.0 / 16.0), k2 = A(1.0 / 16.0);
+		out.resize(in.rows / 2, in.cols / 2, in.slices / 2);
+		if (out.rows == 0 || out.cols == 0 || out.slices == 0)
+			return;
+		const size_t plane = (size_t) in.rows * in.cols;
+#pragma omp parallel
+		{
+			std::vector<V> slab(plane);
+			std::vector<vec<A, C>> buffer(in.rows + 4);
+#pragma omp for
+			for (int k = 0; k < out.slices; k++) {
+				const vec<T, C>* z[5];
+				for (int kk = 0; kk < 5; kk++) {
+					z[kk] = &in.data[(size_t) clamp(2 * k + kk - 2, 0, in.slices - 1) * plane];
+				}
+				for (size_t idx = 0; idx < plane; idx++) {
+					slab[idx] = k2 * (V(z[0][idx]) + V(z[4][idx])) + k1 * (V(z[1][idx]) + V(z[3][idx])) + k0 * V(z[2][idx]);
+				}
+				for (int j = 0; j < out.cols; j++) {
+					ReduceColumns(slab.data(), in.rows, in.cols, j, buffer.data() + 2);
+					ReduceRow(buffer.data() + 2, in.rows, &out.data[((size_t) k * out.cols + j) * out.rows], out.rows);
+				}
+			}
+		}
+	}
+	template<class T, int C, ImageType I> void UpSample(const Volume<T, C, I>& in, Volume<T, C, I>& out) {
+		typedef typename FilterAccumulator<T>::type A;
+		typedef vec<A, C> V;
+		const A k0 = A(6.0 / 8.0), k1 = A(1.0 / 8.0), k2 = A(0.5);
+		if (out.size() == 0)
+			out.resize(in.rows * 2, in.cols * 2, in.slices * 2);
+		if (in.rows == 0 || in.cols == 0 || in.slices == 0)
+			return;
+		const size_t plane = (size_t) in.rows * in.cols;
+#pragma omp parallel
+		{
+			std::vector<V> slab(plane);
+			std::vector<vec<A, C>> buffer(in.rows + 2);
+#pragma omp for
+			for (int k = 0; k < out.slices; k++) {
+				const int m = k / 2;
+				const vec<T, C>* z0 = &in.data[(size_t) clamp(m - 1, 0, in.slices - 1) * plane];
+				const vec<T, C>* z1 = &in.data[(size_t) clamp(m, 0, in.slices - 1) * plane];
+				const vec<T, C>* z2 = &in.data[(size_t) clamp(m + 1, 0, in.slices - 1) * plane];
+				if (k % 2 == 0) {
+					for (size_t idx = 0; idx < plane; idx++) {
+						slab[idx] = k1 * (V(z0[idx]) + V(z2[idx])) + k0 * V(z1[idx]);
+					}
+				} else {
+					for (size_t idx = 0; idx < plane; idx++) {
+						slab[idx] = k2 * (V(z1[idx]) + V(z2[idx]));
+					}
+				}
+				for (int j = 0; j < out.cols; j++) {
+					ExpandColumns(slab.data(), in.rows, in.cols, j, buffer.data() + 1);
+					ExpandRow(buffer.data() + 1, in.rows, &out.data[((size_t) k * out.cols + j) * out.rows], out.rows);
+				}
+			}
+		}
+	}
+	//Level 0 is a copy of the input and each following level is DownSample() of the previous one.
+	template<class T, int C, ImageType I> void GaussianPyramid(const Volume<T, C, I>& in,
+		std::vector<Volume<T, C, I>>& pyramid, int levels, int minSize = 1) {
+		pyramid.resize(1);
+		pyramid[0] = in;
+		while ((int) pyramid.size() < levels) {
+			const Volume<T, C, I>& last = pyramid.back();
+			if (last.rows / 2 < minSize || last.cols / 2 < minSize || last.slices / 2 < minSize)
+				break;
+			Volume<T, C, I> next;
+			DownSample(last, next);
+			pyramid.push_back(std::move(next));
+		}
+	}
 	template<class T, int C, ImageType I> void Transform(Volume<T, C, I>& im1,
 		Volume<T, C, I>& im2,
 		const std::function<void(vec<T, C>&, vec<T, C>&)>& func) {
@@ -597,162 +616,193 @@ namespace aly {
 	template<class T, int C, ImageType I> Volume<T, C, I> operator+(
 		const vec<T, C>& scalar, const Volume<T, C, I>& img) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar + val2;};
-		Transform(out, img, f);
+		VecTransform<AddKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 		return out;
 	}
-
 	template<class T, int C, ImageType I> Volume<T, C, I> operator-(
 		const vec<T, C>& scalar, const Volume<T, C, I>& img) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar - val2;};
-		Transform(out, img, f);
+		VecTransform<SubtractKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator*(
 		const vec<T, C>& scalar, const Volume<T, C, I>& img) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar*val2;};
-		Transform(out, img, f);
+		VecTransform<MultiplyKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator/(
 		const vec<T, C>& scalar, const Volume<T, C, I>& img) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = scalar / val2;};
-		Transform(out, img, f);
+		VecTransform<DivideKernel>(out.data.data(), img.data.data(), scalar, img.size(), true);
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator+(
 		const Volume<T, C, I>& img, const vec<T, C>& scalar) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2 + scalar;};
-		Transform(out, img, f);
+		VecTransform<AddKernel>(out.data.data(), img.data.data(), scalar, img.size());
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator-(
 		const Volume<T, C, I>& img, const vec<T, C>& scalar) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2 - scalar;};
-		Transform(out, img, f);
+		VecTransform<SubtractKernel>(out.data.data(), img.data.data(), scalar, img.size());
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator*(
 		const Volume<T, C, I>& img, const vec<T, C>& scalar) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2*scalar;};
-		Transform(out, img, f);
+		VecTransform<MultiplyKernel>(out.data.data(), img.data.data(), scalar, img.size());
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator/(
 		const Volume<T, C, I>& img, const vec<T, C>& scalar) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = val2 / scalar;};
-		Transform(out, img, f);
+		VecTransform<DivideKernel>(out.data.data(), img.data.data(), scalar, img.size());
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator-(
 		const Volume<T, C, I>& img) {
 		Volume<T, C, I> out(img.rows, img.cols, img.slices, img.position());
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 = -val2;};
-		Transform(out, img, f);
+		VecTransform<SubtractKernel>(out.data.data(), img.data.data(), vec<T, C>(T(0)), img.size(), true);
 		return out;
 	}
-	template<class T, int C, ImageType I> Volume<T, C, I> operator+=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator+=(
 		Volume<T, C, I>& out, const Volume<T, C, I>& img) {
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 += val2;};
-		Transform(out, img, f);
+		if (out.dimensions() != img.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< out.dimensions() << "!=" << img.dimensions());
+		VecTransform<AddKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 		return out;
 	}
-	template<class T, int C, ImageType I> Volume<T, C, I> operator-=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator-=(
 		Volume<T, C, I>& out, const Volume<T, C, I>& img) {
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 -= val2;};
-		Transform(out, img, f);
+		if (out.dimensions() != img.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< out.dimensions() << "!=" << img.dimensions());
+		VecTransform<SubtractKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 		return out;
 	}
-	template<class T, int C, ImageType I> Volume<T, C, I> operator*=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator*=(
 		Volume<T, C, I>& out, const Volume<T, C, I>& img) {
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 *= val2;};
-		Transform(out, img, f);
+		if (out.dimensions() != img.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< out.dimensions() << "!=" << img.dimensions());
+		VecTransform<MultiplyKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 		return out;
 	}
-	template<class T, int C, ImageType I> Volume<T, C, I> operator/=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator/=(
 		Volume<T, C, I>& out, const Volume<T, C, I>& img) {
-		std::function<void(vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2) {val1 /= val2;};
-		Transform(out, img, f);
+		if (out.dimensions() != img.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< out.dimensions() << "!=" << img.dimensions());
+		VecTransform<DivideKernel>(out.data.data(), out.data.data(), img.data.data(), out.size());
 		return out;
 	}
 
-	template<class T, int C, ImageType I> Volume<T, C, I> operator+=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator+=(
 		Volume<T, C, I>& out, const vec<T, C>& scalar) {
-		std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 += scalar;};
-		Transform(out, f);
+		VecTransform<AddKernel>(out.data.data(), out.data.data(), scalar, out.size());
 		return out;
 	}
-	template<class T, int C, ImageType I> Volume<T, C, I> operator-=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator-=(
 		Volume<T, C, I>& out, const vec<T, C>& scalar) {
-		std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 -= scalar;};
-		Transform(out, f);
+		VecTransform<SubtractKernel>(out.data.data(), out.data.data(), scalar, out.size());
 		return out;
 	}
-	template<class T, int C, ImageType I> Volume<T, C, I> operator*=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator*=(
 		Volume<T, C, I>& out, const vec<T, C>& scalar) {
-		std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 *= scalar;};
-		Transform(out, f);
+		VecTransform<MultiplyKernel>(out.data.data(), out.data.data(), scalar, out.size());
 		return out;
 	}
-	template<class T, int C, ImageType I> Volume<T, C, I> operator/=(
+	template<class T, int C, ImageType I> Volume<T, C, I>& operator/=(
 		Volume<T, C, I>& out, const vec<T, C>& scalar) {
-		std::function<void(vec<T, C>&)> f = [=](vec<T, C>& val1) {val1 /= scalar;};
-		Transform(out, f);
+		VecTransform<DivideKernel>(out.data.data(), out.data.data(), scalar, out.size());
 		return out;
 	}
 
 	template<class T, int C, ImageType I> Volume<T, C, I> operator+(
 		const Volume<T, C, I>& img1, const Volume<T, C, I>& img2) {
+		if (img1.dimensions() != img2.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< img1.dimensions() << "!=" << img2.dimensions());
 		Volume<T, C, I> out(img1.rows, img1.cols, img1.slices);
-		std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 + val3;};
-		Transform(out, img1, img2, f);
+		VecTransform<AddKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator-(
 		const Volume<T, C, I>& img1, const Volume<T, C, I>& img2) {
+		if (img1.dimensions() != img2.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< img1.dimensions() << "!=" << img2.dimensions());
 		Volume<T, C, I> out(img1.rows, img1.cols, img1.slices);
-		std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 - val3;};
-		Transform(out, img1, img2, f);
+		VecTransform<SubtractKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator*(
 		const Volume<T, C, I>& img1, const Volume<T, C, I>& img2) {
+		if (img1.dimensions() != img2.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< img1.dimensions() << "!=" << img2.dimensions());
 		Volume<T, C, I> out(img1.rows, img1.cols, img1.slices);
-		std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2*val3;};
-		Transform(out, img1, img2, f);
+		VecTransform<MultiplyKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 		return out;
 	}
 	template<class T, int C, ImageType I> Volume<T, C, I> operator/(
 		const Volume<T, C, I>& img1, const Volume<T, C, I>& img2) {
+		if (img1.dimensions() != img2.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< img1.dimensions() << "!=" << img2.dimensions());
 		Volume<T, C, I> out(img1.rows, img1.cols, img1.slices);
-		std::function<void(vec<T, C>&, const vec<T, C>&, const vec<T, C>&)> f =
-			[=](vec<T, C>& val1, const vec<T, C>& val2, const vec<T, C>& val3) {val1 = val2 / val3;};
-		Transform(out, img1, img2, f);
+		VecTransform<DivideKernel>(out.data.data(), img1.data.data(), img2.data.data(), out.size());
 		return out;
 	}
+	//out = img1 + scalar * img2
+	template<class T, int C, ImageType I> void ScaleAdd(Volume<T, C, I>& out,
+		const Volume<T, C, I>& img1, const vec<T, C>& scalar,
+		const Volume<T, C, I>& img2) {
+		if (img1.dimensions() != img2.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< img1.dimensions() << "!=" << img2.dimensions());
+		out.resize(img1.rows, img1.cols, img1.slices);
+		VecScaleAdd(out.data.data(), img1.data.data(), scalar, img2.data.data(), out.size());
+	}
+	//out = img1 - scalar * img2
+	template<class T, int C, ImageType I> void ScaleSubtract(Volume<T, C, I>& out,
+		const Volume<T, C, I>& img1, const vec<T, C>& scalar,
+		const Volume<T, C, I>& img2) {
+		if (img1.dimensions() != img2.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< img1.dimensions() << "!=" << img2.dimensions());
+		out.resize(img1.rows, img1.cols, img1.slices);
+		VecScaleAdd(out.data.data(), img1.data.data(), scalar, img2.data.data(), out.size(), true);
+	}
+	//Sum of products over all voxels and channels.
+	template<class T, int C, ImageType I> double dot(const Volume<T, C, I>& img1,
+		const Volume<T, C, I>& img2) {
+		if (img1.dimensions() != img2.dimensions())
+			throw std::runtime_error(
+				MakeString() << "Volume dimensions do not match. "
+				<< img1.dimensions() << "!=" << img2.dimensions());
+		return VecDot(img1.data.data(), img2.data.data(), img1.size());
+	}
+	template<class T, int C, ImageType I> double lengthSqr(
+		const Volume<T, C, I>& img) {
+		return VecDot(img.data.data(), img.data.data(), img.size());
+	}
+	//MIPAV XML header that accompanies a planar .raw volume with the same base name.
+	void WriteVolumeHeaderToXML(const std::string& file, ImageType type, int rows,
+		int cols, int slices, int channels);
 	template<class T, int C, ImageType I> void WriteImageToRawFile(
 		const std::string& file, const Volume<T, C, I>& img) {
 		std::ostringstream vstr;
@@ -764,100 +814,70 @@ namespace aly {
 				MakeString() << "Could not open " << vstr.str().c_str()
 				<< " for writing.");
 		}
-		for (int c = 0; c < img.channels; c++) {
-			for (int k = 0; k < img.slices; k++) {
-				for (int j = 0; j < img.cols; j++) {
-					for (int i = 0; i < img.rows; i++) {
-						T val = img(i, j, k)[c];
-						fwrite(&val, sizeof(T), 1, f);
-					}
-				}
-			}
-		}
+		bool ok = WriteRawPlanes(f, img.data.data(), img.size());
 		fclose(f);
-		std::string typeName = "";
-		switch (img.type) {
-		case ImageType::BYTE:
-			typeName = "Byte";
-			break;
-		case ImageType::UBYTE:
-			typeName = "Unsigned Byte";
-			break;
-		case ImageType::SHORT:
-			typeName = "Short";
-			break;
-		case ImageType::USHORT:
-			typeName = "Unsigned Short";
-			break;
-		case ImageType::INT:
-			typeName = "Integer";
-			break;
-		case ImageType::UINT:
-			typeName = "Unsigned Integer";
-			break;
-		case ImageType::FLOAT:
-			typeName = "Float";
-			break;
-		case ImageType::DOUBLE:
-			typeName = "Double";
-			break;
-		case ImageType::UNKNOWN:
-			typeName = "Unknown";
-			break;
-		}
-		//std::cout << vstr.str() << std::endl;
-		std::stringstream sstr;
-		sstr << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-		sstr << "<!-- MIPAV header file -->\n";
-		if (img.channels > 1) {
-			sstr << "<image xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" nDimensions=\"4\">\n";
-		}
-		else {
-			sstr << "<image xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" nDimensions=\"3\">\n";
-		}
-		sstr << "	<Dataset-attributes>\n";
-		sstr << "		<Image-offset>0</Image-offset>\n";
-		sstr << "		<Data-type>" << typeName << "</Data-type>\n";
-		sstr << "		<Endianess>Little</Endianess>\n";
-		sstr << "		<Extents>" << img.rows << "</Extents>\n";
-		sstr << "		<Extents>" << img.cols << "</Extents>\n";
-		sstr << "		<Extents>" << img.slices << "</Extents>\n";
-		if (img.channels > 1) {
-			sstr << "		<Extents>" << img.channels << "</Extents>\n";
-		}
-		sstr << "		<Resolutions>\n";
-		sstr << "			<Resolution>1.0</Resolution>\n";
-		sstr << "			<Resolution>1.0</Resolution>\n";
-		sstr << "			<Resolution>1.0</Resolution>\n";
-		sstr << "		</Resolutions>\n";
-		sstr << "		<Slice-spacing>1.0</Slice-spacing>\n";
-		sstr << "		<Slice-thickness>0.0</Slice-thickness>\n";
-		sstr << "		<Units>Millimeters</Units>\n";
-		sstr << "		<Units>Millimeters</Units>\n";
-		sstr << "		<Units>Millimeters</Units>\n";
-		sstr << "		<Compression>none</Compression>\n";
-		sstr << "		<Orientation>Unknown</Orientation>\n";
-		sstr << "		<Subject-axis-orientation>Unknown</Subject-axis-orientation>\n";
-		sstr << "		<Subject-axis-orientation>Unknown</Subject-axis-orientation>\n";
-		sstr << "		<Subject-axis-orientation>Unknown</Subject-axis-orientation>\n";
-		sstr << "		<Origin>0.0</Origin>\n";
-		sstr << "		<Origin>0.0</Origin>\n";
-		sstr << "		<Origin>0.0</Origin>\n";
-		sstr << "		<Modality>Unknown Modality</Modality>\n";
-		sstr << "	</Dataset-attributes>\n";
-		sstr << "</image>\n";
-		std::ofstream myfile;
-		std::stringstream xmlFile;
-		xmlFile << fileName << ".xml";
-		myfile.open(xmlFile.str().c_str(), std::ios_base::out);
-		if (!myfile.is_open()) {
+		if (!ok) {
 			throw std::runtime_error(
-				MakeString() << "Could not open " << xmlFile.str()
-				<< " for writing.");
+				MakeString() << "Could not write " << vstr.str());
 		}
-		myfile << sstr.str();
-		myfile.close();
+		WriteVolumeHeaderToXML(file, img.type, img.rows, img.cols, img.slices, img.channels);
 	}
+	//Reads a MIPAV .xml/.raw pair written by WriteImageToRawFile. Scalars are converted to T if the file type differs.
+	template<class T, int C, ImageType I> void ReadVolumeFromFile(
+		const std::string& file, Volume<T, C, I>& img) {
+		MappedRawFile raw(file);
+		const std::vector<int>& extents = raw.getHeader().extents;
+		int channels = (extents.size() > 3) ? extents[3] : 1;
+		if (channels != C) {
+			throw std::runtime_error(
+				MakeString() << "Channel count in " << file << " (" << channels
+				<< ") does not match volume (" << C << ").");
+		}
+		img.resize(extents[0], (extents.size() > 1) ? extents[1] : 1,
+			(extents.size() > 2) ? extents[2] : 1);
+		ReadRawPlanes(raw, img.data.data(), img.size());
+	}
+	//Zero-copy view of a raw volume stored with scalar type T. Each channel is a contiguous plane of the mapped file,
+	//so volumes larger than memory can be sampled without reading them in.
+	template<class T, ImageType I> class MappedVolume {
+	protected:
+		MappedRawFile raw;
+		const T* ptr;
+	public:
+		int rows;
+		int cols;
+		int slices;
+		int channels;
+		MappedVolume() :
+			ptr(nullptr), rows(0), cols(0), slices(0), channels(0) {
+		}
+		MappedVolume(const std::string& file) :
+			MappedVolume() {
+			open(file);
+		}
+		void open(const std::string& file) {
+			raw.open(file);
+			raw.checkDirectAccess(I, alignof(T));
+			const std::vector<int>& extents = raw.getHeader().extents;
+			rows = extents[0];
+			cols = (extents.size() > 1) ? extents[1] : 1;
+			slices = (extents.size() > 2) ? extents[2] : 1;
+			channels = (extents.size() > 3) ? extents[3] : 1;
+			ptr = (const T*)raw.data();
+		}
+		size_t size() const {
+			return (size_t)rows * cols * slices;
+		}
+		int3 dimensions() const {
+			return int3(rows, cols, slices);
+		}
+		const T* channel(int c) const {
+			return ptr + c * size();
+		}
+		const T& operator()(int i, int j, int k, int c = 0) const {
+			return ptr[i + ((size_t)j + (size_t)k * cols) * rows + c * size()];
+		}
+	};
 	typedef Volume<uint8_t, 4, ImageType::UBYTE> VolumeRGBA;
 	typedef Volume<int, 4, ImageType::INT> VolumeRGBAi;
 	typedef Volume<float, 4, ImageType::FLOAT> VolumeRGBAf;
@@ -27,7 +27,10 @@ public:
 	SHA1();
 	void update(const std::string &s);
 	void update(std::istream &is);
+	void update(const unsigned char *data, size_t length);
 	std::string final();
+	/* Writes the 20 byte digest and resets */
+	void final(unsigned char *digest);
 	static std::string from_file(const std::string &filename);
 
 private:
@@ -45,6 +48,8 @@ private:
 
 	static void buffer_to_block(const std::string &buffer,
 			uint32_t block[BLOCK_BYTES]);
+	static void bytes_to_block(const unsigned char *bytes,
+			uint32_t block[BLOCK_BYTES]);
 	static void read(std::istream &is, std::string &s, int max);
 };
 
@@ -0,0 +1,484 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "AlloyBinaryFile.h"
+#include <cstring>
+namespace aly {
+	//On disk layout of the file header and section table entries.
+	struct BinaryFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t sectionCount;
+		uint64_t tableOffset;
+		uint8_t reserved[40];
+	};
+	struct BinarySectionRecord {
+		char name[48];
+		int32_t type;
+		int32_t channels;
+		int32_t compression;
+		int32_t reserved;
+		uint64_t count;
+		uint64_t extents[3];
+		uint64_t offset;
+		uint64_t storedSize;
+		uint64_t hash;
+		uint64_t padding;
+	};
+	static_assert(sizeof(BinaryFileHeader) == 64, "Binary file header must be 64 bytes.");
+	static_assert(sizeof(BinarySectionRecord) == 128, "Binary section record must be 128 bytes.");
+	static const char BINARY_FILE_MAGIC[8] = { 'A', 'L', 'Y', 'B', 'I', 'N', '\r', '\n' };
+	static const uint32_t BINARY_FILE_VERSION = 1;
+	static const size_t BINARY_FILE_ALIGNMENT = 64;
+	static const size_t BINARY_BLOCK_SIZE = 1 << 20;
+	static inline uint32_t ReadU32(const uint8_t* ptr) {
+		uint32_t val;
+		std::memcpy(&val, ptr, sizeof(uint32_t));
+		return val;
+	}
+	static inline uint64_t ReadU64(const uint8_t* ptr) {
+		uint64_t val;
+		std::memcpy(&val, ptr, sizeof(uint64_t));
+		return val;
+	}
+	/*
+	 Collet, Y. LZ4 Block Format Description. https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+
+	 Greedy single pass compressor with a hash table of 4 byte sequences. Output follows the block format, including
+	 the rule that the last 5 bytes are literals and the last match starts at least 12 bytes before the end.
+	 */
+	static size_t CompressBoundLZ4(size_t size) {
+		return size + size / 255 + 16;
+	}
+	static inline void WriteLengthLZ4(uint8_t*& op, size_t length) {
+		while (length >= 255) {
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = (uint8_t) length;
+	}
+	static size_t CompressLZ4(const uint8_t* src, size_t size, uint8_t* dst) {
+		const int HASH_LOG = 16;
+		const size_t MIN_MATCH = 4;
+		const size_t LAST_LITERALS = 5;
+		const size_t MATCH_LIMIT = 12;
+		std::vector<uint32_t> table((size_t) 1 << HASH_LOG, 0);
+		uint8_t* op = dst;
+		size_t anchor = 0;
+		if (size > MATCH_LIMIT) {
+			const size_t limit = size - MATCH_LIMIT;
+			const size_t matchEnd = size - LAST_LITERALS;
+			size_t ip = 0;
+			size_t misses = 0;
+			while (ip < limit) {
+				uint32_t seq = ReadU32(src + ip);
+				uint32_t h = (seq * 2654435761U) >> (32 - HASH_LOG);
+				size_t ref = table[h];
+				table[h] = (uint32_t) ip;
+				if (ref >= ip || ip - ref > 65535 || ReadU32(src + ref) != seq) {
+					ip += 1 + (misses++ >> 6);
+					continue;
+				}
+				misses = 0;
+				while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+					ip--;
+					ref--;
+				}
+				size_t end = ip + MIN_MATCH;
+				while (end < matchEnd && src[end] == src[ref + end - ip]) {
+					end++;
+				}
+				size_t literals = ip - anchor;
+				size_t match = end - ip - MIN_MATCH;
+				uint8_t* token = op++;
+				*token = (uint8_t) (std::min(literals, (size_t) 15) << 4 | std::min(match, (size_t) 15));
+				if (literals >= 15)
+					WriteLengthLZ4(op, literals - 15);
+				std::memcpy(op, src + anchor, literals);
+				op += literals;
+				uint16_t offset = (uint16_t) (ip - ref);
+				*op++ = (uint8_t) (offset & 0xFF);
+				*op++ = (uint8_t) (offset >> 8);
+				if (match >= 15)
+					WriteLengthLZ4(op, match - 15);
+				ip = end;
+				anchor = ip;
+			}
+		}
+		size_t literals = size - anchor;
+		*op++ = (uint8_t) (std::min(literals, (size_t) 15) << 4);
+		if (literals >= 15)
+			WriteLengthLZ4(op, literals - 15);
+		std::memcpy(op, src + anchor, literals);
+		op += literals;
+		return (size_t) (op - dst);
+	}
+	//Returns false if the block is malformed or does not decode to exactly size bytes.
+	static bool DecompressLZ4(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t size) {
+		const uint8_t* ip = src;
+		const uint8_t* ipEnd = src + srcSize;
+		uint8_t* op = dst;
+		uint8_t* opEnd = dst + size;
+		while (ip < ipEnd) {
+			uint8_t token = *ip++;
+			size_t literals = token >> 4;
+			if (literals == 15) {
+				uint8_t s;
+				do {
+					if (ip >= ipEnd)
+						return false;
+					s = *ip++;
+					literals += s;
+				} while (s == 255);
+			}
+			if ((size_t) (ipEnd - ip) < literals || (size_t) (opEnd - op) < literals)
+				return false;
+			std::memcpy(op, ip, literals);
+			ip += literals;
+			op += literals;
+			if (ip == ipEnd)
+				break;
+			if (ipEnd - ip < 2)
+				return false;
+			size_t offset = ip[0] | ((size_t) ip[1] << 8);
+			ip += 2;
+			if (offset == 0 || offset > (size_t) (op - dst))
+				return false;
+			size_t match = (token & 15);
+			if (match == 15) {
+				uint8_t s;
+				do {
+					if (ip >= ipEnd)
+						return false;
+					s = *ip++;
+					match += s;
+				} while (s == 255);
+			}
+			match += 4;
+			if ((size_t) (opEnd - op) < match)
+				return false;
+			const uint8_t* ref = op - offset;
+			if (offset >= match) {
+				std::memcpy(op, ref, match);
+				op += match;
+			} else {
+				for (size_t i = 0; i < match; i++) {
+					*op++ = *ref++;
+				}
+			}
+		}
+		return (op == opEnd);
+	}
+	//Groups byte k of every scalar together so the exponent and high mantissa bytes of floats form long runs.
+	static void ShuffleBytes(const uint8_t* src, uint8_t* dst, size_t size, size_t scalar) {
+		size_t n = size / scalar;
+		for (size_t k = 0; k < scalar; k++) {
+			uint8_t* lane = dst + k * n;
+			for (size_t i = 0; i < n; i++) {
+				lane[i] = src[i * scalar + k];
+			}
+		}
+	}
+	static void UnshuffleBytes(const uint8_t* src, uint8_t* dst, size_t size, size_t scalar) {
+		size_t n = size / scalar;
+		for (size_t k = 0; k < scalar; k++) {
+			const uint8_t* lane = src + k * n;
+			for (size_t i = 0; i < n; i++) {
+				dst[i * scalar + k] = lane[i];
+			}
+		}
+	}
+	BinaryFileWriter::BinaryFileWriter() :
+			file(nullptr), position(0) {
+	}
+	BinaryFileWriter::BinaryFileWriter(const std::string& file) :
+			BinaryFileWriter() {
+		open(file);
+	}
+	BinaryFileWriter::~BinaryFileWriter() {
+		try {
+			close();
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+		}
+	}
+	void BinaryFileWriter::writeBytes(const void* data, size_t size) {
+		if (size > 0 && fwrite(data, 1, size, file) != size)
+			throw std::runtime_error(MakeString() << "Could not write to " << fileName);
+		position += size;
+	}
+	void BinaryFileWriter::align() {
+		static const uint8_t zeros[BINARY_FILE_ALIGNMENT] = { 0 };
+		size_t pad = (size_t) ((BINARY_FILE_ALIGNMENT - position % BINARY_FILE_ALIGNMENT) % BINARY_FILE_ALIGNMENT);
+		writeBytes(zeros, pad);
+	}
+	void BinaryFileWriter::open(const std::string& file) {
+		close();
+		this->file = fopen(file.c_str(), "wb");
+		if (this->file == nullptr)
+			throw std::runtime_error(MakeString() << "Could not open " << file << " for writing.");
+		fileName = file;
+		position = 0;
+		sections.clear();
+		lookup.clear();
+		BinaryFileHeader header;
+		std::memset(&header, 0, sizeof(BinaryFileHeader));
+		writeBytes(&header, sizeof(BinaryFileHeader));
+	}
+	void BinaryFileWriter::close() {
+		if (file == nullptr)
+			return;
+		FILE* f = file;
+		try {
+			align();
+			BinaryFileHeader header;
+			std::memset(&header, 0, sizeof(BinaryFileHeader));
+			std::memcpy(header.magic, BINARY_FILE_MAGIC, sizeof(header.magic));
+			header.version = BINARY_FILE_VERSION;
+			header.sectionCount = (uint32_t) sections.size();
+			header.tableOffset = position;
+			for (const BinarySection& section : sections) {
+				BinarySectionRecord record;
+				std::memset(&record, 0, sizeof(BinarySectionRecord));
+				std::memcpy(record.name, section.name.c_str(), section.name.size());
+				record.type = (int32_t) section.type;
+				record.channels = section.channels;
+				record.compression = (int32_t) section.compression;
+				record.count = section.count;
+				for (int i = 0; i < 3; i++) {
+					record.extents[i] = section.extents[i];
+				}
+				record.offset = section.offset;
+				record.storedSize = section.storedSize;
+				record.hash = section.hash;
+				writeBytes(&record, sizeof(BinarySectionRecord));
+			}
+			if (fseek(file, 0, SEEK_SET) != 0)
+				throw std::runtime_error(MakeString() << "Could not write to " << fileName);
+			writeBytes(&header, sizeof(BinaryFileHeader));
+		} catch (...) {
+			fclose(f);
+			file = nullptr;
+			throw;
+		}
+		fclose(f);
+		file = nullptr;
+	}
+	void BinaryFileWriter::write(const std::string& name, const void* data, ImageType type, int channels, size_t count,
+			BinaryCompression compression, int3 extents) {
+		if (file == nullptr)
+			throw std::runtime_error("Binary file is not open for writing.");
+		if (name.size() == 0 || name.size() >= sizeof(BinarySectionRecord::name))
+			throw std::runtime_error(MakeString() << "Section name \"" << name << "\" must be between 1 and 47 characters.");
+		if (GetImageTypeSize(type) == 0 || channels <= 0)
+			throw std::runtime_error(MakeString() << "Section " << name << " has an unsupported element type.");
+		if (lookup.find(name) != lookup.end())
+			throw std::runtime_error(MakeString() << "Section " << name << " already exists in " << fileName);
+		BinarySection section;
+		section.name = name;
+		section.type = type;
+		section.channels = channels;
+		section.count = count;
+		for (int i = 0; i < 3; i++) {
+			section.extents[i] = (uint64_t) std::max(extents[i], 0);
+		}
+		section.compression = compression;
+		section.offset = position;
+		const size_t size = section.size();
+		const uint8_t* bytes = (const uint8_t*) data;
+		section.hash = XXHash64::hash(bytes, size);
+		if (compression == BinaryCompression::Raw) {
+			writeBytes(bytes, size);
+		} else {
+			const size_t scalar = GetImageTypeSize(type);
+			const bool shuffle = (compression == BinaryCompression::ShuffleLZ4 && scalar > 1);
+			const size_t blocks = (size + BINARY_BLOCK_SIZE - 1) / BINARY_BLOCK_SIZE;
+			const size_t BATCH = 64;
+			std::vector<std::vector<uint8_t>> buffers(BATCH);
+			std::vector<uint64_t> blockEnds(blocks);
+			for (size_t first = 0; first < blocks; first += BATCH) {
+				const int batch = (int) std::min(BATCH, blocks - first);
+#pragma omp parallel for
+				for (int b = 0; b < batch; b++) {
+					size_t start = (first + b) * BINARY_BLOCK_SIZE;
+					size_t length = std::min(BINARY_BLOCK_SIZE, size - start);
+					const uint8_t* src = bytes + start;
+					std::vector<uint8_t> shuffled;
+					if (shuffle) {
+						shuffled.resize(length);
+						ShuffleBytes(src, shuffled.data(), length, scalar);
+						src = shuffled.data();
+					}
+					std::vector<uint8_t>& buffer = buffers[b];
+					buffer.resize(CompressBoundLZ4(length));
+					size_t stored = CompressLZ4(src, length, buffer.data());
+					//Blocks that do not shrink are stored as is, which the reader detects from their size.
+					if (stored >= length) {
+						std::memcpy(buffer.data(), bytes + start, length);
+						stored = length;
+					}
+					buffer.resize(stored);
+				}
+				for (int b = 0; b < batch; b++) {
+					writeBytes(buffers[b].data(), buffers[b].size());
+					blockEnds[first + b] = position - section.offset;
+				}
+			}
+			writeBytes(blockEnds.data(), blockEnds.size() * sizeof(uint64_t));
+		}
+		section.storedSize = position - section.offset;
+		align();
+		lookup[name] = sections.size();
+		sections.push_back(section);
+	}
+	void MappedBinaryFile::open(const std::string& file) {
+		close();
+		this->file.open(file);
+		fileName = file;
+		const uint8_t* base = (const uint8_t*) this->file.data();
+		const size_t fileSize = this->file.size();
+		BinaryFileHeader header;
+		if (fileSize < sizeof(BinaryFileHeader))
+			throw std::runtime_error(MakeString() << file << " is not an Alloy binary file.");
+		std::memcpy(&header, base, sizeof(BinaryFileHeader));
+		if (std::memcmp(header.magic, BINARY_FILE_MAGIC, sizeof(header.magic)) != 0)
+			throw std::runtime_error(MakeString() << file << " is not an Alloy binary file.");
+		if (header.version != BINARY_FILE_VERSION)
+			throw std::runtime_error(MakeString() << file << " has unsupported version " << header.version);
+		if (header.tableOffset > fileSize || (fileSize - header.tableOffset) / sizeof(BinarySectionRecord) < header.sectionCount)
+			throw std::runtime_error(MakeString() << "Section table is truncated [" << file << "]");
+		sections.resize(header.sectionCount);
+		for (size_t n = 0; n < sections.size(); n++) {
+			BinarySectionRecord record;
+			std::memcpy(&record, base + header.tableOffset + n * sizeof(BinarySectionRecord), sizeof(BinarySectionRecord));
+			record.name[sizeof(record.name) - 1] = '\0';
+			BinarySection& section = sections[n];
+			section.name = record.name;
+			section.type = (ImageType) record.type;
+			section.channels = record.channels;
+			section.compression = (BinaryCompression) record.compression;
+			section.count = record.count;
+			for (int i = 0; i < 3; i++) {
+				section.extents[i] = record.extents[i];
+			}
+			section.offset = record.offset;
+			section.storedSize = record.storedSize;
+			section.hash = record.hash;
+			if (GetImageTypeSize(section.type) == 0 || section.channels <= 0 || section.offset > fileSize
+					|| section.storedSize > fileSize - section.offset)
+				throw std::runtime_error(MakeString() << "Section " << section.name << " is corrupt [" << file << "]");
+			if (section.compression == BinaryCompression::Raw) {
+				if (section.storedSize != section.size())
+					throw std::runtime_error(MakeString() << "Section " << section.name << " is corrupt [" << file << "]");
+			} else if (section.compression == BinaryCompression::LZ4 || section.compression == BinaryCompression::ShuffleLZ4) {
+				size_t blocks = (section.size() + BINARY_BLOCK_SIZE - 1) / BINARY_BLOCK_SIZE;
+				if (section.storedSize < blocks * sizeof(uint64_t))
+					throw std::runtime_error(MakeString() << "Section " << section.name << " is corrupt [" << file << "]");
+			} else {
+				throw std::runtime_error(MakeString() << "Section " << section.name << " has unknown compression [" << file << "]");
+			}
+			lookup[section.name] = n;
+		}
+	}
+	void MappedBinaryFile::close() {
+		file.close();
+		sections.clear();
+		lookup.clear();
+	}
+	const BinarySection& MappedBinaryFile::getSection(const std::string& name) const {
+		auto iter = lookup.find(name);
+		if (iter == lookup.end())
+			throw std::runtime_error(MakeString() << "Section " << name << " not found in " << fileName);
+		return sections[iter->second];
+	}
+	const BinarySection& MappedBinaryFile::checkSection(const std::string& name, ImageType type, int channels) const {
+		const BinarySection& section = getSection(name);
+		if (section.type != type || section.channels != channels)
+			throw std::runtime_error(MakeString() << "Section " << name << " holds " << section.type << "x" << section.channels
+				<< " elements, not " << type << "x" << channels);
+		return section;
+	}
+	const void* MappedBinaryFile::data(const std::string& name) const {
+		const BinarySection& section = getSection(name);
+		if (section.compression != BinaryCompression::Raw)
+			throw std::runtime_error(MakeString() << "Section " << name << " is compressed and must be read.");
+		return file.data() + section.offset;
+	}
+	void MappedBinaryFile::read(const std::string& name, void* dest, ImageType type, int channels) const {
+		const BinarySection& section = checkSection(name, type, channels);
+		const size_t size = section.size();
+		const uint8_t* src = (const uint8_t*) file.data() + section.offset;
+		uint8_t* out = (uint8_t*) dest;
+		const int blocks = (int) ((size + BINARY_BLOCK_SIZE - 1) / BINARY_BLOCK_SIZE);
+		if (section.compression == BinaryCompression::Raw) {
+#pragma omp parallel for
+			for (int b = 0; b < blocks; b++) {
+				size_t start = b * BINARY_BLOCK_SIZE;
+				std::memcpy(out + start, src + start, std::min(BINARY_BLOCK_SIZE, size - start));
+			}
+			return;
+		}
+		const size_t scalar = GetImageTypeSize(type);
+		const bool shuffle = (section.compression == BinaryCompression::ShuffleLZ4 && scalar > 1);
+		const uint8_t* blockEnds = src + section.storedSize - blocks * sizeof(uint64_t);
+		const size_t dataSize = section.storedSize - blocks * sizeof(uint64_t);
+		bool corrupt = false;
+#pragma omp parallel for
+		for (int b = 0; b < blocks; b++) {
+			size_t start = b * BINARY_BLOCK_SIZE;
+			size_t length = std::min(BINARY_BLOCK_SIZE, size - start);
+			uint64_t storedStart = (b > 0) ? ReadU64(blockEnds + (b - 1) * sizeof(uint64_t)) : 0;
+			uint64_t storedEnd = ReadU64(blockEnds + b * sizeof(uint64_t));
+			bool valid = (storedStart <= storedEnd && storedEnd <= dataSize);
+			if (valid) {
+				size_t stored = (size_t) (storedEnd - storedStart);
+				if (stored == length) {
+					std::memcpy(out + start, src + storedStart, length);
+				} else if (shuffle) {
+					std::vector<uint8_t> shuffled(length);
+					valid = DecompressLZ4(src + storedStart, stored, shuffled.data(), length);
+					if (valid)
+						UnshuffleBytes(shuffled.data(), out + start, length, scalar);
+				} else {
+					valid = DecompressLZ4(src + storedStart, stored, out + start, length);
+				}
+			}
+			if (!valid) {
+#pragma omp critical
+				corrupt = true;
+			}
+		}
+		if (corrupt)
+			throw std::runtime_error(MakeString() << "Section " << name << " is corrupt [" << fileName << "]");
+	}
+	bool MappedBinaryFile::verify(const std::string& name) const {
+		const BinarySection& section = getSection(name);
+		if (section.compression == BinaryCompression::Raw) {
+			return (XXHash64::hash(file.data() + section.offset, section.size()) == section.hash);
+		}
+		std::vector<uint8_t> bytes(section.size());
+		try {
+			read(name, bytes.data(), section.type, section.channels);
+		} catch (const std::exception&) {
+			return false;
+		}
+		return (XXHash64::hash(bytes.data(), bytes.size()) == section.hash);
+	}
+}
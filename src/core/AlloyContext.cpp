@@ -23,6 +23,7 @@
 #include "AlloyContext.h"
 #include "AlloyUI.h"
 #include "AlloyDrawUtil.h"
+#include "AlloyTiledImage.h"
 #include "AlloyApplication.h"
 #include "nanovg.h"
 
@@ -189,6 +190,94 @@ void ImageGlyph::draw(const box2px& bounds, const Color& fgColor,
 	}
 
 }
+TiledImageGlyph::TiledImageGlyph(const std::shared_ptr<TiledImageRGBA>& image,
+		AlloyContext* context, size_t maxTextures) :
+		Glyph("tiled_image", GlyphType::Image, (pixel) image->getWidth(),
+				(pixel) image->getHeight()), image(image), maxTextures(
+				maxTextures), frame(0) {
+}
+int TiledImageGlyph::getTexture(int level, int tx, int ty,
+		AlloyContext* context) {
+	uint64_t key = ((uint64_t) level << 56) | ((uint64_t) ty << 28)
+			| (uint64_t) tx;
+	auto iter = textures.find(key);
+	if (iter != textures.end()) {
+		iter->second.frame = frame;
+		return iter->second.handle;
+	}
+	//Textures drawn in an earlier frame have been flushed by nanovg, so the least recently drawn can be released.
+	while (textures.size() >= maxTextures) {
+		auto oldest = textures.begin();
+		for (auto it = textures.begin(); it != textures.end(); it++) {
+			if (it->second.frame < oldest->second.frame)
+				oldest = it;
+		}
+		if (oldest->second.frame == frame)
+			break;
+		nvgDeleteImage(context->nvgContext, oldest->second.handle);
+		textures.erase(oldest);
+	}
+	TiledImageRGBA::TilePtr tile = image->getTile(level, tx, ty);
+	TileTexture texture;
+	texture.handle = nvgCreateImageRGBA(context->nvgContext, tile->width,
+			tile->height, 0, tile->ptr());
+	texture.frame = frame;
+	textures[key] = texture;
+	return texture.handle;
+}
+void TiledImageGlyph::draw(const box2px& bounds, const Color& fgColor,
+		const Color& bgColor, AlloyContext* context) {
+	NVGcontext* nvg = context->nvgContext;
+	frame++;
+	box2px visible = bounds;
+	visible.intersect(context->getViewport());
+	if (visible.dimensions.x > 0 && visible.dimensions.y > 0) {
+		//Finest level with at least one texel per screen pixel.
+		float scale = image->getWidth()
+				/ std::max(bounds.dimensions.x * context->pixelRatio, 1.0f);
+		int level = clamp((int) std::floor(std::log2(std::max(scale, 1.0f))),
+				0, image->getLevels() - 1);
+		const int ts = image->getTileSize();
+		const float sx = bounds.dimensions.x / image->getWidth(level);
+		const float sy = bounds.dimensions.y / image->getHeight(level);
+		int tx0 = clamp((int) ((visible.position.x - bounds.position.x) / sx) / ts, 0, image->getTilesX(level) - 1);
+		int tx1 = clamp((int) ((visible.position.x + visible.dimensions.x - bounds.position.x) / sx) / ts, 0, image->getTilesX(level) - 1);
+		int ty0 = clamp((int) ((visible.position.y - bounds.position.y) / sy) / ts, 0, image->getTilesY(level) - 1);
+		int ty1 = clamp((int) ((visible.position.y + visible.dimensions.y - bounds.position.y) / sy) / ts, 0, image->getTilesY(level) - 1);
+		for (int ty = ty0; ty <= ty1; ty++) {
+			for (int tx = tx0; tx <= tx1; tx++) {
+				int handle = getTexture(level, tx, ty, context);
+				int2 dims = image->getLayout().getTileDimensions(level, tx, ty);
+				box2px rect(
+						bounds.position + pixel2(tx * ts * sx, ty * ts * sy),
+						pixel2(dims.x * sx, dims.y * sy));
+				NVGpaint imgPaint = nvgImagePattern(nvg, rect.position.x,
+						rect.position.y, rect.dimensions.x, rect.dimensions.y,
+						0.f, handle, 1.0f);
+				nvgBeginPath(nvg);
+				nvgRect(nvg, rect.position.x, rect.position.y,
+						rect.dimensions.x, rect.dimensions.y);
+				nvgFillPaint(nvg, imgPaint);
+				nvgFill(nvg);
+			}
+		}
+	}
+	if (fgColor.a > 0) {
+		nvgBeginPath(nvg);
+		nvgRect(nvg, bounds.position.x, bounds.position.y, bounds.dimensions.x,
+				bounds.dimensions.y);
+		nvgFillColor(nvg, Color(fgColor));
+		nvgFill(nvg);
+	}
+}
+TiledImageGlyph::~TiledImageGlyph() {
+	AlloyContext* context = AlloyDefaultContext().get();
+	if (context) {
+		for (auto& pr : textures) {
+			nvgDeleteImage(context->nvgContext, pr.second.handle);
+		}
+	}
+}
 CheckerboardGlyph::CheckerboardGlyph(int width, int height, int horizTiles,
 		int vertTiles, AlloyContext* context, bool mipmap) :
 		Glyph("image_rgba", GlyphType::Image, (pixel) width, (pixel) height) {
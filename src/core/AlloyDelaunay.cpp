@@ -19,11 +19,138 @@
 * THE SOFTWARE.
 */
 
-//Re-implementation of Paul Bourke's incremental Delaunay construction algorithm.
-//http://paulbourke.net/papers/triangulate/cpp.zip
+//Incremental Delaunay triangulation with ghost triangles, after Shewchuk's "Triangle" and Amenta, Choi and Rote,
+//"Incremental Constructions con BRIO". Constraints are inserted by Sloan's edge flipping method.
 #include "AlloyDelaunay.h"
 #include <algorithm>
+#include <random>
+#include <deque>
+#include <cmath>
+#include <limits>
 namespace aly {
+	//Exact arithmetic on floating-point expansions from Shewchuk, "Adaptive Precision Floating-Point Arithmetic and
+	//Fast Robust Geometric Predicates". Components do not overlap and increase in magnitude. Only the rare inputs that
+	//fail the floating-point filter reach these.
+	typedef std::vector<double> Expansion;
+	static inline void TwoSum(double a, double b, double& x, double& y) {
+		x = a + b;
+		double bv = x - a;
+		double av = x - bv;
+		y = (a - av) + (b - bv);
+	}
+	static inline void TwoProduct(double a, double b, double& x, double& y) {
+		x = a * b;
+		y = std::fma(a, b, -x);
+	}
+	static Expansion Sum(const Expansion& e, const Expansion& f) {
+		Expansion h = e;
+		Expansion g;
+		for (double q : f) {
+			g.clear();
+			for (double hv : h) {
+				double x, y;
+				TwoSum(q, hv, x, y);
+				if (y != 0.0)
+					g.push_back(y);
+				q = x;
+			}
+			if (q != 0.0 || g.empty())
+				g.push_back(q);
+			h.swap(g);
+		}
+		return h;
+	}
+	static Expansion Product(const Expansion& e, const Expansion& f) {
+		Expansion h(1, 0.0);
+		for (double a : e) {
+			for (double b : f) {
+				double x, y;
+				TwoProduct(a, b, x, y);
+				h = Sum(h, Expansion { y, x });
+			}
+		}
+		return h;
+	}
+	static Expansion Difference(double a, double b) {
+		double x, y;
+		TwoSum(a, -b, x, y);
+		return Expansion { y, x };
+	}
+	static Expansion Negate(Expansion e) {
+		for (double& v : e)
+			v = -v;
+		return e;
+	}
+	static int Sign(const Expansion& e) {
+		double v = e.back();
+		return (v > 0.0) ? 1 : ((v < 0.0) ? -1 : 0);
+	}
+	int Orient2D(const float2& a, const float2& b, const float2& c) {
+		double acx = (double)a.x - c.x, bcx = (double)b.x - c.x;
+		double acy = (double)a.y - c.y, bcy = (double)b.y - c.y;
+		double detLeft = acx * bcy;
+		double detRight = acy * bcx;
+		double det = detLeft - detRight;
+		double bound = 3.3306690738754716E-16 * (std::abs(detLeft) + std::abs(detRight));
+		if (det > bound)
+			return 1;
+		if (-det > bound)
+			return -1;
+		Expansion ex = Difference(a.x, c.x), bx = Difference(b.x, c.x);
+		Expansion ey = Difference(a.y, c.y), by = Difference(b.y, c.y);
+		return Sign(Sum(Product(ex, by), Negate(Product(ey, bx))));
+	}
+	int InCircle(const float2& a, const float2& b, const float2& c, const float2& d) {
+		double adx = (double)a.x - d.x, bdx = (double)b.x - d.x, cdx = (double)c.x - d.x;
+		double ady = (double)a.y - d.y, bdy = (double)b.y - d.y, cdy = (double)c.y - d.y;
+		double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+		double cdxady = cdx * ady, adxcdy = adx * cdy;
+		double adxbdy = adx * bdy, bdxady = bdx * ady;
+		double alift = adx * adx + ady * ady;
+		double blift = bdx * bdx + bdy * bdy;
+		double clift = cdx * cdx + cdy * cdy;
+		double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+		double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+				+ (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+		double bound = 1.1102230246251577E-15 * permanent;
+		if (det > bound)
+			return 1;
+		if (-det > bound)
+			return -1;
+		Expansion ax = Difference(a.x, d.x), bx = Difference(b.x, d.x), cx = Difference(c.x, d.x);
+		Expansion ay = Difference(a.y, d.y), by = Difference(b.y, d.y), cy = Difference(c.y, d.y);
+		Expansion al = Sum(Product(ax, ax), Product(ay, ay));
+		Expansion bl = Sum(Product(bx, bx), Product(by, by));
+		Expansion cl = Sum(Product(cx, cx), Product(cy, cy));
+		Expansion bc = Sum(Product(bx, cy), Negate(Product(cx, by)));
+		Expansion ca = Sum(Product(cx, ay), Negate(Product(ax, cy)));
+		Expansion ab = Sum(Product(ax, by), Negate(Product(bx, ay)));
+		return Sign(Sum(Sum(Product(al, bc), Product(bl, ca)), Product(cl, ab)));
+	}
+	//Position along a 2^16 x 2^16 Hilbert curve.
+	static uint32_t HilbertKey(uint32_t x, uint32_t y) {
+		uint32_t d = 0;
+		for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+			uint32_t rx = (x & s) ? 1 : 0;
+			uint32_t ry = (y & s) ? 1 : 0;
+			d += s * s * ((3 * rx) ^ ry);
+			if (ry == 0) {
+				if (rx == 1) {
+					x = 0xFFFF - x;
+					y = 0xFFFF - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return d;
+	}
+	//Collinear p lies strictly between u and v.
+	static bool IsBetween(const float2& p, const float2& u, const float2& v) {
+		if (u.x != v.x) {
+			return (p.x > u.x && p.x < v.x) || (p.x < u.x && p.x > v.x);
+		}
+		return (p.y > u.y && p.y < v.y) || (p.y < u.y && p.y > v.y);
+	}
 	bool CircumCircle(float xp, float yp, float x1, float y1, float x2,
 		float y2, float x3, float y3, float &xc, float &yc, float &r) {
 
@@ -67,123 +194,685 @@ namespace aly {
 		drsqr = dx * dx + dy * dy;
 		return((drsqr <= rsqr) ? true : false);
 	}
-	void Triangulate(std::vector<float2>& pxyz, std::vector<int3>& triangles) {
-		int nv = (int)pxyz.size();
-		std::vector<int2> edges;
-		bool inside;
-		int i, j, k;
-		float xp, yp, x1, y1, x2, y2, x3, y3, xc, yc, r;
-		float xmin, xmax, ymin, ymax, xmid, ymid;
-		float dx, dy, dmax;
-		std::vector<bool> complete;
-		/*
-		Find the maximum and minimum vertex bounds.
-		This is to allow calculation of the bounding triangle
-		*/
-		xmin = pxyz[0].x;
-		ymin = pxyz[0].y;
-		xmax = xmin;
-		ymax = ymin;
-		for (i = 1; i < nv; i++) {
-			if (pxyz[i].x < xmin) xmin = pxyz[i].x;
-			if (pxyz[i].x > xmax) xmax = pxyz[i].x;
-			if (pxyz[i].y < ymin) ymin = pxyz[i].y;
-			if (pxyz[i].y > ymax) ymax = pxyz[i].y;
-		}
-		dx = xmax - xmin;
-		dy = ymax - ymin;
-		dmax = (dx > dy) ? dx : dy;
-		xmid = (xmax + xmin) *0.5f;
-		ymid = (ymax + ymin) *0.5f;
-		float scale = 20.0f;
-		triangles.clear();
-		pxyz.push_back(float2(xmid - scale * dmax, ymid - dmax));
-		pxyz.push_back(float2(xmid, ymid + scale * dmax));
-		pxyz.push_back(float2(xmid + scale * dmax, ymid - dmax));
-		triangles.push_back(int3( nv, nv + 1, nv + 2 ));
-		complete.push_back(false);
-		for (i = 0; i < (int)pxyz.size(); i++) {
-			xp = pxyz[i].x;
-			yp = pxyz[i].y;
-			edges.clear();
-			for (j = 0; j < (int)triangles.size(); j++) {
-				if (complete[j])
+	int Delaunay::orient(int a, int b, int c) const {
+		return Orient2D((*points)[a], (*points)[b], (*points)[c]);
+	}
+	bool Delaunay::isGhost(int t) const {
+		return (vertexes[3 * t] == infinite || vertexes[3 * t + 1] == infinite || vertexes[3 * t + 2] == infinite);
+	}
+	bool Delaunay::inConflict(int t, int p) const {
+		const int* v = &vertexes[3 * t];
+		for (int i = 0; i < 3; i++) {
+			if (v[i] == infinite) {
+				//Hull edge u->v has the interior on its right.
+				int u = v[(i + 1) % 3], w = v[(i + 2) % 3];
+				int o = orient(u, w, p);
+				if (o != 0)
+					return (o > 0);
+				return IsBetween((*points)[p], (*points)[u], (*points)[w]);
+			}
+		}
+		return (InCircle((*points)[v[0]], (*points)[v[1]], (*points)[v[2]], (*points)[p]) > 0);
+	}
+	void Delaunay::link(int e, int f) {
+		twins[e] = f;
+		twins[f] = e;
+	}
+	int Delaunay::locate(int p) {
+		int t = lastEdge / 3;
+		if (isGhost(t)) {
+			for (int i = 0; i < 3; i++) {
+				if (vertexes[3 * t + i] == infinite) {
+					t = twins[3 * t + (i + 1) % 3] / 3;
+					break;
+				}
+			}
+		}
+		//Visibility walk with a random first edge, which terminates on Delaunay triangulations.
+		int from = -1;
+		while (true) {
+			walkSeed = walkSeed * 1664525u + 1013904223u;
+			int r = (int)((walkSeed >> 16) % 3);
+			int next = -1;
+			for (int k = 0; k < 3; k++) {
+				int e = 3 * t + (r + k) % 3;
+				if (e == from)
 					continue;
-				x1 = pxyz[triangles[j].x].x;
-				y1 = pxyz[triangles[j].x].y;
-				x2 = pxyz[triangles[j].y].x;
-				y2 = pxyz[triangles[j].y].y;
-				x3 = pxyz[triangles[j].z].x;
-				y3 = pxyz[triangles[j].z].y;
-				inside = CircumCircle(xp, yp, x1, y1, x2, y2, x3, y3, xc, yc, r);
-				if (xc + r < xp)complete[j] = true;
-				if (inside) {
-					edges.push_back(int2( triangles[j].x, triangles[j].y ));
-					edges.push_back(int2(triangles[j].y, triangles[j].z ));
-					edges.push_back(int2(triangles[j].z, triangles[j].x ));
-					triangles.erase(triangles.begin() + j);
-					complete.erase(complete.begin() + j);
-					j--;
-				}
-			}
-			/*
-			Tag multiple edges
-			Note: if all triangles are specified anticlockwise then all
-			interior edges are opposite pointing in direction.
-			*/
-			for (j = 0; j < (int)edges.size() - 1; j++) {
-				for (k = j + 1; k < (int)edges.size(); k++) {
-					if ((edges[j].x == edges[k].y) && (edges[j].y == edges[k].x)) {
-						edges[j] = int2(-1, -1 );
-						edges[k] = int2(-1, -1 );
+				if (orient(vertexes[e], vertexes[Next(e)], p) < 0) {
+					next = twins[e];
+					break;
+				}
+			}
+			if (next < 0)
+				return 3 * t;
+			t = next / 3;
+			if (isGhost(t))
+				return next;
+			from = next;
+		}
+		return -1;
+	}
+	bool Delaunay::insert(int p) {
+		int t = locate(p) / 3;
+		if (!isGhost(t)) {
+			const float2& pt = (*points)[p];
+			for (int i = 0; i < 3; i++) {
+				int v = vertexes[3 * t + i];
+				if ((*points)[v] == pt) {
+					alias[p] = v;
+					return false;
+				}
+			}
+		}
+		markCounter++;
+		cavity.clear();
+		boundary.clear();
+		cavityMark[t] = markCounter;
+		cavity.push_back(t);
+		for (size_t n = 0; n < cavity.size(); n++) {
+			int ct = cavity[n];
+			for (int e = 3 * ct; e < 3 * ct + 3; e++) {
+				int nt = twins[e] / 3;
+				if (cavityMark[nt] == markCounter)
+					continue;
+				if (inConflict(nt, p)) {
+					cavityMark[nt] = markCounter;
+					cavity.push_back(nt);
+				} else {
+					boundary.push_back(int3(vertexes[e], vertexes[Next(e)], twins[e]));
+				}
+			}
+		}
+		//The cavity is a disk with two more boundary edges than triangles, so triangles are reused before appending.
+		int solidEdge = -1;
+		for (size_t n = 0; n < boundary.size(); n++) {
+			int nt;
+			if (n < cavity.size()) {
+				nt = cavity[n];
+			} else {
+				nt = (int)(vertexes.size() / 3);
+				vertexes.resize(vertexes.size() + 3);
+				twins.resize(twins.size() + 3);
+				constrained.resize(constrained.size() + 3);
+				cavityMark.push_back(0);
+			}
+			const int3& b = boundary[n];
+			int e = 3 * nt;
+			vertexes[e] = b.x;
+			vertexes[e + 1] = b.y;
+			vertexes[e + 2] = p;
+			constrained[e] = constrained[b.z];
+			constrained[e + 1] = constrained[e + 2] = 0;
+			link(e, b.z);
+			fanEdge[b.x] = e + 2;
+			vertexEdge[b.x] = e;
+			if (b.x != infinite && b.y != infinite)
+				solidEdge = e;
+		}
+		for (size_t n = 0; n < boundary.size(); n++) {
+			int e = fanEdge[boundary[n].x];
+			link(Prev(e), fanEdge[boundary[n].y]);
+		}
+		vertexEdge[p] = fanEdge[boundary[0].x];
+		lastEdge = solidEdge;
+		return true;
+	}
+	void Delaunay::flip(int e) {
+		//Triangles (a,b,c) and (b,a,d) become (c,a,d) and (d,b,c).
+		int f = twins[e];
+		int t0 = e / 3, t1 = f / 3;
+		int a = vertexes[e], b = vertexes[Next(e)], c = vertexes[Prev(e)], d = vertexes[Prev(f)];
+		int bc = twins[Next(e)], ca = twins[Prev(e)], ad = twins[Next(f)], db = twins[Prev(f)];
+		char bcFixed = constrained[Next(e)], caFixed = constrained[Prev(e)];
+		char adFixed = constrained[Next(f)], dbFixed = constrained[Prev(f)];
+		int e0 = 3 * t0, e1 = 3 * t1;
+		vertexes[e0] = c;
+		vertexes[e0 + 1] = a;
+		vertexes[e0 + 2] = d;
+		vertexes[e1] = d;
+		vertexes[e1 + 1] = b;
+		vertexes[e1 + 2] = c;
+		link(e0, ca);
+		link(e0 + 1, ad);
+		link(e0 + 2, e1 + 2);
+		link(e1, db);
+		link(e1 + 1, bc);
+		constrained[e0] = caFixed;
+		constrained[e0 + 1] = adFixed;
+		constrained[e1] = dbFixed;
+		constrained[e1 + 1] = bcFixed;
+		constrained[e0 + 2] = constrained[e1 + 2] = 0;
+		vertexEdge[c] = e0;
+		vertexEdge[a] = e0 + 1;
+		vertexEdge[d] = e1;
+		vertexEdge[b] = e1 + 1;
+	}
+	bool Delaunay::findEdge(int a, int b, int& e) const {
+		int start = vertexEdge[a];
+		e = start;
+		do {
+			if (vertexes[Next(e)] == b)
+				return true;
+			e = twins[Prev(e)];
+		} while (e != start);
+		return false;
+	}
+	void Delaunay::insertConstraint(int a, int b) {
+		const std::vector<float2>& pts = *points;
+		std::deque<int2> crossing;
+		std::vector<int2> created;
+		while (a != b) {
+			//Find the edge toward b, a vertex on the segment, or the first triangle the segment enters.
+			int start = vertexEdge[a];
+			int e = start;
+			int stop = -1;
+			int cross = -1;
+			do {
+				int v = vertexes[Next(e)];
+				int w = vertexes[Prev(e)];
+				if (v == b) {
+					stop = v;
+				} else if (v != infinite && orient(a, b, v) == 0) {
+					const float2& pa = pts[a];
+					const float2& pb = pts[b];
+					const float2& pv = pts[v];
+					bool forward = (pa.x != pb.x) ? ((pv.x > pa.x) == (pb.x > pa.x)) : ((pv.y > pa.y) == (pb.y > pa.y));
+					if (forward)
+						stop = v;
+				} else if (v != infinite && w != infinite && orient(a, b, v) < 0 && orient(a, b, w) > 0) {
+					cross = Next(e);
+				}
+				if (stop >= 0 || cross >= 0)
+					break;
+				e = twins[Prev(e)];
+			} while (e != start);
+			if (stop < 0 && cross < 0) {
+				throw std::runtime_error(MakeString() << "Could not find constraint segment (" << a << "," << b << ")");
+			}
+			if (cross >= 0) {
+				//March along the segment collecting crossed edges, each oriented from its right to its left side.
+				crossing.clear();
+				int h = cross;
+				while (true) {
+					if (constrained[h]) {
+						throw std::runtime_error(MakeString() << "Constraint (" << a << "," << b << ") crosses another constraint.");
+					}
+					crossing.push_back(int2(vertexes[h], vertexes[Next(h)]));
+					int g = twins[h];
+					int x = vertexes[Prev(g)];
+					if (x == b) {
+						stop = b;
+						break;
+					}
+					int o = orient(a, b, x);
+					if (o == 0) {
+						stop = x;
+						break;
+					}
+					h = (o > 0) ? Next(g) : Prev(g);
+				}
+				created.clear();
+				while (!crossing.empty()) {
+					int2 uv = crossing.front();
+					crossing.pop_front();
+					int f;
+					findEdge(uv.x, uv.y, f);
+					int c = vertexes[Prev(f)];
+					int d = vertexes[Prev(twins[f])];
+					if (orient(c, uv.x, d) <= 0 || orient(d, uv.y, c) <= 0) {
+						crossing.push_back(uv);
+						continue;
+					}
+					flip(f);
+					int oc = orient(a, stop, c), od = orient(a, stop, d);
+					if ((oc > 0 && od < 0) || (oc < 0 && od > 0)) {
+						crossing.push_back(int2(c, d));
+					} else {
+						created.push_back(int2(c, d));
+					}
+				}
+				//Restore the Delaunay property on the edges created by flipping.
+				bool swapped = true;
+				while (swapped) {
+					swapped = false;
+					for (int2& cd : created) {
+						if ((cd.x == a && cd.y == stop) || (cd.x == stop && cd.y == a))
+							continue;
+						int f;
+						findEdge(cd.x, cd.y, f);
+						int g = twins[f];
+						if (isGhost(f / 3) || isGhost(g / 3))
+							continue;
+						if (InCircle(pts[vertexes[f]], pts[vertexes[Next(f)]], pts[vertexes[Prev(f)]], pts[vertexes[Prev(g)]]) > 0) {
+							int c = vertexes[Prev(f)], d = vertexes[Prev(g)];
+							flip(f);
+							cd = int2(c, d);
+							swapped = true;
+						}
+					}
+				}
+			}
+			int f;
+			if (!findEdge(a, stop, f)) {
+				throw std::runtime_error(MakeString() << "Could not recover constraint segment (" << a << "," << stop << ")");
+			}
+			constrained[f] = constrained[twins[f]] = 1;
+			a = stop;
+		}
+	}
+	void Delaunay::buildInsertionOrder(const std::vector<float2>& pts, std::vector<int>& order) const {
+		int N = (int)pts.size();
+		order.resize(N);
+		for (int i = 0; i < N; i++) {
+			order[i] = i;
+		}
+		std::mt19937 mt(N);
+		std::shuffle(order.begin(), order.end(), mt);
+		float2 minPt = pts[0], maxPt = pts[0];
+		for (const float2& pt : pts) {
+			minPt = aly::min(minPt, pt);
+			maxPt = aly::max(maxPt, pt);
+		}
+		float2 scale = float2(65535.0f) / aly::max(maxPt - minPt, float2(1E-30f));
+		std::vector<uint32_t> keys(N);
+#pragma omp parallel for
+		for (int i = 0; i < N; i++) {
+			float2 q = aly::clamp((pts[i] - minPt) * scale, float2(0.0f), float2(65535.0f));
+			keys[i] = HilbertKey((uint32_t)q.x, (uint32_t)q.y);
+		}
+		//Rounds of doubling size, each a random sample of the points sorted along the curve.
+		int end = N;
+		while (end > 0) {
+			int begin = (end > 128) ? end / 2 : 0;
+			std::sort(order.begin() + begin, order.begin() + end, [&keys](int a, int b) {
+				return (keys[a] < keys[b] || (keys[a] == keys[b] && a < b));
+			});
+			end = begin;
+		}
+	}
+	bool Delaunay::triangulate(const std::vector<float2>& pts) {
+		int N = (int)pts.size();
+		vertexes.clear();
+		vertexEdge.assign(N + 1, -1);
+		alias.resize(N);
+		for (int i = 0; i < N; i++) {
+			alias[i] = i;
+		}
+		if (N < 3) {
+			return false;
+		}
+		std::vector<int> order;
+		buildInsertionOrder(pts, order);
+		//The first triangle needs three points that are not collinear.
+		int a = order[0], b = -1, c = -1, j = 0, k = 0;
+		for (j = 1; j < N; j++) {
+			if (pts[order[j]] != pts[a]) {
+				b = order[j];
+				break;
+			}
+		}
+		if (b < 0) {
+			return false;
+		}
+		for (k = j + 1; k < N; k++) {
+			if (orient(a, b, order[k]) != 0) {
+				c = order[k];
+				break;
+			}
+		}
+		if (c < 0) {
+			return false;
+		}
+		order.erase(order.begin() + k);
+		order.erase(order.begin() + j);
+		order.erase(order.begin());
+		if (orient(a, b, c) < 0) {
+			std::swap(b, c);
+		}
+		vertexes = { a, b, c, b, a, infinite, c, b, infinite, a, c, infinite };
+		twins.resize(12);
+		link(0, 3);
+		link(1, 6);
+		link(2, 9);
+		link(4, 11);
+		link(7, 5);
+		link(10, 8);
+		constrained.assign(12, 0);
+		cavityMark.assign(4, 0);
+		markCounter = 0;
+		walkSeed = 0;
+		lastEdge = 0;
+		vertexEdge[a] = 0;
+		vertexEdge[b] = 1;
+		vertexEdge[c] = 2;
+		vertexEdge[infinite] = 5;
+		fanEdge.assign(N + 1, -1);
+		size_t triCount = 2 * (size_t)N + 2;
+		vertexes.reserve(3 * triCount);
+		twins.reserve(3 * triCount);
+		constrained.reserve(3 * triCount);
+		cavityMark.reserve(triCount);
+		for (int p : order) {
+			insert(p);
+		}
+		return true;
+	}
+	//Half-edges without twins lie on the hull. Each hull edge u->v gets the ghost (v,u,infinite), whose edge u->infinite
+	//meets the ghost that starts at u.
+	void Delaunay::closeHull() {
+		int N = infinite;
+		int T = (int)(vertexes.size() / 3);
+		std::vector<int> ghostFrom(N, -1);
+		for (int e = 0; e < 3 * T; e++) {
+			if (twins[e] < 0) {
+				int g = (int)(vertexes.size() / 3);
+				int v = vertexes[Next(e)];
+				vertexes.push_back(v);
+				vertexes.push_back(vertexes[e]);
+				vertexes.push_back(infinite);
+				twins.resize(twins.size() + 3, -1);
+				link(e, 3 * g);
+				ghostFrom[v] = g;
+			}
+		}
+		int G = (int)(vertexes.size() / 3);
+		for (int g = T; g < G; g++) {
+			link(3 * g + 1, 3 * ghostFrom[vertexes[3 * g + 1]] + 2);
+		}
+		vertexEdge.assign(N + 1, -1);
+		for (int e = 0; e < 3 * G; e++) {
+			vertexEdge[vertexes[e]] = e;
+		}
+		constrained.assign(3 * (size_t)G, 0);
+		cavityMark.assign(G, 0);
+		fanEdge.assign(N + 1, -1);
+		markCounter = 0;
+		walkSeed = 0;
+		lastEdge = 0;
+	}
+	bool Delaunay::triangulateBlocks(const std::vector<float2>& pts) {
+		int N = (int)pts.size();
+		float minX = pts[0].x, maxX = pts[0].x;
+		for (const float2& pt : pts) {
+			minX = std::min(minX, pt.x);
+			maxX = std::max(maxX, pt.x);
+		}
+		if (!(maxX > minX)) {
+			return triangulate(pts);
+		}
+		//Strips are cut at histogram bin edges, so equal x values always share a strip.
+		int blockCount = N / blockSize;
+		int binCount = 64 * blockCount;
+		double binScale = binCount / ((double)maxX - minX);
+		std::vector<int> bins(N);
+#pragma omp parallel for
+		for (int i = 0; i < N; i++) {
+			bins[i] = clamp((int)((pts[i].x - (double)minX) * binScale), 0, binCount - 1);
+		}
+		std::vector<int> binSizes(binCount, 0);
+		for (int i = 0; i < N; i++) {
+			binSizes[bins[i]]++;
+		}
+		std::vector<int> binStrip(binCount);
+		int stripCount = 0;
+		int64_t before = 0;
+		int last = -1;
+		for (int b = 0; b < binCount; b++) {
+			int target = (int)(before * blockCount / N);
+			if (binSizes[b] > 0 && target != last) {
+				last = target;
+				stripCount++;
+			}
+			binStrip[b] = std::max(stripCount - 1, 0);
+			before += binSizes[b];
+		}
+		std::vector<std::vector<int>> stripIndexes(stripCount);
+		for (int i = 0; i < N; i++) {
+			stripIndexes[binStrip[bins[i]]].push_back(i);
+		}
+		std::vector<Delaunay> blocks(stripCount);
+		std::vector<std::vector<float2>> blockPoints(stripCount);
+		std::vector<float2> ranges(stripCount);
+		std::vector<char> valid(stripCount);
+#pragma omp parallel for schedule(dynamic)
+		for (int s = 0; s < stripCount; s++) {
+			const std::vector<int>& ids = stripIndexes[s];
+			std::vector<float2>& local = blockPoints[s];
+			local.resize(ids.size());
+			ranges[s] = float2(pts[ids[0]].x);
+			for (size_t n = 0; n < ids.size(); n++) {
+				local[n] = pts[ids[n]];
+				ranges[s].x = std::min(ranges[s].x, local[n].x);
+				ranges[s].y = std::max(ranges[s].y, local[n].x);
+			}
+			Delaunay& block = blocks[s];
+			block.points = &local;
+			block.infinite = (int)local.size();
+			valid[s] = block.triangulate(local);
+		}
+		//A triangle is final if its circumcircle lies strictly between the neighboring strips, since then no other
+		//strip has a point inside it. The slack keeps round-off in the circumcircle on the safe side.
+		std::vector<std::vector<char>> finals(stripCount);
+		std::vector<char> merging(N, 0);
+#pragma omp parallel for schedule(dynamic)
+		for (int s = 0; s < stripCount; s++) {
+			const std::vector<int>& ids = stripIndexes[s];
+			const Delaunay& block = blocks[s];
+			if (!valid[s]) {
+				for (int id : ids) {
+					merging[id] = 1;
+				}
+				continue;
+			}
+			double lo = (s > 0) ? ranges[s - 1].y : -std::numeric_limits<double>::infinity();
+			double hi = (s + 1 < stripCount) ? ranges[s + 1].x : std::numeric_limits<double>::infinity();
+			int T = (int)(block.vertexes.size() / 3);
+			std::vector<char>& isFinal = finals[s];
+			isFinal.assign(T, 0);
+			std::vector<char> covered(ids.size(), 0);
+			for (int t = 0; t < T; t++) {
+				const int* v = &block.vertexes[3 * t];
+				if (!block.isGhost(t)) {
+					const float2& a = blockPoints[s][v[0]];
+					double bx = (double)blockPoints[s][v[1]].x - a.x, by = (double)blockPoints[s][v[1]].y - a.y;
+					double cx = (double)blockPoints[s][v[2]].x - a.x, cy = (double)blockPoints[s][v[2]].y - a.y;
+					double d = 2.0 * (bx * cy - by * cx);
+					if (d != 0.0) {
+						double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+						double ux = (cy * b2 - by * c2) / d, uy = (bx * c2 - cx * b2) / d;
+						double r = std::sqrt(ux * ux + uy * uy);
+						double center = a.x + ux;
+						double slack = 1E-7 * (r + std::abs(center));
+						isFinal[t] = (center - r - slack > lo && center + r + slack < hi);
 					}
-					/* Shouldn't need the following, see note above */
-					if ((edges[j].x == edges[k].x) && (edges[j].y == edges[k].y)) {
-						edges[j] = int2(-1, -1 );
-						edges[k] = int2(-1, -1 );
+				}
+				for (int i = 0; i < 3; i++) {
+					if (v[i] == block.infinite)
+						continue;
+					if (isFinal[t]) {
+						covered[v[i]] = 1;
+					} else {
+						merging[ids[v[i]]] = 1;
 					}
 				}
 			}
-			/*
-			Form new triangles for the current point
-			Skipping over any tagged edges.
-			All edges are arranged in clockwise order.
-			*/
-			for (j = 0; j < (int)edges.size(); j++) {
-				if (edges[j].x < 0 || edges[j].y < 0)
+			for (size_t n = 0; n < ids.size(); n++) {
+				if (!covered[n] && block.alias[n] == (int)n) {
+					merging[ids[n]] = 1;
+				}
+			}
+		}
+		//Points of triangles that are not final are triangulated again. Edges between final and other triangles
+		//bound the gaps, which are filled from the far side of those edges.
+		std::vector<int> mergeIndexes;
+		std::vector<int> mergeLocal(N, -1);
+		std::vector<float2> mergePoints;
+		for (int i = 0; i < N; i++) {
+			if (merging[i]) {
+				mergeLocal[i] = (int)mergeIndexes.size();
+				mergeIndexes.push_back(i);
+				mergePoints.push_back(pts[i]);
+			}
+		}
+		Delaunay merge;
+		merge.points = &mergePoints;
+		merge.infinite = (int)mergePoints.size();
+		if (!merge.triangulate(mergePoints)) {
+			return triangulate(pts);
+		}
+		int M = (int)(merge.vertexes.size() / 3);
+		std::vector<char> blocked(3 * (size_t)M, 0);
+		std::vector<char> keep(M, 0);
+		std::vector<int> stack;
+		std::vector<int3> seams;
+		for (int s = 0; s < stripCount; s++) {
+			const std::vector<int>& ids = stripIndexes[s];
+			const Delaunay& block = blocks[s];
+			for (int t = 0; t < (int)finals[s].size(); t++) {
+				if (!finals[s][t])
+					continue;
+				for (int e = 3 * t; e < 3 * t + 3; e++) {
+					if (finals[s][block.twins[e] / 3])
+						continue;
+					int u = mergeLocal[ids[block.vertexes[e]]];
+					int v = mergeLocal[ids[block.vertexes[Next(e)]]];
+					int f;
+					if (u < 0 || v < 0 || !merge.findEdge(v, u, f)) {
+						return triangulate(pts);
+					}
+					blocked[f] = blocked[merge.twins[f]] = 1;
+					seams.push_back(int3(s, e, f));
+				}
+			}
+		}
+		if (seams.empty()) {
+			for (int t = 0; t < M; t++) {
+				stack.push_back(t);
+			}
+		} else {
+			for (const int3& seam : seams) {
+				stack.push_back(seam.z / 3);
+			}
+		}
+		while (!stack.empty()) {
+			int t = stack.back();
+			stack.pop_back();
+			if (keep[t] || merge.isGhost(t))
+				continue;
+			keep[t] = 1;
+			for (int e = 3 * t; e < 3 * t + 3; e++) {
+				if (!blocked[e]) {
+					stack.push_back(merge.twins[e] / 3);
+				}
+			}
+		}
+		//Final and kept triangles keep their links, and the seams join the two.
+		std::vector<std::vector<int>> finalIndexes(stripCount);
+		int T = 0;
+		for (int s = 0; s < stripCount; s++) {
+			finalIndexes[s].assign(finals[s].size(), -1);
+			for (int t = 0; t < (int)finals[s].size(); t++) {
+				if (finals[s][t]) {
+					finalIndexes[s][t] = T++;
+				}
+			}
+		}
+		std::vector<int> keepIndexes(M, -1);
+		for (int t = 0; t < M; t++) {
+			if (keep[t]) {
+				keepIndexes[t] = T++;
+			}
+		}
+		vertexes.resize(3 * (size_t)T);
+		twins.assign(3 * (size_t)T, -1);
+#pragma omp parallel for schedule(dynamic)
+		for (int s = 0; s < stripCount; s++) {
+			const std::vector<int>& ids = stripIndexes[s];
+			const Delaunay& block = blocks[s];
+			for (int t = 0; t < (int)finals[s].size(); t++) {
+				int g = finalIndexes[s][t];
+				if (g < 0)
 					continue;
-				triangles.push_back(int3(edges[j].x, edges[j].y, i ));
-				complete.push_back(false);
+				for (int i = 0; i < 3; i++) {
+					int f = block.twins[3 * t + i];
+					vertexes[3 * g + i] = ids[block.vertexes[3 * t + i]];
+					if (finalIndexes[s][f / 3] >= 0) {
+						twins[3 * g + i] = 3 * finalIndexes[s][f / 3] + f % 3;
+					}
+				}
+			}
+			for (size_t n = 0; n < ids.size(); n++) {
+				alias[ids[n]] = ids[block.alias[n]];
+			}
+		}
+#pragma omp parallel for
+		for (int t = 0; t < M; t++) {
+			int g = keepIndexes[t];
+			if (g < 0)
+				continue;
+			for (int i = 0; i < 3; i++) {
+				int f = merge.twins[3 * t + i];
+				vertexes[3 * g + i] = mergeIndexes[merge.vertexes[3 * t + i]];
+				if (keepIndexes[f / 3] >= 0) {
+					twins[3 * g + i] = 3 * keepIndexes[f / 3] + f % 3;
+				}
+			}
+		}
+		for (const int3& seam : seams) {
+			if (keep[seam.z / 3]) {
+				link(3 * finalIndexes[seam.x][seam.y / 3] + seam.y % 3, 3 * keepIndexes[seam.z / 3] + seam.z % 3);
 			}
 		}
+		for (size_t m = 0; m < mergeIndexes.size(); m++) {
+			alias[mergeIndexes[m]] = mergeIndexes[merge.alias[m]];
+		}
+		closeHull();
+		return true;
 	}
-	void MakeDelaunay(const std::vector<float2>& vertexes, std::vector<uint3>& output)
-	{
+	void Delaunay::solve(const std::vector<float2>& pts, const std::vector<uint2>& constraints, std::vector<uint3>& output) {
 		output.clear();
-		if (vertexes.size() < 3) {
+		int N = (int)pts.size();
+		if (N < 3) {
 			return;
 		}
-		int N = (int)vertexes.size();
-		std::vector<std::pair<float2, int>> vertPairs(N);
-		int index = 0;
-		for (const float2& vert : vertexes) {
-			vertPairs[index] = std::pair<float2, int>(vert, index);
-			index++;
+		points = &pts;
+		infinite = N;
+		alias.resize(N);
+		if (!((N / blockSize >= 2) ? triangulateBlocks(pts) : triangulate(pts))) {
+			points = nullptr;
+			return;
 		}
-		std::sort(vertPairs.begin(), vertPairs.end());
-		std::vector<float2> tmp;
-		tmp.reserve(vertPairs.size());
-		for (std::pair<float2, int>& pr : vertPairs) {
-			tmp.push_back(pr.first);
+		for (const uint2& seg : constraints) {
+			if ((int)seg.x >= N || (int)seg.y >= N) {
+				throw std::runtime_error(MakeString() << "Constraint (" << seg.x << "," << seg.y << ") is out of range.");
+			}
+			int u = alias[seg.x], v = alias[seg.y];
+			if (u == v || vertexEdge[u] < 0 || vertexEdge[v] < 0)
+				continue;
+			insertConstraint(u, v);
 		}
-		std::vector<int3>	cTriangles;
-		Triangulate(tmp, cTriangles);
-		for (int3& triangle : cTriangles) {
-			if (triangle.x < N &&
-				triangle.y < N &&
-				triangle.z < N) {
-				output.push_back(uint3((uint32_t)vertPairs[triangle.x].second, (uint32_t)vertPairs[triangle.y].second, vertPairs[triangle.z].second));
+		int T = (int)(vertexes.size() / 3);
+		output.reserve(T);
+		for (int t = 0; t < T; t++) {
+			if (!isGhost(t)) {
+				output.push_back(uint3((uint32_t)vertexes[3 * t], (uint32_t)vertexes[3 * t + 2], (uint32_t)vertexes[3 * t + 1]));
 			}
 		}
+		points = nullptr;
+	}
+	void Delaunay::solve(const std::vector<float2>& pts, std::vector<uint3>& output) {
+		solve(pts, std::vector<uint2>(), output);
+	}
+	void Triangulate(std::vector<float2>& pxyz, std::vector<uint3>& v) {
+		Delaunay delaunay;
+		delaunay.solve(pxyz, v);
+	}
+	void MakeDelaunay(const std::vector<float2>& vertexes, std::vector<uint3>& output) {
+		Delaunay delaunay;
+		delaunay.solve(vertexes, output);
+	}
+	void MakeDelaunay(const std::vector<float2>& vertexes, const std::vector<uint2>& constraints, std::vector<uint3>& output) {
+		Delaunay delaunay;
+		delaunay.solve(vertexes, constraints, output);
 	}
 }
@@ -21,324 +21,306 @@
 #include "AlloyDenseSolve.h"
 #include "AlloyFileUtil.h"
 namespace aly {
-void LaplaceFill(const Image4f& sourceImg, Image4f& targetImg, int iterations,
-		int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor ) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	if (levels <= 1) {
-		LaplaceFill(sourceImg, targetImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
-			}
-			else {
-				return true;
+template<int C> struct MultigridLevel {
+	int width;
+	int height;
+	std::vector<vec<float, C>> solution;
+	std::vector<vec<float, C>> rhs;
+	std::vector<vec<float, C>> residual;
+	std::vector<uint8_t> active;
+	MultigridLevel(int w = 0, int h = 0) :
+			width(w), height(h), solution(w * h), rhs(w * h), residual(w * h), active(w * h, 0) {
+	}
+};
+//Red-black Gauss-Seidel. Neighbors outside the image are clamped to the border.
+template<int C> void MultigridSmooth(MultigridLevel<C>& level, int sweeps, float omega) {
+	const int w = level.width;
+	const int h = level.height;
+	vec<float, C>* u = level.solution.data();
+	const vec<float, C>* f = level.rhs.data();
+	const uint8_t* active = level.active.data();
+	for (int s = 0; s < sweeps; s++) {
+		for (int color = 0; color < 2; color++) {
+#pragma omp parallel for
+			for (int j = 0; j < h; j++) {
+				const int jc = j * w;
+				const int jm = std::max(j - 1, 0) * w;
+				const int jp = std::min(j + 1, h - 1) * w;
+				for (int i = (j + color) & 1; i < w; i += 2) {
+					const int idx = jc + i;
+					if (!active[idx])
+						continue;
+					vec<float, C> nbrs = u[jm + i] + u[jp + i] + u[jc + std::max(i - 1, 0)] + u[jc + std::min(i + 1, w - 1)];
+					u[idx] += omega * ((f[idx] + 0.25f * nbrs) - u[idx]);
+				}
 			}
-		});
-	} else {
-		std::vector<Image4f> srcPyramid(levels);
-		std::vector<Image4f> tarPyramid(levels);
-		srcPyramid[0] = sourceImg;
-		tarPyramid[0] = targetImg;
-		for (int l = 1; l < levels; l++) {
-			srcPyramid[l - 1].downSample(srcPyramid[l]);
-			tarPyramid[l - 1].downSample(tarPyramid[l]);
 		}
-		for (int l = levels - 1; l >= 1; l--) {
-			if (iterationMonitor) {
-				if (!iterationMonitor(l, 0))return;
-			}
-			LaplaceFill(srcPyramid[l], tarPyramid[l], iterations, lambda, [=](int iter) {
-				if (iterationMonitor) {
-					return iterationMonitor(l, iter);
-				}
-				else {
-					return true;
+	}
+}
+//Returns sum of squared residuals over active pixels.
+template<int C> double MultigridResidual(MultigridLevel<C>& level) {
+	const int w = level.width;
+	const int h = level.height;
+	const vec<float, C>* u = level.solution.data();
+	const vec<float, C>* f = level.rhs.data();
+	vec<float, C>* r = level.residual.data();
+	const uint8_t* active = level.active.data();
+	double sum = 0.0;
+#pragma omp parallel for reduction(+:sum)
+	for (int j = 0; j < h; j++) {
+		const int jc = j * w;
+		const int jm = std::max(j - 1, 0) * w;
+		const int jp = std::min(j + 1, h - 1) * w;
+		for (int i = 0; i < w; i++) {
+			const int idx = jc + i;
+			if (active[idx]) {
+				vec<float, C> nbrs = u[jm + i] + u[jp + i] + u[jc + std::max(i - 1, 0)] + u[jc + std::min(i + 1, w - 1)];
+				r[idx] = f[idx] - (u[idx] - 0.25f * nbrs);
+				for (int c = 0; c < C; c++) {
+					sum += r[idx][c] * r[idx][c];
 				}
-			});
-			tarPyramid[l].upSample(tarPyramid[l - 1]);
-		}
-		targetImg = tarPyramid[0];
-		LaplaceFill(sourceImg, targetImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
+			} else {
+				r[idx] = vec<float, C>(0.0f);
 			}
-			else {
-				return true;
-			}
-		});
+		}
 	}
+	return sum;
 }
-void LaplaceFill(const Image2f& sourceImg, Image2f& targetImg, int iterations,
-		int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	if (levels <= 1) {
-		LaplaceFill(sourceImg, targetImg, iterations, lambda, [=](int iter) {
-			return iterationMonitor(0, iter);
-		});
-	} else {
-		std::vector<Image2f> srcPyramid(levels);
-		std::vector<Image2f> tarPyramid(levels);
-		srcPyramid[0] = sourceImg;
-		tarPyramid[0] = targetImg;
-		for (int l = 1; l < levels; l++) {
-			srcPyramid[l - 1].downSample(srcPyramid[l]);
-			tarPyramid[l - 1].downSample(tarPyramid[l]);
-		}
-		for (int l = levels - 1; l >= 1; l--) {
-			if (iterationMonitor) {
-				if (!iterationMonitor(l, 0))return;
-			}
-			LaplaceFill(srcPyramid[l], tarPyramid[l], iterations, lambda, [=](int iter) {
-				if (iterationMonitor) {
-					return iterationMonitor(l, iter);
-				}
-				else {
-					return true;
+//Coarse pixel (I,J) sits on fine pixel (2I,2J). Full weighting restriction of the residual.
+//The coarse operator is 4x the fine operator for the same error.
+template<int C> void MultigridRestrict(const MultigridLevel<C>& fine, MultigridLevel<C>& coarse) {
+	const float weights[3] = { 0.25f, 0.5f, 0.25f };
+#pragma omp parallel for
+	for (int J = 0; J < coarse.height; J++) {
+		for (int I = 0; I < coarse.width; I++) {
+			const int idx = J * coarse.width + I;
+			coarse.solution[idx] = vec<float, C>(0.0f);
+			if (!coarse.active[idx]) {
+				coarse.rhs[idx] = vec<float, C>(0.0f);
+				continue;
+			}
+			vec<float, C> sum(0.0f);
+			float wsum = 0.0f;
+			for (int dj = -1; dj <= 1; dj++) {
+				const int j = 2 * J + dj;
+				if (j < 0 || j >= fine.height)
+					continue;
+				for (int di = -1; di <= 1; di++) {
+					const int i = 2 * I + di;
+					if (i < 0 || i >= fine.width)
+						continue;
+					const float wt = weights[di + 1] * weights[dj + 1];
+					sum += wt * fine.residual[j * fine.width + i];
+					wsum += wt;
 				}
-			});
-			tarPyramid[l].upSample(tarPyramid[l - 1]);
-		}
-		targetImg = tarPyramid[0];
-		LaplaceFill(sourceImg, targetImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
-			}
-			else {
-				return true;
 			}
-		});
+			coarse.rhs[idx] = (4.0f / wsum) * sum;
+		}
 	}
 }
-void LaplaceFill(const Image2f& sourceImg, Image2f& targetImg, int iterations,
-		float lambda,const std::function<bool(int)>& iterationMonitor) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	Image2f divergence(sourceImg.width, sourceImg.height);
-	divergence.set(float2(0.0f));
+//Bilinear interpolation of the coarse correction, added to active fine pixels.
+template<int C> void MultigridProlong(const MultigridLevel<C>& coarse, MultigridLevel<C>& fine) {
+	const int cw = coarse.width;
+	const int ch = coarse.height;
 #pragma omp parallel for
-	for (int j = 1; j < sourceImg.height - 1; j++) {
-		for (int i = 1; i < sourceImg.width - 1; i++) {
-			float2 src = sourceImg(i, j);
-			float2 tar = targetImg(i, j);
-			float alpha = src.y;
-			src.y = 1.0f;
-			float2 val1 = sourceImg(i, j);
-			float2 val2 = sourceImg(i, j + 1);
-			float2 val3 = sourceImg(i, j - 1);
-			float2 val4 = sourceImg(i + 1, j);
-			float2 val5 = sourceImg(i - 1, j);
-			float2 div(0.0f);
-			if (val1.y > 0 && val2.y > 0 && val3.y > 0 && val4.y > 0
-					&& val5.y > 0) {
-				div = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				div.y = 0.0f;
+	for (int j = 0; j < fine.height; j++) {
+		const int J0 = j / 2;
+		const int J1 = std::min((j + 1) / 2, ch - 1);
+		for (int i = 0; i < fine.width; i++) {
+			const int idx = j * fine.width + i;
+			if (!fine.active[idx])
+				continue;
+			const int I0 = i / 2;
+			const int I1 = std::min((i + 1) / 2, cw - 1);
+			fine.solution[idx] += 0.25f
+					* (coarse.solution[J0 * cw + I0] + coarse.solution[J0 * cw + I1] + coarse.solution[J1 * cw + I0]
+							+ coarse.solution[J1 * cw + I1]);
+		}
+	}
+}
+template<int C> void MultigridCycleInternal(std::vector<MultigridLevel<C>>& levels, int l, MultigridCycle cycle, int preSmooth,
+		int postSmooth, int coarseIterations, float omega) {
+	MultigridLevel<C>& level = levels[l];
+	if (l == (int) levels.size() - 1) {
+		MultigridSmooth(level, coarseIterations, omega);
+		return;
+	}
+	MultigridSmooth(level, preSmooth, omega);
+	MultigridResidual(level);
+	MultigridRestrict(level, levels[l + 1]);
+	switch (cycle) {
+	case MultigridCycle::V:
+		MultigridCycleInternal(levels, l + 1, MultigridCycle::V, preSmooth, postSmooth, coarseIterations, omega);
+		break;
+	case MultigridCycle::W:
+		MultigridCycleInternal(levels, l + 1, MultigridCycle::W, preSmooth, postSmooth, coarseIterations, omega);
+		MultigridCycleInternal(levels, l + 1, MultigridCycle::W, preSmooth, postSmooth, coarseIterations, omega);
+		break;
+	case MultigridCycle::F:
+		MultigridCycleInternal(levels, l + 1, MultigridCycle::F, preSmooth, postSmooth, coarseIterations, omega);
+		MultigridCycleInternal(levels, l + 1, MultigridCycle::V, preSmooth, postSmooth, coarseIterations, omega);
+		break;
+	}
+	MultigridProlong(levels[l + 1], level);
+	MultigridSmooth(level, postSmooth, omega);
+}
+template<int C> double MultigridSolveInternal(const Image<float, C, ImageType::FLOAT>& rhs, const Image1ub& mask,
+		Image<float, C, ImageType::FLOAT>& solution, MultigridCycle cycle, int maxLevels, int preSmooth, int postSmooth,
+		int coarseIterations, float omega, int maxCycles, double tolerance, const std::function<bool(int, double)>& iterationMonitor) {
+	if (rhs.dimensions() != solution.dimensions() || rhs.dimensions() != mask.dimensions())
+		throw std::runtime_error(
+				MakeString() << "Cannot solve. Image dimensions do not match " << rhs.dimensions() << " " << mask.dimensions() << " "
+						<< solution.dimensions());
+	std::vector<MultigridLevel<C>> levels;
+	levels.push_back(MultigridLevel<C>(rhs.width, rhs.height));
+	MultigridLevel<C>& finest = levels.front();
+	size_t activeCount = 0;
+	for (size_t idx = 0; idx < mask.data.size(); idx++) {
+		finest.active[idx] = (mask.data[idx].x != 0) ? 1 : 0;
+		activeCount += finest.active[idx];
+	}
+	if (activeCount == 0)
+		return 0.0;
+	std::copy(rhs.data.begin(), rhs.data.end(), finest.rhs.begin());
+	std::copy(solution.data.begin(), solution.data.end(), finest.solution.begin());
+	//Coarsen until the grid is small enough for the coarse smoother to solve directly.
+	while ((int) levels.size() < maxLevels && (levels.back().width > 4 || levels.back().height > 4)) {
+		const MultigridLevel<C>& fine = levels.back();
+		MultigridLevel<C> coarse((fine.width + 1) / 2, (fine.height + 1) / 2);
+		for (int J = 0; J < coarse.height; J++) {
+			for (int I = 0; I < coarse.width; I++) {
+				coarse.active[J * coarse.width + I] = fine.active[2 * J * fine.width + 2 * I];
 			}
-			divergence(i, j) = alpha * div;
-			targetImg(i, j) = mix(tar, src, alpha);
 		}
+		levels.push_back(std::move(coarse));
 	}
-	const int xShift[] = { 0, 0, 1, 1 };
-	const int yShift[] = { 0, 1, 0, 1 };
-	for (int iter = 0; iter < iterations; iter++) {
+	double residual = MultigridResidual(levels.front()) / activeCount;
+	for (int iter = 0; iter < maxCycles; iter++) {
+		if (residual <= tolerance)
+			break;
 		if (iterationMonitor) {
-			if (!iterationMonitor(iter))break;
-		}
-		for (int k = 0; k < 4; k++) {
-			//Assumes color at boundary of target image is fixed!
-#pragma omp parallel for
-			for (int j = yShift[k] + 1; j < sourceImg.height - 1; j += 2) {
-				for (int i = xShift[k] + 1; i < sourceImg.width - 1; i += 2) {
-					float2 div = targetImg(i, j)
-							- 0.25f
-									* (targetImg(i, j - 1) + targetImg(i, j + 1)
-											+ targetImg(i - 1, j)
-											+ targetImg(i + 1, j));
-					div = (div - divergence(i, j));
-					targetImg(i, j) -= lambda * div;
-				}
-			}
+			if (!iterationMonitor(iter, residual))
+				break;
 		}
+		MultigridCycleInternal(levels, 0, cycle, preSmooth, postSmooth, coarseIterations, omega);
+		residual = MultigridResidual(levels.front()) / activeCount;
 	}
+	std::copy(levels.front().solution.begin(), levels.front().solution.end(), solution.data.begin());
+	return residual;
 }
-void LaplaceFill(const Image4f& sourceImg, Image4f& targetImg, int iterations,
-		float lambda, const std::function<bool(int)>& iterationMonitor) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	Image4f divergence(sourceImg.width, sourceImg.height);
-	divergence.set(float4(0.0f));
+MultigridPoisson2D::MultigridPoisson2D(MultigridCycle cycle, int maxLevels) :
+		cycle(cycle), maxLevels(maxLevels), preSmoothIterations(2), postSmoothIterations(2), coarseIterations(64), relaxation(1.0f) {
+}
+double MultigridPoisson2D::solve(const Image1f& rhs, const Image1ub& mask, Image1f& solution, int maxCycles, double tolerance,
+		const std::function<bool(int, double)>& iterationMonitor) const {
+	return MultigridSolveInternal(rhs, mask, solution, cycle, maxLevels, preSmoothIterations, postSmoothIterations, coarseIterations,
+			relaxation, maxCycles, tolerance, iterationMonitor);
+}
+double MultigridPoisson2D::solve(const Image2f& rhs, const Image1ub& mask, Image2f& solution, int maxCycles, double tolerance,
+		const std::function<bool(int, double)>& iterationMonitor) const {
+	return MultigridSolveInternal(rhs, mask, solution, cycle, maxLevels, preSmoothIterations, postSmoothIterations, coarseIterations,
+			relaxation, maxCycles, tolerance, iterationMonitor);
+}
+double MultigridPoisson2D::solve(const Image4f& rhs, const Image1ub& mask, Image4f& solution, int maxCycles, double tolerance,
+		const std::function<bool(int, double)>& iterationMonitor) const {
+	return MultigridSolveInternal(rhs, mask, solution, cycle, maxLevels, preSmoothIterations, postSmoothIterations, coarseIterations,
+			relaxation, maxCycles, tolerance, iterationMonitor);
+}
+//Divergence of the source where the whole stencil lies inside the source mask (last channel).
+template<int C> vec<float, C> MaskedDivergence(const Image<float, C, ImageType::FLOAT>& img, int i, int j) {
+	vec<float, C> val1 = img(i, j);
+	vec<float, C> val2 = img(i, j + 1);
+	vec<float, C> val3 = img(i, j - 1);
+	vec<float, C> val4 = img(i + 1, j);
+	vec<float, C> val5 = img(i - 1, j);
+	vec<float, C> div(0.0f);
+	if (val1[C - 1] > 0 && val2[C - 1] > 0 && val3[C - 1] > 0 && val4[C - 1] > 0 && val5[C - 1] > 0) {
+		div = val1 - 0.25f * (val2 + val3 + val4 + val5);
+		div[C - 1] = 0.0f;
+	}
+	return div;
+}
+template<int C> void LaplaceFillSetup(const Image<float, C, ImageType::FLOAT>& sourceImg, Image<float, C, ImageType::FLOAT>& targetImg,
+		Image<float, C, ImageType::FLOAT>& divergence) {
+	divergence.resize(sourceImg.width, sourceImg.height);
+	divergence.set(vec<float, C>(0.0f));
 #pragma omp parallel for
 	for (int j = 1; j < sourceImg.height - 1; j++) {
 		for (int i = 1; i < sourceImg.width - 1; i++) {
-			float4 src = sourceImg(i, j);
-			float4 tar = targetImg(i, j);
-			float alpha = src.w;
-			src.w = 1.0f;
-			float4 val1 = sourceImg(i, j);
-			float4 val2 = sourceImg(i, j + 1);
-			float4 val3 = sourceImg(i, j - 1);
-			float4 val4 = sourceImg(i + 1, j);
-			float4 val5 = sourceImg(i - 1, j);
-			float4 div(0.0f);
-			if (val1.w > 0 && val2.w > 0 && val3.w > 0 && val4.w > 0
-					&& val5.w > 0) {
-				div = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				div.w = 0.0f;
-			}
-			divergence(i, j) = alpha * div;
+			vec<float, C> src = sourceImg(i, j);
+			vec<float, C> tar = targetImg(i, j);
+			float alpha = src[C - 1];
+			src[C - 1] = 1.0f;
+			divergence(i, j) = alpha * MaskedDivergence(sourceImg, i, j);
 			targetImg(i, j) = mix(tar, src, alpha);
 		}
 	}
-	const int xShift[] = { 0, 0, 1, 1 };
-	const int yShift[] = { 0, 1, 0, 1 };
-	for (int iter = 0; iter < iterations; iter++) {
-		if (iterationMonitor) {
-			if (!iterationMonitor(iter))break;
-		}
-		for (int k = 0; k < 4; k++) {
-			//Assumes color at boundary of target image is fixed!
+}
+template<int C> void PoissonInpaintSetup(const Image<float, C, ImageType::FLOAT>& sourceImg,
+		const Image<float, C, ImageType::FLOAT>& targetImg, Image<float, C, ImageType::FLOAT>& divergence) {
+	divergence.resize(sourceImg.width, sourceImg.height);
+	divergence.set(vec<float, C>(0.0f));
 #pragma omp parallel for
-			for (int j = yShift[k] + 1; j < sourceImg.height - 1; j += 2) {
-				for (int i = xShift[k] + 1; i < sourceImg.width - 1; i += 2) {
-					float4 div = targetImg(i, j)
-							- 0.25f
-									* (targetImg(i, j - 1) + targetImg(i, j + 1)
-											+ targetImg(i - 1, j)
-											+ targetImg(i + 1, j));
-					div = (div - divergence(i, j));
-					targetImg(i, j) -= lambda * div;
-				}
-			}
+	for (int j = 1; j < sourceImg.height - 1; j++) {
+		for (int i = 1; i < sourceImg.width - 1; i++) {
+			float alpha = sourceImg(i, j)[C - 1];
+			divergence(i, j) = mix(MaskedDivergence(targetImg, i, j), MaskedDivergence(sourceImg, i, j), alpha);
 		}
 	}
 }
-void PoissonInpaint(const Image4f& sourceImg, const Image4f& targetImg,
-		Image4f& outImg, int iterations, int levels, float lambda, const std::function<bool(int,int)>& iterationMonitor) {
-	//Assumes mask is encoded in the W channel of the source image.
-	if (sourceImg.dimensions() != targetImg.dimensions()
-			|| sourceImg.dimensions() != outImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	if (levels <= 1) {
-		PoissonInpaint(sourceImg, targetImg, outImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
-			}
-			else {
-				return true;
-			}
-		});
-	} else {
-		std::vector<Image4f> srcPyramid(levels);
-		std::vector<Image4f> tarPyramid(levels);
-		std::vector<Image4f> outPyramid(levels);
-		srcPyramid[0] = sourceImg;
-		tarPyramid[0] = targetImg;
-		outPyramid[0] = outImg;
-		for (int l = 1; l < levels; l++) {
-			srcPyramid[l - 1].downSample(srcPyramid[l]);
-			tarPyramid[l - 1].downSample(tarPyramid[l]);
-			outPyramid[l - 1].downSample(outPyramid[l]);
+template<int C> void PoissonBlendSetup(const Image<float, C, ImageType::FLOAT>& sourceImg, Image<float, C, ImageType::FLOAT>& divergence) {
+	divergence.resize(sourceImg.width, sourceImg.height);
+	divergence.set(vec<float, C>(0.0f));
+#pragma omp parallel for
+	for (int j = 1; j < sourceImg.height - 1; j++) {
+		for (int i = 1; i < sourceImg.width - 1; i++) {
+			divergence(i, j) = MaskedDivergence(sourceImg, i, j);
 		}
-		for (int l = levels - 1; l >= 1; l--) {
-			if (iterationMonitor) {
-				if (!iterationMonitor(l, 0))return;
-			}
-			PoissonInpaint(srcPyramid[l], tarPyramid[l], outPyramid[l],
-					iterations, lambda, [=](int iter) {
-				if (iterationMonitor) {
-					return iterationMonitor(l, iter);
-				}
-				else {
-					return true;
-				}
-			});
-			outPyramid[l].upSample(outPyramid[l - 1]);
+	}
+}
+//Interior pixels are unknowns, the image border is fixed.
+void InteriorMask(int width, int height, Image1ub& mask) {
+	mask.resize(width, height);
+	mask.set(ubyte1((uint8_t) 0));
+#pragma omp parallel for
+	for (int j = 1; j < height - 1; j++) {
+		for (int i = 1; i < width - 1; i++) {
+			mask(i, j).x = 1;
 		}
-		outImg = outPyramid[0];
-		PoissonInpaint(sourceImg, targetImg, outImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
-			}
-			else {
-				return true;
-			}
-		});
 	}
 }
-void PoissonInpaint(const Image4f& sourceImg, const Image4f& targetImg,
-		Image4f& outImg, int iterations, float lambda, const std::function<bool(int)>& iterationMonitor) {
-	//Assumes mask is encoded in the W channel of the source image.
-	if (sourceImg.dimensions() != targetImg.dimensions()
-			|| sourceImg.dimensions() != outImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	Image4f divergence(sourceImg.width, sourceImg.height);
-	divergence.set(float4(0.0f));
+//Interior pixels whose whole stencil lies inside the target mask (last channel) are unknowns.
+template<int C> void PoissonBlendMask(const Image<float, C, ImageType::FLOAT>& targetImg, Image1ub& mask) {
+	const float THRESHOLD = 0.5;
+	mask.resize(targetImg.width, targetImg.height);
+	mask.set(ubyte1((uint8_t) 0));
 #pragma omp parallel for
-	for (int j = 1; j < sourceImg.height - 1; j++) {
-		for (int i = 1; i < sourceImg.width - 1; i++) {
-			float4 src = sourceImg(i, j);
-			float alpha = src.w;
-			src.w = 1.0f;
-			float4 val1 = sourceImg(i, j);
-			float4 val2 = sourceImg(i, j + 1);
-			float4 val3 = sourceImg(i, j - 1);
-			float4 val4 = sourceImg(i + 1, j);
-			float4 val5 = sourceImg(i - 1, j);
-			float4 divSrc(0.0f);
-			if (val1.w > 0 && val2.w > 0 && val3.w > 0 && val4.w > 0
-					&& val5.w > 0) {
-				divSrc = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				divSrc.w = 0.0f;
-			}
-
-			val1 = targetImg(i, j);
-			val2 = targetImg(i, j + 1);
-			val3 = targetImg(i, j - 1);
-			val4 = targetImg(i + 1, j);
-			val5 = targetImg(i - 1, j);
-			float4 divTar(0.0f);
-			if (val1.w > 0 && val2.w > 0 && val3.w > 0 && val4.w > 0
-					&& val5.w > 0) {
-				divTar = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				divTar.w = 0.0f;
+	for (int j = 1; j < targetImg.height - 1; j++) {
+		for (int i = 1; i < targetImg.width - 1; i++) {
+			if (targetImg(i, j)[C - 1] >= THRESHOLD && targetImg(i, j + 1)[C - 1] >= THRESHOLD
+					&& targetImg(i, j - 1)[C - 1] >= THRESHOLD && targetImg(i + 1, j)[C - 1] >= THRESHOLD
+					&& targetImg(i - 1, j)[C - 1] >= THRESHOLD) {
+				mask(i, j).x = 1;
 			}
-			divergence(i, j) = mix(divTar, divSrc, alpha);
 		}
 	}
+}
+template<int C> void RelaxInternal(const Image<float, C, ImageType::FLOAT>& divergence, Image<float, C, ImageType::FLOAT>& outImg,
+		int iterations, float lambda, const std::function<bool(int)>& iterationMonitor) {
 	const int xShift[] = { 0, 0, 1, 1 };
 	const int yShift[] = { 0, 1, 0, 1 };
 	for (int iter = 0; iter < iterations; iter++) {
 		if (iterationMonitor) {
-			if (!iterationMonitor(iter))break;
+			if (!iterationMonitor(iter))
+				break;
 		}
 		for (int k = 0; k < 4; k++) {
 			//Assumes color at boundary of target image is fixed!
 #pragma omp parallel for
-			for (int j = yShift[k] + 1; j < sourceImg.height - 1; j += 2) {
-				for (int i = xShift[k] + 1; i < sourceImg.width - 1; i += 2) {
-					float4 div = outImg(i, j)
-							- 0.25f
-									* (outImg(i, j - 1) + outImg(i, j + 1)
-											+ outImg(i - 1, j)
-											+ outImg(i + 1, j));
+			for (int j = yShift[k] + 1; j < outImg.height - 1; j += 2) {
+				for (int i = xShift[k] + 1; i < outImg.width - 1; i += 2) {
+					vec<float, C> div = outImg(i, j)
+							- 0.25f * (outImg(i, j - 1) + outImg(i, j + 1) + outImg(i - 1, j) + outImg(i + 1, j));
 					div = (div - divergence(i, j));
 					outImg(i, j) -= lambda * div;
 				}
@@ -346,17 +328,35 @@ void PoissonInpaint(const Image4f& sourceImg, const Image4f& targetImg,
 		}
 	}
 }
-void PoissonInpaint(const Image2f& sourceImg, const Image2f& targetImg,
-		Image2f& outImg, int iterations, int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
-	//Assumes mask is encoded in the W channel of the source image.
-	if (sourceImg.dimensions() != targetImg.dimensions()
-			|| sourceImg.dimensions() != outImg.dimensions())
+template<int C> void MultigridRelaxInternal(const Image<float, C, ImageType::FLOAT>& divergence, const Image1ub& mask,
+		Image<float, C, ImageType::FLOAT>& outImg, int iterations, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
+	MultigridPoisson2D solver(MultigridCycle::V);
+	solver.setRelaxation(lambda);
+	solver.solve(divergence, mask, outImg, iterations, 1E-10, [=](int cycle, double residual) {
+		if (iterationMonitor) {
+			return iterationMonitor(0, cycle);
+		}
+		else {
+			return true;
+		}
+	});
+}
+template<int C> void CheckDimensions(const Image<float, C, ImageType::FLOAT>& sourceImg, const Image<float, C, ImageType::FLOAT>& targetImg) {
+	if (sourceImg.dimensions() != targetImg.dimensions())
 		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
+				MakeString() << "Cannot solve. Image dimensions do not match " << sourceImg.dimensions() << " " << targetImg.dimensions());
+}
+template<int C> void LaplaceFillInternal(const Image<float, C, ImageType::FLOAT>& sourceImg, Image<float, C, ImageType::FLOAT>& targetImg,
+		int iterations, float lambda, const std::function<bool(int)>& iterationMonitor) {
+	CheckDimensions(sourceImg, targetImg);
+	Image<float, C, ImageType::FLOAT> divergence;
+	LaplaceFillSetup(sourceImg, targetImg, divergence);
+	RelaxInternal(divergence, targetImg, iterations, lambda, iterationMonitor);
+}
+template<int C> void LaplaceFillInternal(const Image<float, C, ImageType::FLOAT>& sourceImg, Image<float, C, ImageType::FLOAT>& targetImg,
+		int iterations, int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
 	if (levels <= 1) {
-		PoissonInpaint(sourceImg, targetImg, outImg, iterations, lambda, [=](int iter) {
+		LaplaceFillInternal(sourceImg, targetImg, iterations, lambda, [=](int iter) {
 			if (iterationMonitor) {
 				return iterationMonitor(0, iter);
 			}
@@ -364,35 +364,30 @@ void PoissonInpaint(const Image2f& sourceImg, const Image2f& targetImg,
 				return true;
 			}
 		});
-	} else {
-		std::vector<Image2f> srcPyramid(levels);
-		std::vector<Image2f> tarPyramid(levels);
-		std::vector<Image2f> outPyramid(levels);
-		srcPyramid[0] = sourceImg;
-		tarPyramid[0] = targetImg;
-		outPyramid[0] = outImg;
-		for (int l = 1; l < levels; l++) {
-			srcPyramid[l - 1].downSample(srcPyramid[l]);
-			tarPyramid[l - 1].downSample(tarPyramid[l]);
-			outPyramid[l - 1].downSample(outPyramid[l]);
-		}
-		for (int l = levels - 1; l >= 1; l--) {
-			if (iterationMonitor) {
-				if (!iterationMonitor(l, 0))return;
-			}
-			PoissonInpaint(srcPyramid[l], tarPyramid[l], outPyramid[l],
-					iterations, lambda, [=](int iter) {
-				if (iterationMonitor) {
-					return iterationMonitor(l, iter);
-				}
-				else {
-					return true;
-				}
-			});
-			outPyramid[l].upSample(outPyramid[l - 1]);
-		}
-		outImg = outPyramid[0];
-		PoissonInpaint(sourceImg, targetImg, outImg, iterations, lambda, [=](int iter) {
+		return;
+	}
+	CheckDimensions(sourceImg, targetImg);
+	Image<float, C, ImageType::FLOAT> divergence;
+	Image1ub mask;
+	LaplaceFillSetup(sourceImg, targetImg, divergence);
+	InteriorMask(sourceImg.width, sourceImg.height, mask);
+	MultigridRelaxInternal(divergence, mask, targetImg, iterations, lambda, iterationMonitor);
+}
+template<int C> void PoissonInpaintInternal(const Image<float, C, ImageType::FLOAT>& sourceImg,
+		const Image<float, C, ImageType::FLOAT>& targetImg, Image<float, C, ImageType::FLOAT>& outImg, int iterations, float lambda,
+		const std::function<bool(int)>& iterationMonitor) {
+	//Assumes mask is encoded in the last channel of the source image.
+	CheckDimensions(sourceImg, targetImg);
+	CheckDimensions(sourceImg, outImg);
+	Image<float, C, ImageType::FLOAT> divergence;
+	PoissonInpaintSetup(sourceImg, targetImg, divergence);
+	RelaxInternal(divergence, outImg, iterations, lambda, iterationMonitor);
+}
+template<int C> void PoissonInpaintInternal(const Image<float, C, ImageType::FLOAT>& sourceImg,
+		const Image<float, C, ImageType::FLOAT>& targetImg, Image<float, C, ImageType::FLOAT>& outImg, int iterations, int levels,
+		float lambda, const std::function<bool(int, int)>& iterationMonitor) {
+	if (levels <= 1) {
+		PoissonInpaintInternal(sourceImg, targetImg, outImg, iterations, lambda, [=](int iter) {
 			if (iterationMonitor) {
 				return iterationMonitor(0, iter);
 			}
@@ -400,115 +395,50 @@ void PoissonInpaint(const Image2f& sourceImg, const Image2f& targetImg,
 				return true;
 			}
 		});
+		return;
 	}
+	CheckDimensions(sourceImg, targetImg);
+	CheckDimensions(sourceImg, outImg);
+	Image<float, C, ImageType::FLOAT> divergence;
+	Image1ub mask;
+	PoissonInpaintSetup(sourceImg, targetImg, divergence);
+	InteriorMask(sourceImg.width, sourceImg.height, mask);
+	MultigridRelaxInternal(divergence, mask, outImg, iterations, lambda, iterationMonitor);
 }
-void PoissonInpaint(const Image2f& sourceImg, const Image2f& targetImg,
-		Image2f& outImg, int iterations, float lambda, const std::function<bool(int)>& iterationMonitor) {
-	//Assumes mask is encoded in the W channel of the source image.
-	if (sourceImg.dimensions() != targetImg.dimensions()
-			|| sourceImg.dimensions() != outImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	Image2f divergence(sourceImg.width, sourceImg.height);
-	divergence.set(float2(0.0f));
-#pragma omp parallel for
-	for (int j = 1; j < sourceImg.height - 1; j++) {
-		for (int i = 1; i < sourceImg.width - 1; i++) {
-			float2 src = sourceImg(i, j);
-			float alpha = src.y;
-			src.y = 1.0f;
-			float2 val1 = sourceImg(i, j);
-			float2 val2 = sourceImg(i, j + 1);
-			float2 val3 = sourceImg(i, j - 1);
-			float2 val4 = sourceImg(i + 1, j);
-			float2 val5 = sourceImg(i - 1, j);
-			float2 divSrc(0.0f);
-			if (val1.y > 0 && val2.y > 0 && val3.y > 0 && val4.y > 0
-					&& val5.y > 0) {
-				divSrc = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				divSrc.y = 0.0f;
-			}
-
-			val1 = targetImg(i, j);
-			val2 = targetImg(i, j + 1);
-			val3 = targetImg(i, j - 1);
-			val4 = targetImg(i + 1, j);
-			val5 = targetImg(i - 1, j);
-			float2 divTar(0.0f);
-			if (val1.y > 0 && val2.y > 0 && val3.y > 0 && val4.y > 0
-					&& val5.y > 0) {
-				divTar = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				divTar.y = 0.0f;
-			}
-			divergence(i, j) = mix(divTar, divSrc, alpha);
-		}
-	}
+template<int C> void PoissonBlendInternal(const Image<float, C, ImageType::FLOAT>& sourceImg, Image<float, C, ImageType::FLOAT>& targetImg,
+		int iterations, float lambda, const std::function<bool(int)>& iterationMonitor) {
+	CheckDimensions(sourceImg, targetImg);
+	Image<float, C, ImageType::FLOAT> divergence;
+	Image1ub mask;
+	PoissonBlendSetup(sourceImg, divergence);
+	PoissonBlendMask(targetImg, mask);
 	const int xShift[] = { 0, 0, 1, 1 };
 	const int yShift[] = { 0, 1, 0, 1 };
 	for (int iter = 0; iter < iterations; iter++) {
 		if (iterationMonitor) {
-			if (!iterationMonitor(iter))break;
+			if (!iterationMonitor(iter))
+				break;
 		}
 		for (int k = 0; k < 4; k++) {
-			//Assumes color at boundary of target image is fixed!
 #pragma omp parallel for
 			for (int j = yShift[k] + 1; j < sourceImg.height - 1; j += 2) {
 				for (int i = xShift[k] + 1; i < sourceImg.width - 1; i += 2) {
-					float2 div = outImg(i, j)
-							- 0.25f
-									* (outImg(i, j - 1) + outImg(i, j + 1)
-											+ outImg(i - 1, j)
-											+ outImg(i + 1, j));
-					div = (div - divergence(i, j));
-					outImg(i, j) -= lambda * div;
+					if (mask(i, j).x) {
+						vec<float, C> div = targetImg(i, j)
+								- 0.25f * (targetImg(i, j + 1) + targetImg(i, j - 1) + targetImg(i + 1, j) + targetImg(i - 1, j));
+						div = (div - divergence(i, j));
+						div[C - 1] = 0;
+						targetImg(i, j) -= lambda * div;
+					}
 				}
 			}
 		}
 	}
 }
-void PoissonBlend(const Image4f& sourceImg, Image4f& targetImg, int iterations,
-		int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
+template<int C> void PoissonBlendInternal(const Image<float, C, ImageType::FLOAT>& sourceImg, Image<float, C, ImageType::FLOAT>& targetImg,
+		int iterations, int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
 	if (levels <= 1) {
-		PoissonBlend(sourceImg, targetImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
-			}
-			else {
-				return true;
-			}
-		});
-	} else {
-		std::vector<Image4f> srcPyramid(levels);
-		std::vector<Image4f> tarPyramid(levels);
-		srcPyramid[0] = sourceImg;
-		tarPyramid[0] = targetImg;
-		for (int l = 1; l < levels; l++) {
-			srcPyramid[l - 1].downSample(srcPyramid[l]);
-			tarPyramid[l - 1].downSample(tarPyramid[l]);
-		}
-		for (int l = levels - 1; l >= 1; l--) {
-			if (iterationMonitor) {
-				if (!iterationMonitor(l, 0))return;
-			}
-			PoissonBlend(srcPyramid[l], tarPyramid[l], iterations, lambda, [=](int iter) {
-				if (iterationMonitor) {
-					return iterationMonitor(l, iter);
-				}
-				else {
-					return true;
-				}
-			});
-			tarPyramid[l].upSample(tarPyramid[l - 1]);
-		}
-		targetImg = tarPyramid[0];
-		PoissonBlend(sourceImg, targetImg, iterations, lambda, [=](int iter) {
+		PoissonBlendInternal(sourceImg, targetImg, iterations, lambda, [=](int iter) {
 			if (iterationMonitor) {
 				return iterationMonitor(0, iter);
 			}
@@ -516,171 +446,69 @@ void PoissonBlend(const Image4f& sourceImg, Image4f& targetImg, int iterations,
 				return true;
 			}
 		});
+		return;
 	}
+	CheckDimensions(sourceImg, targetImg);
+	Image<float, C, ImageType::FLOAT> divergence;
+	Image1ub mask;
+	PoissonBlendSetup(sourceImg, divergence);
+	PoissonBlendMask(targetImg, mask);
+	//Channels are independent, so the mask channel is restored after the solve.
+	std::vector<float> alpha(targetImg.data.size());
+	for (size_t idx = 0; idx < alpha.size(); idx++) {
+		alpha[idx] = targetImg.data[idx][C - 1];
+	}
+	MultigridRelaxInternal(divergence, mask, targetImg, iterations, lambda, iterationMonitor);
+	for (size_t idx = 0; idx < alpha.size(); idx++) {
+		targetImg.data[idx][C - 1] = alpha[idx];
+	}
+}
+void LaplaceFill(const Image4f& sourceImg, Image4f& targetImg, int iterations,
+		int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor ) {
+	LaplaceFillInternal(sourceImg, targetImg, iterations, levels, lambda, iterationMonitor);
+}
+void LaplaceFill(const Image2f& sourceImg, Image2f& targetImg, int iterations,
+		int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
+	LaplaceFillInternal(sourceImg, targetImg, iterations, levels, lambda, iterationMonitor);
+}
+void LaplaceFill(const Image2f& sourceImg, Image2f& targetImg, int iterations,
+		float lambda,const std::function<bool(int)>& iterationMonitor) {
+	LaplaceFillInternal(sourceImg, targetImg, iterations, lambda, iterationMonitor);
+}
+void LaplaceFill(const Image4f& sourceImg, Image4f& targetImg, int iterations,
+		float lambda, const std::function<bool(int)>& iterationMonitor) {
+	LaplaceFillInternal(sourceImg, targetImg, iterations, lambda, iterationMonitor);
+}
+void PoissonInpaint(const Image4f& sourceImg, const Image4f& targetImg,
+		Image4f& outImg, int iterations, int levels, float lambda, const std::function<bool(int,int)>& iterationMonitor) {
+	PoissonInpaintInternal(sourceImg, targetImg, outImg, iterations, levels, lambda, iterationMonitor);
+}
+void PoissonInpaint(const Image4f& sourceImg, const Image4f& targetImg,
+		Image4f& outImg, int iterations, float lambda, const std::function<bool(int)>& iterationMonitor) {
+	PoissonInpaintInternal(sourceImg, targetImg, outImg, iterations, lambda, iterationMonitor);
+}
+void PoissonInpaint(const Image2f& sourceImg, const Image2f& targetImg,
+		Image2f& outImg, int iterations, int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
+	PoissonInpaintInternal(sourceImg, targetImg, outImg, iterations, levels, lambda, iterationMonitor);
+}
+void PoissonInpaint(const Image2f& sourceImg, const Image2f& targetImg,
+		Image2f& outImg, int iterations, float lambda, const std::function<bool(int)>& iterationMonitor) {
+	PoissonInpaintInternal(sourceImg, targetImg, outImg, iterations, lambda, iterationMonitor);
+}
+void PoissonBlend(const Image4f& sourceImg, Image4f& targetImg, int iterations,
+		int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
+	PoissonBlendInternal(sourceImg, targetImg, iterations, levels, lambda, iterationMonitor);
 }
 void PoissonBlend(const Image2f& sourceImg, Image2f& targetImg, int iterations,
 		int levels, float lambda, const std::function<bool(int, int)>& iterationMonitor) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	if (levels <= 1) {
-		PoissonBlend(sourceImg, targetImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
-			}
-			else {
-				return true;
-			}
-		});
-	} else {
-		std::vector<Image2f> srcPyramid(levels);
-		std::vector<Image2f> tarPyramid(levels);
-		srcPyramid[0] = sourceImg;
-		tarPyramid[0] = targetImg;
-		for (int l = 1; l < levels; l++) {
-			srcPyramid[l - 1].downSample(srcPyramid[l]);
-			tarPyramid[l - 1].downSample(tarPyramid[l]);
-		}
-		for (int l = levels - 1; l >= 1; l--) {
-			if (iterationMonitor) {
-				if (!iterationMonitor(l, 0))return;
-			}
-			PoissonBlend(srcPyramid[l], tarPyramid[l], iterations, lambda, [=](int iter) {
-				if (iterationMonitor) {
-					return iterationMonitor(l, iter);
-				}
-				else {
-					return true;
-				}
-			});
-			tarPyramid[l].upSample(tarPyramid[l - 1]);
-		}
-		targetImg = tarPyramid[0];
-		PoissonBlend(sourceImg, targetImg, iterations, lambda, [=](int iter) {
-			if (iterationMonitor) {
-				return iterationMonitor(0, iter);
-			}
-			else {
-				return true;
-			}
-		});
-	}
+	PoissonBlendInternal(sourceImg, targetImg, iterations, levels, lambda, iterationMonitor);
 }
 void PoissonBlend(const Image4f& sourceImg, Image4f& targetImg, int iterations,
 		float lambda, const std::function<bool(int)>& iterationMonitor) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	Image4f divergence(sourceImg.width, sourceImg.height);
-#pragma omp parallel for
-	for (int j = 1; j < sourceImg.height - 1; j++) {
-		for (int i = 1; i < sourceImg.width - 1; i++) {
-			float4 val1 = sourceImg(i, j);
-			float4 val2 = sourceImg(i, j + 1);
-			float4 val3 = sourceImg(i, j - 1);
-			float4 val4 = sourceImg(i + 1, j);
-			float4 val5 = sourceImg(i - 1, j);
-			float4 div(0.0f);
-			if (val1.w > 0 && val2.w > 0 && val3.w > 0 && val4.w > 0
-					&& val5.w > 0) {
-				div = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				div.w = 0.0f;
-			}
-			divergence(i, j) = div;
-
-		}
-	}
-	const int xShift[] = { 0, 0, 1, 1 };
-	const int yShift[] = { 0, 1, 0, 1 };
-	const float THRESHOLD = 0.5;
-	for (int iter = 0; iter < iterations; iter++) {
-		if (iterationMonitor) {
-			if (!iterationMonitor(iter))break;
-		}
-		for (int k = 0; k < 4; k++) {
-			//Assumes color at boundary of target image is fixed!
-#pragma omp parallel for
-			for (int j = yShift[k] + 1; j < sourceImg.height - 1; j += 2) {
-				for (int i = xShift[k] + 1; i < sourceImg.width - 1; i += 2) {
-					float4 val1 = targetImg(i, j);
-					float4 val2 = targetImg(i, j + 1);
-					float4 val3 = targetImg(i, j - 1);
-					float4 val4 = targetImg(i + 1, j);
-					float4 val5 = targetImg(i - 1, j);
-					float4 div(0.0f);
-					if (val1.w >= THRESHOLD && val2.w >= THRESHOLD
-							&& val3.w >= THRESHOLD && val4.w >= THRESHOLD
-							&& val5.w >= THRESHOLD) {
-						div = val1 - 0.25f * (val2 + val3 + val4 + val5);
-						div = (div - divergence(i, j));
-						div.w = 0;
-						targetImg(i, j) -= lambda * div;
-					}
-				}
-			}
-		}
-	}
+	PoissonBlendInternal(sourceImg, targetImg, iterations, lambda, iterationMonitor);
 }
-
 void PoissonBlend(const Image2f& sourceImg, Image2f& targetImg, int iterations,
 		float lambda, const std::function<bool(int)>& iterationMonitor) {
-	if (sourceImg.dimensions() != targetImg.dimensions())
-		throw std::runtime_error(
-				MakeString() << "Cannot solve. Image dimensions do not match "
-						<< sourceImg.dimensions() << " "
-						<< targetImg.dimensions());
-	Image2f divergence(sourceImg.width, sourceImg.height);
-#pragma omp parallel for
-	for (int j = 1; j < sourceImg.height - 1; j++) {
-		for (int i = 1; i < sourceImg.width - 1; i++) {
-			float2 val1 = sourceImg(i, j);
-			float2 val2 = sourceImg(i, j + 1);
-			float2 val3 = sourceImg(i, j - 1);
-			float2 val4 = sourceImg(i + 1, j);
-			float2 val5 = sourceImg(i - 1, j);
-			float2 div(0.0f);
-			if (val1.y > 0 && val2.y > 0 && val3.y > 0 && val4.y > 0
-					&& val5.y > 0) {
-				div = val1 - 0.25f * (val2 + val3 + val4 + val5);
-				div.y = 0.0f;
-			}
-			divergence(i, j) = div;
-
-		}
-	}
-	const int xShift[] = { 0, 0, 1, 1 };
-	const int yShift[] = { 0, 1, 0, 1 };
-	const float THRESHOLD = 0.5;
-	for (int iter = 0; iter < iterations; iter++) {
-		if (iterationMonitor) {
-			if (!iterationMonitor(iter))break;
-		}
-		for (int k = 0; k < 4; k++) {
-			//Assumes color at boundary of target image is fixed!
-#pragma omp parallel for
-			for (int j = yShift[k] + 1; j < sourceImg.height - 1; j += 2) {
-				for (int i = xShift[k] + 1; i < sourceImg.width - 1; i += 2) {
-					float2 val1 = targetImg(i, j);
-					float2 val2 = targetImg(i, j + 1);
-					float2 val3 = targetImg(i, j - 1);
-					float2 val4 = targetImg(i + 1, j);
-					float2 val5 = targetImg(i - 1, j);
-					float2 div(0.0f);
-					if (val1.y >= THRESHOLD && val2.y >= THRESHOLD
-							&& val3.y >= THRESHOLD && val4.y >= THRESHOLD
-							&& val5.y >= THRESHOLD) {
-						div = val1 - 0.25f * (val2 + val3 + val4 + val5);
-						div = (div - divergence(i, j));
-						div.y = 0;
-						targetImg(i, j) -= lambda * div;
-					}
-				}
-			}
-		}
-	}
+	PoissonBlendInternal(sourceImg, targetImg, iterations, lambda, iterationMonitor);
 }
 }
@@ -20,6 +20,8 @@
  */
 
 #include "AlloyDistanceField.h"
+#include "AlloyIntersector.h"
+#include "AlloyMesh.h"
 #include "BinaryMinHeap.h"
 #include <list>
 using namespace std;
@@ -94,11 +96,486 @@ float DistanceField3f::march(float IMv, float IPv, float JMv, float JPv,
 	tmp = (s + std::sqrt(std::max(0.0,s * s - count * (s2 - 1.0f)))) / count;
 	return (float)tmp;
 }
+/*
+ Zhao, H. (2005). A fast sweeping method for eikonal equations. Mathematics of computation, 74(250), 603-627.
+
+ Level set redistancing on a grid of bricks. Only allocated bricks are solved, which is every brick for fast sweeping
+ and bricks near the interface for narrow band mode. Bricks on the same diagonal of a sweep ordering share no faces, so
+ they are processed in parallel with the same result as a sequential Gauss-Seidel sweep.
+ */
+class DenseLevelSet {
+protected:
+	const float1* data;
+public:
+	int rows, cols, slices;
+	size_t sliceSize;
+	DenseLevelSet(const float1* data, int rows, int cols, int slices) :
+			data(data), rows(rows), cols(cols), slices(slices), sliceSize(
+					(size_t) rows * cols) {
+	}
+	float operator()(int i, int j, int k) const {
+		return data[i + (size_t) j * rows + k * sliceSize].x;
+	}
+	//Voxels that may lie next to the interface, scanned one slice per group.
+	int groups() const {
+		return slices;
+	}
+	template<class F> void forEachInGroup(int g, const F& func) const {
+		for (int j = 0; j < cols; j++) {
+			for (int i = 0; i < rows; i++) {
+				func(i, j, g);
+			}
+		}
+	}
+};
+//Only active voxels are considered next to the interface, scanned one leaf per group.
+class SparseLevelSet {
+protected:
+	const SparseVolume1f& vol;
+public:
+	int rows, cols, slices;
+	SparseLevelSet(const SparseVolume1f& vol) :
+			vol(vol), rows(vol.rows), cols(vol.cols), slices(vol.slices) {
+	}
+	float operator()(int i, int j, int k) const {
+		return vol.getValue(i, j, k).x;
+	}
+	int groups() const {
+		return (int) vol.leafCount();
+	}
+	template<class F> void forEachInGroup(int g, const F& func) const {
+		const SparseVolume1f::Leaf& leaf = vol.getLeaf(g);
+		const int S = SparseVolume1f::LEAF_SHIFT;
+		const int M = SparseVolume1f::LEAF_MASK;
+		for (int v = 0; v < SparseVolume1f::LEAF_VOXELS; v++) {
+			if (leaf.active[v]) {
+				func(leaf.origin.x + (v & M), leaf.origin.y + ((v >> S) & M),
+						leaf.origin.z + (v >> (2 * S)));
+			}
+		}
+	}
+};
+template<class Source> class LevelSetSweeper {
+protected:
+	//Bricks are 2^BRICK_SHIFT voxels on a side, or one voxel deep for images.
+	static const int BRICK_SHIFT = 4;
+	const Source* vol;
+	int rows, cols, slices;
+	size_t sliceSize;
+	float maxDistance;
+	int3 brickDim;
+	int3 brickShift;
+	int3 brickCount;
+	int brickVoxels;
+	std::vector<int> brickTable;
+	std::vector<int3> bricks;
+	std::vector<float> dist;
+	std::vector<int8_t> signs;
+	std::vector<uint8_t> frozen;
+	//Distance to the zero crossing for voxels next to a sign change, linearly interpolated along each axis.
+	float interfaceDistance(int i, int j, int k) const {
+		const float UNDEFINED = DistanceField3f::DISTANCE_UNDEFINED;
+		const Source& src = *vol;
+		float Cv = src(i, j, k);
+		if (Cv == 0)
+			return 0.0f;
+		if (Cv == UNDEFINED)
+			return UNDEFINED;
+		const int coord[3] = { i, j, k };
+		const int dims[3] = { rows, cols, slices };
+		float result = 0;
+		for (int a = 0; a < 3; a++) {
+			int3 m(i, j, k), p(i, j, k);
+			m[a]--;
+			p[a]++;
+			float Mv = (coord[a] > 0) ? src(m.x, m.y, m.z) : Cv;
+			float Pv = (coord[a] < dims[a] - 1) ? src(p.x, p.y, p.z) : Cv;
+			bool mFlag = (Mv * Cv < 0 && Mv != UNDEFINED);
+			bool pFlag = (Pv * Cv < 0 && Pv != UNDEFINED);
+			if (!mFlag && !pFlag)
+				continue;
+			float s;
+			if (mFlag && pFlag) {
+				s = (std::abs(Mv) > std::abs(Pv)) ? Mv : Pv;
+			} else {
+				s = (mFlag) ? Mv : Pv;
+			}
+			s = Cv / (Cv - s);
+			result += 1.0f / (s * s);
+		}
+		if (result == 0)
+			return UNDEFINED;
+		return 1.0f / std::sqrt(result);
+	}
+	int brickIndex(int i, int j, int k) const {
+		return brickTable[(i >> brickShift.x)
+				+ ((j >> brickShift.y) + (k >> brickShift.z) * brickCount.y)
+						* brickCount.x];
+	}
+	int3 voxel(size_t idx) const {
+		return int3((int) (idx % rows), (int) ((idx / rows) % cols),
+				(int) (idx / sliceSize));
+	}
+	size_t localIndex(int i, int j, int k) const {
+		return (i & (brickDim.x - 1))
+				+ ((j & (brickDim.y - 1)) + (k & (brickDim.z - 1)) * brickDim.y)
+						* brickDim.x;
+	}
+	//Distance and sign of a voxel, or DISTANCE_UNDEFINED if it lies outside the allocated bricks.
+	float value(int i, int j, int k, int8_t& s) const {
+		if (i < 0 || j < 0 || k < 0 || i >= rows || j >= cols || k >= slices) {
+			s = 0;
+			return DistanceField3f::DISTANCE_UNDEFINED;
+		}
+		int b = brickIndex(i, j, k);
+		if (b < 0) {
+			s = 0;
+			return DistanceField3f::DISTANCE_UNDEFINED;
+		}
+		size_t idx = b * (size_t) brickVoxels + localIndex(i, j, k);
+		s = signs[idx];
+		return dist[idx];
+	}
+	//Godunov upwind solution of |grad u|=1 given the smallest neighbor along each axis.
+	static float eikonal(float a, float b, float c) {
+		if (a > b)
+			std::swap(a, b);
+		if (b > c)
+			std::swap(b, c);
+		if (a > b)
+			std::swap(a, b);
+		float u = a + 1.0f;
+		if (u <= b)
+			return u;
+		u = 0.5f * (a + b + std::sqrt(2.0f - (a - b) * (a - b)));
+		if (u <= c)
+			return u;
+		float s = a + b + c;
+		return (s + std::sqrt(std::max(0.0f, s * s - 3.0f * (a * a + b * b + c * c - 1.0f)))) / 3.0f;
+	}
+	//Neighbors inside the brick are read directly. Only voxels on the brick boundary go through the brick table.
+	bool update(int i, int j, int k, const int3& local, const int3& extent,
+			size_t idx) {
+		const size_t strideY = brickDim.x;
+		const size_t strideZ = (size_t) brickDim.x * brickDim.y;
+		int8_t s[6];
+		float v[6];
+		if (local.x > 0) {
+			v[0] = dist[idx - 1];
+			s[0] = signs[idx - 1];
+		} else {
+			v[0] = value(i - 1, j, k, s[0]);
+		}
+		if (local.x < extent.x - 1) {
+			v[1] = dist[idx + 1];
+			s[1] = signs[idx + 1];
+		} else {
+			v[1] = value(i + 1, j, k, s[1]);
+		}
+		if (local.y > 0) {
+			v[2] = dist[idx - strideY];
+			s[2] = signs[idx - strideY];
+		} else {
+			v[2] = value(i, j - 1, k, s[2]);
+		}
+		if (local.y < extent.y - 1) {
+			v[3] = dist[idx + strideY];
+			s[3] = signs[idx + strideY];
+		} else {
+			v[3] = value(i, j + 1, k, s[3]);
+		}
+		if (local.z > 0) {
+			v[4] = dist[idx - strideZ];
+			s[4] = signs[idx - strideZ];
+		} else {
+			v[4] = value(i, j, k - 1, s[4]);
+		}
+		if (local.z < extent.z - 1) {
+			v[5] = dist[idx + strideZ];
+			s[5] = signs[idx + strideZ];
+		} else {
+			v[5] = value(i, j, k + 1, s[5]);
+		}
+		float a = std::min(v[0], v[1]);
+		float b = std::min(v[2], v[3]);
+		float c = std::min(v[4], v[5]);
+		if (std::min(std::min(a, b), c) >= maxDistance)
+			return false;
+		float u = eikonal(a, b, c);
+		float& d = dist[idx];
+		if (u >= d)
+			return false;
+		bool changed = (d - u > 1E-5f);
+		d = u;
+		//Voxels without a sign in the input inherit it from their closest signed neighbor.
+		if (signs[idx] == 0) {
+			int best = -1;
+			for (int n = 0; n < 6; n++) {
+				if (s[n] != 0 && (best < 0 || v[n] < v[best]))
+					best = n;
+			}
+			if (best >= 0) {
+				signs[idx] = s[best];
+				changed = true;
+			}
+		}
+		return changed;
+	}
+	bool sweepBrick(int b, int di, int dj, int dk) {
+		int3 lo = bricks[b] * brickDim;
+		int3 extent = aly::minVec(lo + brickDim, int3(rows, cols, slices)) - lo;
+		int i0 = (di > 0) ? 0 : extent.x - 1, i1 = (di > 0) ? extent.x : -1;
+		int j0 = (dj > 0) ? 0 : extent.y - 1, j1 = (dj > 0) ? extent.y : -1;
+		int k0 = (dk > 0) ? 0 : extent.z - 1, k1 = (dk > 0) ? extent.z : -1;
+		size_t offset = b * (size_t) brickVoxels;
+		bool changed = false;
+		int3 local;
+		for (local.z = k0; local.z != k1; local.z += dk) {
+			for (local.y = j0; local.y != j1; local.y += dj) {
+				for (local.x = i0; local.x != i1; local.x += di) {
+					size_t idx = offset + local.x
+							+ (local.y + local.z * brickDim.y) * brickDim.x;
+					if (!frozen[idx]
+							&& update(lo.x + local.x, lo.y + local.y,
+									lo.z + local.z, local, extent, idx))
+						changed = true;
+				}
+			}
+		}
+		return changed;
+	}
+public:
+	void solve(const Source& vol, float maxDistance, bool narrowBand) {
+		this->vol = &vol;
+		rows = vol.rows;
+		cols = vol.cols;
+		slices = vol.slices;
+		this->maxDistance = maxDistance;
+		sliceSize = (size_t) rows * cols;
+		brickShift = int3(BRICK_SHIFT, BRICK_SHIFT, (slices > 1) ? BRICK_SHIFT : 0);
+		brickDim = int3(1 << brickShift.x, 1 << brickShift.y, 1 << brickShift.z);
+		brickVoxels = brickDim.x * brickDim.y * brickDim.z;
+		brickCount = int3((rows + brickDim.x - 1) / brickDim.x,
+				(cols + brickDim.y - 1) / brickDim.y,
+				(slices + brickDim.z - 1) / brickDim.z);
+		const int totalBricks = brickCount.x * brickCount.y * brickCount.z;
+		//Interface voxels keep the distance interpolated from the input.
+		const int groups = vol.groups();
+		std::vector<std::vector<std::pair<size_t, float>>> seeds(groups);
+#pragma omp parallel for
+		for (int g = 0; g < groups; g++) {
+			std::vector<std::pair<size_t, float>>& group = seeds[g];
+			vol.forEachInGroup(g, [&](int i, int j, int k) {
+				float d = interfaceDistance(i, j, k);
+				if (d != DistanceField3f::DISTANCE_UNDEFINED) {
+					group.push_back(std::pair<size_t, float>(i + (size_t) j * rows + k * sliceSize, d));
+				}
+			});
+		}
+		brickTable.assign(totalBricks, -1);
+		if (narrowBand) {
+			int3 radius(0);
+			for (int c = 0; c < 3; c++) {
+				radius[c] = (int) std::min((float) brickCount[c],
+						std::ceil(maxDistance / brickDim[c]));
+			}
+			for (int g = 0; g < groups; g++) {
+				for (const std::pair<size_t, float>& seed : seeds[g]) {
+					int3 b = voxel(seed.first) / brickDim;
+					int& entry = brickTable[b.x + (b.y + b.z * brickCount.y) * brickCount.x];
+					if (entry == 0)
+						continue;
+					entry = 0;
+					int3 lo = aly::maxVec(b - radius, int3(0));
+					int3 hi = aly::minVec(b + radius, brickCount - int3(1));
+					for (int bk = lo.z; bk <= hi.z; bk++) {
+						for (int bj = lo.y; bj <= hi.y; bj++) {
+							for (int bi = lo.x; bi <= hi.x; bi++) {
+								int& nbr = brickTable[bi + (bj + bk * brickCount.y) * brickCount.x];
+								if (nbr < 0)
+									nbr = 1;
+							}
+						}
+					}
+				}
+			}
+		} else {
+			brickTable.assign(totalBricks, 1);
+		}
+		bricks.clear();
+		for (int b = 0; b < totalBricks; b++) {
+			if (brickTable[b] >= 0) {
+				brickTable[b] = (int) bricks.size();
+				bricks.push_back(
+						int3(b % brickCount.x, (b / brickCount.x) % brickCount.y,
+								b / (brickCount.x * brickCount.y)));
+			}
+		}
+		const int N = (int) bricks.size();
+		dist.assign(N * (size_t) brickVoxels, DistanceField3f::DISTANCE_UNDEFINED);
+		signs.assign(N * (size_t) brickVoxels, 0);
+		frozen.assign(N * (size_t) brickVoxels, 1);
+#pragma omp parallel for
+		for (int b = 0; b < N; b++) {
+			int3 lo = bricks[b] * brickDim;
+			int3 hi = aly::minVec(lo + brickDim, int3(rows, cols, slices));
+			size_t offset = b * (size_t) brickVoxels;
+			for (int k = lo.z; k < hi.z; k++) {
+				for (int j = lo.y; j < hi.y; j++) {
+					for (int i = lo.x; i < hi.x; i++) {
+						size_t idx = offset + localIndex(i, j, k);
+						float Cv = vol(i, j, k);
+						signs[idx] = (Cv == DistanceField3f::DISTANCE_UNDEFINED) ? 0 : (int8_t) aly::sign(Cv);
+						frozen[idx] = 0;
+					}
+				}
+			}
+		}
+#pragma omp parallel for
+		for (int g = 0; g < groups; g++) {
+			for (const std::pair<size_t, float>& seed : seeds[g]) {
+				int3 v = voxel(seed.first);
+				size_t idx = brickIndex(v.x, v.y, v.z) * (size_t) brickVoxels + localIndex(v.x, v.y, v.z);
+				dist[idx] = seed.second;
+				frozen[idx] = 1;
+			}
+		}
+		//Bricks grouped by diagonal for each sweep ordering.
+		const int orderings = (slices > 1) ? 8 : 4;
+		const int diagonals = brickCount.x + brickCount.y + brickCount.z - 2;
+		std::vector<std::vector<int>> diagonal(diagonals);
+		//Sweep count when each brick last changed. A brick is skipped once neither it nor its face neighbors
+		//have changed for a full round of orderings. Initially only bricks on the interface count as changed.
+		std::vector<int> lastChanged(N, std::numeric_limits<int>::min() / 2);
+		for (int g = 0; g < groups; g++) {
+			for (const std::pair<size_t, float>& seed : seeds[g]) {
+				int3 v = voxel(seed.first);
+				lastChanged[brickIndex(v.x, v.y, v.z)] = 0;
+			}
+		}
+		seeds.clear();
+		int sweep = 0;
+		//Bricks only wake up after a neighbor changes, so fronts can take several rounds to cross the volume.
+		const int maxIterations = diagonals + 1;
+		for (int iter = 0; iter < maxIterations; iter++) {
+			int changed = 0;
+			for (int o = 0; o < orderings; o++) {
+				int di = (o & 1) ? -1 : 1;
+				int dj = (o & 2) ? -1 : 1;
+				int dk = (o & 4) ? -1 : 1;
+				sweep++;
+				for (std::vector<int>& d : diagonal) {
+					d.clear();
+				}
+				for (int b = 0; b < N; b++) {
+					int3 c = bricks[b];
+					int latest = lastChanged[b];
+					for (int n = 0; n < 6; n++) {
+						int3 nc = c;
+						nc[n / 2] += (n % 2 == 0) ? -1 : 1;
+						if (nc[n / 2] < 0 || nc[n / 2] >= brickCount[n / 2])
+							continue;
+						int nb = brickTable[nc.x + (nc.y + nc.z * brickCount.y) * brickCount.x];
+						if (nb >= 0)
+							latest = std::max(latest, lastChanged[nb]);
+					}
+					if (latest < sweep - orderings)
+						continue;
+					int d = ((di > 0) ? c.x : brickCount.x - 1 - c.x)
+							+ ((dj > 0) ? c.y : brickCount.y - 1 - c.y)
+							+ ((dk > 0) ? c.z : brickCount.z - 1 - c.z);
+					diagonal[d].push_back(b);
+				}
+				for (const std::vector<int>& d : diagonal) {
+					int count = (int) d.size();
+#pragma omp parallel for reduction(+:changed)
+					for (int n = 0; n < count; n++) {
+						if (sweepBrick(d[n], di, dj, dk)) {
+							lastChanged[d[n]] = sweep;
+							changed = 1;
+						}
+					}
+				}
+			}
+			if (!changed)
+				break;
+		}
+	}
+	void copyTo(float1* out) const {
+		const Source& src = *vol;
+#pragma omp parallel for
+		for (int k = 0; k < slices; k++) {
+			for (int j = 0; j < cols; j++) {
+				for (int i = 0; i < rows; i++) {
+					int8_t s;
+					float d = value(i, j, k, s);
+					if (s == 0)
+						s = (int8_t) aly::sign(src(i, j, k));
+					out[i + (size_t) j * rows + k * sliceSize].x = s * std::min(d, maxDistance);
+				}
+			}
+		}
+	}
+	//Leaves of the input and the solved bricks become leaves of the output. Voxels closer than maxDistance are active.
+	//Everything else keeps the sign of the input at maxDistance and is pruned back to tiles.
+	void copyTo(const SparseVolume1f& in, SparseVolume1f& out) const {
+		const int L = SparseVolume1f::LEAF_SIZE;
+		const float bg = in.getBackground().x;
+		out = SparseVolume1f(rows, cols, slices, float1((bg < 0) ? -maxDistance : maxDistance));
+		in.forEachTile([&](const int3& origin, const float1& value) {
+			out.setTile(origin.x, origin.y, origin.z, float1((value.x < 0) ? -maxDistance : maxDistance));
+		});
+		for (size_t n = 0; n < in.leafCount(); n++) {
+			const int3& origin = in.getLeaf(n).origin;
+			out.touchLeaf(origin.x, origin.y, origin.z);
+		}
+		for (const int3& b : bricks) {
+			int3 lo = b * brickDim;
+			int3 hi = aly::minVec(lo + brickDim, int3(rows, cols, slices));
+			for (int k = lo.z; k < hi.z; k += L) {
+				for (int j = lo.y; j < hi.y; j += L) {
+					for (int i = lo.x; i < hi.x; i += L) {
+						out.touchLeaf(i, j, k);
+					}
+				}
+			}
+		}
+		const int N = (int) out.leafCount();
+#pragma omp parallel for
+		for (int n = 0; n < N; n++) {
+			SparseVolume1f::Leaf& leaf = out.getLeaf(n);
+			SparseVolume1f::ConstAccessor src = in.getConstAccessor();
+			int3 hi = aly::minVec(leaf.origin + int3(L), int3(rows, cols, slices));
+			for (int k = leaf.origin.z; k < hi.z; k++) {
+				for (int j = leaf.origin.y; j < hi.y; j++) {
+					for (int i = leaf.origin.x; i < hi.x; i++) {
+						int8_t s;
+						float d = value(i, j, k, s);
+						if (s == 0)
+							s = (int8_t) aly::sign(src.getValue(i, j, k).x);
+						int off = SparseVolume1f::leafOffset(i, j, k);
+						leaf.values[off].x = s * std::min(d, maxDistance);
+						leaf.active[off] = (d < maxDistance);
+					}
+				}
+			}
+		}
+		out.prune();
+	}
+};
 void DistanceField3f::solve(const Volume1f& vol, Volume1f& distVol,
 		float maxDistance) {
 	const int rows = vol.rows;
 	const int cols = vol.cols;
 	const int slices = vol.slices;
+	if (method != DistanceFieldMethod::FastMarching) {
+		distVol.resize(rows, cols, slices);
+		DenseLevelSet src(vol.data.data(), rows, cols, slices);
+		LevelSetSweeper<DenseLevelSet> sweeper;
+		sweeper.solve(src, maxDistance, method == DistanceFieldMethod::NarrowBand);
+		sweeper.copyTo(distVol.data.data());
+		return;
+	}
 	BinaryMinHeap<float, 3> heap(vol.dimensions());
 	distVol.resize(rows, cols, slices);
 	distVol.set(float1(DISTANCE_UNDEFINED));
@@ -416,6 +893,13 @@ void DistanceField3f::solve(const Volume1f& vol, Volume1f& distVol,
 	heap.clear();
 }
 
+void DistanceField3f::solve(const SparseVolume1f& vol, SparseVolume1f& distVol,
+		float maxDistance) {
+	SparseLevelSet src(vol);
+	LevelSetSweeper<SparseLevelSet> sweeper;
+	sweeper.solve(src, maxDistance, true);
+	sweeper.copyTo(vol, distVol);
+}
 float DistanceField2f::march(float IMv, float IPv, float JMv, float JPv,
 		int IMl, int IPl, int JMl, int JPl) {
 	double s, s2;
@@ -459,6 +943,14 @@ void DistanceField2f::solve(const Image1f& vol, Image1f& distVol,
 		float maxDistance) {
 	const int width = vol.width;
 	const int height = vol.height;
+	if (method != DistanceFieldMethod::FastMarching) {
+		distVol.resize(width, height);
+		DenseLevelSet src(vol.data.data(), width, height, 1);
+		LevelSetSweeper<DenseLevelSet> sweeper;
+		sweeper.solve(src, maxDistance, method == DistanceFieldMethod::NarrowBand);
+		sweeper.copyTo(distVol.data.data());
+		return;
+	}
 	BinaryMinHeap<float, 2> heap(vol.dimensions());
 	distVol.resize(width, height);
 	distVol.set(float1(DISTANCE_UNDEFINED));
@@ -707,4 +1199,276 @@ void DistanceField2f::solve(const Image1f& vol, Image1f& distVol,
 	}
 	heap.clear();
 }
+
+/*
+ Bridson, R. SDFGen. Orientation test with consistent tie breaking, so a point on an edge shared by two triangles
+ is counted by exactly one of them.
+ */
+static int MeshDistanceOrientation(double x1, double y1, double x2, double y2,
+		double& twiceSignedArea) {
+	twiceSignedArea = y1 * x2 - x1 * y2;
+	if (twiceSignedArea > 0)
+		return 1;
+	else if (twiceSignedArea < 0)
+		return -1;
+	else if (y2 > y1)
+		return 1;
+	else if (y2 < y1)
+		return -1;
+	else if (x1 > x2)
+		return 1;
+	else if (x1 < x2)
+		return -1;
+	else
+		return 0;
+}
+static bool MeshDistancePointInTriangle(double x0, double y0, double x1,
+		double y1, double x2, double y2, double x3, double y3, double& a,
+		double& b, double& c) {
+	x1 -= x0;
+	x2 -= x0;
+	x3 -= x0;
+	y1 -= y0;
+	y2 -= y0;
+	y3 -= y0;
+	int signa = MeshDistanceOrientation(x2, y2, x3, y3, a);
+	if (signa == 0)
+		return false;
+	int signb = MeshDistanceOrientation(x3, y3, x1, y1, b);
+	if (signb != signa)
+		return false;
+	int signc = MeshDistanceOrientation(x1, y1, x2, y2, c);
+	if (signc != signa)
+		return false;
+	double sum = a + b + c;
+	if (sum == 0)
+		return false;
+	a /= sum;
+	b /= sum;
+	c /= sum;
+	return true;
+}
+void MeshToSignedDistanceVolume::solve(const Mesh& mesh, const box3f& bbox,
+		float voxelSize, Volume1f& out, float maxDistance) {
+	if (voxelSize <= 0.0f)
+		throw std::runtime_error(
+				MakeString() << "Voxel size must be positive. " << voxelSize);
+	if (brickSize <= 0)
+		throw std::runtime_error(
+				MakeString() << "Brick size must be positive. " << brickSize);
+	const int rows = std::max(1, (int) std::ceil(bbox.dimensions.x / voxelSize));
+	const int cols = std::max(1, (int) std::ceil(bbox.dimensions.y / voxelSize));
+	const int slices = std::max(1,
+			(int) std::ceil(bbox.dimensions.z / voxelSize));
+	const size_t sliceSize = (size_t) rows * cols;
+	out.resize(rows, cols, slices);
+	out.set(float1(std::numeric_limits<float>::max()));
+	//Triangles in voxel coordinates, where voxel (i,j,k) is centered at (i,j,k).
+	std::vector<float3> tris;
+	tris.reserve(3 * (mesh.triIndexes.size() + 2 * mesh.quadIndexes.size()));
+	auto toVoxel = [=](const float3& pt) {
+		return (pt - bbox.position) / voxelSize - float3(0.5f);
+	};
+	for (const uint3& face : mesh.triIndexes.data) {
+		tris.push_back(toVoxel(mesh.vertexLocations[face.x]));
+		tris.push_back(toVoxel(mesh.vertexLocations[face.y]));
+		tris.push_back(toVoxel(mesh.vertexLocations[face.z]));
+	}
+	for (const uint4& face : mesh.quadIndexes.data) {
+		float3 pt1 = toVoxel(mesh.vertexLocations[face.x]);
+		float3 pt2 = toVoxel(mesh.vertexLocations[face.y]);
+		float3 pt3 = toVoxel(mesh.vertexLocations[face.z]);
+		float3 pt4 = toVoxel(mesh.vertexLocations[face.w]);
+		if (distanceSqr(pt1, pt3) < distanceSqr(pt2, pt4)) {
+			tris.insert(tris.end(), { pt1, pt2, pt3, pt3, pt4, pt1 });
+		} else {
+			tris.insert(tris.end(), { pt1, pt2, pt4, pt4, pt2, pt3 });
+		}
+	}
+	const int T = (int) (tris.size() / 3);
+	const float band = std::min((float) bandWidth, maxDistance);
+	//Voxels outside the band are only computed if they can be closer than maxDistance.
+	const bool sweep = (maxDistance > band);
+	std::vector<int> closest;
+	if (sweep)
+		closest.assign(out.size(), -1);
+
+	//Bin triangles into the bricks they touch after dilation by the band.
+	const int B = brickSize;
+	const int3 bricks((rows + B - 1) / B, (cols + B - 1) / B,
+			(slices + B - 1) / B);
+	const int brickCount = bricks.x * bricks.y * bricks.z;
+	std::vector<std::vector<int>> brickTriangles(brickCount);
+	std::vector<int3> lo(T), hi(T);
+	const int3 maxVoxel(rows - 1, cols - 1, slices - 1);
+	for (int t = 0; t < T; t++) {
+		float3 minPt = aly::minVec(aly::minVec(tris[3 * t], tris[3 * t + 1]),
+				tris[3 * t + 2]);
+		float3 maxPt = aly::maxVec(aly::maxVec(tris[3 * t], tris[3 * t + 1]),
+				tris[3 * t + 2]);
+		bool inside = true;
+		for (int c = 0; c < 3; c++) {
+			lo[t][c] = (int) std::ceil(minPt[c] - band);
+			hi[t][c] = (int) std::floor(maxPt[c] + band);
+			inside &= (lo[t][c] <= maxVoxel[c] && hi[t][c] >= 0);
+			lo[t][c] = aly::clamp(lo[t][c], 0, maxVoxel[c]);
+			hi[t][c] = aly::clamp(hi[t][c], 0, maxVoxel[c]);
+		}
+		if (!inside)
+			continue;
+		for (int bk = lo[t].z / B; bk <= hi[t].z / B; bk++) {
+			for (int bj = lo[t].y / B; bj <= hi[t].y / B; bj++) {
+				for (int bi = lo[t].x / B; bi <= hi[t].x / B; bi++) {
+					brickTriangles[bi + (bj + bk * bricks.y) * bricks.x].push_back(t);
+				}
+			}
+		}
+	}
+	//Exact distances in the band, one brick per task so updates stay in cache.
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < brickCount; b++) {
+		int3 blo = B
+				* int3(b % bricks.x, (b / bricks.x) % bricks.y,
+						b / (bricks.x * bricks.y));
+		int3 bhi = aly::minVec(blo + int3(B - 1), maxVoxel);
+		float3 lastPoint;
+		for (int t : brickTriangles[b]) {
+			const float3& p1 = tris[3 * t];
+			const float3& p2 = tris[3 * t + 1];
+			const float3& p3 = tris[3 * t + 2];
+			int3 vlo = aly::maxVec(lo[t], blo);
+			int3 vhi = aly::minVec(hi[t], bhi);
+			for (int k = vlo.z; k <= vhi.z; k++) {
+				for (int j = vlo.y; j <= vhi.y; j++) {
+					size_t offset = k * sliceSize + (size_t) j * rows;
+					for (int i = vlo.x; i <= vhi.x; i++) {
+						float d = (float) KDTriangle::distance(
+								float3((float) i, (float) j, (float) k), p1, p2, p3,
+								lastPoint);
+						float& val = out.data[offset + i].x;
+						if (d < val) {
+							val = d;
+							if (sweep)
+								closest[offset + i] = t;
+						}
+					}
+				}
+			}
+		}
+	}
+	if (sweep) {
+		//Fast sweeping of closest triangles, one axis at a time so lines can be processed in parallel.
+		auto relax = [&](size_t idx, size_t nbr, int i, int j, int k) {
+			int t = closest[nbr];
+			if (t < 0 || t == closest[idx])
+				return;
+			float& val = out.data[idx].x;
+			//Neighbors are one voxel apart, so the candidate is at least this far away.
+			if (out.data[nbr].x - 1.0f >= std::min(val, maxDistance))
+				return;
+			float3 lastPoint;
+			float d = (float) KDTriangle::distance(
+					float3((float) i, (float) j, (float) k), tris[3 * t],
+					tris[3 * t + 1], tris[3 * t + 2], lastPoint);
+			if (d < val) {
+				val = d;
+				closest[idx] = t;
+			}
+		};
+		for (int iter = 0; iter < 2; iter++) {
+#pragma omp parallel for
+			for (int line = 0; line < cols * slices; line++) {
+				int j = line % cols;
+				int k = line / cols;
+				size_t offset = (size_t) line * rows;
+				for (int i = 1; i < rows; i++) {
+					relax(offset + i, offset + i - 1, i, j, k);
+				}
+				for (int i = rows - 2; i >= 0; i--) {
+					relax(offset + i, offset + i + 1, i, j, k);
+				}
+			}
+#pragma omp parallel for
+			for (int k = 0; k < slices; k++) {
+				for (int j = 1; j < cols; j++) {
+					size_t offset = k * sliceSize + (size_t) j * rows;
+					for (int i = 0; i < rows; i++) {
+						relax(offset + i, offset + i - rows, i, j, k);
+					}
+				}
+				for (int j = cols - 2; j >= 0; j--) {
+					size_t offset = k * sliceSize + (size_t) j * rows;
+					for (int i = 0; i < rows; i++) {
+						relax(offset + i, offset + i + rows, i, j, k);
+					}
+				}
+			}
+#pragma omp parallel for
+			for (int j = 0; j < cols; j++) {
+				for (int k = 1; k < slices; k++) {
+					size_t offset = k * sliceSize + (size_t) j * rows;
+					for (int i = 0; i < rows; i++) {
+						relax(offset + i, offset + i - sliceSize, i, j, k);
+					}
+				}
+				for (int k = slices - 2; k >= 0; k--) {
+					size_t offset = k * sliceSize + (size_t) j * rows;
+					for (int i = 0; i < rows; i++) {
+						relax(offset + i, offset + i + sliceSize, i, j, k);
+					}
+				}
+			}
+		}
+	}
+	//Sign from the parity of surface crossings along +x through voxel centers.
+	std::vector<std::vector<int>> sliceTriangles(slices);
+	for (int t = 0; t < T; t++) {
+		float3 minPt = aly::minVec(aly::minVec(tris[3 * t], tris[3 * t + 1]),
+				tris[3 * t + 2]);
+		float3 maxPt = aly::maxVec(aly::maxVec(tris[3 * t], tris[3 * t + 1]),
+				tris[3 * t + 2]);
+		int k0 = std::max((int) std::ceil(minPt.z), 0);
+		int k1 = std::min((int) std::floor(maxPt.z), slices - 1);
+		for (int k = k0; k <= k1; k++) {
+			sliceTriangles[k].push_back(t);
+		}
+	}
+#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < slices; k++) {
+		std::vector<int> crossings(sliceSize, 0);
+		double a, b, c;
+		for (int t : sliceTriangles[k]) {
+			const float3& p1 = tris[3 * t];
+			const float3& p2 = tris[3 * t + 1];
+			const float3& p3 = tris[3 * t + 2];
+			int j0 = std::max(
+					(int) std::ceil(std::min(std::min(p1.y, p2.y), p3.y)), 0);
+			int j1 = std::min(
+					(int) std::floor(std::max(std::max(p1.y, p2.y), p3.y)),
+					cols - 1);
+			for (int j = j0; j <= j1; j++) {
+				if (MeshDistancePointInTriangle(j, k, p1.y, p1.z, p2.y, p2.z,
+						p3.y, p3.z, a, b, c)) {
+					double x = a * p1.x + b * p2.x + c * p3.x;
+					int i = std::max((int) std::ceil(x), 0);
+					if (i < rows) {
+						crossings[i + (size_t) j * rows]++;
+					}
+				}
+			}
+		}
+		for (int j = 0; j < cols; j++) {
+			size_t offset = k * sliceSize + (size_t) j * rows;
+			int count = 0;
+			for (int i = 0; i < rows; i++) {
+				count += crossings[i + (size_t) j * rows];
+				float& val = out.data[offset + i].x;
+				val = std::min(val, maxDistance);
+				if (count % 2 == 1) {
+					val = -val;
+				}
+			}
+		}
+	}
+}
 }
@@ -30,6 +30,7 @@
 #include <ios>
 #include <list>
 #include <queue>
+#include <cstring>
 #include "stdint.h"
 #include "AlloyFileUtil.h"
 #include "AlloyCommon.h"
@@ -61,6 +62,9 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <pwd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 #include "AlloyFilesystem.h"
 
@@ -257,6 +261,306 @@ void WriteBinaryFile(const std::string& str, const char* data, size_t elements)
 	} else
 		throw runtime_error(MakeString() << "Could not write " << str);
 }
+MemoryMappedFile::MemoryMappedFile() :
+		ptr(nullptr), length(0),
+#ifdef ALY_WINDOWS
+		fileHandle(INVALID_HANDLE_VALUE), mapHandle(NULL) {
+#else
+		fileDescriptor(-1) {
+#endif
+}
+MemoryMappedFile::MemoryMappedFile(const std::string& file) :
+		MemoryMappedFile() {
+	open(file);
+}
+MemoryMappedFile::~MemoryMappedFile() {
+	close();
+}
+void MemoryMappedFile::open(const std::string& file) {
+	close();
+#ifdef ALY_WINDOWS
+	fileHandle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		throw runtime_error(MakeString() << "Could not open " << file);
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	length = (size_t) fileSize.QuadPart;
+	if (length == 0)
+		return;
+	mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapHandle != NULL)
+		ptr = (const char*) MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	fileDescriptor = ::open(file.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		throw runtime_error(MakeString() << "Could not open " << file);
+	struct stat st;
+	fstat(fileDescriptor, &st);
+	length = (size_t) st.st_size;
+	if (length == 0)
+		return;
+	void* addr = mmap(NULL, length, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	if (addr != MAP_FAILED) {
+		madvise(addr, length, MADV_SEQUENTIAL);
+		ptr = (const char*) addr;
+	}
+#endif
+	if (ptr == nullptr) {
+		close();
+		throw runtime_error(MakeString() << "Could not map " << file << " into memory.");
+	}
+}
+void MemoryMappedFile::close() {
+#ifdef ALY_WINDOWS
+	if (ptr != nullptr)
+		UnmapViewOfFile(ptr);
+	if (mapHandle != NULL)
+		CloseHandle(mapHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+	mapHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (ptr != nullptr)
+		munmap((void*) ptr, length);
+	if (fileDescriptor >= 0)
+		::close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	ptr = nullptr;
+	length = 0;
+}
+static const uint64_t XXH_PRIME1 = 11400714785074694791ULL;
+static const uint64_t XXH_PRIME2 = 14029467366897019727ULL;
+static const uint64_t XXH_PRIME3 = 1609587929392839161ULL;
+static const uint64_t XXH_PRIME4 = 9650029242287828579ULL;
+static const uint64_t XXH_PRIME5 = 2870177450012600261ULL;
+static inline uint64_t XXHRotate(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+static inline uint64_t XXHRead64(const uint8_t* ptr) {
+	uint64_t val;
+	std::memcpy(&val, ptr, sizeof(uint64_t));
+	return val;
+}
+static inline uint64_t XXHRound(uint64_t acc, uint64_t input) {
+	acc += input * XXH_PRIME2;
+	return XXHRotate(acc, 31) * XXH_PRIME1;
+}
+static inline uint64_t XXHMerge(uint64_t h, uint64_t acc) {
+	h ^= XXHRound(0, acc);
+	return h * XXH_PRIME1 + XXH_PRIME4;
+}
+void XXHash64::reset(uint64_t seed) {
+	this->seed = seed;
+	acc[0] = seed + XXH_PRIME1 + XXH_PRIME2;
+	acc[1] = seed + XXH_PRIME2;
+	acc[2] = seed;
+	acc[3] = seed - XXH_PRIME1;
+	totalLength = 0;
+	bufferSize = 0;
+}
+void XXHash64::update(const void* data, size_t size) {
+	const uint8_t* ptr = (const uint8_t*) data;
+	const uint8_t* end = ptr + size;
+	totalLength += size;
+	if (bufferSize + size < 32) {
+		std::memcpy(buffer + bufferSize, ptr, size);
+		bufferSize += size;
+		return;
+	}
+	if (bufferSize > 0) {
+		size_t fill = 32 - bufferSize;
+		std::memcpy(buffer + bufferSize, ptr, fill);
+		for (int i = 0; i < 4; i++) {
+			acc[i] = XXHRound(acc[i], XXHRead64(buffer + 8 * i));
+		}
+		ptr += fill;
+		bufferSize = 0;
+	}
+	uint64_t v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+	while (end - ptr >= 32) {
+		v1 = XXHRound(v1, XXHRead64(ptr));
+		v2 = XXHRound(v2, XXHRead64(ptr + 8));
+		v3 = XXHRound(v3, XXHRead64(ptr + 16));
+		v4 = XXHRound(v4, XXHRead64(ptr + 24));
+		ptr += 32;
+	}
+	acc[0] = v1;
+	acc[1] = v2;
+	acc[2] = v3;
+	acc[3] = v4;
+	bufferSize = (size_t) (end - ptr);
+	std::memcpy(buffer, ptr, bufferSize);
+}
+uint64_t XXHash64::final() const {
+	uint64_t h;
+	if (totalLength >= 32) {
+		h = XXHRotate(acc[0], 1) + XXHRotate(acc[1], 7) + XXHRotate(acc[2], 12) + XXHRotate(acc[3], 18);
+		for (int i = 0; i < 4; i++) {
+			h = XXHMerge(h, acc[i]);
+		}
+	} else {
+		h = seed + XXH_PRIME5;
+	}
+	h += totalLength;
+	const uint8_t* ptr = buffer;
+	const uint8_t* end = buffer + bufferSize;
+	while (end - ptr >= 8) {
+		h ^= XXHRound(0, XXHRead64(ptr));
+		h = XXHRotate(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+		ptr += 8;
+	}
+	if (end - ptr >= 4) {
+		uint32_t val;
+		std::memcpy(&val, ptr, sizeof(uint32_t));
+		h ^= (uint64_t) val * XXH_PRIME1;
+		h = XXHRotate(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+		ptr += 4;
+	}
+	while (ptr < end) {
+		h ^= (*ptr) * XXH_PRIME5;
+		h = XXHRotate(h, 11) * XXH_PRIME1;
+		ptr++;
+	}
+	h ^= h >> 33;
+	h *= XXH_PRIME2;
+	h ^= h >> 29;
+	h *= XXH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+uint64_t XXHash64::hash(const void* data, size_t size, uint64_t seed) {
+	XXHash64 state(seed);
+	state.update(data, size);
+	return state.final();
+}
+Hasher::Hasher(HashMethod method) :
+		method(method) {
+	init();
+}
+void Hasher::init() {
+	switch (method) {
+	case HashMethod::SHA1:
+		sha1State = SHA1();
+		break;
+	case HashMethod::SHA224:
+		sha224_init(&sha256State);
+		break;
+	case HashMethod::SHA256:
+		sha256_init(&sha256State);
+		break;
+	case HashMethod::SHA384:
+		sha384_init(&sha512State);
+		break;
+	case HashMethod::SHA512:
+		sha512_init(&sha512State);
+		break;
+	case HashMethod::XXH64:
+		xxhState.reset();
+		break;
+	}
+}
+void Hasher::update(const void* data, size_t size) {
+	//The SHA-2 block loop indexes with int, so large buffers are fed in pieces.
+	const size_t PIECE = (size_t) 1 << 30;
+	const unsigned char* ptr = (const unsigned char*) data;
+	while (size > 0) {
+		size_t length = std::min(size, PIECE);
+		switch (method) {
+		case HashMethod::SHA1:
+			sha1State.update(ptr, length);
+			break;
+		case HashMethod::SHA224:
+			sha224_update(&sha256State, ptr, length);
+			break;
+		case HashMethod::SHA256:
+			sha256_update(&sha256State, ptr, length);
+			break;
+		case HashMethod::SHA384:
+			sha384_update(&sha512State, ptr, length);
+			break;
+		case HashMethod::SHA512:
+			sha512_update(&sha512State, ptr, length);
+			break;
+		case HashMethod::XXH64:
+			xxhState.update(ptr, length);
+			break;
+		}
+		ptr += length;
+		size -= length;
+	}
+}
+std::vector<uint8_t> Hasher::final() {
+	std::vector<uint8_t> digest;
+	switch (method) {
+	case HashMethod::SHA1:
+		digest.resize(20);
+		sha1State.final(digest.data());
+		break;
+	case HashMethod::SHA224:
+		digest.resize(SHA224_DIGEST_SIZE);
+		sha224_final(&sha256State, digest.data());
+		break;
+	case HashMethod::SHA256:
+		digest.resize(SHA256_DIGEST_SIZE);
+		sha256_final(&sha256State, digest.data());
+		break;
+	case HashMethod::SHA384:
+		digest.resize(SHA384_DIGEST_SIZE);
+		sha384_final(&sha512State, digest.data());
+		break;
+	case HashMethod::SHA512:
+		digest.resize(SHA512_DIGEST_SIZE);
+		sha512_final(&sha512State, digest.data());
+		break;
+	case HashMethod::XXH64: {
+		uint64_t h = xxhState.final();
+		digest.resize(8);
+		for (int i = 0; i < 8; i++) {
+			digest[i] = (uint8_t) (h >> (56 - 8 * i));
+		}
+		break;
+	}
+	}
+	init();
+	return digest;
+}
+std::string EncodeHash(const std::vector<uint8_t>& digest, HashMethod method) {
+	if (method == HashMethod::SHA1 || method == HashMethod::XXH64) {
+		std::ostringstream result;
+		for (uint8_t b : digest) {
+			result << std::hex << std::setfill('0') << std::setw(2) << (int) b;
+		}
+		return result.str();
+	}
+	return EncodeBase64(digest, false);
+}
+std::string HashCode(const void* data, size_t size, HashMethod method) {
+	Hasher hasher(method);
+	hasher.update(data, size);
+	return EncodeHash(hasher.final(), method);
+}
+std::string TreeHashCode(const void* data, size_t size, HashMethod method, size_t leafSize) {
+	if (leafSize == 0 || size <= leafSize)
+		return HashCode(data, size, method);
+	const uint8_t* bytes = (const uint8_t*) data;
+	const int leaves = (int) ((size + leafSize - 1) / leafSize);
+	std::vector<std::vector<uint8_t>> digests(leaves);
+#pragma omp parallel for schedule(dynamic)
+	for (int l = 0; l < leaves; l++) {
+		size_t start = l * leafSize;
+		Hasher hasher(method);
+		hasher.update(bytes + start, std::min(leafSize, size - start));
+		digests[l] = hasher.final();
+	}
+	Hasher root(method);
+	for (const std::vector<uint8_t>& digest : digests) {
+		root.update(digest.data(), digest.size());
+	}
+	return EncodeHash(root.final(), method);
+}
 bool FileExists(const std::string& name) {
 	try {
 		return (filesystem::internal::exists(name));
@@ -36,6 +36,107 @@
 #endif
 
 namespace aly {
+size_t GetImageTypeSize(ImageType type) {
+	switch (type) {
+	case ImageType::BYTE:
+	case ImageType::UBYTE:
+		return 1;
+	case ImageType::SHORT:
+	case ImageType::USHORT:
+		return 2;
+	case ImageType::INT:
+	case ImageType::UINT:
+	case ImageType::FLOAT:
+		return 4;
+	case ImageType::DOUBLE:
+		return 8;
+	default:
+		return 0;
+	}
+}
+//Text between each <tag> and </tag> in order of appearance.
+static std::vector<std::string> GetXMLTagValues(const std::string& xml,
+		const std::string& tag) {
+	std::vector<std::string> values;
+	const std::string open = "<" + tag + ">";
+	const std::string close = "</" + tag + ">";
+	size_t pos = 0;
+	while ((pos = xml.find(open, pos)) != std::string::npos) {
+		pos += open.size();
+		size_t end = xml.find(close, pos);
+		if (end == std::string::npos)
+			break;
+		values.push_back(xml.substr(pos, end - pos));
+		pos = end + close.size();
+	}
+	return values;
+}
+RawImageHeader ReadRawImageHeader(const std::string& file) {
+	std::string xmlFile = GetFileWithoutExtension(file) + ".xml";
+	std::string xml = ReadTextFile(xmlFile);
+	RawImageHeader header;
+	std::vector<std::string> values = GetXMLTagValues(xml, "Data-type");
+	const std::string typeName = (values.size() > 0) ? values[0] : "";
+	if (typeName == "Byte") {
+		header.type = ImageType::BYTE;
+	} else if (typeName == "Unsigned Byte") {
+		header.type = ImageType::UBYTE;
+	} else if (typeName == "Short") {
+		header.type = ImageType::SHORT;
+	} else if (typeName == "Unsigned Short") {
+		header.type = ImageType::USHORT;
+	} else if (typeName == "Integer") {
+		header.type = ImageType::INT;
+	} else if (typeName == "Unsigned Integer") {
+		header.type = ImageType::UINT;
+	} else if (typeName == "Float") {
+		header.type = ImageType::FLOAT;
+	} else if (typeName == "Double") {
+		header.type = ImageType::DOUBLE;
+	} else {
+		throw std::runtime_error(
+				MakeString() << "Unsupported data type \"" << typeName << "\" in " << xmlFile);
+	}
+	for (const std::string& extent : GetXMLTagValues(xml, "Extents")) {
+		header.extents.push_back(std::stoi(extent));
+	}
+	if (header.extents.size() == 0) {
+		throw std::runtime_error(MakeString() << "No extents in " << xmlFile);
+	}
+	values = GetXMLTagValues(xml, "Image-offset");
+	if (values.size() > 0)
+		header.offset = (size_t) std::stoull(values[0]);
+	values = GetXMLTagValues(xml, "Endianess");
+	header.bigEndian = (values.size() > 0 && values[0] == "Big");
+	return header;
+}
+void MappedRawFile::open(const std::string& fileName) {
+	header = ReadRawImageHeader(fileName);
+	std::string rawFile = GetFileWithoutExtension(fileName) + ".raw";
+	file.open(rawFile);
+	size_t elements = 1;
+	for (int extent : header.extents) {
+		elements *= (size_t) extent;
+	}
+	if (file.size() < header.offset + elements * GetImageTypeSize(header.type)) {
+		file.close();
+		throw std::runtime_error(MakeString() << rawFile << " is truncated.");
+	}
+	payload = file.data() + header.offset;
+}
+void MappedRawFile::checkDirectAccess(ImageType type, size_t alignment) const {
+	if (header.type != type) {
+		throw std::runtime_error(
+				MakeString() << "Raw data type (" << header.type
+						<< ") does not match requested type (" << type << ").");
+	}
+	if (header.bigEndian) {
+		throw std::runtime_error("Big endian raw data cannot be accessed in place.");
+	}
+	if (((size_t) payload) % alignment != 0) {
+		throw std::runtime_error("Raw data offset is not aligned for in place access.");
+	}
+}
 void ConvertImage(const Image1f& in, ImageRGBAf& out) {
 	out.resize(in.width, in.height);
 	out.id = in.id;
@@ -2,6 +2,10 @@
 
 #include "AlloyImageFeatures.h"
 #include "AlloyImageProcessing.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ALY_DAISY_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace aly {
 	namespace daisy {
@@ -43,6 +47,88 @@ namespace aly {
 			y = (T2)(r * std::sin(t));
 		}
 
+		//Histograms are only a few floats long, so these are inlined rather than going through the dispatched SIMD kernels.
+		//out = (a * (1 - dx) + b * dx) * (1 - dy) + (c * (1 - dx) + d * dx) * dy
+		inline void BilinearHistogram(float* out, const float* a, const float* b, const float* c, const float* d, float dx, float dy, int n) {
+			int i = 0;
+#ifdef ALY_DAISY_SSE2
+			const __m128 wx0 = _mm_set1_ps(1.0f - dx), wx1 = _mm_set1_ps(dx);
+			const __m128 wy0 = _mm_set1_ps(1.0f - dy), wy1 = _mm_set1_ps(dy);
+			for (; i + 4 <= n; i += 4) {
+				__m128 top = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), wx0), _mm_mul_ps(_mm_loadu_ps(b + i), wx1));
+				__m128 bottom = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c + i), wx0), _mm_mul_ps(_mm_loadu_ps(d + i), wx1));
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(top, wy0), _mm_mul_ps(bottom, wy1)));
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = (a[i] * (1.0f - dx) + b[i] * dx) * (1.0f - dy) + (c[i] * (1.0f - dx) + d[i] * dx) * dy;
+			}
+		}
+		//out = (1 - alpha) * a + alpha * b
+		inline void LerpHistogram(float* out, const float* a, const float* b, float alpha, int n) {
+			int i = 0;
+#ifdef ALY_DAISY_SSE2
+			const __m128 w0 = _mm_set1_ps(1.0f - alpha), w1 = _mm_set1_ps(alpha);
+			for (; i + 4 <= n; i += 4) {
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), w0), _mm_mul_ps(_mm_loadu_ps(b + i), w1)));
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = (1.0f - alpha) * a[i] + alpha * b[i];
+			}
+		}
+		inline float SumOfSquares(const float* a, int n) {
+			int i = 0;
+			float sum = 0.0f;
+#ifdef ALY_DAISY_SSE2
+			__m128 acc = _mm_setzero_ps();
+			for (; i + 4 <= n; i += 4) {
+				__m128 v = _mm_loadu_ps(a + i);
+				acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+			}
+			float lanes[4];
+			_mm_storeu_ps(lanes, acc);
+			sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+			for (; i < n; i++) {
+				sum += a[i] * a[i];
+			}
+			return sum;
+		}
+		inline void ScaleHistogram(float* a, float scale, int n) {
+			int i = 0;
+#ifdef ALY_DAISY_SSE2
+			const __m128 s = _mm_set1_ps(scale);
+			for (; i + 4 <= n; i += 4) {
+				_mm_storeu_ps(a + i, _mm_mul_ps(_mm_loadu_ps(a + i), s));
+			}
+#endif
+			for (; i < n; i++) {
+				a[i] *= scale;
+			}
+		}
+		//Clamps values above the threshold and returns true if any were changed.
+		inline bool ClampHistogram(float* a, float threshold, int n) {
+			int i = 0;
+			bool changed = false;
+#ifdef ALY_DAISY_SSE2
+			const __m128 t = _mm_set1_ps(threshold);
+			for (; i + 4 <= n; i += 4) {
+				__m128 v = _mm_loadu_ps(a + i);
+				if (_mm_movemask_ps(_mm_cmpgt_ps(v, t)) != 0) {
+					changed = true;
+					_mm_storeu_ps(a + i, _mm_min_ps(v, t));
+				}
+			}
+#endif
+			for (; i < n; i++) {
+				if (a[i] > threshold) {
+					a[i] = threshold;
+					changed = true;
+				}
+			}
+			return changed;
+		}
 		void WriteLayeredImageToFile(const std::string& file, const LayeredImage& img) {
 			std::ostringstream vstr;
 			std::string fileName = GetFileWithoutExtension(file);
@@ -131,28 +217,28 @@ namespace aly {
 					fltr[x] /= sum;
 			}
 		}
+		//Accumulates one kernel tap at a time over a whole row, so the inner loops vectorize.
 		template<class T1, class T2> inline
-			void conv_buffer_(T1* buffer, T2* kernel, int rsize, int ksize)
+			void conv_buffer_(const T1* buffer, T1* out, T2* kernel, int rsize, int ksize)
 		{
 			for (int i = 0; i < rsize; i++)
+				out[i] = 0;
+			for (int j = 0; j < ksize; j++)
 			{
-				float sum = 0;
-				for (int j = 0; j < ksize; j++)
-				{
-					sum += buffer[i + j] * kernel[j];
-				}
-				buffer[i] = sum;
+				T2 k = kernel[j];
+				const T1* in = buffer + j;
+				for (int i = 0; i < rsize; i++)
+					out[i] += in[i] * k;
 			}
 		}
 		template<class T1, class T2> inline
 			void conv_horizontal(T1* image, int h, int w, T2 *kernel, int ksize)
 		{
 			int halfsize = ksize / 2;
-			assert(w + ksize < 4096);
-
-			T1  buffer[4096];
+#pragma omp parallel for
 			for (int r = 0; r < h; r++)
 			{
+				std::vector<T1> buffer(w + ksize);
 				int rw = r*w;
 
 				for (int i = 0; i < halfsize; i++)
@@ -164,39 +250,27 @@ namespace aly {
 				for (int i = 0; i < halfsize; i++)
 					buffer[i + halfsize + w] = temp;
 
-				conv_buffer_(buffer, kernel, w, ksize);
-
-				for (int c = 0; c < w; c++)
-					image[rw + c] = buffer[c];
+				conv_buffer_(buffer.data(), &image[rw], kernel, w, ksize);
 			}
 		}
-
+		//Rows are read whole instead of one column at a time.
 		template<class T1, class T2> inline
 			void conv_vertical(T1* image, int h, int w, T2 *kernel, int ksize)
 		{
-			T1  buffer[4096];
-
 			int halfsize = ksize / 2;
-			assert(h + ksize < 4096);
-
-			int h_1w = (h - 1)*w;
-
-			for (int c = 0; c < w; c++)
+			std::vector<T1> src(image, image + (size_t)h * w);
+#pragma omp parallel for
+			for (int r = 0; r < h; r++)
 			{
-				for (int i = 0; i < halfsize; i++)
-					buffer[i] = image[c];
-
-				for (int i = 0; i < h; i++)
-					buffer[halfsize + i] = image[i*w + c];
-
-				for (int i = 0; i < halfsize; i++)
-					buffer[halfsize + i + h] = image[h_1w + c];
-
-				conv_buffer_(buffer, kernel, h, ksize);
-
-				for (int r = 0; r < h; r++)
+				T1* out = image + (size_t)r * w;
+				for (int c = 0; c < w; c++)
+					out[c] = 0;
+				for (int j = 0; j < ksize; j++)
 				{
-					image[r*w + c] = buffer[r];
+					const T1* in = &src[(size_t)clamp(r + j - halfsize, 0, h - 1) * w];
+					T2 k = kernel[j];
+					for (int c = 0; c < w; c++)
+						out[c] += in[c] * k;
 				}
 			}
 		}
@@ -504,17 +578,12 @@ namespace aly {
 		}
 		void Daisy::computeHistograms()
 		{
-			std::vector<float> hist;
+			//Each cube takes the histograms of the next smoother cube, which is a copy of its layers.
 			for (int r = 0; r < cubeNumber; r++) {
 				LayeredImage& dst = smoothLayers[r];
-				LayeredImage& src = smoothLayers[r + 1];
-				for (int y = 0; y < image.height; y++) {
-					for (int x = 0; x < image.width; x++) {
-						computeHistogram(src, x, y, hist);
-						for (int i = 0; i < histogramBins; i++) {
-							dst[i](x, y) = hist[i];
-						}
-					}
+				const LayeredImage& src = smoothLayers[r + 1];
+				for (int i = 0; i < histogramBins; i++) {
+					dst[i] = src[i];
 				}
 			}
 		}
@@ -620,77 +689,58 @@ namespace aly {
 			//}
 		}
 		void Daisy::normalizeDescriptor(Descriptor& desc, Normalization nrm_type)
+		{
+			normalizeDescriptor(desc.data(), (int)desc.size(), nrm_type);
+		}
+		void Daisy::normalizePartial(Descriptor& desc) {
+			normalizePartial(desc.data());
+		}
+		void Daisy::normalizeFull(Descriptor& desc) {
+			normalizeFull(desc.data(), (int)desc.size());
+		}
+		void Daisy::normalizeSiftWay(Descriptor& desc) {
+			normalizeSiftWay(desc.data(), (int)desc.size());
+		}
+		void Daisy::normalizeDescriptor(float* desc, int size, Normalization nrm_type)
 		{
 			if (nrm_type == Normalization::Partial)
 				normalizePartial(desc);
 			else if (nrm_type == Normalization::Full)
-				normalizeFull(desc);
+				normalizeFull(desc, size);
 			else if (nrm_type == Normalization::Sift)
-				normalizeSiftWay(desc);
+				normalizeSiftWay(desc, size);
 		}
-
-		void Daisy::normalizePartial(Descriptor& desc) {
-			float norm;
+		void Daisy::normalizePartial(float* desc) {
 			for (int h = 0; h < numberOfGridPoints; h++)
 			{
-				norm = 0.0f;
-				for (int i = 0; i < histogramBins; i++) {
-					float val = desc[h*histogramBins + i];
-					norm += val*val;
-				}
+				float* hist = desc + h * histogramBins;
+				float norm = SumOfSquares(hist, histogramBins);
 				if (norm != 0.0) {
-					norm = std::sqrt(norm);
-					for (int i = 0; i < histogramBins; i++) {
-						desc[h*histogramBins + i] /= norm;
-					}
+					ScaleHistogram(hist, 1.0f / std::sqrt(norm), histogramBins);
 				}
 			}
 		}
-		void Daisy::normalizeFull(Descriptor& desc)
+		void Daisy::normalizeFull(float* desc, int size)
 		{
-			float norm = 0.0f;
-			for (int i = 0; i < (int)desc.size(); i++) {
-				float val = desc[i];
-				norm += val*val;
-			}
+			float norm = SumOfSquares(desc, size);
 			if (norm != 0.0) {
-				norm = std::sqrt(norm);
-				for (int i = 0; i < (int)desc.size(); i++) {
-					desc[i] /= norm;
-				}
+				ScaleHistogram(desc, 1.0f / std::sqrt(norm), size);
 			}
 		}
-		void Daisy::normalizeSiftWay(Descriptor& desc)
+		void Daisy::normalizeSiftWay(float* desc, int size)
 		{
 			bool changed = true;
 			int iter = 0;
-			float norm;
-			int h;
 			const int MAX_NORMALIZATION_ITER = 5;
 			const float m_descriptor_normalization_threshold = 0.154f; // sift magical number
 			while (changed && iter < MAX_NORMALIZATION_ITER)
 			{
 				iter++;
-				changed = false;
-				norm = 0.0f;
-				for (int i = 0; i < (int)desc.size(); i++) {
-					float val = desc[i];
-					norm += val*val;
-				}
-				norm = std::sqrt(norm);
+				float norm = std::sqrt(SumOfSquares(desc, size));
 				if (norm > 1e-5) {
-					for (int i = 0; i < (int)desc.size(); i++) {
-						desc[i] /= norm;
-					}
-				}
-				for (h = 0; h < (int)desc.size(); h++)
-				{
-					if (desc[h] > m_descriptor_normalization_threshold)
-					{
-						desc[h] = m_descriptor_normalization_threshold;
-						changed = true;
-					}
+					ScaleHistogram(desc, 1.0f / norm, size);
 				}
+				changed = ClampHistogram(desc, m_descriptor_normalization_threshold, size);
 			}
 		}
 		void Daisy::getUnnormalizedDescriptor(float x, float y, int orientation, Descriptor& descriptor, bool disableInterpolation)
@@ -721,9 +771,8 @@ namespace aly {
 			}
 			updateSelectedCubes();
 		}
-		void Daisy::getDescriptors(DescriptorField& descriptorField, Normalization  normalizationType, bool scaleInvariant, bool rotationInvariant, bool disableInterpolation) {
+		void Daisy::computeOrientationMap(Image1i& orientMap, bool scaleInvariant, bool rotationInvariant) {
 			Image1f scaleMap;
-			Image1i orientMap;
 			if (scaleInvariant) {
 				//Not really used
 				computeScales(scaleMap);
@@ -731,19 +780,15 @@ namespace aly {
 			if (rotationInvariant) {
 				computeOrientations(orientMap, scaleMap, scaleInvariant);
 			}
-			//d::cout << "Scale " << scaleMap << std::endl;
-			//WriteImageToRawFile(MakeString() << GetDesktopDirectory() << ALY_PATH_SEPARATOR << "scale.xml", scaleMap);
-
-			//std::cout << "Orient " << orientMap << std::endl;
-			//WriteImageToRawFile(MakeString() << GetDesktopDirectory() << ALY_PATH_SEPARATOR << "orient.xml", orientMap);
-
-			//std::cout << "Write Descriptor" << std::endl;
-			int orientation;
+		}
+		void Daisy::getDescriptors(DescriptorField& descriptorField, Normalization  normalizationType, bool scaleInvariant, bool rotationInvariant, bool disableInterpolation) {
+			Image1i orientMap;
+			computeOrientationMap(orientMap, scaleInvariant, rotationInvariant);
 			descriptorField.resize(image.width, image.height);
 #pragma omp parallel for
 			for (int j = 0; j < image.height; j++) {
 				for (int i = 0; i < image.width; i++) {
-					orientation = 0;
+					int orientation = 0;
 					if (orientMap.size() > 0) orientation = orientMap(i, j).x;
 					if (!(orientation >= 0 && orientation < ORIENTATIONS)) orientation = 0;
 					getUnnormalizedDescriptor((float)i, (float)j, orientation, descriptorField(i, j), disableInterpolation);
@@ -751,6 +796,135 @@ namespace aly {
 				}
 			}
 		}
+		void Daisy::interleaveLayers(const LayeredImage& layers, std::vector<float>& out) {
+			const int N = (int)image.size();
+			out.resize((size_t)N * histogramBins);
+#pragma omp parallel for
+			for (int index = 0; index < N; index++) {
+				float* hist = &out[(size_t)index * histogramBins];
+				for (int h = 0; h < histogramBins; h++) {
+					hist[h] = layers[h][index];
+				}
+			}
+		}
+		//Same result as i_get_histogram, reading all orientation layers of a pixel with one contiguous load.
+		void Daisy::sampleHistogram(const float* cube, float x, float y, float shift, float* histogram, float* buffer) {
+			int ishift = (int)shift;
+			float fshift = shift - ishift;
+			bool blend = false;
+			if (fshift > 0.99f) {
+				ishift++;
+			}
+			else if (fshift >= 0.01f) {
+				blend = true;
+			}
+			int mnx = int(x);
+			int mny = int(y);
+			if (mnx >= image.width - 2 || mny >= image.height - 2) {
+				std::fill(histogram, histogram + histogramBins, 0.0f);
+				return;
+			}
+			float dx = x - mnx;
+			float dy = y - mny;
+			const float* p00 = cube + ((size_t)mny * image.width + mnx) * histogramBins;
+			const float* p10 = p00 + histogramBins;
+			const float* p01 = p00 + (size_t)image.width * histogramBins;
+			const float* p11 = p01 + histogramBins;
+			if (ishift == 0 && !blend) {
+				BilinearHistogram(histogram, p00, p10, p01, p11, dx, dy, histogramBins);
+				return;
+			}
+			//Two copies back to back turn the circular shift into an offset.
+			BilinearHistogram(buffer, p00, p10, p01, p11, dx, dy, histogramBins);
+			std::copy(buffer, buffer + histogramBins, buffer + histogramBins);
+			if (blend) {
+				LerpHistogram(histogram, buffer + ishift, buffer + ishift + 1, fshift, histogramBins);
+			}
+			else {
+				std::copy(buffer + ishift, buffer + ishift + histogramBins, histogram);
+			}
+		}
+		void Daisy::sampleNearestHistogram(const float* cube, int x, int y, int shift, float* histogram) {
+			const float* hist = cube + ((size_t)clamp(y, 0, image.height - 1) * image.width + clamp(x, 0, image.width - 1)) * histogramBins;
+			shift %= histogramBins;
+			std::copy(hist + shift, hist + histogramBins, histogram);
+			std::copy(hist, hist + shift, histogram + histogramBins - shift);
+		}
+		void Daisy::getDenseDescriptor(int x, int y, int orientation, const std::vector<const float*>& cubes, float* descriptor, float* buffer, bool disableInterpolation) {
+			const float shift = orientationShift[orientation];
+			const std::vector<float2>& grid = orientedGridPoints[orientation];
+			std::fill(descriptor, descriptor + descriptorSize, 0.0f);
+			if (disableInterpolation) {
+				int ishift = (int)shift;
+				if (shift - ishift > 0.5)ishift++;
+				sampleNearestHistogram(cubes[0], x, y, ishift, descriptor);
+				for (int r = 0; r < radiusBins; r++) {
+					int rdt = r * angleBins + 1;
+					for (int region = rdt; region < rdt + angleBins; region++) {
+						float xx = x + grid[region].x;
+						float yy = y + grid[region].y;
+						int iy = (int)yy;
+						if (yy - iy > 0.5)
+							iy++;
+						int ix = (int)xx;
+						if (xx - ix > 0.5)
+							ix++;
+						if (is_outside(ix, 0, image.width - 1, iy, 0, image.height - 1))
+							continue;
+						sampleNearestHistogram(cubes[r], ix, iy, ishift, descriptor + region * histogramBins);
+					}
+				}
+			}
+			else {
+				sampleHistogram(cubes[0], (float)x, (float)y, shift, descriptor, buffer);
+				for (int r = 0; r < radiusBins; r++) {
+					int rdt = r * angleBins + 1;
+					for (int region = rdt; region < rdt + angleBins; region++) {
+						float xx = x + grid[region].x;
+						float yy = y + grid[region].y;
+						if (is_outside(xx, 0, image.width - 1, yy, 0, image.height - 1))
+							continue;
+						sampleHistogram(cubes[r], xx, yy, shift, descriptor + region * histogramBins, buffer);
+					}
+				}
+			}
+		}
+		void Daisy::getDescriptors(DenseDescriptorField& descriptorField, Normalization  normalizationType, bool scaleInvariant, bool rotationInvariant, bool disableInterpolation) {
+			Image1i orientMap;
+			computeOrientationMap(orientMap, scaleInvariant, rotationInvariant);
+			std::vector<std::vector<float>> interleaved(smoothLayers.size());
+			std::vector<const float*> cubes(radiusBins);
+			for (int r = 0; r < radiusBins; r++) {
+				std::vector<float>& cube = interleaved[selectedCubes[r]];
+				if (cube.size() == 0) {
+					interleaveLayers(smoothLayers[selectedCubes[r]], cube);
+				}
+				cubes[r] = cube.data();
+			}
+			descriptorField.resize(image.width, image.height, descriptorSize);
+			//Square tiles keep the petals of neighboring descriptors in cache.
+			const int TILE_SIZE = 64;
+			const int tilesX = (image.width + TILE_SIZE - 1) / TILE_SIZE;
+			const int tilesY = (image.height + TILE_SIZE - 1) / TILE_SIZE;
+#pragma omp parallel for schedule(dynamic)
+			for (int t = 0; t < tilesX * tilesY; t++) {
+				std::vector<float> buffer(2 * histogramBins);
+				const int x0 = (t % tilesX) * TILE_SIZE;
+				const int y0 = (t / tilesX) * TILE_SIZE;
+				const int x1 = std::min(x0 + TILE_SIZE, image.width);
+				const int y1 = std::min(y0 + TILE_SIZE, image.height);
+				for (int j = y0; j < y1; j++) {
+					for (int i = x0; i < x1; i++) {
+						int orientation = 0;
+						if (orientMap.size() > 0) orientation = orientMap(i, j).x;
+						if (!(orientation >= 0 && orientation < ORIENTATIONS)) orientation = 0;
+						float* descriptor = descriptorField(i, j);
+						getDenseDescriptor(i, j, orientation, cubes, descriptor, buffer.data(), disableInterpolation);
+						normalizeDescriptor(descriptor, descriptorSize, normalizationType);
+					}
+				}
+			}
+		}
 		void Daisy::computeOrientedGridPoints() {
 			for (int i = 0; i < ORIENTATIONS; i++) {
 				float angle = -i*2.0f*ALY_PI / ORIENTATIONS;
@@ -57,6 +57,11 @@
 
 #include <AlloyIntersector.h>
 #include "AlloyMesh.h"
+#include "AlloySIMD.h"
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ALY_INTERSECTOR_SSE
+#include <emmintrin.h>
+#endif
 
 #include <list>
 #include <queue>
@@ -713,9 +718,10 @@ float3 KDTriangle::intersectionPointRay(const float3& org,
 	return NO_HIT_POINT;
 }
 double KDTriangle::distance(const float3& p, float3& lastIntersect) const {
-	float3 p1 = pts[0];
-	float3 p2 = pts[1];
-	float3 p3 = pts[2];
+	return distance(p, pts[0], pts[1], pts[2], lastIntersect);
+}
+double KDTriangle::distance(const float3& p, const float3& p1, const float3& p2,
+		const float3& p3, float3& lastIntersect) {
 	float3 kDiff = (p1 - p);
 	float3 kEdge0 = (p2 - p1);
 	float3 kEdge1 = (p3 - p1);
@@ -887,10 +893,159 @@ double KDTriangle::distance(const float3& p, float3& lastIntersect) const {
 	if (fSqrDistance < (float) 0.0) {
 		fSqrDistance = (float) 0.0;
 	}
-	lastIntersect = pts[0] + kEdge0 * (float) fS + kEdge1 * (float) fT;
+	lastIntersect = p1 + kEdge0 * (float) fS + kEdge1 * (float) fT;
 	return std::sqrt(fSqrDistance);
 }
+struct BVHPrimitive {
+	float3 minPoint;
+	float3 maxPoint;
+	float3 centroid;
+	int index;
+};
+struct BVHBin {
+	float3 minPoint;
+	float3 maxPoint;
+	int count;
+	BVHBin() :
+			minPoint(1E30f), maxPoint(-1E30f), count(0) {
+	}
+};
+static const int BVH_BINS = 16;
+static double BVHHalfArea(const float3& minPoint, const float3& maxPoint) {
+	float3 d = maxPoint - minPoint;
+	if (d.x < 0 || d.y < 0 || d.z < 0)
+		return 0.0;
+	return (double) d.x * d.y + (double) d.y * d.z + (double) d.z * d.x;
+}
+static int BVHBinIndex(const BVHPrimitive& prim, int axis, float minC,
+		float scale) {
+	return aly::clamp((int) ((prim.centroid[axis] - minC) * scale), 0,
+			BVH_BINS - 1);
+}
+//Binned SAH build in depth-first order, so the first child of each interior node is the next node in the array.
+static void BuildBVHNode(std::vector<BVHNode>& nodes,
+		std::vector<BVHPrimitive>& prims, int start, int end, int depth,
+		double traversalCost, double intersectCost) {
+	int nodeIndex = (int) nodes.size();
+	nodes.push_back(BVHNode());
+	float3 minPoint(1E30f), maxPoint(-1E30f);
+	float3 minC(1E30f), maxC(-1E30f);
+	for (int i = start; i < end; i++) {
+		minPoint = aly::minVec(minPoint, prims[i].minPoint);
+		maxPoint = aly::maxVec(maxPoint, prims[i].maxPoint);
+		minC = aly::minVec(minC, prims[i].centroid);
+		maxC = aly::maxVec(maxC, prims[i].centroid);
+	}
+	nodes[nodeIndex].minPoint = minPoint;
+	nodes[nodeIndex].maxPoint = maxPoint;
+	int count = end - start;
+	if (count <= Intersector::MAX_LEAF_SIZE) {
+		nodes[nodeIndex].offset = start;
+		nodes[nodeIndex].count = (uint16_t) count;
+		nodes[nodeIndex].axis = 0;
+		return;
+	}
+	float3 extent = maxC - minC;
+	int axis = 0;
+	if (extent.y > extent.x && extent.y >= extent.z) {
+		axis = 1;
+	} else if (extent.z > extent.x && extent.z > extent.y) {
+		axis = 2;
+	}
+	int mid = -1;
+	//Deep nodes fall back to median splits so traversal stacks stay bounded.
+	if (extent[axis] > 0 && depth < Intersector::MAX_DEPTH / 2) {
+		float scale = BVH_BINS / extent[axis];
+		BVHBin bins[BVH_BINS];
+		for (int i = start; i < end; i++) {
+			BVHBin& bin = bins[BVHBinIndex(prims[i], axis, minC[axis], scale)];
+			bin.minPoint = aly::minVec(bin.minPoint, prims[i].minPoint);
+			bin.maxPoint = aly::maxVec(bin.maxPoint, prims[i].maxPoint);
+			bin.count++;
+		}
+		double rightArea[BVH_BINS];
+		int rightCount[BVH_BINS];
+		BVHBin acc;
+		for (int b = BVH_BINS - 1; b > 0; b--) {
+			acc.minPoint = aly::minVec(acc.minPoint, bins[b].minPoint);
+			acc.maxPoint = aly::maxVec(acc.maxPoint, bins[b].maxPoint);
+			acc.count += bins[b].count;
+			rightArea[b] = BVHHalfArea(acc.minPoint, acc.maxPoint);
+			rightCount[b] = acc.count;
+		}
+		double invArea = 1.0 / std::max(BVHHalfArea(minPoint, maxPoint), 1E-30);
+		double minCost = 1E300;
+		int bestBin = -1;
+		acc = BVHBin();
+		for (int b = 0; b < BVH_BINS - 1; b++) {
+			acc.minPoint = aly::minVec(acc.minPoint, bins[b].minPoint);
+			acc.maxPoint = aly::maxVec(acc.maxPoint, bins[b].maxPoint);
+			acc.count += bins[b].count;
+			if (acc.count == 0 || rightCount[b + 1] == 0)
+				continue;
+			double cost = traversalCost
+					+ intersectCost * invArea
+							* (acc.count * BVHHalfArea(acc.minPoint, acc.maxPoint)
+									+ rightCount[b + 1] * rightArea[b + 1]);
+			if (cost < minCost) {
+				minCost = cost;
+				bestBin = b;
+			}
+		}
+		if (bestBin >= 0) {
+			float minAxis = minC[axis];
+			BVHPrimitive* split = std::partition(&prims[start], &prims[0] + end,
+					[=](const BVHPrimitive& prim) {
+						return BVHBinIndex(prim, axis, minAxis, scale) <= bestBin;
+					});
+			mid = (int) (split - &prims[0]);
+		}
+	}
+	if (mid <= start || mid >= end) {
+		mid = (start + end) / 2;
+		std::nth_element(&prims[start], &prims[mid], &prims[0] + end,
+				[=](const BVHPrimitive& a, const BVHPrimitive& b) {
+					return (a.centroid[axis] < b.centroid[axis]);
+				});
+	}
+	BuildBVHNode(nodes, prims, start, mid, depth + 1, traversalCost,
+			intersectCost);
+	nodes[nodeIndex].offset = (int32_t) nodes.size();
+	nodes[nodeIndex].count = 0;
+	nodes[nodeIndex].axis = (uint16_t) axis;
+	BuildBVHNode(nodes, prims, mid, end, depth + 1, traversalCost,
+			intersectCost);
+}
+//Clips [tNear,tFar] to one slab. A zero direction component with the origin on a slab plane gives a NaN distance.
+//The ray then lies in that plane and passes the inside test on the origin, so the slab does not clip it.
+static inline void ClipBVHSlab(float minPoint, float maxPoint, float org,
+		float invDir, float& tNear, float& tFar) {
+	float t1 = (minPoint - org) * invDir;
+	float t2 = (maxPoint - org) * invDir;
+	if (std::isnan(t1) || std::isnan(t2))
+		return;
+	tNear = std::max(tNear, std::min(t1, t2));
+	tFar = std::min(tFar, std::max(t1, t2));
+}
+static inline bool IntersectBVHBox(const BVHNode& node, const float3& org,
+		const float3& invDir, float tMax) {
+	float tNear = -std::numeric_limits<float>::infinity();
+	float tFar = std::numeric_limits<float>::infinity();
+	ClipBVHSlab(node.minPoint.x, node.maxPoint.x, org.x, invDir.x, tNear, tFar);
+	ClipBVHSlab(node.minPoint.y, node.maxPoint.y, org.y, invDir.y, tNear, tFar);
+	ClipBVHSlab(node.minPoint.z, node.maxPoint.z, org.z, invDir.z, tNear, tFar);
+	//Pad the exit distance so round-off does not reject flat boxes.
+	tFar *= 1.0000004f;
+	return (tFar >= std::max(tNear, 0.0f) && tNear <= tMax);
+}
+static inline double BVHBoxDistanceSqr(const BVHNode& node, const float3& p) {
+	double dx = std::max(std::max(node.minPoint.x - p.x, p.x - node.maxPoint.x), 0.0f);
+	double dy = std::max(std::max(node.minPoint.y - p.y, p.y - node.maxPoint.y), 0.0f);
+	double dz = std::max(std::max(node.minPoint.z - p.z, p.z - node.maxPoint.z), 0.0f);
+	return dx * dx + dy * dy + dz * dz;
+}
 void Intersector::build(const Mesh& mesh, int maxDepth) {
+	reset();
 	root = std::shared_ptr<KDBox>(new KDBox());
 	uint64_t id = 0;
 	KDTriangle* tri;
@@ -931,250 +1086,196 @@ void Intersector::build(const Mesh& mesh, int maxDepth) {
 		id++;
 	}
 	root->update();
-	buildTree(maxDepth);
+	buildTree();
 }
-void Intersector::buildTree(int maxDepth) {
-	std::list<KDBox*> boxes;
-	boxes.push_back(root.get());
-	int sz;
-	int splitPos;
-	KDBox* leftChild;
-	KDBox* rightChild;
-	int depthCount = 0;
-	while (boxes.size() > 0) {
-		KDBox* box = boxes.front();
-		boxes.pop_front();
-		if (box->getDepth() > maxDepth)
-			continue;
-		if (box->getDepth() > depthCount) {
-			depthCount = box->getDepth();
-		}
-		std::vector<KDBox*>& children = box->getChildren();
-		if (children.size() < 2)
-			continue;
-		sz = (int) children.size() * 2;
-		std::vector<KDBoxEdge> edges;
-		splitPos = splitPosition(children, edges, box);
-		if (splitPos <= 0 || splitPos == sz - 1) {
-			continue;
-		}
-		storage.push_back(
-				std::shared_ptr<KDBox>(
-						leftChild = new KDBox(box->getDepth() + 1)));
-		storage.push_back(
-				std::shared_ptr<KDBox>(
-						rightChild = new KDBox(box->getDepth() + 1)));
-		std::vector<KDBox*>& lchildren = leftChild->getChildren();
-		std::vector<KDBox*>& rchildren = rightChild->getChildren();
-		for (int i = 0; i < splitPos; i++) {
-			if (edges[i].isMin()) {
-				edges[i].getBox()->setDepth(leftChild->getDepth() + 1);
-				lchildren.push_back(edges[i].getBox());
-
-			}
-		}
-		for (int i = splitPos + 1; i < sz; i++) {
-			if (!edges[i].isMin()) {
-				edges[i].getBox()->setDepth(rightChild->getDepth() + 1);
-				rchildren.push_back(edges[i].getBox());
-			}
-		}
-		if (lchildren.size() >= children.size()
-				|| rchildren.size() >= children.size()) {
-			continue;
+void Intersector::buildTree() {
+	std::vector<KDBox*>& children = root->getChildren();
+	int N = (int) children.size();
+	if (N == 0)
+		return;
+	std::vector<BVHPrimitive> prims(N);
+	for (int i = 0; i < N; i++) {
+		KDTriangle* tri = static_cast<KDTriangle*>(children[i]);
+		prims[i].minPoint = tri->getMin();
+		prims[i].maxPoint = tri->getMax();
+		prims[i].centroid = 0.5f * (prims[i].minPoint + prims[i].maxPoint);
+		prims[i].index = i;
+	}
+	nodes.reserve(2 * N / MAX_LEAF_SIZE + 1);
+	BuildBVHNode(nodes, prims, 0, N, 0, traversalCost, intersectCost);
+	nodes.shrink_to_fit();
+	for (int k = 0; k < 3; k++) {
+		bvhTriangles.x[k].resize(N);
+		bvhTriangles.y[k].resize(N);
+		bvhTriangles.z[k].resize(N);
+	}
+	bvhTriangles.triangles.resize(N);
+	for (int i = 0; i < N; i++) {
+		KDTriangle* tri = static_cast<KDTriangle*>(children[prims[i].index]);
+		bvhTriangles.triangles[i] = tri;
+		for (int k = 0; k < 3; k++) {
+			const float3& pt = tri->getPoint(k);
+			bvhTriangles.x[k][i] = pt.x;
+			bvhTriangles.y[k][i] = pt.y;
+			bvhTriangles.z[k][i] = pt.z;
 		}
-		leftChild->update();
-		rightChild->update();
-		children.clear();
-		children.push_back(leftChild);
-		children.push_back(rightChild);
-		box->update();
-		//std::cout << "Left: " << *leftChild<<std::endl;
-		//std::cout << "Right: " << *rightChild << std::endl;
-		boxes.push_back(leftChild);
-		boxes.push_back(rightChild);
-
 	}
 }
-int Intersector::splitPosition(std::vector<KDBox*>& children,
-		std::vector<KDBoxEdge>& edges, KDBox* box) {
-	int nAbove = 0;
-	int nBelow = 0;
-	double pAbove = 0;
-	double pBelow = 0;
-	double cost = 0;
-	int dim = 0;
-	int bestSplit = -1;
-	double sum = 0;
-	double prod = 0;
-	double voxel;
-	double val;
-	double minCost;
-	int sz;
-	//KDBoxEdge e1, e2;
-	float3 v = box->getMax() - box->getMin();
-	if (v.x > v.y && v.x > v.z)
-		dim = 0;
-	else if (v.y > v.z)
-		dim = 1;
-	else
-		dim = 2;
-	int retry = 3;
-	voxel = 1.0 / (v.x + v.y + v.z);
-	do {
-		bestSplit = -1;
-		switch (dim) {
-		case 0:
-			sum = v.y + v.z;
-			prod = v.y * v.z;
-			break;
-		case 1:
-			sum = v.x + v.z;
-			prod = v.x * v.z;
-			break;
-		case 2:
-			sum = v.x + v.y;
-			prod = v.x * v.y;
-			break;
-		}
-
-		sz = (int) children.size() * 2;
-		edges.resize(sz);
-		for (int i = 0; i < sz; i++) {
-			KDBox* child = children[i / 2];
-			edges[i] = KDBoxEdge(child, dim, (i % 2 == 1) ? true : false);
-		}
-
-		std::sort(edges.begin(), edges.end(),
-				[](const KDBoxEdge& e1, const KDBoxEdge& e2) {
-					return (e1.getValue() < e2.getValue());
-				});
-		for (int i = 0; i < (int) edges.size() - 1; i++) {
-			KDBoxEdge& e1 = edges[i];
-			KDBoxEdge& e2 = edges[i + 1];
-			if (e1.getValue() == e2.getValue()) {
-				if (!e1.isMin() && e2.isMin()) {
-					std::swap(e1, e2);
+int Intersector::intersectRay(const float3& org, const float3& dir, float tMax,
+		float& tHit) const {
+	//Barycentric tolerance that closes cracks between adjacent triangles.
+	static const float EPS = 1E-4f;
+	const float3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	const bool dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
+	const float* x0 = bvhTriangles.x[0].data();
+	const float* y0 = bvhTriangles.y[0].data();
+	const float* z0 = bvhTriangles.z[0].data();
+	const float* x1 = bvhTriangles.x[1].data();
+	const float* y1 = bvhTriangles.y[1].data();
+	const float* z1 = bvhTriangles.z[1].data();
+	const float* x2 = bvhTriangles.x[2].data();
+	const float* y2 = bvhTriangles.y[2].data();
+	const float* z2 = bvhTriangles.z[2].data();
+	int stack[MAX_DEPTH];
+	int stackSize = 0;
+	int current = 0;
+	int hit = -1;
+	float best = tMax;
+	while (true) {
+		const BVHNode& node = nodes[current];
+		if (IntersectBVHBox(node, org, invDir, best)) {
+			if (node.isLeaf()) {
+				int end = node.offset + node.count;
+				for (int i = node.offset; i < end; i++) {
+					//Moller-Trumbore, evaluated in the same order as the packet version.
+					float e1x = x1[i] - x0[i], e1y = y1[i] - y0[i], e1z = z1[i] - z0[i];
+					float e2x = x2[i] - x0[i], e2y = y2[i] - y0[i], e2z = z2[i] - z0[i];
+					float px = dir.y * e2z - dir.z * e2y;
+					float py = dir.z * e2x - dir.x * e2z;
+					float pz = dir.x * e2y - dir.y * e2x;
+					float det = (e1x * px + e1y * py) + e1z * pz;
+					if (det == 0.0f)
+						continue;
+					float invDet = 1.0f / det;
+					float tx = org.x - x0[i], ty = org.y - y0[i], tz = org.z - z0[i];
+					float u = ((tx * px + ty * py) + tz * pz) * invDet;
+					if (u < -EPS || u > 1.0f + EPS)
+						continue;
+					float qx = ty * e1z - tz * e1y;
+					float qy = tz * e1x - tx * e1z;
+					float qz = tx * e1y - ty * e1x;
+					float v = ((dir.x * qx + dir.y * qy) + dir.z * qz) * invDet;
+					if (v < -EPS || u + v > 1.0f + EPS)
+						continue;
+					float t = ((e2x * qx + e2y * qy) + e2z * qz) * invDet;
+					if (t >= 0.0f && t < best) {
+						best = t;
+						hit = i;
+					}
 				}
+				if (stackSize == 0)
+					break;
+				current = stack[--stackSize];
+			} else if (dirIsNeg[node.axis]) {
+				stack[stackSize++] = current + 1;
+				current = node.offset;
+			} else {
+				stack[stackSize++] = node.offset;
+				current = current + 1;
 			}
+		} else {
+			if (stackSize == 0)
+				break;
+			current = stack[--stackSize];
 		}
-		nBelow = 0;
-		nAbove = (int) children.size();
-		// Do not assume prior minimum cost because the spherical
-		// orientation
-		// is in some sense optimal when rays are cast from outside the
-		// sphere.
-		// If minimum cost is assumed, then no branches in kd-tree will be
-		// generated
-		// minCost=intersectCost*nAbove;
-		minCost = 1E30;
-
-		KDBoxEdge e1(box, dim, true);
-		KDBoxEdge e2(box, dim, false);
-		for (int i = 0; i < sz; i++) {
-			if (!edges[i].isMin())
-				nAbove--;
-			val = edges[i].getValue();
-			if (val > e1.getValue() && e2.getValue() > val) {
-				pBelow = (sum * (val - e1.getValue()) + prod) * voxel;
-				pAbove = (sum * (e2.getValue() - val) + prod) * voxel;
-				cost = traversalCost
-						+ intersectCost
-								* (1
-										- ((nAbove == 0 || nBelow == 0) ?
-												emptyBonus : 0))
-								* (pBelow * nBelow + pAbove * nAbove);
-				if (cost < minCost) {
-					minCost = cost;
-					bestSplit = i;
+	}
+	tHit = best;
+	return hit;
+}
+int Intersector::closestTriangle(const float3& pt, double maxDistance,
+		const float3* halfSpace, float3& lastPoint, double& dist) const {
+	int stack[2 * MAX_DEPTH];
+	double stackDist[2 * MAX_DEPTH];
+	int stackSize = 0;
+	int hit = -1;
+	double best = maxDistance;
+	double bestSqr = maxDistance * maxDistance;
+	float3 lastIntersect;
+	stack[stackSize] = 0;
+	stackDist[stackSize++] = BVHBoxDistanceSqr(nodes[0], pt);
+	while (stackSize > 0) {
+		stackSize--;
+		if (stackDist[stackSize] > bestSqr)
+			continue;
+		const BVHNode& node = nodes[stack[stackSize]];
+		if (node.isLeaf()) {
+			int end = node.offset + node.count;
+			for (int i = node.offset; i < end; i++) {
+				double d = KDTriangle::distance(pt, bvhTriangles.getPoint(i, 0),
+						bvhTriangles.getPoint(i, 1), bvhTriangles.getPoint(i, 2),
+						lastIntersect);
+				if (d <= best
+						&& (halfSpace == nullptr
+								|| dot(lastIntersect - pt, *halfSpace) >= 0)) {
+					best = d;
+					bestSqr = d * d;
+					hit = i;
+					lastPoint = lastIntersect;
 				}
 			}
-			if (edges[i].isMin())
-				nBelow++;
+		} else {
+			int first = stack[stackSize] + 1;
+			int second = node.offset;
+			double d1 = BVHBoxDistanceSqr(nodes[first], pt);
+			double d2 = BVHBoxDistanceSqr(nodes[second], pt);
+			//Push the farther child first so the nearer one is visited next.
+			if (d1 < d2) {
+				std::swap(first, second);
+				std::swap(d1, d2);
+			}
+			if (d1 <= bestSqr) {
+				stack[stackSize] = first;
+				stackDist[stackSize++] = d1;
+			}
+			if (d2 <= bestSqr) {
+				stack[stackSize] = second;
+				stackDist[stackSize++] = d2;
+			}
 		}
-		dim = (dim + 1) % 3;
-		retry--;
-	} while (bestSplit == -1 && retry > 0);
-	return bestSplit;
+	}
+	dist = best;
+	return hit;
 }
 double Intersector::intersectRayDistance(const float3& p1, const float3& v,
 		float3& lastPoint, KDTriangle*& lastTriangle) const {
-	if (root->getChildren().size() == 0)
-		throw new std::runtime_error("KD-Tree has not been initialized.");
-	std::list<KDBox*> boxes;
-	boxes.push_back(getRoot());
-	double d;
-	double mind = 1E30;
-	KDTriangle* resultTriangle = nullptr;
-	float3 resultIntersect = NO_HIT_POINT;
-	KDTriangle* tri;
-	while (boxes.size() > 0) {
-		KDBox* box = boxes.front();
-		//std::cout << *box << std::endl;
-		boxes.pop_front();
-		if (box->intersectRayBox(p1, v)) {
-			if (box->isLeaf) {
-				tri = dynamic_cast<KDTriangle*>(box);
-				float3 intersect = tri->intersectionPointRay(p1, v);
-				if (intersect != NO_HIT_POINT) {
-					d = distance(p1, intersect);
-					if (d < mind) {
-						mind = d;
-						resultTriangle = tri;
-						resultIntersect = intersect;
-					}
-				}
-			}
-			boxes.insert(boxes.end(), box->getChildren().begin(),
-					box->getChildren().end());
-		}
-	}
-	lastTriangle = resultTriangle;
-	lastPoint = resultIntersect;
-	if (resultTriangle == nullptr) {
+	if (nodes.size() == 0)
+		throw std::runtime_error("Intersector has not been initialized.");
+	float t;
+	int index = intersectRay(p1, v, std::numeric_limits<float>::infinity(), t);
+	if (index < 0) {
+		lastTriangle = nullptr;
+		lastPoint = NO_HIT_POINT;
 		return NO_HIT_DISTANCE;
-	} else {
-		return mind;
 	}
+	lastTriangle = bvhTriangles.triangles[index];
+	lastPoint = p1 + v * t;
+	return distance(p1, lastPoint);
 }
 double Intersector::intersectSegmentDistance(const float3& p1, const float3& p2,
 		float3& lastPoint, KDTriangle*& lastTriangle) const {
-	if (root->getChildren().size() == 0)
-		throw new std::runtime_error("KD-Tree has not been initialized.");
-	std::list<KDBox*> boxes;
-	boxes.push_back(getRoot());
-	double d;
-	double mind = 1E30;
-	KDTriangle* resultTriangle = nullptr;
-	float3 resultIntersect = NO_HIT_POINT;
-	KDTriangle* tri;
-	while (boxes.size() > 0) {
-		KDBox* box = boxes.front();
-		boxes.pop_front();
-		if (box->intersectSegmentBox(p1, p2)) {
-			if (box->isLeaf) {
-				tri = dynamic_cast<KDTriangle*>(box);
-				float3 intersect = tri->intersectionPointSegment(p1, p2);
-				if (intersect != NO_HIT_POINT) {
-					d = distance(p1, intersect);
-					if (d < mind) {
-						mind = d;
-						resultTriangle = tri;
-						resultIntersect = intersect;
-					}
-				}
-			}
-			boxes.insert(boxes.end(), box->getChildren().begin(),
-					box->getChildren().end());
-		}
-	}
-	lastTriangle = resultTriangle;
-	lastPoint = resultIntersect;
-	if (resultTriangle == nullptr) {
+	if (nodes.size() == 0)
+		throw std::runtime_error("Intersector has not been initialized.");
+	float t;
+	float3 v = p2 - p1;
+	int index = intersectRay(p1, v, 1.0f, t);
+	if (index < 0) {
+		lastTriangle = nullptr;
+		lastPoint = NO_HIT_POINT;
 		return NO_HIT_DISTANCE;
-	} else {
-		return mind;
 	}
+	lastTriangle = bvhTriangles.triangles[index];
+	lastPoint = p1 + v * t;
+	return distance(p1, lastPoint);
 }
 double Intersector::closestPointSignedDistance(const float3& r, float3& lastPoint,
 		KDTriangle*& lastTriangle) const {
@@ -1203,128 +1304,320 @@ double Intersector::closestPointSignedDistance(const float3& r,const float& maxD
 }
 double Intersector::closestPoint(const float3& pt, const float& maxDistance,
 		float3& lastPoint, KDTriangle*& lastTriangle) const {
-	if (root->getChildren().size() == 0)
-		throw new std::runtime_error("KD-Tree has not been initialized.");
+	if (nodes.size() == 0)
+		throw std::runtime_error("Intersector has not been initialized.");
 	double d;
-	double triangleDist = maxDistance;
-	std::priority_queue<KDBoxDistance,std::vector<KDBoxDistance>,CompareKDBox> queue;
-	queue.push(KDBoxDistance(pt, getRoot()));
-	lastTriangle = nullptr;
 	lastPoint = NO_HIT_POINT;
-	float3 lastIntersect = NO_HIT_POINT;
-	while (queue.size() > 0) {
-		KDBoxDistance boxd = queue.top();
-		queue.pop();
-		if (boxd.box->isLeaf) {
-			KDTriangle* tri = dynamic_cast<KDTriangle*>(boxd.box);
-			d = tri->distance(pt, lastIntersect);
-			if (d <= triangleDist) {
-				triangleDist = d;
-				lastTriangle = tri;
-				lastPoint = lastIntersect;
-			}
-		} else {
-			for (KDBox* child : boxd.box->getChildren()) {
-				KDBoxDistance kdb(pt, child);
-				if (kdb.dist <= maxDistance) {
-					queue.push(kdb);
-				}
-			}
-		}
-	}
-	if (lastTriangle == nullptr) {
+	int index = closestTriangle(pt, maxDistance, nullptr, lastPoint, d);
+	if (index < 0) {
+		lastTriangle = nullptr;
 		return NO_HIT_DISTANCE;
-	} else {
-		return triangleDist;
 	}
+	lastTriangle = bvhTriangles.triangles[index];
+	return d;
 }
 double Intersector::closestPoint(const float3& pt, float3& lastPoint,
 		KDTriangle*& lastTriangle) const {
-	if (root->getChildren().size() == 0)
-		throw new std::runtime_error("KD-Tree has not been initialized.");
+	return closestPoint(pt, std::numeric_limits<float>::infinity(), lastPoint,
+			lastTriangle);
+}
+
+double Intersector::closestPointOutside(const float3& r, const float3& v,
+		float3& lastPoint, KDTriangle*& lastTriangle) const {
+	if (nodes.size() == 0)
+		throw std::runtime_error("Intersector has not been initialized.");
 	double d;
-	double mind = 1E30;
-	double triangleDist = 1E30;
-	std::priority_queue<KDBoxDistance,std::vector<KDBoxDistance>,CompareKDBox> queue;
-	queue.push(KDBoxDistance(pt, getRoot()));
-	lastTriangle = nullptr;
 	lastPoint = NO_HIT_POINT;
-	float3 lastIntersect = NO_HIT_POINT;
-	while (queue.size() > 0) {
-		KDBoxDistance boxd = queue.top();
-		queue.pop();
-		if (boxd.dist <= mind || boxd.box->isLeaf) {
-			if (boxd.box->isLeaf) {
-				mind = boxd.dist;
-				KDTriangle* tri = dynamic_cast<KDTriangle*>(boxd.box);
-				d = tri->distance(pt, lastIntersect);
-				if (d < triangleDist) {
-					triangleDist = d;
-					lastTriangle = tri;
-					lastPoint = lastIntersect;
+	//Only points on the side of the plane through r that v faces are considered.
+	int index = closestTriangle(r, std::numeric_limits<double>::infinity(), &v,
+			lastPoint, d);
+	if (index < 0) {
+		lastTriangle = nullptr;
+		return NO_HIT_DISTANCE;
+	}
+	lastTriangle = bvhTriangles.triangles[index];
+	return d;
+}
+//Barycentric weights of p with respect to triangle (a,b,c).
+static float3 BVHBarycentrics(const float3& p, const float3& a, const float3& b,
+		const float3& c) {
+	float3 v0 = b - a;
+	float3 v1 = c - a;
+	float3 v2 = p - a;
+	double d00 = dot(v0, v0);
+	double d01 = dot(v0, v1);
+	double d11 = dot(v1, v1);
+	double d20 = dot(v2, v0);
+	double d21 = dot(v2, v1);
+	double denom = d00 * d11 - d01 * d01;
+	if (denom == 0.0)
+		return float3(1.0f, 0.0f, 0.0f);
+	double v = (d11 * d20 - d01 * d21) / denom;
+	double w = (d00 * d21 - d01 * d20) / denom;
+	return float3((float) (1.0 - v - w), (float) v, (float) w);
+}
+#ifdef ALY_INTERSECTOR_SSE
+static inline __m128 BVHSelect(const __m128& mask, const __m128& a,
+		const __m128& b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+//SSE version of ClipBVHSlab. Lanes with a NaN distance are set to NaN, and min/max return their second operand
+//when either is NaN, so those lanes keep the accumulated interval.
+static inline void ClipBVHSlabPacket(float minPoint, float maxPoint, const __m128& org,
+		const __m128& invDir, __m128& tNear, __m128& tFar) {
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minPoint), org), invDir);
+	__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxPoint), org), invDir);
+	__m128 nan = _mm_cmpunord_ps(t1, t2);
+	tNear = _mm_max_ps(_mm_or_ps(_mm_min_ps(t1, t2), nan), tNear);
+	tFar = _mm_min_ps(_mm_or_ps(_mm_max_ps(t1, t2), nan), tFar);
+}
+//Traces up to PACKET_SIZE rays through the tree together, one SSE lane per ray.
+//Unused lanes repeat the last ray. Children are ordered by the direction of the first ray.
+void Intersector::intersectPacket(const float3* org, const float3* dir,
+		int count, float tMax, float* tHit, int* hit) const {
+	static const float EPS = 1E-4f;
+	int k[4];
+	for (int l = 0; l < 4; l++) {
+		k[l] = std::min(l, count - 1);
+	}
+	const __m128 ox = _mm_setr_ps(org[k[0]].x, org[k[1]].x, org[k[2]].x, org[k[3]].x);
+	const __m128 oy = _mm_setr_ps(org[k[0]].y, org[k[1]].y, org[k[2]].y, org[k[3]].y);
+	const __m128 oz = _mm_setr_ps(org[k[0]].z, org[k[1]].z, org[k[2]].z, org[k[3]].z);
+	const __m128 dx = _mm_setr_ps(dir[k[0]].x, dir[k[1]].x, dir[k[2]].x, dir[k[3]].x);
+	const __m128 dy = _mm_setr_ps(dir[k[0]].y, dir[k[1]].y, dir[k[2]].y, dir[k[3]].y);
+	const __m128 dz = _mm_setr_ps(dir[k[0]].z, dir[k[1]].z, dir[k[2]].z, dir[k[3]].z);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 lo = _mm_set1_ps(-EPS);
+	const __m128 hi = _mm_set1_ps(1.0f + EPS);
+	const __m128 pad = _mm_set1_ps(1.0000004f);
+	const __m128 pinf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+	const __m128 ninf = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+	const __m128 idx = _mm_div_ps(one, dx);
+	const __m128 idy = _mm_div_ps(one, dy);
+	const __m128 idz = _mm_div_ps(one, dz);
+	const bool dirIsNeg[3] = { 1.0f / dir[0].x < 0, 1.0f / dir[0].y < 0, 1.0f
+			/ dir[0].z < 0 };
+	const float* x0 = bvhTriangles.x[0].data();
+	const float* y0 = bvhTriangles.y[0].data();
+	const float* z0 = bvhTriangles.z[0].data();
+	const float* x1 = bvhTriangles.x[1].data();
+	const float* y1 = bvhTriangles.y[1].data();
+	const float* z1 = bvhTriangles.z[1].data();
+	const float* x2 = bvhTriangles.x[2].data();
+	const float* y2 = bvhTriangles.y[2].data();
+	const float* z2 = bvhTriangles.z[2].data();
+	__m128 best = _mm_set1_ps(tMax);
+	__m128 hitIndex = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	int stack[MAX_DEPTH];
+	int stackSize = 0;
+	int current = 0;
+	while (true) {
+		const BVHNode& node = nodes[current];
+		__m128 tNear = ninf;
+		__m128 tFar = pinf;
+		ClipBVHSlabPacket(node.minPoint.x, node.maxPoint.x, ox, idx, tNear, tFar);
+		ClipBVHSlabPacket(node.minPoint.y, node.maxPoint.y, oy, idy, tNear, tFar);
+		ClipBVHSlabPacket(node.minPoint.z, node.maxPoint.z, oz, idz, tNear, tFar);
+		tFar = _mm_mul_ps(tFar, pad);
+		__m128 active = _mm_and_ps(_mm_cmpge_ps(tFar, _mm_max_ps(tNear, zero)),
+				_mm_cmple_ps(tNear, best));
+		if (_mm_movemask_ps(active) != 0) {
+			if (node.isLeaf()) {
+				int end = node.offset + node.count;
+				for (int i = node.offset; i < end; i++) {
+					//Moller-Trumbore
+					const __m128 e1x = _mm_set1_ps(x1[i] - x0[i]);
+					const __m128 e1y = _mm_set1_ps(y1[i] - y0[i]);
+					const __m128 e1z = _mm_set1_ps(z1[i] - z0[i]);
+					const __m128 e2x = _mm_set1_ps(x2[i] - x0[i]);
+					const __m128 e2y = _mm_set1_ps(y2[i] - y0[i]);
+					const __m128 e2z = _mm_set1_ps(z2[i] - z0[i]);
+					__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+					__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+					__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+					__m128 det = _mm_add_ps(
+							_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)),
+							_mm_mul_ps(e1z, pz));
+					__m128 invDet = _mm_div_ps(one, det);
+					__m128 tx = _mm_sub_ps(ox, _mm_set1_ps(x0[i]));
+					__m128 ty = _mm_sub_ps(oy, _mm_set1_ps(y0[i]));
+					__m128 tz = _mm_sub_ps(oz, _mm_set1_ps(z0[i]));
+					__m128 u = _mm_mul_ps(
+							_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)),
+									_mm_mul_ps(tz, pz)), invDet);
+					__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+					__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+					__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+					__m128 v = _mm_mul_ps(
+							_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+									_mm_mul_ps(dz, qz)), invDet);
+					__m128 t = _mm_mul_ps(
+							_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+									_mm_mul_ps(e2z, qz)), invDet);
+					__m128 mask = _mm_and_ps(_mm_cmpneq_ps(det, zero),
+							_mm_and_ps(_mm_cmpge_ps(u, lo), _mm_cmple_ps(u, hi)));
+					mask = _mm_and_ps(mask,
+							_mm_and_ps(_mm_cmpge_ps(v, lo),
+									_mm_cmple_ps(_mm_add_ps(u, v), hi)));
+					mask = _mm_and_ps(mask,
+							_mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, best)));
+					if (_mm_movemask_ps(mask) != 0) {
+						best = BVHSelect(mask, t, best);
+						hitIndex = BVHSelect(mask,
+								_mm_castsi128_ps(_mm_set1_epi32(i)), hitIndex);
+					}
 				}
+				if (stackSize == 0)
+					break;
+				current = stack[--stackSize];
+			} else if (dirIsNeg[node.axis]) {
+				stack[stackSize++] = current + 1;
+				current = node.offset;
 			} else {
-				for (KDBox* child : boxd.box->getChildren()) {
-					KDBoxDistance kdb(pt, child);
-					queue.push(kdb);
-				}
+				stack[stackSize++] = node.offset;
+				current = current + 1;
 			}
+		} else {
+			if (stackSize == 0)
+				break;
+			current = stack[--stackSize];
 		}
 	}
-	if (lastTriangle == nullptr) {
-		return NO_HIT_DISTANCE;
-	} else {
-		return triangleDist;
+	float bestOut[4];
+	int hitOut[4];
+	_mm_storeu_ps(bestOut, best);
+	_mm_storeu_si128((__m128i *) hitOut, _mm_castps_si128(hitIndex));
+	for (int l = 0; l < count; l++) {
+		tHit[l] = bestOut[l];
+		hit[l] = hitOut[l];
 	}
 }
-
-double Intersector::closestPointOutside(const float3& r, const float3& v,
-		float3& lastPoint, KDTriangle*& lastTriangle) const {
-	if (root->getChildren().size() == 0)
-		throw new std::runtime_error("KD-Tree has not been initialized.");
-
-	double d;
-	double mind = 1E30;
-	double triangleDist = 1E30;
-	std::priority_queue<KDBoxDistance,std::vector<KDBoxDistance>,CompareKDBox> queue;
-	queue.push(KDBoxDistance(r, getRoot()));
-
-	lastTriangle = nullptr;
-	lastPoint = NO_HIT_POINT;
-	float3 pt;
-	float3 testv;
-	float3 lastIntersect;
-	while (queue.size() > 0) {
-		KDBoxDistance boxd = queue.top();
-		queue.pop();
-		if (boxd.dist <= mind || boxd.box->isLeaf) {
-			if (boxd.box->isLeaf) {
-				mind = boxd.dist;
-				KDTriangle* tri = dynamic_cast<KDTriangle*>(boxd.box);
-				d = tri->distance(r, lastIntersect);
-				boxd.dist = d;
-				if (d < triangleDist) {
-					pt = lastIntersect;
-					testv = pt - r;
-					// Test if point is on one side of plane
-					if (dot(testv, v) >= 0) {
-						triangleDist = d;
-						lastTriangle = tri;
-						lastPoint = pt;
-					}
-				}
+#else
+void Intersector::intersectPacket(const float3* org, const float3* dir,
+		int count, float tMax, float* tHit, int* hit) const {
+	for (int l = 0; l < count; l++) {
+		hit[l] = intersectRay(org[l], dir[l], tMax, tHit[l]);
+	}
+}
+#endif
+void Intersector::intersectRays(const float3* org, const float3* dir, size_t N,
+		float tMax, IntersectorHits& hits) const {
+	if (nodes.size() == 0)
+		throw std::runtime_error("Intersector has not been initialized.");
+	hits.resize(N);
+	const bool packets = (GetSIMDInstructionSet() != SIMDInstructionSet::Scalar);
+	const int packetCount = (int) ((N + PACKET_SIZE - 1) / PACKET_SIZE);
+#pragma omp parallel for schedule(dynamic,64)
+	for (int p = 0; p < packetCount; p++) {
+		size_t start = (size_t) p * PACKET_SIZE;
+		int count = (int) std::min((size_t) PACKET_SIZE, N - start);
+		float tHit[PACKET_SIZE];
+		int hit[PACKET_SIZE];
+		if (packets) {
+			intersectPacket(&org[start], &dir[start], count, tMax, tHit, hit);
+		} else {
+			for (int l = 0; l < count; l++) {
+				hit[l] = intersectRay(org[start + l], dir[start + l], tMax,
+						tHit[l]);
+			}
+		}
+		for (int l = 0; l < count; l++) {
+			size_t i = start + l;
+			int index = hit[l];
+			if (index < 0) {
+				hits.distances[i] = NO_HIT_DISTANCE;
+				hits.ids[i] = -1;
+				hits.points[i] = NO_HIT_POINT;
+				hits.barycentrics[i] = float3(0.0f);
+				hits.triangles[i] = nullptr;
 			} else {
-				for (KDBox* child : boxd.box->getChildren()) {
-					queue.push(KDBoxDistance(pt, child));
-				}
+				float3 pt = org[i] + dir[i] * tHit[l];
+				KDTriangle* tri = bvhTriangles.triangles[index];
+				hits.distances[i] = distance(org[i], pt);
+				hits.ids[i] = (int64_t) tri->id;
+				hits.points[i] = pt;
+				hits.barycentrics[i] = BVHBarycentrics(pt, tri->getPoint(0),
+						tri->getPoint(1), tri->getPoint(2));
+				hits.triangles[i] = tri;
 			}
 		}
 	}
-	if (lastTriangle == nullptr) {
-		return NO_HIT_DISTANCE;
-	} else {
-		return mind;
+}
+void Intersector::intersectRays(const std::vector<float3>& org,
+		const std::vector<float3>& dir, IntersectorHits& hits) const {
+	if (org.size() != dir.size())
+		throw std::runtime_error(
+				MakeString() << "Ray origins and directions do not match. "
+						<< org.size() << " != " << dir.size());
+	intersectRays(org.data(), dir.data(), org.size(),
+			std::numeric_limits<float>::infinity(), hits);
+}
+void Intersector::intersectRays(const Vector3f& org, const Vector3f& dir,
+		IntersectorHits& hits) const {
+	intersectRays(org.data, dir.data, hits);
+}
+void Intersector::intersectSegments(const std::vector<float3>& p1,
+		const std::vector<float3>& p2, IntersectorHits& hits) const {
+	if (p1.size() != p2.size())
+		throw std::runtime_error(
+				MakeString() << "Segment end points do not match. "
+						<< p1.size() << " != " << p2.size());
+	std::vector<float3> dir(p1.size());
+#pragma omp parallel for
+	for (int i = 0; i < (int) dir.size(); i++) {
+		dir[i] = p2[i] - p1[i];
 	}
+	intersectRays(p1.data(), dir.data(), p1.size(), 1.0f, hits);
+}
+void Intersector::intersectSegments(const Vector3f& p1, const Vector3f& p2,
+		IntersectorHits& hits) const {
+	intersectSegments(p1.data, p2.data, hits);
+}
+void Intersector::closestPoints(const float3* pts, size_t N, float maxDistance,
+		bool signedDistance, IntersectorHits& hits) const {
+	if (nodes.size() == 0)
+		throw std::runtime_error("Intersector has not been initialized.");
+	hits.resize(N);
+#pragma omp parallel for schedule(dynamic,64)
+	for (int i = 0; i < (int) N; i++) {
+		double d;
+		float3 lastPoint = NO_HIT_POINT;
+		int index = closestTriangle(pts[i], maxDistance, nullptr, lastPoint, d);
+		if (index < 0) {
+			hits.distances[i] = NO_HIT_DISTANCE;
+			hits.ids[i] = -1;
+			hits.points[i] = NO_HIT_POINT;
+			hits.barycentrics[i] = float3(0.0f);
+			hits.triangles[i] = nullptr;
+		} else {
+			KDTriangle* tri = bvhTriangles.triangles[index];
+			if (signedDistance) {
+				d *= sign(dot(pts[i] - tri->getCentroid(), tri->getNormal()));
+			}
+			hits.distances[i] = (float) d;
+			hits.ids[i] = (int64_t) tri->id;
+			hits.points[i] = lastPoint;
+			hits.barycentrics[i] = BVHBarycentrics(lastPoint, tri->getPoint(0),
+					tri->getPoint(1), tri->getPoint(2));
+			hits.triangles[i] = tri;
+		}
+	}
+}
+void Intersector::closestPoints(const std::vector<float3>& pts,
+		IntersectorHits& hits, float maxDistance) const {
+	closestPoints(pts.data(), pts.size(), maxDistance, false, hits);
+}
+void Intersector::closestPoints(const Vector3f& pts, IntersectorHits& hits,
+		float maxDistance) const {
+	closestPoints(pts.data.data(), pts.size(), maxDistance, false, hits);
+}
+void Intersector::closestPointsSignedDistance(const std::vector<float3>& pts,
+		IntersectorHits& hits, float maxDistance) const {
+	closestPoints(pts.data(), pts.size(), maxDistance, true, hits);
+}
+void Intersector::closestPointsSignedDistance(const Vector3f& pts,
+		IntersectorHits& hits, float maxDistance) const {
+	closestPoints(pts.data.data(), pts.size(), maxDistance, true, hits);
 }
-
 }
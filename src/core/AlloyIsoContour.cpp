@@ -20,163 +20,160 @@
 */
 
 #include "AlloyIsoContour.h"
-#include <map>
-#include <list>
 #include <algorithm>
 namespace aly {
-	bool IsoContour::orient(const Image1f& img, const EdgeSplit& split1, const EdgeSplit& split2, Edge& edge) {
-		float2 pt1 = split1.pt2d;
-		float2 pt2 = split2.pt2d;
-		float1x2 norm = img.gradient(0.5f * (pt1.x + pt2.x), 0.5f * (pt2.y + pt2.y));
-		if (norm.x * (pt2.y - pt1.y) + norm.y * (pt1.x - pt2.x) > 0.0f) {
-			std::swap(edge.x, edge.y);
-			return false;
-		}
-		return true;
-	}
-
-	void IsoContour::solve(const Image1f& levelset, Vector2f& points, std::vector<std::list<uint32_t>>& lines, float isoLevel, const TopologyRule2D& topoRule, const Winding& winding) {
+	//Scans stripes of square columns in parallel. Within a stripe, squares are visited in the same order as a serial
+	//scan, so crossings keep the serial numbering once the stripes are concatenated and seam crossings are merged.
+	void IsoContour::extract(const Image1f& levelset, std::vector<Stripe>& stripes, Vector2f& points) {
 		rows = levelset.width;
 		cols = levelset.height;
-		this->isoLevel = isoLevel;
-		rule = topoRule;
 		img = &levelset;
-		vertCount = 0;
-		std::map<uint64_t, EdgeSplitPtr> splits;
-		std::list<EdgePtr> edges;
-		for (int i = 0; i < rows-1; i++) {
-			for (int j = 0; j < cols-1; j++) {
-				processSquare(i, j, splits, edges);
-			}
-		}
-		std::vector<EdgeSplitPtr> pts(splits.size());
-		for (const std::pair<uint64_t, EdgeSplitPtr>& split : splits) {
-			pts[split.second->vid] = split.second;
-		}
-		lines.clear();
-		points.resize(splits.size());
-		uint32_t index = 0;
-		for (const std::pair<uint64_t, EdgeSplitPtr>& split : splits) {
-			index = split.second->vid;
-			points[index] = split.second->pt2d;
-		}
-		EdgeSplitPtr lastSplit = pts.front();
-		bool firstPass = true;
-		std::list<uint32_t> curvePath;
-		index = 0;
-		while (lastSplit.get() != nullptr) {
-			curvePath.push_back(lastSplit->vid);
-			EdgePtr e1 = lastSplit->e1;
-			EdgePtr e2 = lastSplit->e2;
-			float val = getValue(lastSplit->pt1.x, lastSplit->pt1.y);
-			if ((val > 0 && winding == Winding::CounterClockwise)
-				|| (val <= 0 && winding == Winding::Clockwise)) {
-				// Swap edges so they are correctly ordered. This technique may
-				// fail if a vertex lies exactly on the iso-level.
-				std::swap(e1, e2);
-			}
-			// March around contour
-			if (e1.get() != nullptr) {
-				//if (!firstPass) {
-					lastSplit->e1.reset();
-				//}
-				if (e1->x == lastSplit->vid) {
-					lastSplit = pts[e1->y];
+		int stripeCount = (rows > 1) ? (rows - 1 + STRIPE_WIDTH - 1) / STRIPE_WIDTH : 0;
+		stripes.resize(stripeCount);
+#pragma omp parallel for schedule(dynamic)
+		for (int s = 0; s < stripeCount; s++) {
+			Stripe& stripe = stripes[s];
+			stripe.begin = s * STRIPE_WIDTH;
+			stripe.end = std::min(stripe.begin + STRIPE_WIDTH, rows - 1);
+			stripe.columns[0].assign(3 * cols, -1);
+			stripe.columns[1].assign(3 * cols, -1);
+			loadValues(stripe);
+			for (int i = stripe.begin; i < stripe.end; i++) {
+				if (i > stripe.begin) {
+					std::fill(stripe.columns[(i + 1) & 1].begin(), stripe.columns[(i + 1) & 1].end(), -1);
 				}
-				else {
-					lastSplit = pts[e1->x];
-				}
-				if (!firstPass) {
-					if (lastSplit->e1.get() == e1.get()) {
-						lastSplit->e1.reset();
-					}
-					if (lastSplit->e2.get() == e1.get()) {
-						lastSplit->e2.reset();
-					}
+				for (int j = 0; j < cols - 1; j++) {
+					processSquare(i, j, stripe);
 				}
-				firstPass = false;
 			}
-			else if (e2.get() != nullptr) {
-				//if (!firstPass) {
-					lastSplit->e2.reset();
-				//}
-				firstPass = false;
-				if (e2->x == lastSplit->vid) {
-					lastSplit = pts[e2->y];
+			stripe.lastColumn.swap(stripe.columns[stripe.end & 1]);
+			std::vector<int>().swap(stripe.columns[0]);
+			std::vector<int>().swap(stripe.columns[1]);
+			std::vector<float>().swap(stripe.values);
+		}
+		//Crossings on a stripe's first column that the previous stripe already created take its ids.
+		std::vector<uint32_t> counts(stripeCount, 0);
+#pragma omp parallel for
+		for (int s = 0; s < stripeCount; s++) {
+			Stripe& stripe = stripes[s];
+			for (int& seam : stripe.seams) {
+				if (seam >= 0) {
+					seam = (s > 0) ? stripes[s - 1].lastColumn[seam] : -1;
 				}
-				else {
-					lastSplit = pts[e2->x];
+				if (seam < 0) {
+					counts[s]++;
 				}
-				if (!firstPass) {
-					if (lastSplit->e1.get() == e2.get()) {
-						lastSplit->e1.reset();
-					}
-					if (lastSplit->e2.get() == e2.get()) {
-						lastSplit->e2.reset();
-					}
+			}
+		}
+		uint32_t vertexCount = 0, edgeCount = 0;
+		for (int s = 0; s < stripeCount; s++) {
+			stripes[s].vertexOffset = vertexCount;
+			stripes[s].edgeOffset = edgeCount;
+			vertexCount += counts[s];
+			edgeCount += (uint32_t) stripes[s].edges.size();
+		}
+		points.resize(vertexCount);
+#pragma omp parallel for
+		for (int s = 0; s < stripeCount; s++) {
+			Stripe& stripe = stripes[s];
+			stripe.ids.resize(stripe.seams.size());
+			uint32_t vid = stripe.vertexOffset;
+			for (size_t n = 0; n < stripe.points.size(); n++) {
+				if (stripe.seams[n] < 0) {
+					stripe.ids[n] = vid;
+					points[vid] = stripe.points[n];
+					vid++;
 				}
-				firstPass = false;
 			}
-			else {
-				// Start new contour
-				lastSplit.reset();
-				lines.push_back(curvePath);
-				curvePath.clear();
-				firstPass = true;
-				index = 0;
-				while (index < pts.size()) {
-					EdgeSplitPtr tmp = pts[index++];
-					if (tmp->e1.get() != nullptr && tmp->e2.get() != nullptr) {
-						lastSplit = tmp;
-						break;
-					}
+			std::vector<float2>().swap(stripe.points);
+		}
+#pragma omp parallel for
+		for (int s = 1; s < stripeCount; s++) {
+			Stripe& stripe = stripes[s];
+			for (size_t n = 0; n < stripe.seams.size(); n++) {
+				if (stripe.seams[n] >= 0) {
+					stripe.ids[n] = stripes[s - 1].ids[stripe.seams[n]];
 				}
 			}
 		}
 		img = nullptr;
 	}
-	void IsoContour::solve(const Image1f& levelset, Vector2f& points, Vector2ui& indexes, float isoLevel, const TopologyRule2D& topoRule,const Winding& winding){
-		rows = levelset.width;
-		cols = levelset.height;
+	void IsoContour::solve(const Image1f& levelset, Vector2f& points, std::vector<std::list<uint32_t>>& lines, float isoLevel, const TopologyRule2D& topoRule, const Winding& winding) {
 		this->isoLevel = isoLevel;
 		rule = topoRule;
-		img = &levelset;
-		vertCount = 0;
-		std::map<uint64_t, EdgeSplitPtr> splits;
-		std::list<EdgePtr> edges;
-		for (int i = 0; i < rows - 1; i++) {
-			for (int j = 0; j < cols - 1; j++) {
-				processSquare(i, j, splits, edges);
+		std::vector<Stripe> stripes;
+		extract(levelset, stripes, points);
+		//Segments are oriented, so contours are traced by following each crossing's outgoing segments.
+		std::vector<uint32_t> offsets(points.size() + 1, 0);
+		std::vector<int> balance(points.size(), 0);
+		for (const Stripe& stripe : stripes) {
+			for (const uint2& edge : stripe.edges) {
+				uint2 e(stripe.ids[edge.x], stripe.ids[edge.y]);
+				if (winding == Winding::CounterClockwise) {
+					std::swap(e.x, e.y);
+				}
+				offsets[e.x + 1]++;
+				balance[e.x]++;
+				balance[e.y]--;
 			}
 		}
-		std::vector<EdgeSplitPtr> pts(splits.size());
-		for (const std::pair<uint64_t, EdgeSplitPtr>& split : splits) {
-			pts[split.second->vid] = split.second;
+		for (size_t n = 0; n < points.size(); n++) {
+			offsets[n + 1] += offsets[n];
 		}
-		indexes.resize(edges.size());
-		points.resize(splits.size());
-		uint32_t index = 0;
-		if (winding == Winding::Clockwise) {
-			for (EdgePtr edge : edges) {
-				indexes[index++] = uint2(edge->x, edge->y);
+		std::vector<uint32_t> next(offsets.back());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (const Stripe& stripe : stripes) {
+			for (const uint2& edge : stripe.edges) {
+				uint2 e(stripe.ids[edge.x], stripe.ids[edge.y]);
+				if (winding == Winding::CounterClockwise) {
+					std::swap(e.x, e.y);
+				}
+				next[fill[e.x]++] = e.y;
 			}
 		}
-		else if (winding == Winding::CounterClockwise) {
-			for (EdgePtr edge : edges) {
-				indexes[index++]= uint2(edge->y,edge->x);
+		lines.clear();
+		//Open contours that end on the image border are traced from their first crossing before closed ones.
+		std::vector<uint32_t> used(offsets.begin(), offsets.end() - 1);
+		for (int pass = 0; pass < 2; pass++) {
+			for (uint32_t start = 0; start < (uint32_t) points.size(); start++) {
+				while (used[start] < offsets[start + 1] && (pass > 0 || balance[start] > 0)) {
+					std::list<uint32_t> curvePath;
+					uint32_t vid = start;
+					curvePath.push_back(vid);
+					while (used[vid] < offsets[vid + 1]) {
+						vid = next[used[vid]++];
+						curvePath.push_back(vid);
+					}
+					lines.push_back(curvePath);
+					if (pass == 0) {
+						balance[start]--;
+					}
+				}
 			}
 		}
-		index = 0;
-		for (const std::pair<uint64_t, EdgeSplitPtr>& split : splits) {
-			index = split.second->vid;
-			points[index] = split.second->pt2d;
+	}
+	void IsoContour::solve(const Image1f& levelset, Vector2f& points, Vector2ui& indexes, float isoLevel, const TopologyRule2D& topoRule,const Winding& winding){
+		this->isoLevel = isoLevel;
+		rule = topoRule;
+		std::vector<Stripe> stripes;
+		extract(levelset, stripes, points);
+		indexes.resize(stripes.size() > 0 ? stripes.back().edgeOffset + stripes.back().edges.size() : 0);
+#pragma omp parallel for
+		for (int s = 0; s < (int) stripes.size(); s++) {
+			const Stripe& stripe = stripes[s];
+			for (size_t n = 0; n < stripe.edges.size(); n++) {
+				uint2 edge(stripe.ids[stripe.edges[n].x], stripe.ids[stripe.edges[n].y]);
+				if (winding == Winding::CounterClockwise) {
+					std::swap(edge.x, edge.y);
+				}
+				indexes[stripe.edgeOffset + n] = edge;
+			}
 		}
-		img = nullptr;
 	}
-	void IsoContour::processSquare2(int x, int y, std::map<uint64_t, EdgeSplitPtr>& splits, std::list<EdgePtr>& edges) {
+	void IsoContour::processSquare2(int x, int y, Stripe& stripe) {
 		int iFlagIndex = 0;
 		for (int iVertex = 0; iVertex < 4; iVertex++) {
-			if (getValue(x + a2fVertex1Offset[iVertex][0], y + a2fVertex1Offset[iVertex][1]) > isoLevel) {
+			if (getValue(stripe, x + a2fVertex1Offset[iVertex][0], y + a2fVertex1Offset[iVertex][1]) > isoLevel) {
 				iFlagIndex |= 1 << iVertex;
 			}
 		}
@@ -187,74 +184,21 @@ namespace aly {
 		else {
 			mask = &afSquareValue8[iFlagIndex][0];
 		}
-
-		if (mask[0] < 4) {
-			EdgeSplitPtr split1 = createSplit(splits, x
-				+ a2fVertex1Offset[mask[0]][0], y
-				+ a2fVertex1Offset[mask[0]][1], x
-				+ a2fVertex2Offset[mask[0]][0], y
-				+ a2fVertex2Offset[mask[0]][1]);
-
-			EdgeSplitPtr split2 = createSplit(splits, x
-				+ a2fVertex1Offset[mask[1]][0], y
-				+ a2fVertex1Offset[mask[1]][1], x
-				+ a2fVertex2Offset[mask[1]][0], y
-				+ a2fVertex2Offset[mask[1]][1]);
-			EdgePtr edge = EdgePtr(new Edge(split1->vid, split2->vid));
-
-			if (split1->e1.get() == nullptr) {
-				split1->e1 = edge;
-			}
-			else {
-				split1->e2 = edge;
-			}
-			if (split2->e1.get() == nullptr) {
-				split2->e1 = edge;
-			}
-			else {
-				split2->e2 = edge;
-			}
-			edges.push_back(edge);
-
-		}
-
-		if (mask[2] < 4) {
-			EdgeSplitPtr split1 = createSplit(splits, x
-				+ a2fVertex1Offset[mask[2]][0], y
-				+ a2fVertex1Offset[mask[2]][1], x
-				+ a2fVertex2Offset[mask[2]][0], y
-				+ a2fVertex2Offset[mask[2]][1]);
-
-			EdgeSplitPtr split2 = createSplit(splits, x
-				+ a2fVertex1Offset[mask[3]][0], y
-				+ a2fVertex1Offset[mask[3]][1], x
-				+ a2fVertex2Offset[mask[3]][0], y
-				+ a2fVertex2Offset[mask[3]][1]);
-
-			EdgePtr edge = EdgePtr(new Edge(split1->vid, split2->vid));
-			// orient(*split1, *split2, edge);
-			if (split1->e1.get() == nullptr) {
-				split1->e1 = edge;
+		for (int k = 0; k < 4; k += 2) {
+			if (mask[k] < 4) {
+				addEdge(stripe, x + a2fVertex1Offset[mask[k]][0], y + a2fVertex1Offset[mask[k]][1],
+					x + a2fVertex2Offset[mask[k]][0], y + a2fVertex2Offset[mask[k]][1],
+					x + a2fVertex1Offset[mask[k + 1]][0], y + a2fVertex1Offset[mask[k + 1]][1],
+					x + a2fVertex2Offset[mask[k + 1]][0], y + a2fVertex2Offset[mask[k + 1]][1]);
 			}
-			else {
-				split1->e2 = edge;
-			}
-			if (split2->e1.get() == nullptr) {
-				split2->e1 = edge;
-			}
-			else {
-				split2->e2 = edge;
-			}
-			edges.push_back(edge);
 		}
-
 	}
-	void IsoContour::processSquare(int x, int y, std::map<uint64_t, EdgeSplitPtr>& splits, std::list<EdgePtr>& edges) {
+	void IsoContour::processSquare(int x, int y, Stripe& stripe) {
 		if (rule == TopologyRule2D::Unconstrained) {
-			processSquare1(x, y, splits, edges);
+			processSquare1(x, y, stripe);
 		}
 		else {
-			processSquare2(x, y, splits, edges);
+			processSquare2(x, y, stripe);
 		}
 	}
 	/*
@@ -264,11 +208,11 @@ namespace aly {
 	*
 	* File Version: 4.10.0 (2009/11/18)
 	*/
-	void IsoContour::processSquare1(int i, int j, std::map<uint64_t, EdgeSplitPtr>& splits, std::list<EdgePtr>& edges) {
-		float iF00 = getValue(i, j);
-		float iF10 = getValue(i + 1, j);
-		float iF01 = getValue(i, j + 1);
-		float iF11 = getValue(i + 1, j + 1);
+	void IsoContour::processSquare1(int i, int j, Stripe& stripe) {
+		float iF00 = getValue(stripe, i, j);
+		float iF10 = getValue(stripe, i + 1, j);
+		float iF01 = getValue(stripe, i, j + 1);
+		float iF11 = getValue(stripe, i + 1, j + 1);
 		bool signFlip = false;
 		if (iF00 != 0) {
 			if (iF00 < 0) {
@@ -287,24 +231,24 @@ namespace aly {
 					}
 					else {
 						// +++-
-						addEdge(splits, edges, i, j + 1, i + 1, j + 1, i,
+						addEdge(stripe, i, j + 1, i + 1, j + 1, i,
 							j + 1, i, j);
 					}
 				}
 				else if (iF11 < 0) {
 					if (iF01 > 0) {
 						// ++-+
-						addEdge(splits, edges, i + 1, j, i + 1, j + 1, i + 1,
+						addEdge(stripe, i + 1, j, i + 1, j + 1, i + 1,
 							j + 1, i, j + 1);
 					}
 					else if (iF01 < 0) {
 						// ++--
-						addEdge(splits, edges, i, j + 1, i, j, i + 1, j, i + 1,
+						addEdge(stripe, i, j + 1, i, j, i + 1, j, i + 1,
 							j + 1);
 					}
 					else {
 						// ++-0
-						addEdge(splits, edges, i, j + 1, i, j + 1, i + 1, j,
+						addEdge(stripe, i, j + 1, i, j + 1, i + 1, j,
 							i + 1, j + 1);
 					}
 				}
@@ -315,12 +259,12 @@ namespace aly {
 					}
 					else if (iF01 < 0) {
 						// ++0-
-						addEdge(splits, edges, i + 1, j + 1, i + 1, j + 1, i,
+						addEdge(stripe, i + 1, j + 1, i + 1, j + 1, i,
 							j, i, j + 1);
 					}
 					else {
 						// ++00
-						addEdge(splits, edges, i + 1, j + 1, i + 1, j + 1, i,
+						addEdge(stripe, i + 1, j + 1, i + 1, j + 1, i,
 							j + 1, i, j + 1);
 					}
 				}
@@ -329,7 +273,7 @@ namespace aly {
 				if (iF11 > 0) {
 					if (iF01 > 0) {
 						// +-++
-						addEdge(splits, edges, i, j, i + 1, j, i + 1, j + 1,
+						addEdge(stripe, i, j, i + 1, j, i + 1, j + 1,
 							i + 1, j);
 					}
 					else if (iF01 < 0) {
@@ -348,86 +292,86 @@ namespace aly {
 								iDet = iXN0 * iD3 - iXN1 * iD0;
 							}
 							if (iDet > 0) {
-								addEdge(splits, edges, i + 1, j + 1, i, j + 1,
+								addEdge(stripe, i + 1, j + 1, i, j + 1,
 									i + 1, j + 1, i + 1, j);
-								addEdge(splits, edges, i, j, i + 1, j, i, j, i,
+								addEdge(stripe, i, j, i + 1, j, i, j, i,
 									j + 1);
 							}
 							else {
-								addEdge(splits, edges, i + 1, j + 1, i, j + 1,
+								addEdge(stripe, i + 1, j + 1, i, j + 1,
 									i, j, i, j + 1);
-								addEdge(splits, edges, i, j, i + 1, j, i + 1,
+								addEdge(stripe, i, j, i + 1, j, i + 1,
 									j + 1, i + 1, j);
 							}
 						}
 						else if (rule == TopologyRule2D::Connect4) {
 							if (signFlip) {
-								addEdge(splits, edges, i + 1, j + 1, i, j + 1,
+								addEdge(stripe, i + 1, j + 1, i, j + 1,
 									i + 1, j + 1, i + 1, j);
-								addEdge(splits, edges, i, j, i + 1, j, i, j, i,
+								addEdge(stripe, i, j, i + 1, j, i, j, i,
 									j + 1);
 							}
 							else {
-								addEdge(splits, edges, i + 1, j + 1, i, j + 1,
+								addEdge(stripe, i + 1, j + 1, i, j + 1,
 									i, j, i, j + 1);
-								addEdge(splits, edges, i, j, i + 1, j, i + 1,
+								addEdge(stripe, i, j, i + 1, j, i + 1,
 									j + 1, i + 1, j);
 							}
 						}
 						else if (rule == TopologyRule2D::Connect8) {
 							if (signFlip) {
-								addEdge(splits, edges, i + 1, j + 1, i, j + 1,
+								addEdge(stripe, i + 1, j + 1, i, j + 1,
 									i, j, i, j + 1);
-								addEdge(splits, edges, i, j, i + 1, j, i + 1,
+								addEdge(stripe, i, j, i + 1, j, i + 1,
 									j + 1, i + 1, j);
 							}
 							else {
-								addEdge(splits, edges, i + 1, j + 1, i, j + 1,
+								addEdge(stripe, i + 1, j + 1, i, j + 1,
 									i + 1, j + 1, i + 1, j);
-								addEdge(splits, edges, i, j, i + 1, j, i, j, i,
+								addEdge(stripe, i, j, i + 1, j, i, j, i,
 									j + 1);
 							}
 						}
 					}
 					else {
 						// +-+0
-						addEdge(splits, edges, i, j, i + 1, j, i + 1, j + 1,
+						addEdge(stripe, i, j, i + 1, j, i + 1, j + 1,
 							i + 1, j);
 					}
 				}
 				else if (iF11 < 0) {
 					if (iF01 > 0) {
 						// +--+
-						addEdge(splits, edges, i, j, i + 1, j, i + 1, j + 1, i,
+						addEdge(stripe, i, j, i + 1, j, i + 1, j + 1, i,
 							j + 1);
 					}
 					else if (iF01 < 0) {
 						// +---
-						addEdge(splits, edges, i, j + 1, i, j, i, j, i + 1, j);
+						addEdge(stripe, i, j + 1, i, j, i, j, i + 1, j);
 					}
 					else {
 						// +--0
-						addEdge(splits, edges, i, j + 1, i, j + 1, i, j, i + 1,
+						addEdge(stripe, i, j + 1, i, j + 1, i, j, i + 1,
 							j);
 					}
 				}
 				else {
 					if (iF01 > 0) {
 						// +-0+
-						addEdge(splits, edges, i + 1, j + 1, i + 1, j + 1, i,
+						addEdge(stripe, i + 1, j + 1, i + 1, j + 1, i,
 							j, i + 1, j);
 					}
 					else if (iF01 < 0) {
 						// +-0-
-						addEdge(splits, edges, i, j + 1, i, j, i, j, i + 1, j);
+						addEdge(stripe, i, j + 1, i, j, i, j, i + 1, j);
 					}
 					else {
 						// +-00
-						addEdge(splits, edges, i + 1, j + 1, i + 1, j + 1, i,
+						addEdge(stripe, i + 1, j + 1, i + 1, j + 1, i,
 							j + 1, i + 1, j + 1);
-						addEdge(splits, edges, i, j + 1, i + 1, j + 1, i,
+						addEdge(stripe, i, j + 1, i + 1, j + 1, i,
 							j + 1, i, j + 1);
-						addEdge(splits, edges, i, j + 1, i + 1, j + 1, i, j,
+						addEdge(stripe, i, j + 1, i + 1, j + 1, i, j,
 							i + 1, j);
 					}
 				}
@@ -439,46 +383,46 @@ namespace aly {
 					}
 					else if (iF01 < 0) {
 						// +0+-
-						addEdge(splits, edges, i, j + 1, i + 1, j + 1, i,
+						addEdge(stripe, i, j + 1, i + 1, j + 1, i,
 							j + 1, i, j);
 					}
 				}
 				else if (iF11 < 0) {
 					if (iF01 > 0) {
 						// +0-+
-						addEdge(splits, edges, i + 1, j, i + 1, j, i, j + 1,
+						addEdge(stripe, i + 1, j, i + 1, j, i, j + 1,
 							i + 1, j + 1);
 					}
 					else if (iF01 < 0) {
 						// +0--
-						addEdge(splits, edges, i + 1, j, i + 1, j, i, j, i,
+						addEdge(stripe, i + 1, j, i + 1, j, i, j, i,
 							j + 1);
 					}
 					else {
 						// +0-0
-						addEdge(splits, edges, i + 1, j, i + 1, j, i, j + 1, i,
+						addEdge(stripe, i + 1, j, i + 1, j, i, j + 1, i,
 							j + 1);
 					}
 				}
 				else {
 					if (iF01 > 0) {
 						// +00+
-						addEdge(splits, edges, i + 1, j, i + 1, j, i + 1,
+						addEdge(stripe, i + 1, j, i + 1, j, i + 1,
 							j + 1, i + 1, j + 1);
 					}
 					else if (iF01 < 0) {
 						// +00-
-						addEdge(splits, edges, i + 1, j, i + 1, j, i + 1, j,
+						addEdge(stripe, i + 1, j, i + 1, j, i + 1, j,
 							i + 1, j + 1);
-						addEdge(splits, edges, i + 1, j, i + 1, j + 1, i + 1,
+						addEdge(stripe, i + 1, j, i + 1, j + 1, i + 1,
 							j + 1, i + 1, j + 1);
-						addEdge(splits, edges, i + 1, j, i + 1, j + 1, i, j, i,
+						addEdge(stripe, i + 1, j, i + 1, j + 1, i, j, i,
 							j + 1);
 					}
 					else {
 						// +000
-						addEdge(splits, edges, i, j + 1, i, j + 1, i, j, i, j);
-						addEdge(splits, edges, i, j, i, j, i + 1, j, i + 1, j);
+						addEdge(stripe, i, j + 1, i, j + 1, i, j, i, j);
+						addEdge(stripe, i, j, i, j, i + 1, j, i + 1, j);
 					}
 				}
 			}
@@ -497,28 +441,28 @@ namespace aly {
 				}
 				else if (iF01 < 0) {
 					// 0++-
-					addEdge(splits, edges, i, j, i, j, i, j + 1, i + 1, j + 1);
+					addEdge(stripe, i, j, i, j, i, j + 1, i + 1, j + 1);
 				}
 				else {
 					// 0++0
-					addEdge(splits, edges, i, j + 1, i, j + 1, i, j, i, j);
+					addEdge(stripe, i, j + 1, i, j + 1, i, j, i, j);
 				}
 			}
 			else if (iF11 < 0) {
 				if (iF01 > 0) {
 					// 0+-+
-					addEdge(splits, edges, i + 1, j, i + 1, j + 1, i + 1,
+					addEdge(stripe, i + 1, j, i + 1, j + 1, i + 1,
 						j + 1, i, j + 1);
 				}
 				else if (iF01 < 0) {
 					// 0+--
-					addEdge(splits, edges, i, j, i, j, i + 1, j, i + 1, j + 1);
+					addEdge(stripe, i, j, i, j, i + 1, j, i + 1, j + 1);
 				}
 				else {
 					// 0+-0
-					addEdge(splits, edges, i, j, i, j, i, j, i, j + 1);
-					addEdge(splits, edges, i, j, i, j + 1, i, j + 1, i, j + 1);
-					addEdge(splits, edges, i, j, i, j + 1, i + 1, j, i + 1,
+					addEdge(stripe, i, j, i, j, i, j, i, j + 1);
+					addEdge(stripe, i, j, i, j + 1, i, j + 1, i, j + 1);
+					addEdge(stripe, i, j, i, j + 1, i + 1, j, i + 1,
 						j + 1);
 				}
 			}
@@ -528,14 +472,14 @@ namespace aly {
 				}
 				else if (iF01 < 0) {
 					// 0+0-
-					addEdge(splits, edges, i, j, i, j, i + 1, j + 1, i + 1,
+					addEdge(stripe, i, j, i, j, i + 1, j + 1, i + 1,
 						j + 1);
 				}
 				else {
 					// 0+00
-					addEdge(splits, edges, i + 1, j + 1, i + 1, j + 1, i,
+					addEdge(stripe, i + 1, j + 1, i + 1, j + 1, i,
 						j + 1, i, j + 1);
-					addEdge(splits, edges, i, j + 1, i, j + 1, i, j, i, j);
+					addEdge(stripe, i, j + 1, i, j + 1, i, j, i, j);
 				}
 			}
 		}
@@ -548,94 +492,101 @@ namespace aly {
 
 			if (iF01 > 0) {
 				// 00++
-				addEdge(splits, edges, i, j, i, j, i + 1, j, i + 1, j);
+				addEdge(stripe, i, j, i, j, i + 1, j, i + 1, j);
 			}
 			else if (iF01 < 0) {
 				// 00+-
-				addEdge(splits, edges, i, j, i, j, i, j, i + 1, j);
-				addEdge(splits, edges, i, j, i + 1, j, i + 1, j, i + 1, j);
-				addEdge(splits, edges, i, j, i + 1, j, i, j + 1, i + 1, j + 1);
+				addEdge(stripe, i, j, i, j, i, j, i + 1, j);
+				addEdge(stripe, i, j, i + 1, j, i + 1, j, i + 1, j);
+				addEdge(stripe, i, j, i + 1, j, i, j + 1, i + 1, j + 1);
 			}
 			else {
 				// 00+0
-				addEdge(splits, edges, i + 1, j, i + 1, j, i + 1, j + 1, i + 1,
+				addEdge(stripe, i + 1, j, i + 1, j, i + 1, j + 1, i + 1,
 					j + 1);
-				addEdge(splits, edges, i + 1, j + 1, i + 1, j + 1, i, j + 1, i,
+				addEdge(stripe, i + 1, j + 1, i + 1, j + 1, i, j + 1, i,
 					j + 1);
 			}
 		}
 		else if (iF01 != 0) {
 			// cases 000+ or 000-
-			addEdge(splits, edges, i, j, i, j, i + 1, j, i + 1, j);
-			addEdge(splits, edges, i + 1, j, i + 1, j, i + 1, j + 1, i + 1,
+			addEdge(stripe, i, j, i, j, i + 1, j, i + 1, j);
+			addEdge(stripe, i + 1, j, i + 1, j, i + 1, j + 1, i + 1,
 				j + 1);
 		}
 		else {
 			// case 0000
-			addEdge(splits, edges, i, j, i, j, i + 1, j, i + 1, j);
-			addEdge(splits, edges, i + 1, j, i + 1, j, i + 1, j + 1, i + 1,
+			addEdge(stripe, i, j, i, j, i + 1, j, i + 1, j);
+			addEdge(stripe, i + 1, j, i + 1, j, i + 1, j + 1, i + 1,
 				j + 1);
-			addEdge(splits, edges, i + 1, j + 1, i + 1, j + 1, i, j + 1, i,
+			addEdge(stripe, i + 1, j + 1, i + 1, j + 1, i, j + 1, i,
 				j + 1);
-			addEdge(splits, edges, i, j + 1, i, j + 1, i, j, i, j);
+			addEdge(stripe, i, j + 1, i, j + 1, i, j, i, j);
 		}
 	}
-	float IsoContour::getValue(int i, int j) {
-		float val = (*img)(i,j) - isoLevel;
-		if (nudgeLevelSet) {
-			if (val < 0) {
-				val = std::min(val, -LEVEL_SET_TOLERANCE);
-			}
-			else {
-				val = std::max(val, LEVEL_SET_TOLERANCE);
+	//Copies the stripe's columns of the level set, shifted by the iso-level and nudged, into column-major order so the
+	//column by column scan reads contiguous memory.
+	void IsoContour::loadValues(Stripe& stripe) {
+		int width = stripe.end - stripe.begin + 1;
+		stripe.values.resize((size_t) width * cols);
+		for (int j = 0; j < cols; j++) {
+			for (int i = 0; i < width; i++) {
+				float val = (*img)(stripe.begin + i, j).x - isoLevel;
+				if (nudgeLevelSet) {
+					if (val < 0) {
+						val = std::min(val, -LEVEL_SET_TOLERANCE);
+					}
+					else {
+						val = std::max(val, LEVEL_SET_TOLERANCE);
+					}
+				}
+				stripe.values[(size_t) i * cols + j] = val;
 			}
 		}
-		return val;
 	}
-	float IsoContour::fGetOffset(uint2 v1, uint2 v2) {
-		float fValue1 = getValue(v1.x, v1.y);
-		float fValue2 = getValue(v2.x, v2.y);
+	float IsoContour::getValue(const Stripe& stripe, int i, int j) const {
+		return stripe.values[(size_t) (i - stripe.begin) * cols + j];
+	}
+	float IsoContour::fGetOffset(const Stripe& stripe, uint2 v1, uint2 v2) const {
+		float fValue1 = getValue(stripe, v1.x, v1.y);
+		float fValue2 = getValue(stripe, v2.x, v2.y);
 		double fDelta = fValue2 - fValue1;
 		if (fDelta == 0.0) {
 			return 0.5f;
 		}
 		return (float)(-fValue1 / fDelta);
 	}
-
-	void IsoContour::addEdge(std::map<uint64_t, EdgeSplitPtr>& splits, std::list<EdgePtr>& edges, int p1x, int p1y, int p2x, int p2y, int p3x, int p3y, int p4x, int p4y) {
-		EdgeSplitPtr split1 = createSplit(splits, p1x, p1y, p2x, p2y);
-		EdgeSplitPtr split2 = createSplit(splits, p3x, p3y, p4x, p4y);
-		EdgePtr edge = EdgePtr(new Edge(split1->vid, split2->vid));
-		if (split1->e1.get() == nullptr) {
-			split1->e1 = edge;
-		}
-		else {
-			split1->e2 = edge;
-		}
-		if (split2->e1.get() == nullptr) {
-			split2->e1 = edge;
-		}
-		else {
-			split2->e2 = edge;
+	void IsoContour::addEdge(Stripe& stripe, int p1x, int p1y, int p2x, int p2y, int p3x, int p3y, int p4x, int p4y) {
+		uint32_t split1 = createSplit(stripe, p1x, p1y, p2x, p2y);
+		uint32_t split2 = createSplit(stripe, p3x, p3y, p4x, p4y);
+		//Orient the segment so positive values lie to its left, measured from whichever grid edge is farther from it.
+		float2 pt1 = stripe.points[split1];
+		float2 pt2 = stripe.points[split2];
+		float2 dir = pt2 - pt1;
+		float2 pos1 = (getValue(stripe, p1x, p1y) > 0) ? float2((float) p1x, (float) p1y) : float2((float) p2x, (float) p2y);
+		float2 pos2 = (getValue(stripe, p3x, p3y) > 0) ? float2((float) p3x, (float) p3y) : float2((float) p4x, (float) p4y);
+		float side1 = crossMag(dir, pos1 - pt1);
+		float side2 = crossMag(dir, pos2 - pt2);
+		if (((std::abs(side1) >= std::abs(side2)) ? side1 : side2) < 0.0f) {
+			std::swap(split1, split2);
 		}
-		edges.push_back(edge);
+		stripe.edges.push_back(uint2(split1, split2));
 	}
-	EdgeSplitPtr IsoContour::createSplit(std::map<uint64_t, EdgeSplitPtr>& splits, int p1x, int p1y, int p2x, int p2y) {
-		EdgeSplitPtr split=EdgeSplitPtr(new EdgeSplit(uint2(p1x, p1y), uint2(p2x, p2y)));
-		uint64_t hash = split->hashValue(rows, cols);
-		if (splits.find(hash) != splits.end()) {
-			EdgeSplitPtr foundSplit = splits[hash];
-			return foundSplit;
-		} else {
-			split->vid = vertCount++;
-			float2 pt2d(0.0f);
-			float fOffset = fGetOffset(split->pt1, split->pt2);
-			float fInvOffset = 1.0f - fOffset;
-			pt2d.x = (fInvOffset * p1x + fOffset * p2x);
-			pt2d.y = (fInvOffset * p1y + fOffset * p2y);
-			split->pt2d = pt2d;
-			splits[split->hashValue(rows,cols)]= split;
-			return split;
+	//Crossings are indexed by the grid point with the smaller coordinates and whether they lie on that point, on its
+	//horizontal edge or on its vertical edge. Only two columns of that index are live at once.
+	uint32_t IsoContour::createSplit(Stripe& stripe, int p1x, int p1y, int p2x, int p2y) {
+		int x = std::min(p1x, p2x);
+		int y = std::min(p1y, p2y);
+		int kind = (p1x != p2x) ? 1 : ((p1y != p2y) ? 2 : 0);
+		int& local = stripe.columns[x & 1][3 * y + kind];
+		if (local >= 0) {
+			return (uint32_t) local;
 		}
+		local = (int) stripe.points.size();
+		float fOffset = fGetOffset(stripe, uint2(p1x, p1y), uint2(p2x, p2y));
+		float fInvOffset = 1.0f - fOffset;
+		stripe.points.push_back(float2(fInvOffset * p1x + fOffset * p2x, fInvOffset * p1y + fOffset * p2y));
+		stripe.seams.push_back((x == stripe.begin && stripe.begin > 0) ? 3 * y + kind : -1);
+		return (uint32_t) local;
 	}
 }
@@ -0,0 +1,585 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "AlloyIsoSurface.h"
+#include <algorithm>
+namespace aly {
+	//Corner and edge numbering follow the marching cubes table below. Edge e runs along axis (e>>2) from the corner
+	//offset stored in edgeBase.
+	static const int3 edgeBase[12] = { int3(0, 0, 0), int3(0, 1, 0), int3(0, 0, 1), int3(0, 1, 1), int3(0, 0, 0), int3(1, 0, 0),
+			int3(0, 0, 1), int3(1, 0, 1), int3(0, 0, 0), int3(1, 0, 0), int3(0, 1, 0), int3(1, 1, 0) };
+	static const int3 cornerOffset[8] = { int3(0, 0, 0), int3(1, 0, 0), int3(1, 1, 0), int3(0, 1, 0), int3(0, 0, 1), int3(1, 0, 1),
+			int3(1, 1, 1), int3(0, 1, 1) };
+	static const int3 axisOffset[3] = { int3(1, 0, 0), int3(0, 1, 0), int3(0, 0, 1) };
+	float IsoSurface::getValue(int i, int j, int k) const {
+		float val = vol->data[i + (size_t) rows * (j + (size_t) cols * k)].x - isoLevel;
+		if (nudgeLevelSet) {
+			if (val < 0) {
+				val = std::min(val, -LEVEL_SET_TOLERANCE);
+			} else {
+				val = std::max(val, LEVEL_SET_TOLERANCE);
+			}
+		}
+		return val;
+	}
+	bool IsoSurface::isInside(int i, int j, int k) const {
+		return (vol->data[i + (size_t) rows * (j + (size_t) cols * k)].x < isoLevel);
+	}
+	float3 IsoSurface::getGradient(int i, int j, int k) const {
+		return 0.5f * float3(
+			(*vol)(i + 1, j, k).x - (*vol)(i - 1, j, k).x,
+			(*vol)(i, j + 1, k).x - (*vol)(i, j - 1, k).x,
+			(*vol)(i, j, k + 1).x - (*vol)(i, j, k - 1).x);
+	}
+	float IsoSurface::fGetOffset(int3 v1, int3 v2) const {
+		float fValue1 = getValue(v1.x, v1.y, v1.z);
+		float fValue2 = getValue(v2.x, v2.y, v2.z);
+		double fDelta = fValue2 - fValue1;
+		if (fDelta == 0.0) {
+			return 0.5f;
+		}
+		return (float) (-fValue1 / fDelta);
+	}
+	//A brick is skipped when all of its samples, including the shared layer with the next brick, lie on one side.
+	void IsoSurface::findActiveBricks() {
+		brickDims = int3((rows + BRICK_SIZE - 1) / BRICK_SIZE, (cols + BRICK_SIZE - 1) / BRICK_SIZE,
+				(slices + BRICK_SIZE - 1) / BRICK_SIZE);
+		int brickCount = brickDims.x * brickDims.y * brickDims.z;
+		std::vector<uint8_t> active(brickCount, 0);
+#pragma omp parallel for schedule(dynamic)
+		for (int b = 0; b < brickCount; b++) {
+			int3 origin = BRICK_SIZE * int3(b % brickDims.x, (b / brickDims.x) % brickDims.y, b / (brickDims.x * brickDims.y));
+			int3 last = aly::min(origin + int3(BRICK_SIZE), int3(rows - 1, cols - 1, slices - 1));
+			bool inside = false, outside = false;
+			for (int k = origin.z; k <= last.z; k++) {
+				for (int j = origin.y; j <= last.y; j++) {
+					const float1* ptr = &vol->data[origin.x + (size_t) rows * (j + (size_t) cols * k)];
+					for (int i = 0; i <= last.x - origin.x; i++) {
+						if (ptr[i].x < isoLevel) {
+							inside = true;
+						} else {
+							outside = true;
+						}
+					}
+					if (inside && outside) {
+						active[b] = 1;
+						k = last.z;
+						break;
+					}
+				}
+			}
+		}
+		bricks.clear();
+		brickLookup.assign(brickCount, -1);
+		for (int b = 0; b < brickCount; b++) {
+			if (active[b]) {
+				brickLookup[b] = (int) bricks.size();
+				Brick brick;
+				brick.origin = BRICK_SIZE * int3(b % brickDims.x, (b / brickDims.x) % brickDims.y, b / (brickDims.x * brickDims.y));
+				bricks.push_back(brick);
+			}
+		}
+	}
+	uint32_t IsoSurface::findVertex(int3 voxel, int axis, int stride) const {
+		int3 b = voxel / int3(BRICK_SIZE);
+		const Brick& brick = bricks[brickLookup[b.x + brickDims.x * (b.y + brickDims.y * b.z)]];
+		int3 local = voxel - brick.origin;
+		uint32_t key = (uint32_t) ((local.x + BRICK_SIZE * (local.y + BRICK_SIZE * local.z)) * stride + axis);
+		return brick.vertexOffset
+				+ (uint32_t) (std::lower_bound(brick.vertexKeys.begin(), brick.vertexKeys.end(), key) - brick.vertexKeys.begin());
+	}
+	//Marching cubes: vertexes are the crossing edges whose base voxel lies in the brick, faces are the brick's cells.
+	//Dual contouring: vertexes are the cells with a crossing edge, faces are the crossing edges with four valid cells.
+	void IsoSurface::classifyBrick(Brick& brick, const IsoSurfaceMethod& method) {
+		const int3 dims(rows, cols, slices);
+		const int S = BRICK_SIZE + 1;
+		int3 last = aly::min(brick.origin + int3(BRICK_SIZE), dims);
+		int3 sampleLast = aly::min(brick.origin + int3(S), dims);
+		//Classify each sample once, including the layer shared with the next brick.
+		std::vector<uint8_t> inside(S * S * S, 0);
+		for (int k = brick.origin.z; k < sampleLast.z; k++) {
+			for (int j = brick.origin.y; j < sampleLast.y; j++) {
+				const float1* ptr = &vol->data[brick.origin.x + (size_t) rows * (j + (size_t) cols * k)];
+				uint8_t* flags = &inside[S * ((j - brick.origin.y) + S * (k - brick.origin.z))];
+				for (int i = 0; i < sampleLast.x - brick.origin.x; i++) {
+					flags[i] = (ptr[i].x < isoLevel);
+				}
+			}
+		}
+		const int sampleStride[3] = { 1, S, S * S };
+		int cornerStride[8];
+		for (int c = 0; c < 8; c++) {
+			cornerStride[c] = cornerOffset[c].x + S * (cornerOffset[c].y + S * cornerOffset[c].z);
+		}
+		brick.faceCount = 0;
+		for (int k = brick.origin.z; k < last.z; k++) {
+			for (int j = brick.origin.y; j < last.y; j++) {
+				for (int i = brick.origin.x; i < last.x; i++) {
+					int3 pt(i, j, k);
+					int3 lpt = pt - brick.origin;
+					uint32_t local = (uint32_t) (lpt.x + BRICK_SIZE * (lpt.y + BRICK_SIZE * lpt.z));
+					const uint8_t* flags = &inside[lpt.x + S * (lpt.y + S * lpt.z)];
+					for (int a = 0; a < 3; a++) {
+						if (pt[a] + 1 >= dims[a] || flags[sampleStride[a]] == flags[0]) {
+							continue;
+						}
+						if (method == IsoSurfaceMethod::MarchingCubes) {
+							brick.vertexKeys.push_back(3 * local + a);
+						} else {
+							int b1 = (a + 1) % 3, b2 = (a + 2) % 3;
+							if (pt[b1] > 0 && pt[b2] > 0 && pt[b1] + 1 < dims[b1] && pt[b2] + 1 < dims[b2]) {
+								brick.faceKeys.push_back(3 * local + a);
+								brick.faceCodes.push_back(flags[0]);
+								brick.faceCount++;
+							}
+						}
+					}
+					if (i + 1 >= rows || j + 1 >= cols || k + 1 >= slices) {
+						continue;
+					}
+					int code = 0;
+					for (int c = 0; c < 8; c++) {
+						code |= (flags[cornerStride[c]] << c);
+					}
+					if (code == 0 || code == 255) {
+						continue;
+					}
+					if (method == IsoSurfaceMethod::MarchingCubes) {
+						if (rule == TopologyRule3D::Connect26) {
+							code = (~code) & 255;
+						}
+						brick.faceKeys.push_back(local);
+						brick.faceCodes.push_back((uint8_t) code);
+						for (int t = 0; triangleTable[code][t] >= 0; t += 3) {
+							brick.faceCount++;
+						}
+					} else {
+						brick.vertexKeys.push_back(local);
+					}
+				}
+			}
+		}
+	}
+	//Looks up a vertex in the brick's dense id table when it belongs to the brick, otherwise in the owning neighbor.
+	uint32_t IsoSurface::findVertex(const Brick& brick, const std::vector<uint32_t>& localIds, int3 voxel, int axis,
+			int stride) const {
+		int3 local = voxel - brick.origin;
+		if (local.x >= 0 && local.y >= 0 && local.z >= 0 && local.x < BRICK_SIZE && local.y < BRICK_SIZE && local.z < BRICK_SIZE) {
+			return localIds[(local.x + BRICK_SIZE * (local.y + BRICK_SIZE * local.z)) * stride + axis];
+		}
+		return findVertex(voxel, axis, stride);
+	}
+	void IsoSurface::processCubes(Brick& brick, Mesh& mesh) {
+		std::vector<uint32_t> localIds(3 * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE);
+		for (size_t n = 0; n < brick.vertexKeys.size(); n++) {
+			uint32_t key = brick.vertexKeys[n];
+			uint32_t local = key / 3;
+			int3 v1 = brick.origin + int3(local % BRICK_SIZE, (local / BRICK_SIZE) % BRICK_SIZE, local / (BRICK_SIZE * BRICK_SIZE));
+			int3 v2 = v1 + axisOffset[key % 3];
+			float fOffset = fGetOffset(v1, v2);
+			mesh.vertexLocations[brick.vertexOffset + n] = (1.0f - fOffset) * float3(v1) + fOffset * float3(v2);
+			localIds[key] = brick.vertexOffset + (uint32_t) n;
+		}
+		uint32_t f = brick.faceOffset;
+		for (size_t n = 0; n < brick.faceKeys.size(); n++) {
+			uint32_t local = brick.faceKeys[n];
+			int code = brick.faceCodes[n];
+			int3 cell = brick.origin + int3(local % BRICK_SIZE, (local / BRICK_SIZE) % BRICK_SIZE, local / (BRICK_SIZE * BRICK_SIZE));
+			const int* tri = triangleTable[code];
+			for (int t = 0; tri[t] >= 0; t += 3) {
+				uint3 face;
+				for (int c = 0; c < 3; c++) {
+					face[c] = findVertex(brick, localIds, cell + edgeBase[tri[t + c]], tri[t + c] >> 2, 3);
+				}
+				if (rule == TopologyRule3D::Connect26) {
+					std::swap(face.y, face.z);
+				}
+				mesh.triIndexes[f++] = face;
+			}
+		}
+	}
+	//Minimizes the quadratic error of the edge crossing planes relative to their mass point, discarding directions
+	//with small eigenvalues so flat regions stay near the mass point.
+	float3 IsoSurface::solveDualVertex(int3 cell) const {
+		float3x3 ATA(float3(0.0f), float3(0.0f), float3(0.0f));
+		float3 ATb(0.0f);
+		float3 center(0.0f);
+		float3 points[12], normals[12];
+		int count = 0;
+		for (int e = 0; e < 12; e++) {
+			int3 v1 = cell + edgeBase[e];
+			int3 v2 = v1 + axisOffset[e >> 2];
+			if (isInside(v1.x, v1.y, v1.z) == isInside(v2.x, v2.y, v2.z)) {
+				continue;
+			}
+			float fOffset = fGetOffset(v1, v2);
+			float3 pt = (1.0f - fOffset) * float3(v1) + fOffset * float3(v2);
+			float3 norm = (1.0f - fOffset) * getGradient(v1.x, v1.y, v1.z) + fOffset * getGradient(v2.x, v2.y, v2.z);
+			points[count] = pt;
+			normals[count++] = normalize(norm);
+			center += pt;
+		}
+		center /= (float) count;
+		for (int n = 0; n < count; n++) {
+			ATA += outerProd(normals[n], normals[n]);
+			ATb += normals[n] * dot(normals[n], points[n] - center);
+		}
+		float3x3 Q, D;
+		Eigen(ATA, Q, D, false);
+		float maxEig = std::max(std::abs(D(0, 0)), std::max(std::abs(D(1, 1)), std::abs(D(2, 2))));
+		float3 lambda(0.0f);
+		for (int c = 0; c < 3; c++) {
+			if (std::abs(D(c, c)) > 0.1f * maxEig) {
+				lambda[c] = 1.0f / D(c, c);
+			}
+		}
+		float3 pt = center + Q * (lambda * (transpose(Q) * ATb));
+		return clamp(pt, float3(cell), float3(cell + int3(1)));
+	}
+	void IsoSurface::processDualCells(Brick& brick, Mesh& mesh) {
+		std::vector<uint32_t> localIds(BRICK_SIZE * BRICK_SIZE * BRICK_SIZE);
+		for (size_t n = 0; n < brick.vertexKeys.size(); n++) {
+			uint32_t local = brick.vertexKeys[n];
+			int3 cell = brick.origin + int3(local % BRICK_SIZE, (local / BRICK_SIZE) % BRICK_SIZE, local / (BRICK_SIZE * BRICK_SIZE));
+			mesh.vertexLocations[brick.vertexOffset + n] = solveDualVertex(cell);
+			localIds[local] = brick.vertexOffset + (uint32_t) n;
+		}
+		for (size_t n = 0; n < brick.faceKeys.size(); n++) {
+			uint32_t key = brick.faceKeys[n];
+			uint32_t local = key / 3;
+			int a = key % 3;
+			int3 v = brick.origin + int3(local % BRICK_SIZE, (local / BRICK_SIZE) % BRICK_SIZE, local / (BRICK_SIZE * BRICK_SIZE));
+			int3 d1 = axisOffset[(a + 1) % 3], d2 = axisOffset[(a + 2) % 3];
+			//Cells around the edge in counter-clockwise order when looking down the edge axis.
+			uint4 quad(findVertex(brick, localIds, v - d1 - d2, 0, 1), findVertex(brick, localIds, v - d2, 0, 1),
+					findVertex(brick, localIds, v, 0, 1), findVertex(brick, localIds, v - d1, 0, 1));
+			if (!brick.faceCodes[n]) {
+				std::swap(quad.y, quad.w);
+			}
+			mesh.quadIndexes[brick.faceOffset + n] = quad;
+		}
+	}
+	void IsoSurface::solve(const Volume1f& levelset, Mesh& mesh, float isoLevel, const TopologyRule3D& topoRule, const IsoSurfaceMethod& method) {
+		rows = levelset.rows;
+		cols = levelset.cols;
+		slices = levelset.slices;
+		this->isoLevel = isoLevel;
+		rule = topoRule;
+		vol = &levelset;
+		mesh.clear();
+		findActiveBricks();
+#pragma omp parallel for schedule(dynamic)
+		for (int b = 0; b < (int) bricks.size(); b++) {
+			classifyBrick(bricks[b], method);
+		}
+		uint32_t vertexCount = 0, faceCount = 0;
+		for (Brick& brick : bricks) {
+			brick.vertexOffset = vertexCount;
+			brick.faceOffset = faceCount;
+			vertexCount += (uint32_t) brick.vertexKeys.size();
+			faceCount += brick.faceCount;
+		}
+		mesh.vertexLocations.resize(vertexCount);
+		if (method == IsoSurfaceMethod::MarchingCubes) {
+			mesh.triIndexes.resize(faceCount);
+		} else {
+			mesh.quadIndexes.resize(faceCount);
+		}
+#pragma omp parallel for schedule(dynamic)
+		for (int b = 0; b < (int) bricks.size(); b++) {
+			if (method == IsoSurfaceMethod::MarchingCubes) {
+				processCubes(bricks[b], mesh);
+			} else {
+				processDualCells(bricks[b], mesh);
+			}
+		}
+		bricks.clear();
+		brickLookup.clear();
+		vol = nullptr;
+		mesh.updateBoundingBox();
+		mesh.updateVertexNormals();
+		mesh.setDirty(true);
+	}
+	/*
+	 * Marching cubes triangle table from the Poisson surface reconstruction code (src/poisson/MarchingCubes.cpp).
+	 *
+	 * Copyright (c) 2006, Michael Kazhdan and Matthew Bolitho. All rights reserved.
+	 * Distributed under the BSD license reproduced in src/poisson/MarchingCubes.cpp.
+	 */
+	const int IsoSurface::triangleTable[256][16] = {
+	{  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   4,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   9,   5,   8,   5,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   5,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   4,   8,   1,   5,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,  11,   1,   9,   1,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   9,  11,   8,  11,   1,   8,   1,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   1,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   8,   0,  10,   0,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,   4,   1,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   8,   9,  10,   9,   5,  10,   5,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,  10,   4,  11,   4,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,  10,   8,  11,   8,   0,  11,   0,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,  11,  10,   9,  10,   4,   9,   4,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   9,  11,   8,  11,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   6,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   6,   2,   0,   4,   6,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   6,   2,   8,   5,   0,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   4,   6,   9,   5,   6,   2,   9,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   5,  11,   8,   6,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   5,  11,   6,   2,   0,   4,   6,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   6,   2,   8,   9,  11,   1,   9,   1,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,  11,   2,   2,  11,   1,   2,   1,   6,   6,   1,   4,  -1,  -1,  -1,  -1},
+	{   1,  10,   4,   2,   8,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   0,   1,   6,   2,   1,  10,   6,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,   4,   1,  10,   8,   6,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   2,   9,   5,   6,   2,   5,   1,   6,   1,  10,   6,  -1,  -1,  -1,  -1},
+	{   2,   8,   6,   4,   5,  11,   4,  11,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   2,   0,   6,   2,   5,  11,   6,   5,  10,   6,  11,  -1,  -1,  -1,  -1},
+	{   9,  11,  10,   9,  10,   4,   9,   4,   0,   8,   6,   2,  -1,  -1,  -1,  -1},
+	{   9,  11,   2,   2,  11,   6,  10,   6,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   2,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   9,   2,   4,   8,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   2,   7,   0,   7,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   5,   4,   2,   7,   4,   8,   2,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   9,   2,   5,  11,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   5,  11,   0,   4,   8,   9,   2,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   0,   2,   1,   2,   7,   1,   7,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   7,  11,   1,   2,   7,   1,   4,   2,   4,   8,   2,  -1,  -1,  -1,  -1},
+	{   4,   1,  10,   9,   2,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   9,   2,   0,   1,  10,   0,  10,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   1,  10,   2,   7,   5,   0,   2,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,  10,   8,   1,  10,   2,   7,   1,   2,   5,   1,   7,  -1,  -1,  -1,  -1},
+	{   7,   9,   2,  10,   4,   5,  11,  10,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,  10,   8,  11,   8,   0,  11,   0,   5,   9,   2,   7,  -1,  -1,  -1,  -1},
+	{  11,  10,   7,   7,  10,   4,   7,   4,   2,   2,   4,   0,  -1,  -1,  -1,  -1},
+	{  11,  10,   7,   7,  10,   2,   8,   2,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   9,   8,   6,   7,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   6,   7,   0,   4,   7,   9,   0,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   6,   7,   5,   8,   6,   5,   0,   8,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   6,   7,   5,   4,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,  11,   1,   8,   6,   7,   9,   8,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   6,   7,   0,   4,   7,   9,   0,   7,  11,   1,   5,  -1,  -1,  -1,  -1},
+	{   8,   1,   0,  11,   1,   8,   6,  11,   8,   7,  11,   6,  -1,  -1,  -1,  -1},
+	{  11,   6,   7,   1,   6,  11,   6,   1,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,  10,   4,   6,   7,   9,   6,   9,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   1,   9,   9,   1,  10,   9,  10,   7,   7,  10,   6,  -1,  -1,  -1,  -1},
+	{   6,   7,   5,   8,   6,   5,   0,   8,   5,   1,  10,   4,  -1,  -1,  -1,  -1},
+	{   1,   7,   5,  10,   7,   1,   7,  10,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,  10,   4,  11,   4,   5,   7,   9,   8,   6,   7,   8,  -1,  -1,  -1,  -1},
+	{   0,   6,   9,   9,   6,   7,   6,   0,   5,   5,  11,  10,   5,  10,   6,  -1},
+	{   8,   7,   0,   6,   7,   8,   4,   0,   7,  11,  10,   4,   7,  11,   4,  -1},
+	{  11,  10,   6,  11,   6,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   7,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   4,   8,  11,   7,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   5,   0,  11,   7,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   7,   3,   4,   8,   9,   5,   4,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   1,   5,   3,   5,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   4,   8,   7,   3,   1,   5,   7,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   1,   0,   3,   0,   9,   3,   9,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   8,   9,   4,   8,   7,   3,   4,   7,   1,   4,   3,  -1,  -1,  -1,  -1},
+	{   1,  10,   4,   3,  11,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,  11,   7,   8,   0,   1,  10,   8,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   1,  10,   5,   0,   9,  11,   7,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   8,   9,  10,   9,   5,  10,   5,   1,  11,   7,   3,  -1,  -1,  -1,  -1},
+	{   4,   5,   7,   4,   7,   3,   4,   3,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   8,   3,   3,   8,   0,   3,   0,   7,   7,   0,   5,  -1,  -1,  -1,  -1},
+	{   4,   3,  10,   4,   7,   3,   4,   0,   7,   0,   9,   7,  -1,  -1,  -1,  -1},
+	{  10,   8,   3,   3,   8,   7,   9,   7,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   7,   3,   8,   6,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   7,   3,   2,   0,   4,   2,   4,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   7,   3,   8,   6,   2,   5,   0,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   4,   6,   9,   5,   6,   2,   9,   6,   3,  11,   7,  -1,  -1,  -1,  -1},
+	{   8,   6,   2,   3,   1,   5,   3,   5,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   1,   5,   3,   5,   7,   6,   2,   0,   4,   6,   0,  -1,  -1,  -1,  -1},
+	{   3,   1,   0,   3,   0,   9,   3,   9,   7,   2,   8,   6,  -1,  -1,  -1,  -1},
+	{   9,   4,   2,   2,   4,   6,   4,   9,   7,   7,   3,   1,   7,   1,   4,  -1},
+	{   8,   6,   2,  11,   7,   3,   4,   1,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   0,   1,   6,   2,   1,  10,   6,   1,  11,   7,   3,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,   4,   1,  10,   8,   6,   2,  11,   7,   3,  -1,  -1,  -1,  -1},
+	{  11,   7,   3,   5,   2,   9,   5,   6,   2,   5,   1,   6,   1,  10,   6,  -1},
+	{   4,   5,   7,   4,   7,   3,   4,   3,  10,   6,   2,   8,  -1,  -1,  -1,  -1},
+	{  10,   5,   3,   3,   5,   7,   5,  10,   6,   6,   2,   0,   6,   0,   5,  -1},
+	{   8,   6,   2,   4,   3,  10,   4,   7,   3,   4,   0,   7,   0,   9,   7,  -1},
+	{   9,   7,  10,  10,   7,   3,  10,   6,   9,   6,   2,   9,  -1,  -1,  -1,  -1},
+	{   3,  11,   9,   2,   3,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   8,   0,   2,   3,  11,   2,  11,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   2,   3,   0,   3,  11,   0,  11,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   3,   8,   8,   3,  11,   8,  11,   4,   4,  11,   5,  -1,  -1,  -1,  -1},
+	{   2,   3,   1,   2,   1,   5,   2,   5,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   3,   1,   2,   1,   5,   2,   5,   9,   0,   4,   8,  -1,  -1,  -1,  -1},
+	{   0,   2,   3,   0,   3,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   3,   8,   8,   3,   4,   1,   4,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,  10,   4,   9,   2,   3,  11,   9,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   8,   0,  10,   0,   1,   3,  11,   9,   2,   3,   9,  -1,  -1,  -1,  -1},
+	{   0,   2,   3,   0,   3,  11,   0,  11,   5,   1,  10,   4,  -1,  -1,  -1,  -1},
+	{   5,   2,  11,  11,   2,   3,   2,   5,   1,   1,  10,   8,   1,   8,   2,  -1},
+	{  10,   2,   3,   9,   2,  10,   4,   9,  10,   5,   9,   4,  -1,  -1,  -1,  -1},
+	{   5,  10,   0,   0,  10,   8,  10,   5,   9,   9,   2,   3,   9,   3,  10,  -1},
+	{   0,   2,   4,   4,   2,  10,   3,  10,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   8,   2,  10,   2,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   9,   8,   3,  11,   8,   6,   3,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,  11,   9,   3,  11,   0,   4,   3,   0,   6,   3,   4,  -1,  -1,  -1,  -1},
+	{  11,   5,   3,   5,   0,   3,   0,   6,   3,   0,   8,   6,  -1,  -1,  -1,  -1},
+	{   3,   4,   6,  11,   4,   3,   4,  11,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   1,   6,   6,   1,   5,   6,   5,   8,   8,   5,   9,  -1,  -1,  -1,  -1},
+	{   0,   6,   9,   4,   6,   0,   5,   9,   6,   3,   1,   5,   6,   3,   5,  -1},
+	{   3,   1,   6,   6,   1,   8,   0,   8,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   1,   4,   3,   4,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   9,   8,   3,  11,   8,   6,   3,   8,   4,   1,  10,  -1,  -1,  -1,  -1},
+	{   3,   9,   6,  11,   9,   3,  10,   6,   9,   0,   1,  10,   9,   0,  10,  -1},
+	{   4,   1,  10,  11,   5,   3,   5,   0,   3,   0,   6,   3,   0,   8,   6,  -1},
+	{   5,  10,   6,   1,  10,   5,   6,  11,   5,   6,   3,  11,  -1,  -1,  -1,  -1},
+	{  10,   5,   3,   4,   5,  10,   6,   3,   5,   9,   8,   6,   5,   9,   6,  -1},
+	{   6,   3,  10,   9,   0,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,  10,   0,   0,  10,   4,   0,   8,   3,   8,   6,   3,  -1,  -1,  -1,  -1},
+	{   6,   3,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   3,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   6,  10,   0,   4,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,  10,   3,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   6,  10,   8,   9,   5,   8,   5,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   1,   5,  10,   3,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   4,   8,   1,   5,  11,  10,   3,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   3,   6,   0,   9,  11,   1,   0,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   9,  11,   8,  11,   1,   8,   1,   4,  10,   3,   6,  -1,  -1,  -1,  -1},
+	{   4,   1,   3,   6,   4,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   1,   3,   8,   0,   3,   6,   8,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,   3,   6,   4,   1,   3,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   9,   6,   6,   9,   5,   6,   5,   3,   3,   5,   1,  -1,  -1,  -1,  -1},
+	{   6,   4,   5,   6,   5,  11,   6,  11,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   6,   8,   0,   3,   6,   0,   5,   3,   5,  11,   3,  -1,  -1,  -1,  -1},
+	{   3,   9,  11,   0,   9,   3,   6,   0,   3,   4,   0,   6,  -1,  -1,  -1,  -1},
+	{   8,   9,   6,   6,   9,   3,  11,   3,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   8,  10,   3,   2,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   2,   0,  10,   3,   0,   4,  10,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,   8,  10,   3,   8,   3,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   3,   2,  10,   3,   9,   5,  10,   9,   4,  10,   5,  -1,  -1,  -1,  -1},
+	{  11,   1,   5,   2,   8,  10,   3,   2,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   2,   0,  10,   3,   0,   4,  10,   0,   5,  11,   1,  -1,  -1,  -1,  -1},
+	{   9,  11,   1,   9,   1,   0,   2,   8,  10,   3,   2,  10,  -1,  -1,  -1,  -1},
+	{  10,   2,   4,   3,   2,  10,   1,   4,   2,   9,  11,   1,   2,   9,   1,  -1},
+	{   1,   3,   2,   4,   1,   2,   8,   4,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   1,   3,   2,   0,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   3,   2,   4,   1,   2,   8,   4,   2,   9,   5,   0,  -1,  -1,  -1,  -1},
+	{   9,   3,   2,   5,   3,   9,   3,   5,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   2,  11,  11,   2,   8,  11,   8,   5,   5,   8,   4,  -1,  -1,  -1,  -1},
+	{   5,   2,   0,  11,   2,   5,   2,  11,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   3,   8,   8,   3,   2,   3,   4,   0,   0,   9,  11,   0,  11,   3,  -1},
+	{   9,  11,   3,   9,   3,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   3,   6,   9,   2,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   2,   7,  10,   3,   6,   0,   4,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   3,   6,   7,   5,   0,   7,   0,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   5,   4,   2,   7,   4,   8,   2,   4,  10,   3,   6,  -1,  -1,  -1,  -1},
+	{  10,   3,   6,   9,   2,   7,   1,   5,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   3,   6,   9,   2,   7,   1,   5,  11,   0,   4,   8,  -1,  -1,  -1,  -1},
+	{   1,   0,   2,   1,   2,   7,   1,   7,  11,   3,   6,  10,  -1,  -1,  -1,  -1},
+	{  10,   3,   6,   1,   7,  11,   1,   2,   7,   1,   4,   2,   4,   8,   2,  -1},
+	{   9,   2,   7,   6,   4,   1,   6,   1,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   1,   3,   8,   0,   3,   6,   8,   3,   7,   9,   2,  -1,  -1,  -1,  -1},
+	{   0,   2,   7,   0,   7,   5,   4,   1,   3,   6,   4,   3,  -1,  -1,  -1,  -1},
+	{   2,   5,   8,   7,   5,   2,   6,   8,   5,   1,   3,   6,   5,   1,   6,  -1},
+	{   6,   4,   5,   6,   5,  11,   6,  11,   3,   7,   9,   2,  -1,  -1,  -1,  -1},
+	{   9,   2,   7,   0,   6,   8,   0,   3,   6,   0,   5,   3,   5,  11,   3,  -1},
+	{   3,   4,  11,   6,   4,   3,   7,  11,   4,   0,   2,   7,   4,   0,   7,  -1},
+	{  11,   3,   8,   8,   3,   6,   8,   2,  11,   2,   7,  11,  -1,  -1,  -1,  -1},
+	{   9,   8,  10,   7,   9,  10,   3,   7,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   0,   7,   0,   4,   7,   4,   3,   7,   4,  10,   3,  -1,  -1,  -1,  -1},
+	{   8,  10,   0,   0,  10,   3,   0,   3,   5,   5,   3,   7,  -1,  -1,  -1,  -1},
+	{  10,   5,   4,   3,   5,  10,   5,   3,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   8,  10,   7,   9,  10,   3,   7,  10,   1,   5,  11,  -1,  -1,  -1,  -1},
+	{   1,   5,  11,   9,   0,   7,   0,   4,   7,   4,   3,   7,   4,  10,   3,  -1},
+	{  11,   0,   7,   1,   0,  11,   3,   7,   0,   8,  10,   3,   0,   8,   3,  -1},
+	{   7,   1,   4,  11,   1,   7,   4,   3,   7,   4,  10,   3,  -1,  -1,  -1,  -1},
+	{   4,   9,   8,   7,   9,   4,   1,   7,   4,   3,   7,   1,  -1,  -1,  -1,  -1},
+	{   7,   1,   3,   9,   1,   7,   1,   9,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   7,   0,   0,   7,   5,   7,   8,   4,   4,   1,   3,   4,   3,   7,  -1},
+	{   5,   1,   3,   7,   5,   3,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   4,  11,  11,   4,   5,   4,   3,   7,   7,   9,   8,   7,   8,   4,  -1},
+	{   3,   9,   0,   7,   9,   3,   0,  11,   3,   0,   5,  11,  -1,  -1,  -1,  -1},
+	{   3,   7,  11,   8,   4,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   3,   7,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   6,  10,  11,   7,   6,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,   4,   8,  10,  11,   7,  10,   7,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   5,   0,   6,  10,  11,   7,   6,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   9,   5,   8,   5,   4,   6,  10,  11,   7,   6,  11,  -1,  -1,  -1,  -1},
+	{   5,   7,   6,   5,   6,  10,   5,  10,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   7,   6,   5,   6,  10,   5,  10,   1,   4,   8,   0,  -1,  -1,  -1,  -1},
+	{   1,   0,  10,  10,   0,   9,  10,   9,   6,   6,   9,   7,  -1,  -1,  -1,  -1},
+	{   1,   7,  10,  10,   7,   6,   7,   1,   4,   4,   8,   9,   4,   9,   7,  -1},
+	{   7,   6,   4,   7,   4,   1,   7,   1,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   0,   1,   8,   0,  11,   7,   8,  11,   6,   8,   7,  -1,  -1,  -1,  -1},
+	{   7,   6,   4,   7,   4,   1,   7,   1,  11,   5,   0,   9,  -1,  -1,  -1,  -1},
+	{  11,   6,   1,   7,   6,  11,   5,   1,   6,   8,   9,   5,   6,   8,   5,  -1},
+	{   4,   5,   7,   4,   7,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   7,   0,   0,   7,   8,   6,   8,   7,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   6,   9,   9,   6,   0,   4,   0,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   9,   7,   8,   7,   6,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,  10,  11,   2,   8,  11,   7,   2,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,  11,   4,   4,  11,   7,   4,   7,   0,   0,   7,   2,  -1,  -1,  -1,  -1},
+	{   8,  10,  11,   2,   8,  11,   7,   2,  11,   5,   0,   9,  -1,  -1,  -1,  -1},
+	{   9,   4,   2,   5,   4,   9,   7,   2,   4,  10,  11,   7,   4,  10,   7,  -1},
+	{   1,   8,  10,   2,   8,   1,   5,   2,   1,   7,   2,   5,  -1,  -1,  -1,  -1},
+	{   1,   7,  10,   5,   7,   1,   4,  10,   7,   2,   0,   4,   7,   2,   4,  -1},
+	{   7,   1,   9,   9,   1,   0,   1,   7,   2,   2,   8,  10,   2,  10,   1,  -1},
+	{   7,   2,   9,  10,   1,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   4,   2,   4,   1,   2,   1,   7,   2,   1,  11,   7,  -1,  -1,  -1,  -1},
+	{  11,   0,   1,   7,   0,  11,   0,   7,   2,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   0,   9,   8,   4,   2,   4,   1,   2,   1,   7,   2,   1,  11,   7,  -1},
+	{   2,   5,   1,   9,   5,   2,   1,   7,   2,   1,  11,   7,  -1,  -1,  -1,  -1},
+	{   4,   5,   8,   8,   5,   2,   7,   2,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   2,   0,   5,   7,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   7,   2,   4,   4,   2,   8,   4,   0,   7,   0,   9,   7,  -1,  -1,  -1,  -1},
+	{   7,   2,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,  11,   9,   6,  10,   9,   2,   6,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,  11,   9,   6,  10,   9,   2,   6,   9,   0,   4,   8,  -1,  -1,  -1,  -1},
+	{   5,  10,  11,   6,  10,   5,   0,   6,   5,   2,   6,   0,  -1,  -1,  -1,  -1},
+	{   2,   5,   8,   8,   5,   4,   5,   2,   6,   6,  10,  11,   6,  11,   5,  -1},
+	{  10,   1,   6,   1,   5,   6,   5,   2,   6,   5,   9,   2,  -1,  -1,  -1,  -1},
+	{   0,   4,   8,  10,   1,   6,   1,   5,   6,   5,   2,   6,   5,   9,   2,  -1},
+	{   1,   0,  10,  10,   0,   6,   2,   6,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   6,   1,   1,   6,  10,   1,   4,   2,   4,   8,   2,  -1,  -1,  -1,  -1},
+	{  11,   9,   1,   1,   9,   2,   1,   2,   4,   4,   2,   6,  -1,  -1,  -1,  -1},
+	{   8,   1,   6,   0,   1,   8,   2,   6,   1,  11,   9,   2,   1,  11,   2,  -1},
+	{  11,   6,   1,   1,   6,   4,   6,  11,   5,   5,   0,   2,   5,   2,   6,  -1},
+	{   2,   6,   8,  11,   5,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   6,   4,   2,   2,   4,   9,   5,   9,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   9,   6,   6,   9,   2,   6,   8,   5,   8,   0,   5,  -1,  -1,  -1,  -1},
+	{   0,   2,   6,   0,   6,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   2,   6,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,  10,  11,   9,   8,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   0,  11,   9,   4,  11,   0,  11,   4,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,  10,  11,   0,  10,   5,  10,   0,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,  10,  11,   5,   4,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,   8,  10,   5,   8,   1,   8,   5,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   4,  10,   0,   4,   9,  10,   5,   9,  10,   1,   5,  -1,  -1,  -1,  -1},
+	{   0,   8,  10,   1,   0,  10,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  10,   1,   4,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   4,   9,   8,   1,   9,   4,   9,   1,  11,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   1,  11,   9,   0,   1,   9,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  11,   0,   8,   5,   0,  11,   8,   1,  11,   8,   4,   1,  -1,  -1,  -1,  -1},
+	{  11,   5,   1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   5,   9,   8,   4,   5,   8,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   9,   0,   5,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{   8,   4,   0,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1},
+	{  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1}
+	};
+}
@@ -532,6 +532,7 @@ void Mesh::clear() {
 	textureMap.clear();
 	textureImage.clear();
 	setDirty(true);
+	setTopologyDirty();
 }
 bool Mesh::save(const std::string& file) {
 	try {
@@ -547,11 +548,67 @@ void WriteMeshToFile(const std::string& file, const Mesh& mesh) {
 		WritePlyMeshToFile(file, mesh, true);
 	} else if (ext == "obj") {
 		WriteObjMeshToFile(file, mesh);
+	} else if (ext == "alyb") {
+		WriteBinaryMeshToFile(file, mesh);
 	} else
 		throw std::runtime_error(MakeString() << "Could not write mesh file " << file);
 }
+//Formats count records with format(buffer, i) in parallel blocks and writes the blocks in order.
+template<class F> static void WriteObjRecords(std::ostream& out, size_t count, const F& format) {
+	const size_t BLOCK = 1 << 14;
+	const int BATCH = 64;
+	std::vector<std::string> buffers(BATCH);
+	size_t blocks = (count + BLOCK - 1) / BLOCK;
+	for (size_t first = 0; first < blocks; first += BATCH) {
+		const int batch = (int) std::min((size_t) BATCH, blocks - first);
+#pragma omp parallel for
+		for (int b = 0; b < batch; b++) {
+			std::string& buffer = buffers[b];
+			buffer.clear();
+			size_t last = std::min(count, (first + b + 1) * BLOCK);
+			for (size_t i = (first + b) * BLOCK; i < last; i++) {
+				format(buffer, i);
+			}
+		}
+		for (int b = 0; b < batch; b++) {
+			out.write(buffers[b].data(), buffers[b].size());
+		}
+	}
+}
+//Same text as streaming a float with precision 8.
+static inline void AppendObjFloat(std::string& buffer, float value, char separator) {
+	char str[32];
+	int length = std::snprintf(str, sizeof(str), "%.8g", value);
+	buffer.append(str, length);
+	buffer.push_back(separator);
+}
+static inline void AppendObjIndex(std::string& buffer, uint32_t value, char separator) {
+	char str[16];
+	int length = 0;
+	do {
+		str[15 - length++] = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+	buffer.append(str + 16 - length, length);
+	buffer.push_back(separator);
+}
+//Face corners are written as v, v/v, v/vt or v/vt/v depending on the attributes of the mesh.
+static inline void AppendObjCorner(std::string& buffer, uint32_t v, uint32_t vt, bool normals, bool texture, char separator) {
+	if (normals && !texture) {
+		AppendObjIndex(buffer, v, '/');
+		AppendObjIndex(buffer, v, separator);
+	} else if (!normals && texture) {
+		AppendObjIndex(buffer, v, '/');
+		AppendObjIndex(buffer, vt, separator);
+	} else if (normals && texture) {
+		AppendObjIndex(buffer, v, '/');
+		AppendObjIndex(buffer, vt, '/');
+		AppendObjIndex(buffer, v, separator);
+	} else {
+		AppendObjIndex(buffer, v, separator);
+	}
+}
 void WriteObjMeshToFile(const std::string& file, const Mesh& mesh) {
-	uint32_t i;
 	std::ofstream out(file.c_str());
 	out << setprecision(8);
 	out << "####							 \n";
@@ -586,87 +643,353 @@ void WriteObjMeshToFile(const std::string& file, const Mesh& mesh) {
 		mtl << "map_Kd " << fileName << "\n";
 		mtl.close();
 	}
-	if (mesh.vertexNormals.size() > 0) {
-		for (i = 0; i < mesh.vertexNormals.size(); i++) {
+	bool hasNormals = (mesh.vertexNormals.size() > 0);
+	bool hasColors = (mesh.vertexColors.size() > 0);
+	bool hasTexture = (mesh.textureMap.size() > 0);
+	WriteObjRecords(out, (hasNormals) ? mesh.vertexNormals.size() : mesh.vertexLocations.size(), [&](std::string& buffer, size_t i) {
+		if (hasNormals) {
 			float3 n = mesh.vertexNormals[i];
-			out << "vn " << n.x << " " << n.y << " " << n.z << "\n";
-			float3 p = mesh.vertexLocations[i];
-			if (mesh.vertexColors.size() > 0) {
-				RGBAf c = mesh.vertexColors[i];
-				out << "v " << p.x << " " << p.y << " " << p.z << " " << c.x << " " << c.y << " " << c.z << "\n";
+			buffer.append("vn ");
+			AppendObjFloat(buffer, n.x, ' ');
+			AppendObjFloat(buffer, n.y, ' ');
+			AppendObjFloat(buffer, n.z, '\n');
+		}
+		float3 p = mesh.vertexLocations[i];
+		buffer.append("v ");
+		AppendObjFloat(buffer, p.x, ' ');
+		AppendObjFloat(buffer, p.y, ' ');
+		if (hasColors) {
+			RGBAf c = mesh.vertexColors[i];
+			AppendObjFloat(buffer, p.z, ' ');
+			AppendObjFloat(buffer, c.x, ' ');
+			AppendObjFloat(buffer, c.y, ' ');
+			AppendObjFloat(buffer, c.z, '\n');
+		} else {
+			AppendObjFloat(buffer, p.z, '\n');
+		}
+	});
+	WriteObjRecords(out, mesh.textureMap.size(), [&](std::string& buffer, size_t i) {
+		float2 vt = mesh.textureMap[i];
+		buffer.append("vt ");
+		AppendObjFloat(buffer, vt.x, ' ');
+		AppendObjFloat(buffer, vt.y, '\n');
+	});
+	if (mesh.textureMap.size() > 0 && mesh.textureImage.size() > 0)
+		out << "usemtl material_0\n";
+	WriteObjRecords(out, mesh.triIndexes.size(), [&](std::string& buffer, size_t t) {
+		uint3 tri = mesh.triIndexes[t];
+		uint32_t i = (uint32_t) (3 * t);
+		buffer.append("f ");
+		AppendObjCorner(buffer, tri.x + 1, i + 1, hasNormals, hasTexture, ' ');
+		AppendObjCorner(buffer, tri.y + 1, i + 2, hasNormals, hasTexture, ' ');
+		AppendObjCorner(buffer, tri.z + 1, i + 3, hasNormals, hasTexture, '\n');
+	});
+	WriteObjRecords(out, mesh.quadIndexes.size(), [&](std::string& buffer, size_t q) {
+		uint4 quad = mesh.quadIndexes[q];
+		uint32_t i = (uint32_t) (4 * q);
+		buffer.append("f ");
+		AppendObjCorner(buffer, quad.x + 1, i + 1, hasNormals, hasTexture, ' ');
+		AppendObjCorner(buffer, quad.y + 1, i + 2, hasNormals, hasTexture, ' ');
+		AppendObjCorner(buffer, quad.z + 1, i + 3, hasNormals, hasTexture, ' ');
+		AppendObjCorner(buffer, quad.w + 1, i + 4, hasNormals, hasTexture, '\n');
+	});
+	out.close();
+}
+//Vertex and face layout of a binary little endian PLY file that can be decoded in bulk.
+struct PlyBinaryLayout {
+	size_t vertexCount = 0;
+	size_t faceCount = 0;
+	size_t vertexStride = 0;
+	size_t dataOffset = 0;
+	int position[3] = { -1, -1, -1 };
+	int normal[3] = { -1, -1, -1 };
+	int color[3] = { -1, -1, -1 };
+};
+static int PlyScalarSize(const std::string& name) {
+	for (int t = static_cast<int>(DataType::Int8); t < static_cast<int>(DataType::EndType); t++) {
+		if (name == property_type_names[t] || name == old_property_type_names[t])
+			return ply_type_size[t];
+	}
+	return 0;
+}
+//Accepts vertex elements followed by face elements with a single uchar-count int-index list. Vertex properties
+//may be any scalars, but positions and normals must be float and colors uchar. Returns false for anything else.
+static bool ParseBinaryPlyHeader(const char* data, size_t size, PlyBinaryLayout& layout) {
+	const std::string END_HEADER = "end_header";
+	std::string header(data, std::min(size, (size_t) 65536));
+	size_t end = header.find(END_HEADER);
+	if (end == std::string::npos)
+		return false;
+	end = header.find('\n', end);
+	if (end == std::string::npos)
+		return false;
+	layout.dataOffset = end + 1;
+	std::istringstream lines(header.substr(0, end));
+	std::string line;
+	std::string element;
+	int elementIndex = -1;
+	bool faceIndices = false;
+	static const char* positionNames[3] = { "x", "y", "z" };
+	static const char* normalNames[3] = { "nx", "ny", "nz" };
+	static const char* colorNames[3] = { "red", "green", "blue" };
+	int lineNumber = 0;
+	while (std::getline(lines, line)) {
+		if (line.size() > 0 && line.back() == '\r')
+			line.pop_back();
+		std::istringstream words(line);
+		std::string keyword;
+		words >> keyword;
+		if (lineNumber++ == 0) {
+			if (keyword != "ply")
+				return false;
+		} else if (keyword == "format") {
+			std::string format;
+			words >> format;
+			if (format != "binary_little_endian")
+				return false;
+		} else if (keyword == "element") {
+			size_t count = 0;
+			words >> element >> count;
+			elementIndex++;
+			if (elementIndex == 0 && element == "vertex") {
+				layout.vertexCount = count;
+			} else if (elementIndex == 1 && element == "face") {
+				layout.faceCount = count;
 			} else {
-				out << "v " << p.x << " " << p.y << " " << p.z << "\n";
+				return false;
 			}
-		}
-	} else {
-		for (i = 0; i < mesh.vertexLocations.size(); i++) {
-			float3 p = mesh.vertexLocations[i];
-			if (mesh.vertexColors.size() > 0) {
-				RGBAf c = mesh.vertexColors[i];
-				out << "v " << p.x << " " << p.y << " " << p.z << " " << c.x << " " << c.y << " " << c.z << "\n";
+		} else if (keyword == "property") {
+			std::string type, name;
+			words >> type;
+			if (element == "vertex") {
+				if (type == "list")
+					return false;
+				words >> name;
+				int bytes = PlyScalarSize(type);
+				if (bytes == 0)
+					return false;
+				for (int c = 0; c < 3; c++) {
+					if (name == positionNames[c] || name == normalNames[c]) {
+						if (type != "float" && type != "float32")
+							return false;
+						((name == positionNames[c]) ? layout.position : layout.normal)[c] = (int) layout.vertexStride;
+					} else if (name == colorNames[c]) {
+						if (type != "uchar" && type != "uint8")
+							return false;
+						layout.color[c] = (int) layout.vertexStride;
+					}
+				}
+				layout.vertexStride += bytes;
+			} else if (element == "face") {
+				std::string countType, indexType;
+				words >> countType >> indexType >> name;
+				if (faceIndices || type != "list" || (countType != "uchar" && countType != "uint8")
+						|| (indexType != "int" && indexType != "int32" && indexType != "uint" && indexType != "uint32")
+						|| (name != "vertex_indices" && name != "vertex_index"))
+					return false;
+				faceIndices = true;
 			} else {
-				out << "v " << p.x << " " << p.y << " " << p.z << "\n";
+				return false;
 			}
+		} else if (keyword != "comment" && keyword != "obj_info" && keyword != END_HEADER) {
+			return false;
 		}
 	}
-
-	for (i = 0; i < mesh.textureMap.size(); i++) {
-		float2 vt = mesh.textureMap[i];
-		out << "vt " << vt.x << " " << vt.y << "\n";
+	return (elementIndex == 1 && faceIndices && layout.position[0] >= 0
+			&& layout.position[1] >= 0 && layout.position[2] >= 0);
+}
+//Decodes the common binary PLY layouts straight from a memory mapped file. Vertex blocks are converted in
+//parallel. Faces are variable length, so one pass records where each block of faces starts before they are
+//decoded in parallel.
+static bool ReadBinaryPlyMeshFromFile(const std::string& file, Mesh& mesh) {
+	MemoryMappedFile map(file);
+	PlyBinaryLayout layout;
+	if (!ParseBinaryPlyHeader(map.data(), map.size(), layout))
+		return false;
+	const char* data = map.data() + layout.dataOffset;
+	const char* dataEnd = map.data() + map.size();
+	const size_t stride = layout.vertexStride;
+	if ((size_t) (dataEnd - data) < layout.vertexCount * stride)
+		throw std::runtime_error(MakeString() << "Vertex data is truncated [" << file << "]");
+	bool hasNormals = (layout.normal[0] >= 0 && layout.normal[1] >= 0 && layout.normal[2] >= 0);
+	bool hasColors = (layout.color[0] >= 0 && layout.color[1] >= 0 && layout.color[2] >= 0);
+	const size_t BLOCK = 1 << 14;
+	const char* faceData = data + layout.vertexCount * stride;
+	std::vector<const char*> blockStart;
+	std::vector<uint2> blockCount;
+	uint2 count(0U);
+	const char* ptr = faceData;
+	for (size_t f = 0; f < layout.faceCount; f++) {
+		if (f % BLOCK == 0) {
+			blockStart.push_back(ptr);
+			blockCount.push_back(count);
+		}
+		if (ptr >= dataEnd)
+			throw std::runtime_error(MakeString() << "Face data is truncated [" << file << "]");
+		uint8_t n = (uint8_t) *ptr;
+		if (n == 3) {
+			count.x++;
+		} else if (n == 4) {
+			count.y++;
+		}
+		ptr += 1 + 4 * (size_t) n;
+	}
+	if (ptr > dataEnd)
+		throw std::runtime_error(MakeString() << "Face data is truncated [" << file << "]");
+	mesh.triIndexes.clear();
+	mesh.quadIndexes.clear();
+	mesh.vertexLocations.clear();
+	mesh.vertexNormals.clear();
+	mesh.vertexColors.clear();
+	mesh.textureMap.clear();
+	mesh.textureImage.clear();
+	mesh.vertexLocations.resize(layout.vertexCount);
+	if (hasNormals)
+		mesh.vertexNormals.resize(layout.vertexCount);
+	if (hasColors)
+		mesh.vertexColors.resize(layout.vertexCount);
+	mesh.triIndexes.resize(count.x);
+	mesh.quadIndexes.resize(count.y);
+	const int vertexBlocks = (int) ((layout.vertexCount + BLOCK - 1) / BLOCK);
+#pragma omp parallel for
+	for (int b = 0; b < vertexBlocks; b++) {
+		size_t last = std::min(layout.vertexCount, (b + 1) * BLOCK);
+		for (size_t v = b * BLOCK; v < last; v++) {
+			const char* vertex = data + v * stride;
+			float3 pt;
+			for (int c = 0; c < 3; c++) {
+				std::memcpy(&pt[c], vertex + layout.position[c], sizeof(float));
+			}
+			mesh.vertexLocations[v] = pt;
+			if (hasNormals) {
+				for (int c = 0; c < 3; c++) {
+					std::memcpy(&pt[c], vertex + layout.normal[c], sizeof(float));
+				}
+				mesh.vertexNormals[v] = pt;
+			}
+			if (hasColors) {
+				mesh.vertexColors[v] = float4((uint8_t) vertex[layout.color[0]] / 255.0f,
+						(uint8_t) vertex[layout.color[1]] / 255.0f,
+						(uint8_t) vertex[layout.color[2]] / 255.0f, 1.0f);
+			}
+		}
 	}
-	if (mesh.textureMap.size() > 0 && mesh.textureImage.size() > 0)
-		out << "usemtl material_0\n";
-	i = 0;
-	for (uint3 tri : mesh.triIndexes.data) {
-		out << "f ";
-		if (mesh.vertexNormals.size() > 0 && mesh.textureMap.size() == 0) {
-			out << (tri.x + 1) << "/" << (tri.x + 1) << " ";
-			out << (tri.y + 1) << "/" << (tri.y + 1) << " ";
-			out << (tri.z + 1) << "/" << (tri.z + 1) << "\n";
-		} else if (mesh.vertexNormals.size() == 0 && mesh.textureMap.size() > 0) {
-			out << (tri.x + 1) << "/" << (i + 1) << " ";
-			out << (tri.y + 1) << "/" << (i + 2) << " ";
-			out << (tri.z + 1) << "/" << (i + 3) << "\n";
-		} else if (mesh.vertexNormals.size() > 0 && mesh.textureMap.size() > 0) {
-			out << (tri.x + 1) << "/" << (i + 1) << "/" << (tri.x + 1) << " ";
-			out << (tri.y + 1) << "/" << (i + 2) << "/" << (tri.y + 1) << " ";
-			out << (tri.z + 1) << "/" << (i + 3) << "/" << (tri.z + 1) << "\n";
-		} else {
-			out << (tri.x + 1) << " ";
-			out << (tri.y + 1) << " ";
-			out << (tri.z + 1) << "\n";
-		}
-		i += 3;
-	}
-	i = 0;
-	for (uint4 quad : mesh.quadIndexes.data) {
-		out << "f ";
-		if (mesh.vertexNormals.size() > 0 && mesh.textureMap.size() == 0) {
-			out << (quad.x + 1) << "/" << (quad.x + 1) << " ";
-			out << (quad.y + 1) << "/" << (quad.y + 1) << " ";
-			out << (quad.z + 1) << "/" << (quad.z + 1) << " ";
-			out << (quad.w + 1) << "/" << (quad.w + 1) << "\n";
-		} else if (mesh.vertexNormals.size() == 0 && mesh.textureMap.size() > 0) {
-			out << (quad.x + 1) << "/" << (i + 1) << " ";
-			out << (quad.y + 1) << "/" << (i + 2) << " ";
-			out << (quad.z + 1) << "/" << (i + 3) << " ";
-			out << (quad.w + 1) << "/" << (i + 4) << "\n";
-		} else if (mesh.vertexNormals.size() > 0 && mesh.textureMap.size() > 0) {
-			out << (quad.x + 1) << "/" << (i + 1) << "/" << (quad.x + 1) << " ";
-			out << (quad.y + 1) << "/" << (i + 2) << "/" << (quad.y + 1) << " ";
-			out << (quad.z + 1) << "/" << (i + 3) << "/" << (quad.z + 1) << " ";
-			out << (quad.w + 1) << "/" << (i + 4) << "/" << (quad.w + 1) << "\n";
-		} else {
-			out << (quad.x + 1) << " ";
-			out << (quad.y + 1) << " ";
-			out << (quad.z + 1) << " ";
-			out << (quad.w + 1) << "\n";
+	const int faceBlocks = (int) blockStart.size();
+#pragma omp parallel for
+	for (int b = 0; b < faceBlocks; b++) {
+		size_t last = std::min(layout.faceCount, (b + 1) * BLOCK);
+		const char* face = blockStart[b];
+		uint2 index = blockCount[b];
+		for (size_t f = b * BLOCK; f < last; f++) {
+			uint8_t n = (uint8_t) *face;
+			if (n == 3) {
+				uint3& tri = mesh.triIndexes[index.x++];
+				std::memcpy(&tri, face + 1, sizeof(uint3));
+			} else if (n == 4) {
+				uint4& quad = mesh.quadIndexes[index.y++];
+				std::memcpy(&quad, face + 1, sizeof(uint4));
+			}
+			face += 1 + 4 * (size_t) n;
 		}
-		i += 4;
 	}
-	out.close();
+	mesh.setTopologyDirty();
+	if (mesh.vertexLocations.size() > 0) {
+		mesh.updateBoundingBox();
+	}
+	if (mesh.vertexNormals.size() == 0) {
+		mesh.updateVertexNormals();
+	}
+	mesh.setDirty(true);
+	return true;
+}
+//Writes the same header and records as the generic binary writer, packing blocks of vertices and faces in
+//parallel and writing each block with one fwrite.
+static void WriteBinaryPlyMeshToFile(const std::string& file, const Mesh& mesh) {
+	const size_t numPts = mesh.vertexLocations.size();
+	const size_t numQuads = mesh.quadIndexes.size();
+	const size_t numTris = mesh.triIndexes.size();
+	const bool hasNormals = (mesh.vertexNormals.size() > 0);
+	const bool hasColors = (mesh.vertexColors.size() > 0);
+	std::stringstream header;
+	header << "ply\n";
+	header << "format binary_little_endian 1.0\n";
+	header << "comment PLY File\n";
+	header << "obj_info ImageSci\n";
+	header << "element vertex " << numPts << "\n";
+	header << "property float32 x\nproperty float32 y\nproperty float32 z\n";
+	if (hasNormals) {
+		header << "property float32 nx\nproperty float32 ny\nproperty float32 nz\n";
+	}
+	if (hasColors) {
+		header << "property uint8 red\nproperty uint8 green\nproperty uint8 blue\n";
+	}
+	header << "element face " << (numQuads + numTris) << "\n";
+	header << "property list uint8 int32 vertex_indices\n";
+	header << "end_header\n";
+	FILE* f = fopen(file.c_str(), "wb");
+	if (f == NULL) {
+		throw std::runtime_error(MakeString() << "Could not open " << file << " for writing.");
+	}
+	std::string headerStr = header.str();
+	bool ok = (fwrite(headerStr.data(), 1, headerStr.size(), f) == headerStr.size());
+	const size_t BLOCK = 1 << 16;
+	const size_t stride = 3 * sizeof(float) + ((hasNormals) ? 3 * sizeof(float) : 0) + ((hasColors) ? 3 : 0);
+	std::vector<char> buffer(BLOCK * std::max(stride, 1 + 4 * sizeof(uint32_t)));
+	for (size_t start = 0; start < numPts && ok; start += BLOCK) {
+		const int n = (int) std::min(BLOCK, numPts - start);
+#pragma omp parallel for
+		for (int i = 0; i < n; i++) {
+			char* vertex = buffer.data() + i * stride;
+			std::memcpy(vertex, &mesh.vertexLocations[start + i], sizeof(float3));
+			vertex += sizeof(float3);
+			if (hasNormals) {
+				std::memcpy(vertex, &mesh.vertexNormals[start + i], sizeof(float3));
+				vertex += sizeof(float3);
+			}
+			if (hasColors) {
+				float4 d = mesh.vertexColors[start + i];
+				vertex[0] = (unsigned char) clamp(d[0] * 255.0f, 0.0f, 255.0f);
+				vertex[1] = (unsigned char) clamp(d[1] * 255.0f, 0.0f, 255.0f);
+				vertex[2] = (unsigned char) clamp(d[2] * 255.0f, 0.0f, 255.0f);
+			}
+		}
+		ok = (fwrite(buffer.data(), stride, n, f) == (size_t) n);
+	}
+	const size_t quadSize = 1 + sizeof(uint4);
+	for (size_t start = 0; start < numQuads && ok; start += BLOCK) {
+		const int n = (int) std::min(BLOCK, numQuads - start);
+#pragma omp parallel for
+		for (int i = 0; i < n; i++) {
+			char* face = buffer.data() + i * quadSize;
+			face[0] = 4;
+			std::memcpy(face + 1, &mesh.quadIndexes[start + i], sizeof(uint4));
+		}
+		ok = (fwrite(buffer.data(), quadSize, n, f) == (size_t) n);
+	}
+	const size_t triSize = 1 + sizeof(uint3);
+	for (size_t start = 0; start < numTris && ok; start += BLOCK) {
+		const int n = (int) std::min(BLOCK, numTris - start);
+#pragma omp parallel for
+		for (int i = 0; i < n; i++) {
+			char* face = buffer.data() + i * triSize;
+			face[0] = 3;
+			std::memcpy(face + 1, &mesh.triIndexes[start + i], sizeof(uint3));
+		}
+		ok = (fwrite(buffer.data(), triSize, n, f) == (size_t) n);
+	}
+	fclose(f);
+	if (!ok) {
+		throw std::runtime_error(MakeString() << "Could not write " << file);
+	}
 }
 void WritePlyMeshToFile(const std::string& file, const Mesh& mesh, bool binary) {
+	if (binary && mesh.textureMap.size() == 0 && mesh.textureImage.size() == 0) {
+		WriteBinaryPlyMeshToFile(file, mesh);
+	} else {
+		WriteGenericPlyMeshToFile(file, mesh, binary);
+	}
+}
+void WriteGenericPlyMeshToFile(const std::string& file, const Mesh& mesh, bool binary) {
 	std::vector<std::string> elemNames = { "vertex", "face" };
 	int i, j, idx;
 	bool hasTexture = (mesh.textureMap.size() > 0);
@@ -807,76 +1130,87 @@ void WritePlyMeshToFile(const std::string& file, const Mesh& mesh, bool binary)
 		}
 	}
 }
-void Mesh::updateVertexNormals(int SMOOTH_ITERATIONS, float DOT_TOLERANCE) {
-	uint32_t sz = (uint32_t) triIndexes.size();
-	float3 pt;
-	vertexNormals.clear();
-	vertexNormals.resize(vertexLocations.size(), float3(0.0f));
-	for (uint32_t i = 0; i < sz; i++) {
-		uint3 verts = triIndexes[i];
-		float3 v1 = vertexLocations[verts.x];
-		float3 v2 = vertexLocations[verts.y];
-		float3 v3 = vertexLocations[verts.z];
-		float3 norm = cross((v3 - v1), (v2 - v1));
-		vertexNormals[verts.x] += norm;
-		vertexNormals[verts.y] += norm;
-		vertexNormals[verts.z] += norm;
+//Gathers the normals of the faces around a vertex. Faces are visited in index order, triangles before quads.
+static float3 GatherVertexNormal(const Mesh& mesh, const MeshAdjacency& adj, uint32_t v, NormalWeighting weighting) {
+	float3 norm(0.0f);
+	for (uint32_t k = adj.faceOffsets[v]; k < adj.faceOffsets[v + 1]; k++) {
+		uint32_t f = adj.vertexFaces[k];
+		float3 prev, pt, next;
+		if (f < adj.triCount) {
+			uint3 verts = mesh.triIndexes[f];
+			if (weighting == NormalWeighting::Area) {
+				float3 v1 = mesh.vertexLocations[verts.x];
+				norm += cross((mesh.vertexLocations[verts.z] - v1), (mesh.vertexLocations[verts.y] - v1));
+				continue;
+			}
+			int c = (verts.x == v) ? 0 : ((verts.y == v) ? 1 : 2);
+			prev = mesh.vertexLocations[verts[(c + 2) % 3]];
+			next = mesh.vertexLocations[verts[(c + 1) % 3]];
+		} else {
+			uint4 verts = mesh.quadIndexes[f - adj.triCount];
+			int c = (verts.x == v) ? 0 : ((verts.y == v) ? 1 : ((verts.z == v) ? 2 : 3));
+			prev = mesh.vertexLocations[verts[(c + 3) % 4]];
+			next = mesh.vertexLocations[verts[(c + 1) % 4]];
+		}
+		pt = mesh.vertexLocations[v];
+		float3 corner = cross((prev - pt), (next - pt));
+		if (weighting == NormalWeighting::Area) {
+			norm += corner;
+		} else {
+			float len = length(corner);
+			if (len > 0.0f) {
+				norm += corner * (std::atan2(len, dot(prev - pt, next - pt)) / len);
+			}
+		}
 	}
-	sz = (uint32_t) quadIndexes.size();
-	for (uint32_t i = 0; i < sz; i++) {
-		uint4 verts = quadIndexes[i];
-		float3 v1 = vertexLocations[verts.x];
-		float3 v2 = vertexLocations[verts.y];
-		float3 v3 = vertexLocations[verts.z];
-		float3 v4 = vertexLocations[verts.w];
-
-		vertexNormals[verts.x] += cross((v4 - v1), (v2 - v1));
-		vertexNormals[verts.y] += cross((v1 - v2), (v3 - v2));
-		vertexNormals[verts.z] += cross((v2 - v3), (v4 - v3));
-		vertexNormals[verts.w] += cross((v3 - v4), (v1 - v4));
+	return normalize(norm);
+}
+void Mesh::updateVertexNormals(const std::vector<uint32_t>& movedVertexes, NormalWeighting weighting) {
+	if (vertexNormals.size() != vertexLocations.size()) {
+		updateVertexNormals(0, 0.75f, weighting);
+		return;
 	}
+	const MeshAdjacency& adj = getAdjacency();
+	std::vector<uint32_t> touched;
+	for (uint32_t v : movedVertexes) {
+		for (uint32_t k = adj.faceOffsets[v]; k < adj.faceOffsets[v + 1]; k++) {
+			uint32_t f = adj.vertexFaces[k];
+			if (f < adj.triCount) {
+				uint3 verts = triIndexes[f];
+				touched.insert(touched.end(), { verts.x, verts.y, verts.z });
+			} else {
+				uint4 verts = quadIndexes[f - adj.triCount];
+				touched.insert(touched.end(), { verts.x, verts.y, verts.z, verts.w });
+			}
+		}
+	}
+	std::sort(touched.begin(), touched.end());
+	touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+#pragma omp parallel for
+	for (int i = 0; i < (int) touched.size(); i++) {
+		vertexNormals[touched[i]] = GatherVertexNormal(*this, adj, touched[i], weighting);
+	}
+	setDirty(true);
+}
+void Mesh::updateVertexNormals(int SMOOTH_ITERATIONS, float DOT_TOLERANCE, NormalWeighting weighting) {
+	//Each vertex sums its own faces, so threads never write to the same normal.
+	const MeshAdjacency& adj = getAdjacency();
+	vertexNormals.resize(vertexLocations.size());
 #pragma omp parallel for
 	for (int n = 0; n < (int) vertexNormals.size(); n++) {
-		vertexNormals[n] = normalize(vertexNormals[n]);
+		vertexNormals[n] = GatherVertexNormal(*this, adj, n, weighting);
 	}
 	if (SMOOTH_ITERATIONS > 0) {
 		int vertCount = (int) vertexLocations.size();
 		std::vector<float3> tmp(vertCount);
-		std::vector<std::list<int>> vertNbrs(vertCount);
-		int indexCount = (int) quadIndexes.size();
-		for (int i = 0; i < indexCount; i++) {
-			uint4 verts = quadIndexes[i];
-			int v1 = verts.x;
-			int v2 = verts.y;
-			int v3 = verts.z;
-			int v4 = verts.w;
-
-			vertNbrs[v1].push_back(v2);
-			vertNbrs[v2].push_back(v3);
-			vertNbrs[v3].push_back(v1);
-
-			vertNbrs[v3].push_back(v4);
-			vertNbrs[v4].push_back(v1);
-			vertNbrs[v1].push_back(v3);
-		}
-		indexCount = (int) triIndexes.size();
-		for (int i = 0; i < indexCount; i++) {
-			uint3 verts = triIndexes[i];
-			int v1 = verts.x;
-			int v2 = verts.y;
-			int v3 = verts.z;
-			vertNbrs[v1].push_back(v2);
-			vertNbrs[v2].push_back(v3);
-			vertNbrs[v3].push_back(v1);
-		}
+		const MeshAdjacency& adj = getAdjacency();
 		for (int iter = 0; iter < SMOOTH_ITERATIONS; iter++) {
-#pragma omp for
+#pragma omp parallel for
 			for (int i = 0; i < vertCount; i++) {
 				float3 norm = vertexNormals[i];
 				float3 avg = float3(0.0f);
-				for (int nbr : vertNbrs[i]) {
-					float3 nnorm = vertexNormals[nbr];
-					;
+				for (uint32_t k = adj.vertexOffsets[i]; k < adj.vertexOffsets[i + 1]; k++) {
+					float3 nnorm = vertexNormals[adj.vertexNeighbors[k]];
 					if (dot(norm, nnorm) > DOT_TOLERANCE) {
 						avg += nnorm;
 					} else {
@@ -1021,147 +1355,592 @@ void Mesh::update(bool onScreen) {
 Mesh::~Mesh() {
 	// TODO Auto-generated destructor stub
 }
-void ReadObjMeshFromFile(const std::string& file, std::vector<Mesh>& meshList) {
-	using namespace tinyobj;
-	std::vector<tinyobj::shape_t> shapes;
+//Flags of an OBJ face corner. Relative (negative) indices are resolved against the counts of the chunk they
+//appear in, so the offset of the chunk is added once all chunks have been parsed.
+enum ObjCornerFlags {
+	OBJ_RELATIVE_V = 1, OBJ_RELATIVE_VT = 2, OBJ_RELATIVE_VN = 4, OBJ_HAS_VT = 8, OBJ_HAS_VN = 16
+};
+struct ObjCorner {
+	int v = 0;
+	int vt = -1;
+	int vn = -1;
+	int flags = 0;
+};
+//Shape boundary (g, o, usemtl) or material library (mtllib) statement and the face it precedes.
+struct ObjStatement {
+	char type;
+	size_t face;
+	size_t corner;
+	std::string name;
+};
+struct ObjChunk {
+	std::vector<float3> positions;
+	std::vector<float3> colors;
+	std::vector<float3> normals;
+	std::vector<float2> texCoords;
+	std::vector<ObjCorner> corners;
+	std::vector<uint32_t> faceSizes;
+	std::vector<ObjStatement> statements;
+	bool hasColors = false;
+};
+struct ObjShape {
+	size_t faceBegin;
+	size_t faceEnd;
+	size_t cornerBegin;
+	int material;
+};
+//Contents of an OBJ file split into the same shapes as tinyobj, a new shape starts at every g, o or usemtl statement.
+struct ObjFile {
+	std::vector<float3> positions;
+	std::vector<float3> colors;
+	std::vector<float3> normals;
+	std::vector<float2> texCoords;
+	std::vector<ObjCorner> corners;
+	std::vector<uint32_t> faceSizes;
+	std::vector<ObjShape> shapes;
 	std::vector<tinyobj::material_t> materials;
-	std::string err = tinyobj::LoadObj(shapes, materials, file.c_str(), GetParentDirectory(file).c_str());
-	if (err.size() > 0)
-		throw std::runtime_error(err);
-	meshList.resize(shapes.size());
-	for (int n = 0; n < (int) shapes.size(); n++) {
-		Mesh& mesh = meshList[n];
-		tinyobj::shape_t& shape = shapes[n];
-		if (shape.mesh.positions.size() > 0) {
-			mesh.vertexLocations.resize(shape.mesh.positions.size() / 3);
-			mesh.vertexLocations.set(shape.mesh.positions.data());
-		}
-		if (shape.mesh.normals.size() > 0) {
-			mesh.vertexNormals.resize(shape.mesh.normals.size() / 3);
-			mesh.vertexNormals.set(shape.mesh.normals.data());
-		}
-		if (shape.mesh.triIndices.size() > 0) {
-			mesh.triIndexes.resize(shape.mesh.triIndices.size() / 3);
-			mesh.triIndexes.set(shape.mesh.triIndices.data());
-		}
-		if (shape.mesh.quadIndices.size() > 0) {
-			mesh.quadIndexes.resize(shape.mesh.quadIndices.size() / 4);
-			mesh.quadIndexes.set(shape.mesh.quadIndices.data());
-		}
-		for (size_t i = 0; i < shape.mesh.triIndices.size(); i += 3) {
-			uint32_t vid1 = shape.mesh.triIndices[i];
-			uint32_t vid2 = shape.mesh.triIndices[i + 1];
-			uint32_t vid3 = shape.mesh.triIndices[i + 2];
-			if (shape.mesh.texcoords.size() > 0) {
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid1], shape.mesh.texcoords[2 * vid1 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid2], shape.mesh.texcoords[2 * vid2 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid3], shape.mesh.texcoords[2 * vid3 + 1]));
-			}
-		}
-		for (size_t i = 0; i < shape.mesh.quadIndices.size(); i += 4) {
-			uint32_t vid1 = shape.mesh.quadIndices[i];
-			uint32_t vid2 = shape.mesh.quadIndices[i + 1];
-			uint32_t vid3 = shape.mesh.quadIndices[i + 2];
-			uint32_t vid4 = shape.mesh.quadIndices[i + 3];
-			if (shape.mesh.texcoords.size() > 0) {
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid1], shape.mesh.texcoords[2 * vid1 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid2], shape.mesh.texcoords[2 * vid2 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid3], shape.mesh.texcoords[2 * vid3 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid4], shape.mesh.texcoords[2 * vid4 + 1]));
-			}
-		}
-		std::string texName = materials[n].diffuse_texname;
-		if (texName.size() > 0) {
-			aly::ReadImageFromFile(GetParentDirectory(file) + ALY_PATH_SEPARATOR+ texName, mesh.textureImage);
+};
+static inline bool IsObjSpace(char c) {
+	return (c == ' ' || c == '\t');
+}
+static inline const char* SkipObjSpace(const char* ptr, const char* end) {
+	while (ptr < end && IsObjSpace(*ptr))
+		ptr++;
+	return ptr;
+}
+static inline const char* SkipObjToken(const char* ptr, const char* end) {
+	while (ptr < end && !IsObjSpace(*ptr))
+		ptr++;
+	return ptr;
+}
+static inline bool IsObjDigit(char c) {
+	return (c >= '0' && c <= '9');
+}
+static std::string ParseObjName(const char* ptr, const char* end) {
+	ptr = SkipObjSpace(ptr, end);
+	return std::string(ptr, SkipObjToken(ptr, end));
+}
+//Parses one whitespace delimited number. Up to 19 significant digits are accumulated as an integer and scaled
+//by an exact power of ten, anything that is not a plain decimal number is handed to strtod. Missing values are 0.
+static const char* ParseObjFloat(const char* ptr, const char* end, float& value, bool& found) {
+	static const double powers[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+			1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	ptr = SkipObjSpace(ptr, end);
+	value = 0.0f;
+	found = (ptr < end);
+	if (!found)
+		return ptr;
+	const char* start = ptr;
+	bool negative = false;
+	if (*ptr == '-' || *ptr == '+') {
+		negative = (*ptr == '-');
+		ptr++;
+	}
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int significant = 0;
+	bool digits = false;
+	while (ptr < end && IsObjDigit(*ptr)) {
+		if (significant < 19) {
+			mantissa = mantissa * 10 + (*ptr - '0');
+			if (mantissa != 0)
+				significant++;
+		} else {
+			exponent++;
+		}
+		digits = true;
+		ptr++;
+	}
+	if (ptr < end && *ptr == '.') {
+		ptr++;
+		while (ptr < end && IsObjDigit(*ptr)) {
+			if (significant < 19) {
+				mantissa = mantissa * 10 + (*ptr - '0');
+				if (mantissa != 0)
+					significant++;
+				exponent--;
+			}
+			digits = true;
+			ptr++;
+		}
+	}
+	if (digits && ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+		const char* exp = ptr + 1;
+		bool negativeExp = false;
+		if (exp < end && (*exp == '-' || *exp == '+')) {
+			negativeExp = (*exp == '-');
+			exp++;
+		}
+		if (exp < end && IsObjDigit(*exp)) {
+			int e = 0;
+			while (exp < end && IsObjDigit(*exp)) {
+				if (e < 10000)
+					e = e * 10 + (*exp - '0');
+				exp++;
+			}
+			exponent += (negativeExp) ? -e : e;
+			ptr = exp;
+		}
+	}
+	const char* tokenEnd = SkipObjToken(ptr, end);
+	if (!digits || ptr != tokenEnd) {
+		char str[64];
+		size_t length = std::min((size_t) (tokenEnd - start), sizeof(str) - 1);
+		std::memcpy(str, start, length);
+		str[length] = '\0';
+		value = (float) std::strtod(str, nullptr);
+		return tokenEnd;
+	}
+	double result = (double) mantissa;
+	if (exponent < 0) {
+		result = (exponent >= -22) ? result / powers[-exponent] : result * std::pow(10.0, (double) exponent);
+	} else if (exponent > 0) {
+		result = (exponent <= 22) ? result * powers[exponent] : result * std::pow(10.0, (double) exponent);
+	}
+	value = (float) ((negative) ? -result : result);
+	return tokenEnd;
+}
+static inline const char* ParseObjInt(const char* ptr, const char* end, int& value) {
+	bool negative = false;
+	if (ptr < end && (*ptr == '-' || *ptr == '+')) {
+		negative = (*ptr == '-');
+		ptr++;
+	}
+	uint32_t result = 0;
+	while (ptr < end && IsObjDigit(*ptr)) {
+		result = result * 10 + (uint32_t) (*ptr - '0');
+		ptr++;
+	}
+	value = (negative) ? -(int) result : (int) result;
+	return ptr;
+}
+static inline int ResolveObjIndex(int index, size_t count, int relativeFlag, int& flags) {
+	if (index > 0)
+		return index - 1;
+	if (index == 0)
+		return 0;
+	flags |= relativeFlag;
+	return (int) count + index;
+}
+static inline const char* SkipObjIndex(const char* ptr, const char* end) {
+	while (ptr < end && *ptr != '/' && !IsObjSpace(*ptr))
+		ptr++;
+	return ptr;
+}
+//Parses v, v/vt, v//vn or v/vt/vn.
+static const char* ParseObjCorner(const char* ptr, const char* end, const ObjChunk& chunk, ObjCorner& corner) {
+	int index;
+	ptr = SkipObjIndex(ParseObjInt(ptr, end, index), end);
+	corner.v = ResolveObjIndex(index, chunk.positions.size(), OBJ_RELATIVE_V, corner.flags);
+	if (ptr == end || *ptr != '/')
+		return ptr;
+	ptr++;
+	if (ptr < end && *ptr == '/') {
+		ptr = SkipObjIndex(ParseObjInt(ptr + 1, end, index), end);
+		corner.vn = ResolveObjIndex(index, chunk.normals.size(), OBJ_RELATIVE_VN, corner.flags);
+		corner.flags |= OBJ_HAS_VN;
+		return ptr;
+	}
+	ptr = SkipObjIndex(ParseObjInt(ptr, end, index), end);
+	corner.vt = ResolveObjIndex(index, chunk.texCoords.size(), OBJ_RELATIVE_VT, corner.flags);
+	corner.flags |= OBJ_HAS_VT;
+	if (ptr == end || *ptr != '/')
+		return ptr;
+	ptr = SkipObjIndex(ParseObjInt(ptr + 1, end, index), end);
+	corner.vn = ResolveObjIndex(index, chunk.normals.size(), OBJ_RELATIVE_VN, corner.flags);
+	corner.flags |= OBJ_HAS_VN;
+	return ptr;
+}
+static inline bool IsObjKeyword(const char* ptr, const char* end, const char* keyword, size_t length) {
+	return ((size_t) (end - ptr) > length && std::strncmp(ptr, keyword, length) == 0 && IsObjSpace(ptr[length]));
+}
+static void ParseObjChunk(const char* ptr, const char* end, ObjChunk& chunk) {
+	while (ptr < end) {
+		const char* lineEnd = (const char*) std::memchr(ptr, '\n', end - ptr);
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		const char* next = (lineEnd < end) ? lineEnd + 1 : end;
+		if (lineEnd > ptr && lineEnd[-1] == '\r')
+			lineEnd--;
+		ptr = SkipObjSpace(ptr, lineEnd);
+		bool found;
+		if (IsObjKeyword(ptr, lineEnd, "v", 1)) {
+			float3 pt;
+			const char* token = ptr + 2;
+			for (int c = 0; c < 3; c++) {
+				token = ParseObjFloat(token, lineEnd, pt[c], found);
+			}
+			chunk.positions.push_back(pt);
+			float3 color;
+			int count = 0;
+			for (int c = 0; c < 3; c++) {
+				token = ParseObjFloat(token, lineEnd, color[c], found);
+				count += (found) ? 1 : 0;
+			}
+			if (count == 3 && !chunk.hasColors) {
+				chunk.colors.resize(chunk.positions.size() - 1, float3(0.0f));
+				chunk.hasColors = true;
+			}
+			if (chunk.hasColors) {
+				chunk.colors.push_back((count == 3) ? color : float3(0.0f));
+			}
+		} else if (IsObjKeyword(ptr, lineEnd, "vn", 2)) {
+			float3 norm;
+			const char* token = ptr + 3;
+			for (int c = 0; c < 3; c++) {
+				token = ParseObjFloat(token, lineEnd, norm[c], found);
+			}
+			chunk.normals.push_back(norm);
+		} else if (IsObjKeyword(ptr, lineEnd, "vt", 2)) {
+			float2 uv;
+			const char* token = ptr + 3;
+			for (int c = 0; c < 2; c++) {
+				token = ParseObjFloat(token, lineEnd, uv[c], found);
+			}
+			chunk.texCoords.push_back(uv);
+		} else if (IsObjKeyword(ptr, lineEnd, "f", 1)) {
+			const char* token = SkipObjSpace(ptr + 2, lineEnd);
+			uint32_t count = 0;
+			while (token < lineEnd) {
+				ObjCorner corner;
+				token = SkipObjSpace(ParseObjCorner(token, lineEnd, chunk, corner), lineEnd);
+				chunk.corners.push_back(corner);
+				count++;
+			}
+			chunk.faceSizes.push_back(count);
+		} else if (IsObjKeyword(ptr, lineEnd, "g", 1) || IsObjKeyword(ptr, lineEnd, "o", 1)) {
+			chunk.statements.push_back(ObjStatement { *ptr, chunk.faceSizes.size(), chunk.corners.size(), ParseObjName(ptr + 2, lineEnd) });
+		} else if (IsObjKeyword(ptr, lineEnd, "usemtl", 6)) {
+			chunk.statements.push_back(ObjStatement { 'u', chunk.faceSizes.size(), chunk.corners.size(), ParseObjName(ptr + 7, lineEnd) });
+		} else if (IsObjKeyword(ptr, lineEnd, "mtllib", 6)) {
+			chunk.statements.push_back(ObjStatement { 'm', chunk.faceSizes.size(), chunk.corners.size(), ParseObjName(ptr + 7, lineEnd) });
 		}
-		mesh.updateBoundingBox();
+		ptr = next;
 	}
-
 }
-void ReadObjMeshFromFile(const std::string& file, Mesh& mesh) {
-	using namespace tinyobj;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err = tinyobj::LoadObj(shapes, materials, file.c_str(), GetParentDirectory(file).c_str());
-	if (err.size() > 0)
-		throw std::runtime_error(err);
-
-	uint32_t positionCount = 0;
-	uint32_t colorCount = 0;
-	uint32_t normalCount = 0;
-	uint32_t texCount = 0;
-	uint32_t triIndexCount = 0;
-	uint32_t quadIndexCount = 0;
-	for (int n = 0; n < (int) shapes.size(); n++) {
-		shape_t& shape = shapes[n];
-		positionCount += (uint32_t) shape.mesh.positions.size();
-		colorCount += (uint32_t) shape.mesh.colors.size();
-		normalCount += (uint32_t) shape.mesh.normals.size();
-		texCount += (uint32_t) shape.mesh.texcoords.size();
-		triIndexCount += (uint32_t) shape.mesh.triIndices.size();
-		quadIndexCount += (uint32_t) shape.mesh.quadIndices.size();
+//Splits the memory mapped file into chunks on line boundaries that are parsed in parallel. Chunk offsets are
+//then prefix summed to resolve relative indices and concatenate the chunks, and the shape statements are
+//replayed in order to load material libraries and find the face range of each shape.
+static void ReadObjFile(const std::string& file, ObjFile& obj) {
+	MemoryMappedFile map(file);
+	const char* data = map.data();
+	const char* dataEnd = data + map.size();
+	const size_t CHUNK = 1 << 22;
+	std::vector<const char*> bounds;
+	bounds.push_back(data);
+	while ((size_t) (dataEnd - bounds.back()) > CHUNK) {
+		const char* split = (const char*) std::memchr(bounds.back() + CHUNK, '\n', dataEnd - bounds.back() - CHUNK);
+		if (split == nullptr)
+			break;
+		bounds.push_back(split + 1);
+	}
+	bounds.push_back(dataEnd);
+	const int chunkCount = (int) bounds.size() - 1;
+	std::vector<ObjChunk> chunks(chunkCount);
+#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < chunkCount; c++) {
+		ParseObjChunk(bounds[c], bounds[c + 1], chunks[c]);
+	}
+	std::vector<size_t> positionOffset(chunkCount + 1, 0);
+	std::vector<size_t> normalOffset(chunkCount + 1, 0);
+	std::vector<size_t> texCoordOffset(chunkCount + 1, 0);
+	std::vector<size_t> cornerOffset(chunkCount + 1, 0);
+	std::vector<size_t> faceOffset(chunkCount + 1, 0);
+	bool hasColors = false;
+	for (int c = 0; c < chunkCount; c++) {
+		const ObjChunk& chunk = chunks[c];
+		positionOffset[c + 1] = positionOffset[c] + chunk.positions.size();
+		normalOffset[c + 1] = normalOffset[c] + chunk.normals.size();
+		texCoordOffset[c + 1] = texCoordOffset[c] + chunk.texCoords.size();
+		cornerOffset[c + 1] = cornerOffset[c] + chunk.corners.size();
+		faceOffset[c + 1] = faceOffset[c] + chunk.faceSizes.size();
+		hasColors |= chunk.hasColors;
+	}
+	obj.positions.resize(positionOffset[chunkCount]);
+	obj.colors.resize((hasColors) ? positionOffset[chunkCount] : 0);
+	obj.normals.resize(normalOffset[chunkCount]);
+	obj.texCoords.resize(texCoordOffset[chunkCount]);
+	obj.corners.resize(cornerOffset[chunkCount]);
+	obj.faceSizes.resize(faceOffset[chunkCount]);
+	const int positionCount = (int) obj.positions.size();
+	const int normalCount = (int) obj.normals.size();
+	const int texCoordCount = (int) obj.texCoords.size();
+	std::vector<std::vector<ObjStatement>> statements(chunkCount);
+	bool outOfRange = false;
+#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < chunkCount; c++) {
+		ObjChunk& chunk = chunks[c];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), obj.positions.begin() + positionOffset[c]);
+		if (hasColors) {
+			if (chunk.hasColors) {
+				std::copy(chunk.colors.begin(), chunk.colors.end(), obj.colors.begin() + positionOffset[c]);
+			} else {
+				std::fill(obj.colors.begin() + positionOffset[c], obj.colors.begin() + positionOffset[c + 1], float3(0.0f));
+			}
+		}
+		std::copy(chunk.normals.begin(), chunk.normals.end(), obj.normals.begin() + normalOffset[c]);
+		std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), obj.texCoords.begin() + texCoordOffset[c]);
+		std::copy(chunk.faceSizes.begin(), chunk.faceSizes.end(), obj.faceSizes.begin() + faceOffset[c]);
+		bool valid = true;
+		for (size_t i = 0; i < chunk.corners.size(); i++) {
+			ObjCorner corner = chunk.corners[i];
+			if (corner.flags & OBJ_RELATIVE_V)
+				corner.v += (int) positionOffset[c];
+			if (corner.flags & OBJ_RELATIVE_VT)
+				corner.vt += (int) texCoordOffset[c];
+			if (corner.flags & OBJ_RELATIVE_VN)
+				corner.vn += (int) normalOffset[c];
+			//Texture and normal indices that do not exist are treated as missing.
+			if (corner.vt < 0 || corner.vt >= texCoordCount) {
+				corner.vt = -1;
+				corner.flags &= ~OBJ_HAS_VT;
+			}
+			if (corner.vn < 0 || corner.vn >= normalCount) {
+				corner.vn = -1;
+				corner.flags &= ~OBJ_HAS_VN;
+			}
+			if (corner.v < 0 || corner.v >= positionCount)
+				valid = false;
+			obj.corners[cornerOffset[c] + i] = corner;
+		}
+		if (!valid) {
+#pragma omp critical
+			outOfRange = true;
+		}
+		statements[c].swap(chunk.statements);
+		chunk = ObjChunk();
+	}
+	if (outOfRange)
+		throw std::runtime_error(MakeString() << "Face refers to a vertex that does not exist [" << file << "]");
+	std::string basePath = GetParentDirectory(file);
+	tinyobj::MaterialFileReader materialReader(basePath);
+	std::map<std::string, int> materialMap;
+	ObjShape shape;
+	shape.faceBegin = 0;
+	shape.cornerBegin = 0;
+	shape.material = -1;
+	for (int c = 0; c < chunkCount; c++) {
+		for (const ObjStatement& statement : statements[c]) {
+			if (statement.type == 'm') {
+				std::string err = materialReader(statement.name, obj.materials, materialMap);
+				if (err.size() > 0)
+					throw std::runtime_error(err);
+				continue;
+			}
+			size_t face = faceOffset[c] + statement.face;
+			if (face > shape.faceBegin) {
+				shape.faceEnd = face;
+				obj.shapes.push_back(shape);
+			}
+			shape.faceBegin = face;
+			shape.cornerBegin = cornerOffset[c] + statement.corner;
+			if (statement.type == 'u') {
+				auto iter = materialMap.find(statement.name);
+				shape.material = (iter != materialMap.end()) ? iter->second : -1;
+			}
+		}
 	}
-	mesh.vertexColors.clear();
-	mesh.vertexColors.resize(colorCount / 3);
-	mesh.vertexLocations.resize(positionCount / 3);
-	mesh.vertexNormals.resize(normalCount / 3);
-	mesh.triIndexes.resize(triIndexCount / 3);
-	mesh.quadIndexes.resize(quadIndexCount / 4);
-	positionCount = 0;
-	colorCount=0;
-	normalCount = 0;
-	texCount = 0;
-	triIndexCount = 0;
-	quadIndexCount = 0;
-	mesh.textureMap.clear();
-	for (int n = 0; n < (int) shapes.size(); n++) {
-		shape_t& shape = shapes[n];
-		for (size_t i = 0; i < shape.mesh.triIndices.size(); i += 3) {
-			mesh.triIndexes[triIndexCount++] = uint3(positionCount + shape.mesh.triIndices[i], positionCount + shape.mesh.triIndices[i + 1],
-					positionCount + shape.mesh.triIndices[i + 2]);
-		}
-		for (size_t i = 0; i < shape.mesh.quadIndices.size(); i += 4) {
-			mesh.quadIndexes[quadIndexCount++] = uint4(positionCount + shape.mesh.quadIndices[i], positionCount + shape.mesh.quadIndices[i + 1],
-					positionCount + shape.mesh.quadIndices[i + 2], positionCount + shape.mesh.quadIndices[i + 3]);
-		}
-		for (size_t i = 0; i < shape.mesh.positions.size(); i += 3) {
-			mesh.vertexLocations[positionCount++] = float3(shape.mesh.positions[i], shape.mesh.positions[i + 1], shape.mesh.positions[i + 2]);
-		}
-		for (size_t i = 0; i < shape.mesh.colors.size(); i += 3) {
-			mesh.vertexColors[colorCount++] = float4(shape.mesh.colors[i], shape.mesh.colors[i + 1], shape.mesh.colors[i + 2],1.0f);
-		}
-		for (size_t i = 0; i < shape.mesh.normals.size(); i += 3) {
-			mesh.vertexNormals[normalCount++] = float3(shape.mesh.normals[i], shape.mesh.normals[i + 1], shape.mesh.normals[i + 2]);
-		}
-		for (size_t i = 0; i < shape.mesh.triIndices.size(); i += 3) {
-			uint32_t vid1 = shape.mesh.triIndices[i];
-			uint32_t vid2 = shape.mesh.triIndices[i + 1];
-			uint32_t vid3 = shape.mesh.triIndices[i + 2];
-			if (shape.mesh.texcoords.size() > 0) {
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid1], shape.mesh.texcoords[2 * vid1 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid2], shape.mesh.texcoords[2 * vid2 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid3], shape.mesh.texcoords[2 * vid3 + 1]));
-			}
-		}
-		for (size_t i = 0; i < shape.mesh.quadIndices.size(); i += 4) {
-			uint32_t vid1 = shape.mesh.quadIndices[i];
-			uint32_t vid2 = shape.mesh.quadIndices[i + 1];
-			uint32_t vid3 = shape.mesh.quadIndices[i + 2];
-			uint32_t vid4 = shape.mesh.quadIndices[i + 3];
-			if (shape.mesh.texcoords.size() > 0) {
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid1], shape.mesh.texcoords[2 * vid1 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid2], shape.mesh.texcoords[2 * vid2 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid3], shape.mesh.texcoords[2 * vid3 + 1]));
-				mesh.textureMap.push_back(float2(shape.mesh.texcoords[2 * vid4], shape.mesh.texcoords[2 * vid4 + 1]));
-			}
-		}
-		if(n<(int)materials.size()){
-			std::string texName = materials[n].diffuse_texname;
+	if (obj.faceSizes.size() > shape.faceBegin) {
+		shape.faceEnd = obj.faceSizes.size();
+		obj.shapes.push_back(shape);
+	}
+}
+//Vertices of a shape are unique (v, vt, vn) corners numbered in the order they are first used, as in tinyobj.
+//Corners are matched with a flat table of lists indexed by position instead of a std::map.
+struct ObjShapeIndex {
+	std::vector<ObjCorner> vertices;
+	std::vector<uint32_t> cornerVertex;
+	size_t triCount = 0;
+	size_t quadCount = 0;
+	bool hasNormals = true;
+	bool hasTexCoords = false;
+};
+static void IndexObjShape(const ObjFile& obj, const ObjShape& shape, std::vector<int>& heads, ObjShapeIndex& index) {
+	struct Entry {
+		int vt;
+		int vn;
+		int next;
+	};
+	std::vector<Entry> entries;
+	size_t cornerEnd = shape.cornerBegin;
+	for (size_t f = shape.faceBegin; f < shape.faceEnd; f++) {
+		cornerEnd += obj.faceSizes[f];
+	}
+	index.cornerVertex.resize(cornerEnd - shape.cornerBegin);
+	size_t corner = shape.cornerBegin;
+	for (size_t f = shape.faceBegin; f < shape.faceEnd; f++) {
+		uint32_t n = obj.faceSizes[f];
+		if (n == 3) {
+			index.triCount++;
+		} else if (n == 4) {
+			index.quadCount++;
+		} else if (n > 4) {
+			index.triCount += n - 2;
+		} else {
+			corner += n;
+			continue;
+		}
+		for (uint32_t k = 0; k < n; k++, corner++) {
+			const ObjCorner& key = obj.corners[corner];
+			int e = heads[key.v];
+			while (e >= 0 && (entries[e].vt != key.vt || entries[e].vn != key.vn)) {
+				e = entries[e].next;
+			}
+			if (e < 0) {
+				e = (int) entries.size();
+				entries.push_back(Entry { key.vt, key.vn, heads[key.v] });
+				heads[key.v] = e;
+				index.vertices.push_back(key);
+				index.hasNormals &= (key.vn >= 0);
+				index.hasTexCoords |= (key.vt >= 0);
+			}
+			index.cornerVertex[corner - shape.cornerBegin] = (uint32_t) e;
+		}
+	}
+	for (const ObjCorner& vertex : index.vertices) {
+		heads[vertex.v] = -1;
+	}
+	if (index.vertices.size() == 0)
+		index.hasNormals = false;
+}
+//Copies an indexed shape into the mesh at the given vertex, triangle, quad and texture map offsets.
+static void CopyObjShape(const ObjFile& obj, const ObjShape& shape, const ObjShapeIndex& index, Mesh& mesh,
+		size_t vertexOffset, size_t triOffset, size_t quadOffset, size_t textureOffset, bool copyNormals) {
+	const int vertexCount = (int) index.vertices.size();
+	bool copyColors = (obj.colors.size() > 0);
+#pragma omp parallel for
+	for (int i = 0; i < vertexCount; i++) {
+		const ObjCorner& vertex = index.vertices[i];
+		mesh.vertexLocations[vertexOffset + i] = obj.positions[vertex.v];
+		if (copyColors) {
+			float3 c = obj.colors[vertex.v];
+			mesh.vertexColors[vertexOffset + i] = float4(c.x, c.y, c.z, 1.0f);
+		}
+		if (copyNormals) {
+			mesh.vertexNormals[vertexOffset + i] = obj.normals[vertex.vn];
+		}
+	}
+	uint32_t offset = (uint32_t) vertexOffset;
+	size_t triTexture = textureOffset;
+	size_t quadTexture = textureOffset + 3 * index.triCount;
+	size_t corner = 0;
+	for (size_t f = shape.faceBegin; f < shape.faceEnd; f++) {
+		uint32_t n = obj.faceSizes[f];
+		const uint32_t* v = &index.cornerVertex[corner];
+		const ObjCorner* keys = &obj.corners[shape.cornerBegin + corner];
+		if (n == 3) {
+			mesh.triIndexes[triOffset++] = uint3(offset + v[0], offset + v[1], offset + v[2]);
+		} else if (n == 4) {
+			mesh.quadIndexes[quadOffset++] = uint4(offset + v[0], offset + v[1], offset + v[2], offset + v[3]);
+		} else if (n > 4) {
+			for (uint32_t k = 2; k < n; k++) {
+				mesh.triIndexes[triOffset++] = uint3(offset + v[0], offset + v[k - 1], offset + v[k]);
+			}
+		}
+		if (index.hasTexCoords) {
+			if (n == 4) {
+				for (uint32_t k = 0; k < 4; k++) {
+					mesh.textureMap[quadTexture++] = (keys[k].vt >= 0) ? obj.texCoords[keys[k].vt] : float2(0.0f);
+				}
+			} else if (n >= 3) {
+				for (uint32_t k = 2; k < n; k++) {
+					mesh.textureMap[triTexture++] = (keys[0].vt >= 0) ? obj.texCoords[keys[0].vt] : float2(0.0f);
+					mesh.textureMap[triTexture++] = (keys[k - 1].vt >= 0) ? obj.texCoords[keys[k - 1].vt] : float2(0.0f);
+					mesh.textureMap[triTexture++] = (keys[k].vt >= 0) ? obj.texCoords[keys[k].vt] : float2(0.0f);
+				}
+			}
+		}
+		corner += n;
+	}
+}
+void ReadObjMeshFromFile(const std::string& file, std::vector<Mesh>& meshList) {
+	ObjFile obj;
+	ReadObjFile(file, obj);
+	std::vector<int> heads(obj.positions.size(), -1);
+	meshList.clear();
+	meshList.resize(obj.shapes.size());
+	for (int n = 0; n < (int) obj.shapes.size(); n++) {
+		Mesh& mesh = meshList[n];
+		const ObjShape& shape = obj.shapes[n];
+		ObjShapeIndex index;
+		IndexObjShape(obj, shape, heads, index);
+		mesh.vertexLocations.resize(index.vertices.size());
+		if (obj.colors.size() > 0)
+			mesh.vertexColors.resize(index.vertices.size());
+		if (index.hasNormals)
+			mesh.vertexNormals.resize(index.vertices.size());
+		mesh.triIndexes.resize(index.triCount);
+		mesh.quadIndexes.resize(index.quadCount);
+		if (index.hasTexCoords)
+			mesh.textureMap.resize(3 * index.triCount + 4 * index.quadCount);
+		CopyObjShape(obj, shape, index, mesh, 0, 0, 0, 0, index.hasNormals);
+		if (shape.material >= 0) {
+			std::string texName = obj.materials[shape.material].diffuse_texname;
 			if (texName.size() > 0) {
 				aly::ReadImageFromFile(GetParentDirectory(file) + ALY_PATH_SEPARATOR+ texName, mesh.textureImage);
 			}
 		}
+		mesh.updateBoundingBox();
 	}
+}
+void ReadObjMeshFromFile(const std::string& file, Mesh& mesh) {
+	ObjFile obj;
+	ReadObjFile(file, obj);
+	std::vector<int> heads(obj.positions.size(), -1);
+	std::vector<ObjShapeIndex> indexes(obj.shapes.size());
+	size_t vertexCount = 0;
+	size_t triCount = 0;
+	size_t quadCount = 0;
+	size_t textureCount = 0;
+	bool hasNormals = true;
+	for (size_t n = 0; n < obj.shapes.size(); n++) {
+		ObjShapeIndex& index = indexes[n];
+		IndexObjShape(obj, obj.shapes[n], heads, index);
+		vertexCount += index.vertices.size();
+		triCount += index.triCount;
+		quadCount += index.quadCount;
+		if (index.hasTexCoords)
+			textureCount += 3 * index.triCount + 4 * index.quadCount;
+		hasNormals &= (index.hasNormals || index.vertices.size() == 0);
+	}
+	hasNormals &= (vertexCount > 0);
+	mesh.vertexLocations.clear();
+	mesh.vertexNormals.clear();
+	mesh.vertexColors.clear();
+	mesh.triIndexes.clear();
+	mesh.quadIndexes.clear();
+	mesh.textureMap.clear();
+	mesh.vertexLocations.resize(vertexCount);
+	if (obj.colors.size() > 0)
+		mesh.vertexColors.resize(vertexCount);
+	if (hasNormals)
+		mesh.vertexNormals.resize(vertexCount);
+	mesh.triIndexes.resize(triCount);
+	mesh.quadIndexes.resize(quadCount);
+	mesh.textureMap.resize(textureCount);
+	vertexCount = 0;
+	triCount = 0;
+	quadCount = 0;
+	textureCount = 0;
+	std::string texName;
+	for (size_t n = 0; n < obj.shapes.size(); n++) {
+		const ObjShape& shape = obj.shapes[n];
+		ObjShapeIndex& index = indexes[n];
+		CopyObjShape(obj, shape, index, mesh, vertexCount, triCount, quadCount, textureCount, hasNormals);
+		vertexCount += index.vertices.size();
+		triCount += index.triCount;
+		quadCount += index.quadCount;
+		if (index.hasTexCoords)
+			textureCount += 3 * index.triCount + 4 * index.quadCount;
+		if (shape.material >= 0 && obj.materials[shape.material].diffuse_texname.size() > 0) {
+			texName = obj.materials[shape.material].diffuse_texname;
+		}
+		index = ObjShapeIndex();
+	}
+	if (texName.size() > 0) {
+		aly::ReadImageFromFile(GetParentDirectory(file) + ALY_PATH_SEPARATOR+ texName, mesh.textureImage);
+	}
+	mesh.setTopologyDirty();
 	if (mesh.vertexNormals.size() == 0) {
 		mesh.updateVertexNormals();
 	}
@@ -1173,10 +1952,57 @@ void ReadMeshFromFile(const std::string& file, Mesh &mesh) {
 		ReadPlyMeshFromFile(file, mesh);
 	} else if (ext == "obj") {
 		ReadObjMeshFromFile(file, mesh);
+	} else if (ext == "alyb") {
+		ReadBinaryMeshFromFile(file, mesh);
 	} else
 		throw std::runtime_error(MakeString() << "Could not read file " << file);
+	mesh.setTopologyDirty();
+}
+//Attributes are stored as sections named after the Mesh members. Empty attributes are omitted.
+void WriteBinaryMeshToFile(const std::string& file, const Mesh& mesh, BinaryCompression compression) {
+	BinaryFileWriter writer(file);
+	writer.write("vertexLocations", mesh.vertexLocations, compression);
+	if (mesh.vertexNormals.size() > 0)
+		writer.write("vertexNormals", mesh.vertexNormals, compression);
+	if (mesh.vertexColors.size() > 0)
+		writer.write("vertexColors", mesh.vertexColors, compression);
+	if (mesh.triIndexes.size() > 0)
+		writer.write("triIndexes", mesh.triIndexes, compression);
+	if (mesh.quadIndexes.size() > 0)
+		writer.write("quadIndexes", mesh.quadIndexes, compression);
+	if (mesh.textureMap.size() > 0)
+		writer.write("textureMap", mesh.textureMap, compression);
+	if (mesh.textureImage.size() > 0)
+		writer.write("textureImage", mesh.textureImage, compression);
+	writer.close();
+}
+void ReadBinaryMeshFromFile(const std::string& file, Mesh& mesh) {
+	MappedBinaryFile reader(file);
+	mesh.clear();
+	reader.read("vertexLocations", mesh.vertexLocations);
+	if (reader.hasSection("vertexNormals"))
+		reader.read("vertexNormals", mesh.vertexNormals);
+	if (reader.hasSection("vertexColors"))
+		reader.read("vertexColors", mesh.vertexColors);
+	if (reader.hasSection("triIndexes"))
+		reader.read("triIndexes", mesh.triIndexes);
+	if (reader.hasSection("quadIndexes"))
+		reader.read("quadIndexes", mesh.quadIndexes);
+	if (reader.hasSection("textureMap"))
+		reader.read("textureMap", mesh.textureMap);
+	if (reader.hasSection("textureImage"))
+		reader.read("textureImage", mesh.textureImage);
+	if (mesh.vertexNormals.size() == 0) {
+		mesh.updateVertexNormals();
+	}
+	mesh.updateBoundingBox();
 }
 void ReadPlyMeshFromFile(const std::string& file, Mesh &mesh) {
+	if (!ReadBinaryPlyMeshFromFile(file, mesh)) {
+		ReadGenericPlyMeshFromFile(file, mesh);
+	}
+}
+void ReadGenericPlyMeshFromFile(const std::string& file, Mesh &mesh) {
 	int i, j;
 	int numPts = 0, numPolys = 0;
 	PLYReaderWriter ply;
@@ -1317,6 +2143,7 @@ void ReadPlyMeshFromFile(const std::string& file, Mesh &mesh) {
 			}
 		}							//if face
 	} //for all elements of the PLY file
+	mesh.setTopologyDirty();
 	if (mesh.vertexLocations.size() > 0) {
 		mesh.updateBoundingBox();
 	}
@@ -1326,29 +2153,182 @@ void ReadPlyMeshFromFile(const std::string& file, Mesh &mesh) {
 	mesh.setDirty(true);
 }
 
-void CreateVertexNeighborTable(const Mesh& mesh, std::vector<std::set<uint32_t>>& vertNbrs) {
-	vertNbrs.resize(mesh.vertexLocations.size());
+const uint32_t MeshAdjacency::NO_EDGE;
+void MeshAdjacency::clear() {
+	vertexCount = 0;
+	triCount = 0;
+	quadCount = 0;
+	vertexOffsets.clear();
+	vertexNeighbors.clear();
+	faceOffsets.clear();
+	vertexFaces.clear();
+	edges.clear();
+	edgeOffsets.clear();
+	edgeHalfEdges.clear();
+	halfEdgeToEdge.clear();
+	opposite.clear();
+}
+bool MeshAdjacency::matches(const Mesh& mesh) const {
+	return (vertexCount == mesh.vertexLocations.size() && triCount == mesh.triIndexes.size() && quadCount == mesh.quadIndexes.size());
+}
+void MeshAdjacency::build(const Mesh& mesh) {
+	vertexCount = (uint32_t) mesh.vertexLocations.size();
+	triCount = (uint32_t) mesh.triIndexes.size();
+	quadCount = (uint32_t) mesh.quadIndexes.size();
+	const uint32_t H = getHalfEdgeCount();
+	const uint32_t F = getFaceCount();
+	//Half-edges are bucketed by their smaller vertex with a counting sort, which is a single radix pass with one digit
+	//per vertex. Each bucket is then sorted by the larger vertex, leaving both sides of an edge next to each other.
+	auto faceVertexes = [&](uint32_t f) {
+		return (f < triCount) ? &mesh.triIndexes[f][0] : &mesh.quadIndexes[f - triCount][0];
+	};
+	std::vector<uint32_t> bucketOffsets(vertexCount + 1, 0);
+	for (uint32_t f = 0; f < F; f++) {
+		const uint32_t* face = faceVertexes(f);
+		uint32_t sz = getFaceSize(f);
+		for (uint32_t k = 0; k < sz; k++) {
+			bucketOffsets[std::min(face[k], face[(k + 1) % sz]) + 1]++;
+		}
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		bucketOffsets[v + 1] += bucketOffsets[v];
+	}
+	std::vector<uint32_t> fill(bucketOffsets.begin(), bucketOffsets.end() - 1);
+	std::vector<uint32_t> others(H);
+	edgeHalfEdges.resize(H);
+	uint32_t he = 0;
+	for (uint32_t f = 0; f < F; f++) {
+		const uint32_t* face = faceVertexes(f);
+		uint32_t sz = getFaceSize(f);
+		for (uint32_t k = 0; k < sz; k++) {
+			uint32_t a = face[k];
+			uint32_t b = face[(k + 1) % sz];
+			uint32_t pos = fill[std::min(a, b)]++;
+			others[pos] = std::max(a, b);
+			edgeHalfEdges[pos] = he++;
+		}
+	}
+	//Buckets hold a handful of entries, so a stable insertion sort keeps the half-edges of an edge in face order.
+	std::vector<uint32_t> edgeCounts(vertexCount + 1, 0);
+#pragma omp parallel for
+	for (int v = 0; v < (int) vertexCount; v++) {
+		uint32_t start = bucketOffsets[v];
+		uint32_t end = bucketOffsets[v + 1];
+		for (uint32_t i = start + 1; i < end; i++) {
+			uint32_t other = others[i];
+			uint32_t h = edgeHalfEdges[i];
+			uint32_t j = i;
+			while (j > start && others[j - 1] > other) {
+				others[j] = others[j - 1];
+				edgeHalfEdges[j] = edgeHalfEdges[j - 1];
+				j--;
+			}
+			others[j] = other;
+			edgeHalfEdges[j] = h;
+		}
+		uint32_t count = 0;
+		for (uint32_t i = start; i < end; i++) {
+			if (i == start || others[i] != others[i - 1])
+				count++;
+		}
+		edgeCounts[v + 1] = count;
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		edgeCounts[v + 1] += edgeCounts[v];
+	}
+	edges.resize(edgeCounts[vertexCount]);
+	edgeOffsets.resize(edges.size() + 1);
+#pragma omp parallel for
+	for (int v = 0; v < (int) vertexCount; v++) {
+		uint32_t e = edgeCounts[v];
+		for (uint32_t i = bucketOffsets[v]; i < bucketOffsets[v + 1]; i++) {
+			if (i == bucketOffsets[v] || others[i] != others[i - 1]) {
+				edges[e] = uint2((uint32_t) v, others[i]);
+				edgeOffsets[e] = i;
+				e++;
+			}
+		}
+	}
+	edgeOffsets[edges.size()] = H;
+	const int E = (int) edges.size();
+	halfEdgeToEdge.resize(H);
+	opposite.assign(H, NO_EDGE);
+#pragma omp parallel for
+	for (int e = 0; e < E; e++) {
+		uint32_t start = edgeOffsets[e];
+		uint32_t end = edgeOffsets[e + 1];
+		for (uint32_t i = start; i < end; i++) {
+			halfEdgeToEdge[edgeHalfEdges[i]] = e;
+		}
+		if (end - start == 2) {
+			uint32_t he1 = edgeHalfEdges[start];
+			uint32_t he2 = edgeHalfEdges[start + 1];
+			if (getFace(he1) != getFace(he2)) {
+				opposite[he1] = he2;
+				opposite[he2] = he1;
+			}
+		}
+	}
+	//Filling in edge order leaves every ring sorted, since edges are ordered by their smaller vertex.
+	vertexOffsets.assign(vertexCount + 1, 0);
+	for (const uint2& edge : edges) {
+		vertexOffsets[edge.x + 1]++;
+		vertexOffsets[edge.y + 1]++;
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		vertexOffsets[v + 1] += vertexOffsets[v];
+	}
+	vertexNeighbors.resize(vertexOffsets[vertexCount]);
+	fill.assign(vertexOffsets.begin(), vertexOffsets.end() - 1);
+	for (const uint2& edge : edges) {
+		vertexNeighbors[fill[edge.x]++] = edge.y;
+		vertexNeighbors[fill[edge.y]++] = edge.x;
+	}
+	faceOffsets.assign(vertexCount + 1, 0);
 	for (const uint3& face : mesh.triIndexes.data) {
-		vertNbrs[face.x].insert(face.y);
-		vertNbrs[face.y].insert(face.z);
-		vertNbrs[face.z].insert(face.x);
-		vertNbrs[face.z].insert(face.y);
-		vertNbrs[face.y].insert(face.x);
-		vertNbrs[face.x].insert(face.z);
+		for (int k = 0; k < 3; k++) {
+			faceOffsets[face[k] + 1]++;
+		}
 	}
 	for (const uint4& face : mesh.quadIndexes.data) {
-		vertNbrs[face.x].insert(face.y);
-		vertNbrs[face.y].insert(face.z);
-		vertNbrs[face.z].insert(face.w);
-		vertNbrs[face.w].insert(face.x);
-		vertNbrs[face.w].insert(face.z);
-		vertNbrs[face.z].insert(face.y);
-		vertNbrs[face.y].insert(face.x);
-		vertNbrs[face.x].insert(face.w);
+		for (int k = 0; k < 4; k++) {
+			faceOffsets[face[k] + 1]++;
+		}
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		faceOffsets[v + 1] += faceOffsets[v];
 	}
+	vertexFaces.resize(faceOffsets[vertexCount]);
+	fill.assign(faceOffsets.begin(), faceOffsets.end() - 1);
+	uint32_t fid = 0;
+	for (const uint3& face : mesh.triIndexes.data) {
+		for (int k = 0; k < 3; k++) {
+			vertexFaces[fill[face[k]]++] = fid;
+		}
+		fid++;
+	}
+	for (const uint4& face : mesh.quadIndexes.data) {
+		for (int k = 0; k < 4; k++) {
+			vertexFaces[fill[face[k]]++] = fid;
+		}
+		fid++;
+	}
+}
+const MeshAdjacency& Mesh::getAdjacency() const {
+	if (adjacency.get() == nullptr || dirtyTopology || !adjacency->matches(*this)) {
+		std::shared_ptr<MeshAdjacency> adj(new MeshAdjacency());
+		adj->build(*this);
+		adjacency = adj;
+		dirtyTopology = false;
+	}
+	return *adjacency;
 }
-inline uint64_t faceHashCode(const uint2& val) {
-	return ((uint64_t) val.y) << 32 | ((uint64_t) val.x);
+void CreateVertexNeighborTable(const Mesh& mesh, std::vector<std::set<uint32_t>>& vertNbrs) {
+	const MeshAdjacency& adj = mesh.getAdjacency();
+	vertNbrs.resize(mesh.vertexLocations.size());
+	for (uint32_t v = 0; v < adj.vertexCount; v++) {
+		vertNbrs[v] = std::set<uint32_t>(adj.getVertexNeighbors(v), adj.getVertexNeighbors(v) + adj.getVertexValence(v));
+	}
 }
 void CreateOrderedVertexNeighborTable(const Mesh& mesh, std::vector<std::list<uint32_t>>& vertNbrsOut, bool leaveTail) {
 	//Leave tail means to not remove the duplicate vertex neighbor at the end of the neighbor list.
@@ -1514,8 +2494,10 @@ bool Mesh::convertQuadsToTriangles() {
 			}
 		}
 	}
-	if (quadIndexes.size() > 0)
+	if (quadIndexes.size() > 0) {
 		setDirty(true);
+		setTopologyDirty();
+	}
 	quadIndexes.clear();
 	if (vertexNormals.size() > 0) {
 		updateVertexNormals();
@@ -1523,98 +2505,26 @@ bool Mesh::convertQuadsToTriangles() {
 	return ret;
 }
 void CreateFaceNeighborTable(const Mesh& mesh, std::vector<std::list<uint32_t>>& faceNbrs) {
+	const MeshAdjacency& adj = mesh.getAdjacency();
 	faceNbrs.resize(mesh.triIndexes.size() + mesh.quadIndexes.size());
-	std::map<uint64_t, std::list<uint>> edgeTable;
-	uint2 edge;
-	uint fid = 0;
-	for (const uint3& face : mesh.triIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		edgeTable[faceHashCode(edge)].push_back(fid);
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		edgeTable[faceHashCode(edge)].push_back(fid);
-		edge = (face.z < face.x) ? uint2(face.z, face.x) : uint2(face.x, face.z);
-		edgeTable[faceHashCode(edge)].push_back(fid);
-		fid++;
-	}
-	for (const uint4& face : mesh.quadIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		edgeTable[faceHashCode(edge)].push_back(fid);
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		edgeTable[faceHashCode(edge)].push_back(fid);
-		edge = (face.z < face.w) ? uint2(face.z, face.w) : uint2(face.w, face.z);
-		edgeTable[faceHashCode(edge)].push_back(fid);
-		edge = (face.w < face.x) ? uint2(face.w, face.x) : uint2(face.x, face.w);
-		edgeTable[faceHashCode(edge)].push_back(fid);
-		fid++;
-	}
-	for (std::pair<const uint64_t, std::list<uint>>& edgeList : edgeTable) {
-		if (edgeList.second.size() == 2) {
-			uint fid1 = edgeList.second.front();
-			uint fid2 = edgeList.second.back();
-			if (fid1 != fid2) {
-				faceNbrs[fid1].push_back(fid2);
-				faceNbrs[fid2].push_back(fid1);
-			}
+	for (uint32_t e = 0; e < (uint32_t) adj.edges.size(); e++) {
+		uint32_t he = adj.edgeHalfEdges[adj.edgeOffsets[e]];
+		if (adj.opposite[he] != MeshAdjacency::NO_EDGE) {
+			uint32_t fid1 = adj.getFace(he);
+			uint32_t fid2 = adj.getFace(adj.opposite[he]);
+			faceNbrs[fid1].push_back(fid2);
+			faceNbrs[fid2].push_back(fid1);
 		}
 	}
 }
-struct FaceEdge {
-	std::list<uint> faces;
-	size_t edgePointIndex;
-};
 void SubdivideCatmullClark(Mesh& mesh) {
-	std::vector<std::list<uint32_t>> faceFaceNbrs;
-	faceFaceNbrs.resize(mesh.triIndexes.size() + mesh.quadIndexes.size());
-	std::map<uint64_t, FaceEdge> edgeTable;
-	std::set<uint2> edges;
+	const MeshAdjacency& adj = mesh.getAdjacency();
+	const std::vector<uint2>& edges = adj.edges;
 	bool hasUVs = mesh.textureMap.size() > 0;
 	bool hasColor = mesh.vertexColors.size() > 0;
 	std::vector<std::pair<int, float3>> faceVerts(mesh.vertexLocations.size(), std::pair<int, float3>(0, float3(0.0f)));
 	std::vector<std::pair<int, float3>> edgeVerts(mesh.vertexLocations.size(), std::pair<int, float3>(0, float3(0.0f)));
-	uint2 edge;
 	uint fid = 0;
-	for (const uint3& face : mesh.triIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-
-		edge = (face.z < face.x) ? uint2(face.z, face.x) : uint2(face.x, face.z);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-		fid++;
-	}
-	for (const uint4& face : mesh.quadIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-
-		edge = (face.z < face.w) ? uint2(face.z, face.w) : uint2(face.w, face.z);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-
-		edge = (face.w < face.x) ? uint2(face.w, face.x) : uint2(face.x, face.w);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-		fid++;
-	}
-	for (std::pair<const uint64_t, FaceEdge>& edgeList : edgeTable) {
-		if (edgeList.second.faces.size() == 2) {
-			uint fid1 = edgeList.second.faces.front();
-			uint fid2 = edgeList.second.faces.back();
-			if (fid1 != fid2) {
-				faceFaceNbrs[fid1].push_back(fid2);
-				faceFaceNbrs[fid2].push_back(fid1);
-			}
-		}
-	}
 	size_t backIndex = mesh.vertexLocations.size();
 	size_t endIndex = backIndex;
 	mesh.vertexLocations.resize(endIndex + mesh.quadIndexes.size() + mesh.triIndexes.size() + edges.size());
@@ -1653,16 +2563,18 @@ void SubdivideCatmullClark(Mesh& mesh) {
 		}
 		mesh.vertexLocations[endIndex++] = avg;
 	}
-	for (uint2 edge : edges) {
+	const size_t edgeIndex = endIndex;
+	for (uint32_t e = 0; e < (uint32_t) edges.size(); e++) {
+		uint2 edge = edges[e];
 		float3 pt1 = mesh.vertexLocations[edge.x];
 		float3 pt2 = mesh.vertexLocations[edge.y];
-		FaceEdge& fe = edgeTable[faceHashCode(edge)];
-		fe.edgePointIndex = endIndex;
 		float3 avg;
-		if (fe.faces.size() < 2) {
+		if (adj.getEdgeFaceCount(e) < 2) {
 			avg = 0.5f * (pt1 + pt2);
 		} else {
-			avg = 0.25f * (pt1 + pt2 + mesh.vertexLocations[fe.faces.front() + backIndex] + mesh.vertexLocations[fe.faces.back() + backIndex]);
+			uint32_t front = adj.getFace(adj.edgeHalfEdges[adj.edgeOffsets[e]]);
+			uint32_t back = adj.getFace(adj.edgeHalfEdges[adj.edgeOffsets[e + 1] - 1]);
+			avg = 0.25f * (pt1 + pt2 + mesh.vertexLocations[front + backIndex] + mesh.vertexLocations[back + backIndex]);
 		}
 		for (int k = 0; k < 2; k++) {
 			std::pair<int, float3>& pr = edgeVerts[edge[k]];
@@ -1681,13 +2593,11 @@ void SubdivideCatmullClark(Mesh& mesh) {
 	size_t uvIndex = 0;
 	fid = 0;
 	endIndex = backIndex;
+	uint32_t he = 0;
 	for (const uint3& face : mesh.triIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		size_t ept1 = edgeTable[faceHashCode(edge)].edgePointIndex;
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		size_t ept2 = edgeTable[faceHashCode(edge)].edgePointIndex;
-		edge = (face.z < face.x) ? uint2(face.z, face.x) : uint2(face.x, face.z);
-		size_t ept3 = edgeTable[faceHashCode(edge)].edgePointIndex;
+		size_t ept1 = edgeIndex + adj.halfEdgeToEdge[he++];
+		size_t ept2 = edgeIndex + adj.halfEdgeToEdge[he++];
+		size_t ept3 = edgeIndex + adj.halfEdgeToEdge[he++];
 
 		if (hasUVs) {
 			float2 uv1 = mesh.textureMap[fid];
@@ -1720,14 +2630,10 @@ void SubdivideCatmullClark(Mesh& mesh) {
 		endIndex++;
 	}
 	for (const uint4& face : mesh.quadIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		size_t ept1 = edgeTable[faceHashCode(edge)].edgePointIndex;
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		size_t ept2 = edgeTable[faceHashCode(edge)].edgePointIndex;
-		edge = (face.z < face.w) ? uint2(face.z, face.w) : uint2(face.w, face.z);
-		size_t ept3 = edgeTable[faceHashCode(edge)].edgePointIndex;
-		edge = (face.w < face.x) ? uint2(face.w, face.x) : uint2(face.x, face.w);
-		size_t ept4 = edgeTable[faceHashCode(edge)].edgePointIndex;
+		size_t ept1 = edgeIndex + adj.halfEdgeToEdge[he++];
+		size_t ept2 = edgeIndex + adj.halfEdgeToEdge[he++];
+		size_t ept3 = edgeIndex + adj.halfEdgeToEdge[he++];
+		size_t ept4 = edgeIndex + adj.halfEdgeToEdge[he++];
 		if (hasUVs) {
 			float2 uv1 = mesh.textureMap[fid];
 			float2 uv2 = mesh.textureMap[fid + 1];
@@ -1781,69 +2687,37 @@ void SubdivideCatmullClark(Mesh& mesh) {
 		mesh.textureMap = uvs;
 	mesh.quadIndexes = newQuads;
 	mesh.triIndexes.clear();
+	mesh.setTopologyDirty();
 	if (mesh.vertexNormals.size() > 0)
 		mesh.updateVertexNormals();
 	mesh.setDirty(true);
 }
 void SubdivideLoop(Mesh& mesh) {
 	mesh.convertQuadsToTriangles();
-	std::map<uint64_t, FaceEdge> edgeTable;
-	std::set<uint2> edges;
-	uint2 edge;
+	const MeshAdjacency& adj = mesh.getAdjacency();
+	const std::vector<uint2>& edges = adj.edges;
 	uint fid = 0;
 	bool hasUVs = mesh.textureMap.size() > 0;
 	bool hasColor = mesh.vertexColors.size() > 0;
-	for (const uint3& face : mesh.triIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-
-		edge = (face.z < face.x) ? uint2(face.z, face.x) : uint2(face.x, face.z);
-		edges.insert(edge);
-		edgeTable[faceHashCode(edge)].faces.push_back(fid);
-		fid++;
-	}
-
 	size_t backIndex = mesh.vertexLocations.size();
 	size_t endIndex = backIndex;
 	mesh.vertexLocations.resize(endIndex + edges.size());
 	if (hasColor)
 		mesh.vertexColors.resize(mesh.vertexLocations.size());
-	for (uint2 edge : edges) {
+	for (uint32_t e = 0; e < (uint32_t) edges.size(); e++) {
+		uint2 edge = edges[e];
 		float3 pt1 = mesh.vertexLocations[edge.x];
 		float3 pt2 = mesh.vertexLocations[edge.y];
-		FaceEdge& fe = edgeTable[faceHashCode(edge)];
-		fe.edgePointIndex = endIndex;
 		float3 avg;
-		if (fe.faces.size() < 2) {
+		if (adj.getEdgeFaceCount(e) < 2) {
 			avg = 0.5f * (pt1 + pt2);
 		} else {
-			uint3 face = mesh.triIndexes[fe.faces.front()];
-			int other1 = -1, other2 = -1;
-			if ((face.x == edge.x && face.y == edge.y) || (face.y == edge.x && face.x == edge.y)) {
-				other1 = face.z;
-			} else if ((face.y == edge.x && face.z == edge.y) || (face.z == edge.x && face.y == edge.y)) {
-				other1 = face.x;
-			} else if ((face.x == edge.x && face.z == edge.y) || (face.z == edge.x && face.x == edge.y)) {
-				other1 = face.y;
-			}
-			face = mesh.triIndexes[fe.faces.back()];
-			if ((face.x == edge.x && face.y == edge.y) || (face.y == edge.x && face.x == edge.y)) {
-				other2 = face.z;
-			} else if ((face.y == edge.x && face.z == edge.y) || (face.z == edge.x && face.y == edge.y)) {
-				other2 = face.x;
-			} else if ((face.x == edge.x && face.z == edge.y) || (face.z == edge.x && face.x == edge.y)) {
-				other2 = face.y;
-			}
-			if (other1 >= 0 && other2 >= 0) {
-				avg = 0.125f * (3.0f * pt1 + 3.0f * pt2 + mesh.vertexLocations[other1] + mesh.vertexLocations[other2]);
-			} else {
-				avg = 0.5f * (pt1 + pt2);
-			}
+			//The vertex across from a half-edge is the one before its origin.
+			uint32_t he1 = adj.edgeHalfEdges[adj.edgeOffsets[e]];
+			uint32_t he2 = adj.edgeHalfEdges[adj.edgeOffsets[e + 1] - 1];
+			uint32_t other1 = mesh.triIndexes[he1 / 3][(he1 + 2) % 3];
+			uint32_t other2 = mesh.triIndexes[he2 / 3][(he2 + 2) % 3];
+			avg = 0.125f * (3.0f * pt1 + 3.0f * pt2 + mesh.vertexLocations[other1] + mesh.vertexLocations[other2]);
 		}
 		if (hasColor) {
 			mesh.vertexColors[endIndex] = 0.5f * (mesh.vertexColors[edge.x] + mesh.vertexColors[edge.y]);
@@ -1856,13 +2730,11 @@ void SubdivideLoop(Mesh& mesh) {
 	fid = 0;
 	std::vector<float2> uvs(newTris.size() * 3);
 	size_t uvIndex = 0;
+	uint32_t he = 0;
 	for (const uint3& face : mesh.triIndexes.data) {
-		edge = (face.x < face.y) ? uint2(face.x, face.y) : uint2(face.y, face.x);
-		size_t ept1 = edgeTable[faceHashCode(edge)].edgePointIndex;
-		edge = (face.y < face.z) ? uint2(face.y, face.z) : uint2(face.z, face.y);
-		size_t ept2 = edgeTable[faceHashCode(edge)].edgePointIndex;
-		edge = (face.z < face.x) ? uint2(face.z, face.x) : uint2(face.x, face.z);
-		size_t ept3 = edgeTable[faceHashCode(edge)].edgePointIndex;
+		size_t ept1 = backIndex + adj.halfEdgeToEdge[he++];
+		size_t ept2 = backIndex + adj.halfEdgeToEdge[he++];
+		size_t ept3 = backIndex + adj.halfEdgeToEdge[he++];
 		if (hasUVs) {
 			float2 uv1 = mesh.textureMap[fid];
 			float2 uv2 = mesh.textureMap[fid + 1];
@@ -1893,16 +2765,7 @@ void SubdivideLoop(Mesh& mesh) {
 		newTris[faceIndex++] = uint3(face.z, (uint32_t) ept3, (uint32_t) ept2);
 		newTris[faceIndex++] = uint3((uint32_t) ept1, (uint32_t) ept2, (uint32_t) ept3);
 	}
-	std::vector<std::set<uint32_t>> vertNbrs(mesh.vertexLocations.size());
-	for (const uint3& face : mesh.triIndexes.data) {
-		vertNbrs[face.x].insert(face.y);
-		vertNbrs[face.y].insert(face.z);
-		vertNbrs[face.z].insert(face.x);
-		vertNbrs[face.z].insert(face.y);
-		vertNbrs[face.y].insert(face.x);
-		vertNbrs[face.x].insert(face.z);
-	}
-	mesh.triIndexes = newTris;
+	std::vector<float3> smoothed(backIndex);
 	const int MAX_VALENCE = 32;
 	static std::vector<float> valenceWeights;
 	if (valenceWeights.size() == 0) {
@@ -1914,18 +2777,25 @@ void SubdivideLoop(Mesh& mesh) {
 		}
 	}
 
+	//Rings only reference original vertexes, which are updated after all of them are computed.
+#pragma omp parallel for
 	for (int n = 0; n < (int) backIndex; n++) {
-		int N = (int) vertNbrs[n].size();
+		int N = (int) adj.getVertexValence(n);
+		float3 pt = mesh.vertexLocations[n];
 		if (N > 0 && N < MAX_VALENCE) {
 			float beta = valenceWeights[N];
 			float alpha = (1 - N * beta);
-			float3 pt = alpha * mesh.vertexLocations[n];
-			for (uint32_t nbr : vertNbrs[n]) {
-				pt += beta * mesh.vertexLocations[nbr];
+			pt = alpha * pt;
+			const uint32_t* nbrs = adj.getVertexNeighbors(n);
+			for (int k = 0; k < N; k++) {
+				pt += beta * mesh.vertexLocations[nbrs[k]];
 			}
-			mesh.vertexLocations[n] = pt;
 		}
+		smoothed[n] = pt;
 	}
+	std::copy(smoothed.begin(), smoothed.end(), mesh.vertexLocations.data.begin());
+	mesh.triIndexes = newTris;
+	mesh.setTopologyDirty();
 	if (hasUVs)
 		mesh.textureMap = uvs;
 	if (mesh.vertexNormals.size() > 0)
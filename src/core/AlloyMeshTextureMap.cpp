@@ -387,7 +387,7 @@ namespace aly {
 		SparseMat<double> At = A.transpose();
 		SparseMat<double> AtA = At * A;
 		Vec<double> Atb = At*B;
-		SolveBICGStab(Atb, AtA, X, conformalIterations, 1E-30/*, [=](int iter, double err) {
+		SolveBICGStab(Atb, AtA, X, PreconditionerType::IncompleteCholesky, conformalIterations, 1E-30/*, [=](int iter, double err) {
 			std::cout << "Iteration " << iter << " " << err << std::endl;
 			return true;
 		}*/);
@@ -1043,30 +1043,21 @@ namespace aly {
 	}
 	void MeshTextureMap::smooth(aly::Mesh& mesh,  int iters, float errorTolerance){
 
-		MeshSetNeighborTable nbrTable;
-		CreateVertexNeighborTable(mesh, nbrTable);
-		int index = 0;
+		const MeshAdjacency& adj = mesh.getAdjacency();
 		int N =  (int)mesh.vertexLocations.size();
 		SparseMatrix1f A(N, N);
 		Vector3f b(N);
-		for (std::set<uint32_t>& nbrs : nbrTable) {
-			int K = (int)nbrs.size() - 1;
-			float3 pt = mesh.vertexLocations[index];
-			{
-				auto nbrIter = nbrs.begin();
-				nbrIter++;
-				for (int k = 0; k < K; k++) {
-					float w = -smoothness / K;
-					int offset = *nbrIter;
-					A.set(index, offset, w);
-					nbrIter++;
-				}
+		for (int index = 0; index < N; index++) {
+			int K = (int)adj.getVertexValence(index);
+			const uint32_t* nbrs = adj.getVertexNeighbors(index);
+			for (int k = 0; k < K; k++) {
+				float w = -smoothness / K;
+				A.set(index, nbrs[k], w);
 			}
 			A.set(index, index, smoothness + 1);
-			b[index] = pt;
-			index++;
+			b[index] = mesh.vertexLocations[index];
 		}
-		SolveBICGStab(b, A, mesh.vertexLocations, smoothIterations,errorTolerance);
+		SolveBICGStab(b, A, mesh.vertexLocations, PreconditionerType::IncompleteLU, smoothIterations,errorTolerance);
 		mesh.updateVertexNormals();
 	}
 }
@@ -126,6 +126,93 @@ namespace aly {
 
 		}
 	}
+	template<class T> void SolvePreconditionedCGInternal(const Vec<T>& b, const SparseMat<T>& A, const Preconditioner<T>& M, Vec<T>& x, int iters,
+			double tolerance, const std::function<bool(int, double)>& iterationMonitor) {
+		const double ZERO_TOLERANCE = 1E-16;
+		size_t N = b.size();
+		Vec<T> r(N), z(N), p(N), Ap(N);
+		Multiply(Ap, A, x);
+		Subtract(r, b, Ap);
+		double e = lengthSqr(r) / N;
+		if (iterationMonitor) {
+			if (!iterationMonitor(0, e))
+				return;
+		}
+		M.apply(z.data, r.data);
+		p = z;
+		double rz = dot(r, z);
+		for (int iter = 0; iter < iters; iter++) {
+			Multiply(Ap, A, p);
+			double denom = dot(p, Ap);
+			if (std::abs(denom) < ZERO_TOLERANCE) {
+				denom = (denom < 0) ? -ZERO_TOLERANCE : ZERO_TOLERANCE;
+			}
+			double alpha = rz / denom;
+			ScaleAdd(x, T(alpha), p);
+			ScaleSubtract(r, T(alpha), Ap);
+			double e = lengthSqr(r) / N;
+			if (iterationMonitor) {
+				if (!iterationMonitor(iter + 1, e))
+					return;
+			}
+			if (e < tolerance)
+				break;
+			M.apply(z.data, r.data);
+			double rzNext = dot(r, z);
+			denom = rz;
+			if (std::abs(denom) < ZERO_TOLERANCE) {
+				denom = (denom < 0) ? -ZERO_TOLERANCE : ZERO_TOLERANCE;
+			}
+			double beta = rzNext / denom;
+			ScaleAdd(p, z, T(beta), p);
+			rz = rzNext;
+		}
+	}
+	template<class T> void SolvePreconditionedBICGStabInternal(const Vec<T>& b, const SparseMat<T>& A, const Preconditioner<T>& M, Vec<T>& x,
+			int iters, double tolerance, const std::function<bool(int, double)>& iterationMonitor) {
+		const double ZERO_TOLERANCE = 1E-16;
+		size_t N = b.size();
+		Vec<T> r(N), rinit, p(N), v(N), s(N), t(N), y(N), z(N);
+		v.set(T(0));
+		p.set(T(0));
+		double rhoNext(1);
+		double rho(1);
+		T alpha(1), beta(1);
+		T omega(1);
+		SubtractMultiply(r, b, A, x);
+		rinit = r;
+		double e = lengthSqr(r) / N;
+		if (iterationMonitor) {
+			if (!iterationMonitor(0, e))
+				return;
+		}
+		for (int iter = 0; iter < iters; iter++) {
+			rhoNext = dot(rinit, r);
+			beta = T((rhoNext / rho)) * (alpha / omega);
+			ScaleAdd(p, r, beta, p, -beta * omega, v);
+			M.apply(y.data, p.data);
+			Multiply(v, A, y);
+			alpha = T(rhoNext / dot(rinit, v));
+			ScaleSubtract(s, r, alpha, v);
+			if (lengthL1(s) < N * ZERO_TOLERANCE) {
+				ScaleAdd(x, alpha, y);
+				break;
+			}
+			M.apply(z.data, s.data);
+			Multiply(t, A, z);
+			omega = T(dot(t, s) / dot(t, t));
+			ScaleAdd(x, x, alpha, y, omega, z);
+			ScaleSubtract(r, s, omega, t);
+			rho = rhoNext;
+			double e = lengthSqr(r) / N;
+			if (iterationMonitor) {
+				if (!iterationMonitor(iter + 1, e))
+					return;
+			}
+			if (e < tolerance)
+				break;
+		}
+	}
 	template<class T> void SolveLevenbergMarquardtInternal(SparseProblem<T>& problem, Vec<T>& p, int maxIterations, double errorTolerance,
 			const std::function<bool(int, double)>& monitor) {
 		//Implementation not tested yet! Use at your own risk!
@@ -304,6 +391,32 @@ namespace aly {
 			const std::function<bool(int, double)>& iterationMonitor) {
 		SolveBICGStabInternal(b, A, x, iters, tolerance, iterationMonitor);
 	}
+	void SolveCG(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, const Preconditioner<float>& M, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		SolvePreconditionedCGInternal(b, A, M, x, iters, tolerance, iterationMonitor);
+	}
+	void SolveBICGStab(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, const Preconditioner<float>& M, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		SolvePreconditionedBICGStabInternal(b, A, M, x, iters, tolerance, iterationMonitor);
+	}
+	void SolveCG(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, PreconditionerType type, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		std::shared_ptr<Preconditioner<float>> M = MakePreconditioner(A.compress(), type);
+		if (M.get() == nullptr) {
+			SolveCGInternal(b, A, x, iters, tolerance, iterationMonitor);
+		} else {
+			SolvePreconditionedCGInternal(b, A, *M, x, iters, tolerance, iterationMonitor);
+		}
+	}
+	void SolveBICGStab(const Vec<float>& b, const SparseMat<float>& A, Vec<float>& x, PreconditionerType type, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		std::shared_ptr<Preconditioner<float>> M = MakePreconditioner(A.compress(), type);
+		if (M.get() == nullptr) {
+			SolveBICGStabInternal(b, A, x, iters, tolerance, iterationMonitor);
+		} else {
+			SolvePreconditionedBICGStabInternal(b, A, *M, x, iters, tolerance, iterationMonitor);
+		}
+	}
 	void SolveLevenbergMarquardt(SparseProblem<float>& problem, Vec<float>& p, int maxIterations, double errorTolerance,
 			const std::function<bool(int, double)>& monitor) {
 		SolveLevenbergMarquardtInternal(problem, p, maxIterations, errorTolerance, monitor);
@@ -321,6 +434,32 @@ namespace aly {
 			const std::function<bool(int, double)>& iterationMonitor) {
 		SolveBICGStabInternal(b, A, x, iters, tolerance, iterationMonitor);
 	}
+	void SolveCG(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, const Preconditioner<double>& M, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		SolvePreconditionedCGInternal(b, A, M, x, iters, tolerance, iterationMonitor);
+	}
+	void SolveBICGStab(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, const Preconditioner<double>& M, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		SolvePreconditionedBICGStabInternal(b, A, M, x, iters, tolerance, iterationMonitor);
+	}
+	void SolveCG(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, PreconditionerType type, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		std::shared_ptr<Preconditioner<double>> M = MakePreconditioner(A.compress(), type);
+		if (M.get() == nullptr) {
+			SolveCGInternal(b, A, x, iters, tolerance, iterationMonitor);
+		} else {
+			SolvePreconditionedCGInternal(b, A, *M, x, iters, tolerance, iterationMonitor);
+		}
+	}
+	void SolveBICGStab(const Vec<double>& b, const SparseMat<double>& A, Vec<double>& x, PreconditionerType type, int iters, double tolerance,
+			const std::function<bool(int, double)>& iterationMonitor) {
+		std::shared_ptr<Preconditioner<double>> M = MakePreconditioner(A.compress(), type);
+		if (M.get() == nullptr) {
+			SolveBICGStabInternal(b, A, x, iters, tolerance, iterationMonitor);
+		} else {
+			SolvePreconditionedBICGStabInternal(b, A, *M, x, iters, tolerance, iterationMonitor);
+		}
+	}
 	void SolveLevenbergMarquardt(SparseProblem<double>& problem, Vec<double>& p, int maxIterations, double errorTolerance,
 			const std::function<bool(int, double)>& monitor) {
 		SolveLevenbergMarquardtInternal(problem, p, maxIterations, errorTolerance, monitor);
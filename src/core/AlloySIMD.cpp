@@ -0,0 +1,566 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "AlloySIMD.h"
+#include "AlloyCommon.h"
+#include <iostream>
+#include <cmath>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ALY_SIMD_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+#if defined(ALY_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ALY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ALY_TARGET_AVX2
+#endif
+namespace aly {
+namespace simd {
+typedef void (*BinaryFloatKernel)(float*, const float*, const float*, size_t);
+typedef void (*TernaryFloatKernel)(float*, const float*, const float*, const float*, size_t);
+typedef double (*DotFloatKernel)(const float*, const float*, size_t);
+typedef void (*MinMaxFloatKernel)(const float*, size_t, int, float*, float*);
+typedef void (*BinaryByteKernel)(uint8_t*, const uint8_t*, const uint8_t*, size_t);
+typedef double (*DotByteKernel)(const uint8_t*, const uint8_t*, size_t);
+typedef void (*MinMaxByteKernel)(const uint8_t*, size_t, int, uint8_t*, uint8_t*);
+struct DispatchTable {
+	SIMDInstructionSet set;
+	BinaryFloatKernel addf, subtractf, multiplyf, dividef;
+	TernaryFloatKernel multiplyAddf, multiplySubtractf;
+	DotFloatKernel dotf;
+	MinMaxFloatKernel minMaxf;
+	BinaryByteKernel addb, subtractb, multiplyb;
+	DotByteKernel dotb;
+	MinMaxByteKernel minMaxb;
+};
+//Scalar reference implementations, also used for tails.
+void AddScalar(float* out, const float* a, const float* b, size_t n) {
+	ScalarKernels<float>::add(out, a, b, n);
+}
+void SubtractScalar(float* out, const float* a, const float* b, size_t n) {
+	ScalarKernels<float>::subtract(out, a, b, n);
+}
+void MultiplyScalar(float* out, const float* a, const float* b, size_t n) {
+	ScalarKernels<float>::multiply(out, a, b, n);
+}
+void DivideScalar(float* out, const float* a, const float* b, size_t n) {
+	ScalarKernels<float>::divide(out, a, b, n);
+}
+void MultiplyAddScalar(float* out, const float* a, const float* b, const float* c, size_t n) {
+	ScalarKernels<float>::multiplyAdd(out, a, b, c, n);
+}
+void MultiplySubtractScalar(float* out, const float* a, const float* b, const float* c, size_t n) {
+	ScalarKernels<float>::multiplySubtract(out, a, b, c, n);
+}
+double DotScalar(const float* a, const float* b, size_t n) {
+	return ScalarKernels<float>::dot(a, b, n);
+}
+void MinMaxScalar(const float* a, size_t n, int channels, float* minVal, float* maxVal) {
+	ScalarKernels<float>::minMax(a, n, channels, minVal, maxVal);
+}
+void AddScalar(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	ScalarKernels<uint8_t>::add(out, a, b, n);
+}
+void SubtractScalar(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	ScalarKernels<uint8_t>::subtract(out, a, b, n);
+}
+void MultiplyScalar(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	ScalarKernels<uint8_t>::multiply(out, a, b, n);
+}
+double DotScalar(const uint8_t* a, const uint8_t* b, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0; i < n; i++)
+		sum += (uint32_t) a[i] * (uint32_t) b[i];
+	return (double) sum;
+}
+void MinMaxScalar(const uint8_t* a, size_t n, int channels, uint8_t* minVal, uint8_t* maxVal) {
+	ScalarKernels<uint8_t>::minMax(a, n, channels, minVal, maxVal);
+}
+#ifdef ALY_SIMD_X86
+//Number of accumulator registers needed so every lane of every register maps to a fixed channel.
+inline int ChannelPeriod(int channels, int lanes) {
+	int a = channels, b = lanes;
+	while (b != 0) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return channels / a;
+}
+void AddSSE2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	AddScalar(out + i, a + i, b + i, n - i);
+}
+void SubtractSSE2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(out + i, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	SubtractScalar(out + i, a + i, b + i, n - i);
+}
+void MultiplySSE2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	MultiplyScalar(out + i, a + i, b + i, n - i);
+}
+void DivideSSE2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(out + i, _mm_div_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	DivideScalar(out + i, a + i, b + i, n - i);
+}
+void MultiplyAddSSE2(float* out, const float* a, const float* b, const float* c, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(c + i))));
+	MultiplyAddScalar(out + i, a + i, b + i, c + i, n - i);
+}
+void MultiplySubtractSSE2(float* out, const float* a, const float* b, const float* c, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(out + i, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_mul_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(c + i))));
+	MultiplySubtractScalar(out + i, a + i, b + i, c + i, n - i);
+}
+double DotSSE2(const float* a, const float* b, size_t n) {
+	__m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 va = _mm_loadu_ps(a + i);
+		__m128 vb = _mm_loadu_ps(b + i);
+		lo = _mm_add_pd(lo, _mm_mul_pd(_mm_cvtps_pd(va), _mm_cvtps_pd(vb)));
+		hi = _mm_add_pd(hi, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(va, va)), _mm_cvtps_pd(_mm_movehl_ps(vb, vb))));
+	}
+	double tmp[2];
+	_mm_storeu_pd(tmp, _mm_add_pd(lo, hi));
+	return tmp[0] + tmp[1] + DotScalar(a + i, b + i, n - i);
+}
+void MinMaxSSE2(const float* a, size_t n, int channels, float* minVal, float* maxVal) {
+	const int lanes = 4;
+	const int regs = ChannelPeriod(channels, lanes);
+	const size_t stride = (size_t) regs * lanes;
+	if (regs > 4 || n < stride) {
+		MinMaxScalar(a, n, channels, minVal, maxVal);
+		return;
+	}
+	__m128 vmin[4], vmax[4];
+	for (int r = 0; r < regs; r++) {
+		vmin[r] = vmax[r] = _mm_loadu_ps(a + r * lanes);
+	}
+	size_t i = stride;
+	for (; i + stride <= n; i += stride) {
+		for (int r = 0; r < regs; r++) {
+			__m128 v = _mm_loadu_ps(a + i + r * lanes);
+			vmin[r] = _mm_min_ps(vmin[r], v);
+			vmax[r] = _mm_max_ps(vmax[r], v);
+		}
+	}
+	float tmin[16], tmax[16];
+	for (int r = 0; r < regs; r++) {
+		_mm_storeu_ps(tmin + r * lanes, vmin[r]);
+		_mm_storeu_ps(tmax + r * lanes, vmax[r]);
+	}
+	for (size_t k = 0; k < stride; k++) {
+		int c = (int) (k % channels);
+		minVal[c] = std::min(minVal[c], tmin[k]);
+		maxVal[c] = std::max(maxVal[c], tmax[k]);
+	}
+	//Tail starts on a multiple of stride, which is a multiple of channels.
+	MinMaxScalar(a + i, n - i, channels, minVal, maxVal);
+}
+void AddSSE2(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+		_mm_storeu_si128((__m128i*) (out + i), _mm_add_epi8(_mm_loadu_si128((const __m128i*) (a + i)), _mm_loadu_si128((const __m128i*) (b + i))));
+	AddScalar(out + i, a + i, b + i, n - i);
+}
+void SubtractSSE2(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+		_mm_storeu_si128((__m128i*) (out + i), _mm_sub_epi8(_mm_loadu_si128((const __m128i*) (a + i)), _mm_loadu_si128((const __m128i*) (b + i))));
+	SubtractScalar(out + i, a + i, b + i, n - i);
+}
+void MultiplySSE2(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+		__m128i even = _mm_and_si128(_mm_mullo_epi16(va, vb), mask);
+		__m128i odd = _mm_slli_epi16(_mm_mullo_epi16(_mm_srli_epi16(va, 8), _mm_srli_epi16(vb, 8)), 8);
+		_mm_storeu_si128((__m128i*) (out + i), _mm_or_si128(even, odd));
+	}
+	MultiplyScalar(out + i, a + i, b + i, n - i);
+}
+double DotSSE2(const uint8_t* a, const uint8_t* b, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	uint64_t total = 0;
+	size_t i = 0;
+	while (i + 16 <= n) {
+		//Each 32-bit lane gains at most 4 * 255^2 per step, so flush well before overflow.
+		__m128i acc = _mm_setzero_si128();
+		size_t end = std::min(n - (n - i) % 16, i + 16 * 1024);
+		for (; i < end; i += 16) {
+			__m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+			__m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero)));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero)));
+		}
+		uint32_t tmp[4];
+		_mm_storeu_si128((__m128i*) tmp, acc);
+		total += (uint64_t) tmp[0] + tmp[1] + tmp[2] + tmp[3];
+	}
+	return (double) total + DotScalar(a + i, b + i, n - i);
+}
+void MinMaxSSE2(const uint8_t* a, size_t n, int channels, uint8_t* minVal, uint8_t* maxVal) {
+	const int lanes = 16;
+	const int regs = ChannelPeriod(channels, lanes);
+	const size_t stride = (size_t) regs * lanes;
+	if (regs > 4 || n < stride) {
+		MinMaxScalar(a, n, channels, minVal, maxVal);
+		return;
+	}
+	__m128i vmin[4], vmax[4];
+	for (int r = 0; r < regs; r++) {
+		vmin[r] = vmax[r] = _mm_loadu_si128((const __m128i*) (a + r * lanes));
+	}
+	size_t i = stride;
+	for (; i + stride <= n; i += stride) {
+		for (int r = 0; r < regs; r++) {
+			__m128i v = _mm_loadu_si128((const __m128i*) (a + i + r * lanes));
+			vmin[r] = _mm_min_epu8(vmin[r], v);
+			vmax[r] = _mm_max_epu8(vmax[r], v);
+		}
+	}
+	uint8_t tmin[64], tmax[64];
+	for (int r = 0; r < regs; r++) {
+		_mm_storeu_si128((__m128i*) (tmin + r * lanes), vmin[r]);
+		_mm_storeu_si128((__m128i*) (tmax + r * lanes), vmax[r]);
+	}
+	for (size_t k = 0; k < stride; k++) {
+		int c = (int) (k % channels);
+		minVal[c] = std::min(minVal[c], tmin[k]);
+		maxVal[c] = std::max(maxVal[c], tmax[k]);
+	}
+	MinMaxScalar(a + i, n - i, channels, minVal, maxVal);
+}
+ALY_TARGET_AVX2 void AddAVX2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	AddSSE2(out + i, a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void SubtractAVX2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	SubtractSSE2(out + i, a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void MultiplyAVX2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	MultiplySSE2(out + i, a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void DivideAVX2(float* out, const float* a, const float* b, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	DivideSSE2(out + i, a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void MultiplyAddAVX2(float* out, const float* a, const float* b, const float* c, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_mul_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(c + i))));
+	MultiplyAddSSE2(out + i, a + i, b + i, c + i, n - i);
+}
+ALY_TARGET_AVX2 void MultiplySubtractAVX2(float* out, const float* a, const float* b, const float* c, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_mul_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(c + i))));
+	MultiplySubtractSSE2(out + i, a + i, b + i, c + i, n - i);
+}
+ALY_TARGET_AVX2 double DotAVX2(const float* a, const float* b, size_t n) {
+	__m256d lo = _mm256_setzero_pd(), hi = _mm256_setzero_pd();
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 va = _mm256_loadu_ps(a + i);
+		__m256 vb = _mm256_loadu_ps(b + i);
+		lo = _mm256_add_pd(lo, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(va)), _mm256_cvtps_pd(_mm256_castps256_ps128(vb))));
+		hi = _mm256_add_pd(hi, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(va, 1)), _mm256_cvtps_pd(_mm256_extractf128_ps(vb, 1))));
+	}
+	double tmp[4];
+	_mm256_storeu_pd(tmp, _mm256_add_pd(lo, hi));
+	return tmp[0] + tmp[1] + tmp[2] + tmp[3] + DotSSE2(a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void MinMaxAVX2(const float* a, size_t n, int channels, float* minVal, float* maxVal) {
+	const int lanes = 8;
+	const int regs = ChannelPeriod(channels, lanes);
+	const size_t stride = (size_t) regs * lanes;
+	if (regs > 4 || n < stride) {
+		MinMaxSSE2(a, n, channels, minVal, maxVal);
+		return;
+	}
+	__m256 vmin[4], vmax[4];
+	for (int r = 0; r < regs; r++) {
+		vmin[r] = vmax[r] = _mm256_loadu_ps(a + r * lanes);
+	}
+	size_t i = stride;
+	for (; i + stride <= n; i += stride) {
+		for (int r = 0; r < regs; r++) {
+			__m256 v = _mm256_loadu_ps(a + i + r * lanes);
+			vmin[r] = _mm256_min_ps(vmin[r], v);
+			vmax[r] = _mm256_max_ps(vmax[r], v);
+		}
+	}
+	float tmin[32], tmax[32];
+	for (int r = 0; r < regs; r++) {
+		_mm256_storeu_ps(tmin + r * lanes, vmin[r]);
+		_mm256_storeu_ps(tmax + r * lanes, vmax[r]);
+	}
+	for (size_t k = 0; k < stride; k++) {
+		int c = (int) (k % channels);
+		minVal[c] = std::min(minVal[c], tmin[k]);
+		maxVal[c] = std::max(maxVal[c], tmax[k]);
+	}
+	MinMaxSSE2(a + i, n - i, channels, minVal, maxVal);
+}
+ALY_TARGET_AVX2 void AddAVX2(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+		_mm256_storeu_si256((__m256i*) (out + i), _mm256_add_epi8(_mm256_loadu_si256((const __m256i*) (a + i)), _mm256_loadu_si256((const __m256i*) (b + i))));
+	AddSSE2(out + i, a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void SubtractAVX2(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+		_mm256_storeu_si256((__m256i*) (out + i), _mm256_sub_epi8(_mm256_loadu_si256((const __m256i*) (a + i)), _mm256_loadu_si256((const __m256i*) (b + i))));
+	SubtractSSE2(out + i, a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void MultiplyAVX2(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	const __m256i mask = _mm256_set1_epi16(0x00FF);
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+		__m256i even = _mm256_and_si256(_mm256_mullo_epi16(va, vb), mask);
+		__m256i odd = _mm256_slli_epi16(_mm256_mullo_epi16(_mm256_srli_epi16(va, 8), _mm256_srli_epi16(vb, 8)), 8);
+		_mm256_storeu_si256((__m256i*) (out + i), _mm256_or_si256(even, odd));
+	}
+	MultiplySSE2(out + i, a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 double DotAVX2(const uint8_t* a, const uint8_t* b, size_t n) {
+	const __m256i zero = _mm256_setzero_si256();
+	uint64_t total = 0;
+	size_t i = 0;
+	while (i + 32 <= n) {
+		__m256i acc = _mm256_setzero_si256();
+		size_t end = std::min(n - (n - i) % 32, i + 32 * 1024);
+		for (; i < end; i += 32) {
+			__m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+			__m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_unpacklo_epi8(va, zero), _mm256_unpacklo_epi8(vb, zero)));
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_unpackhi_epi8(va, zero), _mm256_unpackhi_epi8(vb, zero)));
+		}
+		uint32_t tmp[8];
+		_mm256_storeu_si256((__m256i*) tmp, acc);
+		for (int k = 0; k < 8; k++)
+			total += tmp[k];
+	}
+	return (double) total + DotSSE2(a + i, b + i, n - i);
+}
+ALY_TARGET_AVX2 void MinMaxAVX2(const uint8_t* a, size_t n, int channels, uint8_t* minVal, uint8_t* maxVal) {
+	const int lanes = 32;
+	const int regs = ChannelPeriod(channels, lanes);
+	const size_t stride = (size_t) regs * lanes;
+	if (regs > 4 || n < stride) {
+		MinMaxSSE2(a, n, channels, minVal, maxVal);
+		return;
+	}
+	__m256i vmin[4], vmax[4];
+	for (int r = 0; r < regs; r++) {
+		vmin[r] = vmax[r] = _mm256_loadu_si256((const __m256i*) (a + r * lanes));
+	}
+	size_t i = stride;
+	for (; i + stride <= n; i += stride) {
+		for (int r = 0; r < regs; r++) {
+			__m256i v = _mm256_loadu_si256((const __m256i*) (a + i + r * lanes));
+			vmin[r] = _mm256_min_epu8(vmin[r], v);
+			vmax[r] = _mm256_max_epu8(vmax[r], v);
+		}
+	}
+	uint8_t tmin[128], tmax[128];
+	for (int r = 0; r < regs; r++) {
+		_mm256_storeu_si256((__m256i*) (tmin + r * lanes), vmin[r]);
+		_mm256_storeu_si256((__m256i*) (tmax + r * lanes), vmax[r]);
+	}
+	for (size_t k = 0; k < stride; k++) {
+		int c = (int) (k % channels);
+		minVal[c] = std::min(minVal[c], tmin[k]);
+		maxVal[c] = std::max(maxVal[c], tmax[k]);
+	}
+	MinMaxSSE2(a + i, n - i, channels, minVal, maxVal);
+}
+#endif
+SIMDInstructionSet DetectInstructionSet() {
+#if defined(ALY_SIMD_X86)
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, 0, 0);
+	if (info[0] >= 7) {
+		__cpuidex(info, 1, 0);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+			__cpuidex(info, 7, 0);
+			if ((info[1] & (1 << 5)) != 0) {
+				return SIMDInstructionSet::AVX2;
+			}
+		}
+	}
+	return SIMDInstructionSet::SSE2;
+#elif defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return SIMDInstructionSet::AVX2;
+	}
+	return SIMDInstructionSet::SSE2;
+#else
+	return SIMDInstructionSet::SSE2;
+#endif
+#else
+	return SIMDInstructionSet::Scalar;
+#endif
+}
+DispatchTable MakeDispatchTable(SIMDInstructionSet set) {
+	DispatchTable t;
+	t.set = SIMDInstructionSet::Scalar;
+	t.addf = AddScalar;
+	t.subtractf = SubtractScalar;
+	t.multiplyf = MultiplyScalar;
+	t.dividef = DivideScalar;
+	t.multiplyAddf = MultiplyAddScalar;
+	t.multiplySubtractf = MultiplySubtractScalar;
+	t.dotf = DotScalar;
+	t.minMaxf = MinMaxScalar;
+	t.addb = AddScalar;
+	t.subtractb = SubtractScalar;
+	t.multiplyb = MultiplyScalar;
+	t.dotb = DotScalar;
+	t.minMaxb = MinMaxScalar;
+#ifdef ALY_SIMD_X86
+	if (set == SIMDInstructionSet::SSE2) {
+		t.set = set;
+		t.addf = AddSSE2;
+		t.subtractf = SubtractSSE2;
+		t.multiplyf = MultiplySSE2;
+		t.dividef = DivideSSE2;
+		t.multiplyAddf = MultiplyAddSSE2;
+		t.multiplySubtractf = MultiplySubtractSSE2;
+		t.dotf = DotSSE2;
+		t.minMaxf = MinMaxSSE2;
+		t.addb = AddSSE2;
+		t.subtractb = SubtractSSE2;
+		t.multiplyb = MultiplySSE2;
+		t.dotb = DotSSE2;
+		t.minMaxb = MinMaxSSE2;
+	} else if (set == SIMDInstructionSet::AVX2) {
+		t.set = set;
+		t.addf = AddAVX2;
+		t.subtractf = SubtractAVX2;
+		t.multiplyf = MultiplyAVX2;
+		t.dividef = DivideAVX2;
+		t.multiplyAddf = MultiplyAddAVX2;
+		t.multiplySubtractf = MultiplySubtractAVX2;
+		t.dotf = DotAVX2;
+		t.minMaxf = MinMaxAVX2;
+		t.addb = AddAVX2;
+		t.subtractb = SubtractAVX2;
+		t.multiplyb = MultiplyAVX2;
+		t.dotb = DotAVX2;
+		t.minMaxb = MinMaxAVX2;
+	}
+#endif
+	return t;
+}
+DispatchTable& GetDispatchTable() {
+	static DispatchTable table = MakeDispatchTable(GetSupportedSIMDInstructionSet());
+	return table;
+}
+}
+SIMDInstructionSet GetSupportedSIMDInstructionSet() {
+	static SIMDInstructionSet supported = simd::DetectInstructionSet();
+	return supported;
+}
+SIMDInstructionSet GetSIMDInstructionSet() {
+	return simd::GetDispatchTable().set;
+}
+void SetSIMDInstructionSet(SIMDInstructionSet set) {
+	SIMDInstructionSet supported = GetSupportedSIMDInstructionSet();
+	if (static_cast<int>(set) > static_cast<int>(supported)) {
+		set = supported;
+	}
+	simd::GetDispatchTable() = simd::MakeDispatchTable(set);
+}
+void SIMDAdd(float* out, const float* a, const float* b, size_t n) {
+	simd::GetDispatchTable().addf(out, a, b, n);
+}
+void SIMDSubtract(float* out, const float* a, const float* b, size_t n) {
+	simd::GetDispatchTable().subtractf(out, a, b, n);
+}
+void SIMDMultiply(float* out, const float* a, const float* b, size_t n) {
+	simd::GetDispatchTable().multiplyf(out, a, b, n);
+}
+void SIMDDivide(float* out, const float* a, const float* b, size_t n) {
+	simd::GetDispatchTable().dividef(out, a, b, n);
+}
+void SIMDMultiplyAdd(float* out, const float* a, const float* b, const float* c, size_t n) {
+	simd::GetDispatchTable().multiplyAddf(out, a, b, c, n);
+}
+void SIMDMultiplySubtract(float* out, const float* a, const float* b, const float* c, size_t n) {
+	simd::GetDispatchTable().multiplySubtractf(out, a, b, c, n);
+}
+double SIMDDot(const float* a, const float* b, size_t n) {
+	return simd::GetDispatchTable().dotf(a, b, n);
+}
+void SIMDMinMax(const float* a, size_t n, int channels, float* minVal, float* maxVal) {
+	simd::GetDispatchTable().minMaxf(a, n, channels, minVal, maxVal);
+}
+void SIMDAdd(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	simd::GetDispatchTable().addb(out, a, b, n);
+}
+void SIMDSubtract(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	simd::GetDispatchTable().subtractb(out, a, b, n);
+}
+void SIMDMultiply(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t n) {
+	simd::GetDispatchTable().multiplyb(out, a, b, n);
+}
+double SIMDDot(const uint8_t* a, const uint8_t* b, size_t n) {
+	return simd::GetDispatchTable().dotb(a, b, n);
+}
+void SIMDMinMax(const uint8_t* a, size_t n, int channels, uint8_t* minVal, uint8_t* maxVal) {
+	simd::GetDispatchTable().minMaxb(a, n, channels, minVal, maxVal);
+}
+}
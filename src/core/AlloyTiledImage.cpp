@@ -0,0 +1,66 @@
+/*
+ * Copyright(C) 2015, Blake C. Lucas, Ph.D. (img.science@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "AlloyTiledImage.h"
+namespace aly {
+	static const char* TILED_IMAGE_SECTION = "tiled_image";
+	TiledImageLayout::TiledImageLayout(int width, int height, int tileSize, ImageType type, int channels) :
+		width(width), height(height), tileSize(tileSize), levels(1), type(type), channels(channels) {
+		if (width <= 0 || height <= 0)
+			throw std::runtime_error(MakeString() << "Invalid tiled image dimensions " << width << "x" << height);
+		//Coarser levels are built from 2x2 blocks, so a tile must split evenly into parent pixels.
+		if (tileSize < 16 || tileSize % 2 != 0)
+			throw std::runtime_error(MakeString() << "Tile size " << tileSize << " must be even and at least 16.");
+		while (getWidth(levels - 1) > tileSize || getHeight(levels - 1) > tileSize) {
+			levels++;
+		}
+	}
+	int TiledImageLayout::getWidth(int level) const {
+		return ((width - 1) >> level) + 1;
+	}
+	int TiledImageLayout::getHeight(int level) const {
+		return ((height - 1) >> level) + 1;
+	}
+	int TiledImageLayout::getTilesX(int level) const {
+		return (getWidth(level) + tileSize - 1) / tileSize;
+	}
+	int TiledImageLayout::getTilesY(int level) const {
+		return (getHeight(level) + tileSize - 1) / tileSize;
+	}
+	int2 TiledImageLayout::getTileDimensions(int level, int tx, int ty) const {
+		return int2(std::min(tileSize, getWidth(level) - tx * tileSize), std::min(tileSize, getHeight(level) - ty * tileSize));
+	}
+	std::string TiledImageLayout::getTileName(int level, int tx, int ty) {
+		return MakeString() << "tile" << level << "_" << tx << "_" << ty;
+	}
+	void TiledImageLayout::write(BinaryFileWriter& writer) const {
+		int32_t values[6] = { width, height, tileSize, levels, (int32_t) type, channels };
+		writer.write(TILED_IMAGE_SECTION, values, ImageType::INT, 1, 6);
+	}
+	void TiledImageLayout::read(const MappedBinaryFile& file) {
+		if (!file.hasSection(TILED_IMAGE_SECTION) || file.getSection(TILED_IMAGE_SECTION).count != 6)
+			throw std::runtime_error("File does not contain a tiled image.");
+		int32_t values[6];
+		file.read(TILED_IMAGE_SECTION, values, ImageType::INT, 1);
+		*this = TiledImageLayout(values[0], values[1], values[2], (ImageType) values[4], values[5]);
+		if (levels != values[3])
+			throw std::runtime_error(MakeString() << "Tiled image has " << values[3] << " levels, expected " << levels);
+	}
+}
@@ -23,5 +23,90 @@
 #include "AlloyFileUtil.h"
 #include "AlloyMath.h"
 namespace aly {
-
+void WriteVolumeHeaderToXML(const std::string& file, ImageType type, int rows,
+	int cols, int slices, int channels) {
+	std::string fileName = GetFileWithoutExtension(file);
+	std::string typeName = "";
+	switch (type) {
+	case ImageType::BYTE:
+		typeName = "Byte";
+		break;
+	case ImageType::UBYTE:
+		typeName = "Unsigned Byte";
+		break;
+	case ImageType::SHORT:
+		typeName = "Short";
+		break;
+	case ImageType::USHORT:
+		typeName = "Unsigned Short";
+		break;
+	case ImageType::INT:
+		typeName = "Integer";
+		break;
+	case ImageType::UINT:
+		typeName = "Unsigned Integer";
+		break;
+	case ImageType::FLOAT:
+		typeName = "Float";
+		break;
+	case ImageType::DOUBLE:
+		typeName = "Double";
+		break;
+	case ImageType::UNKNOWN:
+		typeName = "Unknown";
+		break;
+	}
+	std::stringstream sstr;
+	sstr << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	sstr << "<!-- MIPAV header file -->\n";
+	if (channels > 1) {
+		sstr << "<image xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" nDimensions=\"4\">\n";
+	}
+	else {
+		sstr << "<image xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" nDimensions=\"3\">\n";
+	}
+	sstr << "	<Dataset-attributes>\n";
+	sstr << "		<Image-offset>0</Image-offset>\n";
+	sstr << "		<Data-type>" << typeName << "</Data-type>\n";
+	sstr << "		<Endianess>Little</Endianess>\n";
+	sstr << "		<Extents>" << rows << "</Extents>\n";
+	sstr << "		<Extents>" << cols << "</Extents>\n";
+	sstr << "		<Extents>" << slices << "</Extents>\n";
+	if (channels > 1) {
+		sstr << "		<Extents>" << channels << "</Extents>\n";
+	}
+	sstr << "		<Resolutions>\n";
+	sstr << "			<Resolution>1.0</Resolution>\n";
+	sstr << "			<Resolution>1.0</Resolution>\n";
+	sstr << "			<Resolution>1.0</Resolution>\n";
+	sstr << "		</Resolutions>\n";
+	sstr << "		<Slice-spacing>1.0</Slice-spacing>\n";
+	sstr << "		<Slice-thickness>0.0</Slice-thickness>\n";
+	sstr << "		<Units>Millimeters</Units>\n";
+	sstr << "		<Units>Millimeters</Units>\n";
+	sstr << "		<Units>Millimeters</Units>\n";
+	sstr << "		<Compression>none</Compression>\n";
+	sstr << "		<Orientation>Unknown</Orientation>\n";
+	sstr << "		<Subject-axis-orientation>Unknown</Subject-axis-orientation>\n";
+	sstr << "		<Subject-axis-orientation>Unknown</Subject-axis-orientation>\n";
+	sstr << "		<Subject-axis-orientation>Unknown</Subject-axis-orientation>\n";
+	sstr << "		<Origin>0.0</Origin>\n";
+	sstr << "		<Origin>0.0</Origin>\n";
+	sstr << "		<Origin>0.0</Origin>\n";
+	sstr << "		<Modality>Unknown Modality</Modality>\n";
+	sstr << "	</Dataset-attributes>\n";
+	sstr << "</image>\n";
+	std::ofstream myfile;
+	std::stringstream xmlFile;
+	xmlFile << fileName << ".xml";
+	myfile.open(xmlFile.str().c_str(), std::ios_base::out);
+	if (!myfile.is_open()) {
+		throw std::runtime_error(
+			MakeString() << "Could not open " << xmlFile.str()
+			<< " for writing.");
+	}
+	myfile << sstr.str();
+	myfile.close();
+}
 }
+
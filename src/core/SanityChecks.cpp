@@ -24,6 +24,14 @@
 #include "AlloyIntersector.h"
 #include "AlloyLocator.h"
 #include "AlloyDistanceField.h"
+#include "AlloyIsoSurface.h"
+#include "AlloyIsoContour.h"
+#include "AlloyDelaunay.h"
+#include "AlloySparseVolume.h"
+#include "AlloyBinaryFile.h"
+#include "AlloyTiledImage.h"
+#include "AlloyIntegralImage.h"
+#include "AlloyImageFeatures.h"
 #include "AlloySparseSolve.h"
 #include "AlloyMath.h"
 #include "AlloyImage.h"
@@ -36,11 +44,13 @@
 #include "AlloySparseMatrix.h"
 #include "AlloyDenseMatrix.h"
 #include "AlloyArray.h"
+#include "AlloySIMD.h"
 #include "AlloySpline.h"
 #include "cereal/archives/json.hpp"
 #include <iostream>
 #include <fstream>
 #include <random>
+#include <set>
 #ifndef ALY_WINDOWS
 #pragma GCC diagnostic ignored "-Wunused-variable"
 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
@@ -240,6 +250,51 @@ namespace aly {
 		}
 		return true;
 	}
+	bool SANITY_CHECK_MESH_ADJACENCY() {
+		Mesh mesh;
+		mesh.load(AlloyDefaultContext()->getFullPath("models/monkey.ply"));
+		Subdivide(mesh, SubDivisionScheme::Loop);
+		const MeshAdjacency& adj = mesh.getAdjacency();
+		std::vector<std::set<uint32_t>> vertNbrs(mesh.vertexLocations.size());
+		for (const uint3& face : mesh.triIndexes.data) {
+			for (int k = 0; k < 3; k++) {
+				vertNbrs[face[k]].insert(face[(k + 1) % 3]);
+				vertNbrs[face[(k + 1) % 3]].insert(face[k]);
+			}
+		}
+		for (uint32_t v = 0; v < adj.vertexCount; v++) {
+			std::vector<uint32_t> ring(adj.getVertexNeighbors(v), adj.getVertexNeighbors(v) + adj.getVertexValence(v));
+			if (ring != std::vector<uint32_t>(vertNbrs[v].begin(), vertNbrs[v].end()))
+				throw std::runtime_error(MakeString() << "Vertex ring does not match at " << v);
+		}
+		for (uint32_t he = 0; he < adj.getHalfEdgeCount(); he++) {
+			uint32_t opp = adj.opposite[he];
+			if (opp == MeshAdjacency::NO_EDGE)
+				continue;
+			uint3 face = mesh.triIndexes[adj.getFace(he)];
+			uint3 oppFace = mesh.triIndexes[adj.getFace(opp)];
+			if (adj.opposite[opp] != he || face[he % 3] != oppFace[(opp + 1) % 3] || adj.halfEdgeToEdge[he] != adj.halfEdgeToEdge[opp])
+				throw std::runtime_error(MakeString() << "Opposite half-edge is inconsistent at " << he);
+		}
+		std::cout << "Mesh adjacency " << adj.edges.size() << " edges for " << adj.getFaceCount() << " faces" << std::endl;
+		mesh.updateVertexNormals();
+		std::vector<uint32_t> moved;
+		for (uint32_t v = 0; v < adj.vertexCount; v += 97) {
+			mesh.vertexLocations[v] += float3(0.01f);
+			moved.push_back(v);
+		}
+		mesh.updateVertexNormals(moved);
+		Vector3f incremental = mesh.vertexNormals;
+		mesh.updateVertexNormals();
+		for (size_t v = 0; v < incremental.size(); v++) {
+			if (incremental[v] != mesh.vertexNormals[v])
+				throw std::runtime_error(MakeString() << "Incremental normal does not match at " << v);
+		}
+		Subdivide(mesh, SubDivisionScheme::Loop);
+		if (mesh.getAdjacency().getFaceCount() != mesh.triIndexes.size())
+			throw std::runtime_error("Mesh adjacency was not rebuilt after subdivision.");
+		return true;
+	}
 	bool SANITY_CHECK_SUBDIVIDE() {
 		Mesh mesh;
 		mesh.load(AlloyDefaultContext()->getFullPath("models/monkey.obj"));
@@ -420,10 +475,22 @@ namespace aly {
 			b[i] = float4((rand() % 1000) / 1000.0f);
 			b1[i] = float1((rand() % 1000) / 1000.0f);
 		}
+		Vector4f At1, At2;
+		MultiplyVecTranspose(At1, A, b);
+		MultiplyVec(At2, A.transpose(), b);
+		std::cout << "Transpose product error " << lengthL1(At1 - At2) << std::endl;
 		SolveVecCG(b, A, x);
 		SolveCG(b1, A1, x1);
 		SolveVecBICGStab(b, A, x);
 		SolveBICGStab(b1, A1, x1);
+		for (PreconditionerType type : { PreconditionerType::Jacobi, PreconditionerType::SSOR,
+			PreconditionerType::IncompleteCholesky, PreconditionerType::IncompleteLU }) {
+			x.set(float4(0.0f));
+			SolveVecBICGStab(b, A, x, type, 100, 1E-6f, [=](int iter, double err) {
+				std::cout << type << " Iteration " << iter << ":: " << err << std::endl;
+				return true;
+			});
+		}
 		std::ofstream os("matrix.json");
 		cereal::JSONOutputArchive archiver(os);
 		archiver(A);
@@ -475,12 +542,524 @@ namespace aly {
 		DistanceField3f df3;
 		df3.solve(vol, distVol,10.0f);
 		distVol.writeToXML("vol_df.xml");
+		df3.setMethod(DistanceFieldMethod::FastSweeping);
+		df3.solve(vol, distVol, 10.0f);
+		distVol.writeToXML("vol_df_sweep.xml");
+		df3.setMethod(DistanceFieldMethod::NarrowBand);
+		df3.solve(vol, distVol, 10.0f);
+		distVol.writeToXML("vol_df_band.xml");
+		Volume1f sdfVol;
+		MeshToSignedDistanceVolume sdf;
+		sdf.solve(mesh, bbox, voxelSize, sdfVol, 10.0f);
+		sdfVol.writeToXML("vol_sdf.xml");
 		img.writeToXML("img_closest.xml");
 		DistanceField2f df2;
 		df2.solve(img, distImg, 10.0f);
 		distImg.writeToXML("img_df.xml");
 		return true;
 	}
+	bool SANITY_CHECK_DAISY() {
+		ImageRGBA img;
+		ReadImageFromFile(AlloyDefaultContext()->getFullPath("images/stereo_left.png"), img);
+		ImageRGBA crop;
+		Crop(img, crop, int2(img.width / 3, img.height / 3), int2(std::min(img.width / 3, 200), std::min(img.height / 3, 150)));
+		ImageRGBAf image;
+		ConvertImage(crop, image);
+		daisy::Daisy daisy;
+		daisy.initialize(image);
+		for (daisy::Normalization normalization : { daisy::Normalization::Partial, daisy::Normalization::Full, daisy::Normalization::Sift }) {
+			for (bool rotationInvariant : { false, true }) {
+				for (bool disableInterpolation : { false, true }) {
+					daisy::DescriptorField field;
+					daisy::DenseDescriptorField dense;
+					daisy.getDescriptors(field, normalization, false, rotationInvariant, disableInterpolation);
+					daisy.getDescriptors(dense, normalization, false, rotationInvariant, disableInterpolation);
+					if (dense.width != field.width || dense.height != field.height || dense.descriptorSize != (int)field[0].size()) {
+						throw std::runtime_error(MakeString() << "Dense Daisy field is " << dense.width << "x" << dense.height << "x" << dense.descriptorSize << ", expected " << field.width << "x" << field.height << "x" << field[0].size());
+					}
+					float maxError = 0.0f;
+					for (int j = 0; j < field.height; j++) {
+						for (int i = 0; i < field.width; i++) {
+							const daisy::Descriptor& desc = field(i, j);
+							const float* denseDesc = dense(i, j);
+							for (int k = 0; k < dense.stride; k++) {
+								float expected = (k < dense.descriptorSize) ? desc[k] : 0.0f;
+								maxError = std::max(maxError, std::abs(denseDesc[k] - expected));
+							}
+						}
+					}
+					std::cout << "Daisy normalization " << (int)normalization << " rotation " << rotationInvariant << " interpolation " << !disableInterpolation << " max error " << maxError << std::endl;
+					if (maxError > 1E-5f) {
+						throw std::runtime_error(MakeString() << "Dense Daisy descriptors differ from the descriptor field by " << maxError);
+					}
+				}
+			}
+		}
+		return true;
+	}
+	//Narrow band signed distance volume of the monkey model, with the given number of voxels across its padded bounding cube.
+	static void MonkeyDistanceVolume(Volume1f& sdfVol, int resolution) {
+		Mesh mesh;
+		mesh.load(AlloyDefaultContext()->getFullPath("models/monkey.ply"));
+		box3f bbox = mesh.getBoundingBox();
+		float3 center = bbox.position + bbox.dimensions*0.5f;
+		float maxDim = 1.1f*aly::max(bbox.dimensions);
+		bbox.position = center - float3(0.5f*maxDim);
+		bbox.dimensions = float3(maxDim);
+		MeshToSignedDistanceVolume sdf;
+		sdf.solve(mesh, bbox, maxDim / resolution, sdfVol, 3.0f);
+	}
+	bool SANITY_CHECK_ISOSURFACE() {
+		Volume1f sdfVol;
+		MonkeyDistanceVolume(sdfVol, 128);
+		IsoSurface isoSurface;
+		Mesh isoMesh;
+		for (TopologyRule3D rule : { TopologyRule3D::Connect6, TopologyRule3D::Connect26 }) {
+			isoSurface.solve(sdfVol, isoMesh, 0.0f, rule, IsoSurfaceMethod::MarchingCubes);
+			const MeshAdjacency& adj = isoMesh.getAdjacency();
+			for (uint32_t he = 0; he < adj.getHalfEdgeCount(); he++) {
+				if (adj.opposite[he] == MeshAdjacency::NO_EDGE)
+					throw std::runtime_error(MakeString() << "Iso-surface has a boundary at half-edge " << he);
+			}
+			std::cout << "Iso-surface " << isoMesh.vertexLocations.size() << " vertexes " << isoMesh.triIndexes.size() << " triangles" << std::endl;
+		}
+		WriteMeshToFile("monkey_isosurface.ply", isoMesh);
+		isoSurface.solve(sdfVol, isoMesh, 0.0f, TopologyRule3D::Connect6, IsoSurfaceMethod::DualContouring);
+		std::cout << "Dual contour " << isoMesh.vertexLocations.size() << " vertexes " << isoMesh.quadIndexes.size() << " quads" << std::endl;
+		WriteMeshToFile("monkey_dualcontour.ply", isoMesh);
+		return true;
+	}
+	bool SANITY_CHECK_ISOCONTOUR() {
+		const int W = 301, H = 211;
+		Image1f sdf(W, H), labels(W, H);
+		std::mt19937 gen(1234);
+		std::uniform_int_distribution<int> coin(0, 1);
+		std::vector<int> cells((W / 5 + 1) * (H / 5 + 1));
+		for (int& c : cells) {
+			c = coin(gen);
+		}
+		for (int j = 0; j < H; j++) {
+			for (int i = 0; i < W; i++) {
+				//Two overlapping disks with a hole cut out of one of them.
+				float d1 = distance(float2((float)i, (float)j), float2(100.0f, 105.0f)) - 70.0f;
+				float d2 = distance(float2((float)i, (float)j), float2(200.3f, 90.7f)) - 60.0f;
+				float d3 = distance(float2((float)i, (float)j), float2(90.0f, 100.0f)) - 25.0f;
+				sdf(i, j).x = std::max(std::min(d1, d2), -d3);
+				//Blocky labels with a checkerboard patch so every saddle case occurs, kept off the border so curves close.
+				bool inside = (i > 4 && j > 4 && i < 45 && j < 45) ? ((i + j) % 2 == 0) : (cells[(i / 5) + (j / 5) * (W / 5 + 1)] != 0);
+				if (i == 0 || j == 0 || i == W - 1 || j == H - 1) {
+					inside = false;
+				}
+				labels(i, j).x = inside ? -1.0f : 1.0f;
+			}
+		}
+		for (const Image1f* img : { &sdf, &labels }) {
+			for (TopologyRule2D rule : { TopologyRule2D::Unconstrained, TopologyRule2D::Connect4, TopologyRule2D::Connect8 }) {
+				int orientation[2] = { 0, 0 };
+				for (Winding winding : { Winding::Clockwise, Winding::CounterClockwise }) {
+					Vector2f refPoints;
+					Vector2ui refIndexes;
+					std::vector<std::list<uint32_t>> refLines;
+					for (int stripeWidth : { 1, 7, 128, W }) {
+						IsoContour isoContour(true, 1E-3f, stripeWidth);
+						Vector2f points, linePoints;
+						Vector2ui indexes;
+						std::vector<std::list<uint32_t>> lines;
+						isoContour.solve(*img, points, indexes, 0.0f, rule, winding);
+						isoContour.solve(*img, linePoints, lines, 0.0f, rule, winding);
+						if (stripeWidth == 1) {
+							refPoints = points;
+							refIndexes = indexes;
+							refLines = lines;
+						} else if (points.data != refPoints.data || linePoints.data != refPoints.data || indexes.data != refIndexes.data || lines != refLines) {
+							throw std::runtime_error(MakeString() << "Iso-contour with stripe width " << stripeWidth << " differs from stripe width 1.");
+						}
+						if (linePoints.data != points.data) {
+							throw std::runtime_error("Iso-contour points differ between segment and line output.");
+						}
+						//Every crossing on a closed curve has as many segments arriving as leaving.
+						std::vector<int> degree(points.size(), 0);
+						for (uint2 edge : indexes.data) {
+							degree[edge.x]++;
+							degree[edge.y]--;
+						}
+						for (size_t n = 0; n < degree.size(); n++) {
+							if (degree[n] != 0) {
+								throw std::runtime_error(MakeString() << "Iso-contour segments are not closed at crossing " << n);
+							}
+						}
+						size_t segments = 0;
+						for (const std::list<uint32_t>& line : lines) {
+							if (line.size() < 3 || line.front() != line.back()) {
+								throw std::runtime_error(MakeString() << "Iso-contour line of " << line.size() << " crossings is not closed.");
+							}
+							segments += line.size() - 1;
+						}
+						if (segments != indexes.size()) {
+							throw std::runtime_error(MakeString() << "Iso-contour lines have " << segments << " segments, expected " << indexes.size());
+						}
+						//The non-negative end of the grid edge under each crossing must lie to the same side of every segment.
+						std::vector<uint2> lineEdges;
+						for (const std::list<uint32_t>& line : lines) {
+							for (auto a = line.begin(), b = std::next(a); b != line.end(); a++, b++) {
+								lineEdges.push_back(uint2(*a, *b));
+							}
+						}
+						for (const std::vector<uint2>* edges : { &indexes.data, &lineEdges }) {
+							for (uint2 edge : *edges) {
+								float2 pt1 = points[edge.x], pt2 = points[edge.y];
+								for (float2 pt : { pt1, pt2 }) {
+									bool vertical = std::abs(pt.x - std::round(pt.x)) < std::abs(pt.y - std::round(pt.y));
+									int2 p1 = vertical ? int2((int)std::round(pt.x), (int)std::floor(pt.y)) : int2((int)std::floor(pt.x), (int)std::round(pt.y));
+									int2 p2 = p1 + (vertical ? int2(0, 1) : int2(1, 0));
+									float2 corner = float2(((*img)(p1.x, p1.y).x >= 0.0f) ? p1 : p2);
+									int sign = (crossMag(pt2 - pt1, corner - pt) > 0.0f) ? 1 : -1;
+									if (orientation[(int)winding] == 0) {
+										orientation[(int)winding] = sign;
+									} else if (orientation[(int)winding] != sign) {
+										throw std::runtime_error(MakeString() << "Iso-contour segment " << edge << " has inconsistent winding.");
+									}
+								}
+							}
+						}
+					}
+					std::cout << "Iso-contour " << refPoints.size() << " crossings " << refIndexes.size() << " segments " << refLines.size() << " curves" << std::endl;
+				}
+				if (orientation[0] == orientation[1]) {
+					throw std::runtime_error("Iso-contour windings do not differ.");
+				}
+			}
+		}
+		//Reference check of the serial path on a circle, against crossings interpolated independently on each grid edge.
+		const float2 center(150.2f, 105.6f);
+		const float radius = 50.3f;
+		Image1f circle(W, H);
+		for (int j = 0; j < H; j++) {
+			for (int i = 0; i < W; i++) {
+				circle(i, j).x = distance(float2((float)i, (float)j), center) - radius;
+			}
+		}
+		//Expected crossing of each grid edge from the point at (i,j) to its right or lower neighbour, or -1 if none.
+		std::vector<float2> expected(W * H, float2(-1.0f));
+		size_t expectedCount = 0;
+		for (int j = 0; j < H; j++) {
+			for (int i = 0; i < W; i++) {
+				float v = circle(i, j).x;
+				if (i + 1 < W && (v > 0.0f) != (circle(i + 1, j).x > 0.0f)) {
+					expected[i + j * W].x = i + v / (v - circle(i + 1, j).x);
+					expectedCount++;
+				}
+				if (j + 1 < H && (v > 0.0f) != (circle(i, j + 1).x > 0.0f)) {
+					expected[i + j * W].y = j + v / (v - circle(i, j + 1).x);
+					expectedCount++;
+				}
+			}
+		}
+		IsoContour isoContour(false, 1E-3f, 1);
+		Vector2f points;
+		std::vector<std::list<uint32_t>> lines;
+		isoContour.solve(circle, points, lines, 0.0f, TopologyRule2D::Unconstrained, Winding::Clockwise);
+		if (points.size() != expectedCount) {
+			throw std::runtime_error(MakeString() << "Iso-contour of circle has " << points.size() << " crossings, expected " << expectedCount);
+		}
+		if (lines.size() != 1 || lines.front().size() != points.size() + 1) {
+			throw std::runtime_error(MakeString() << "Iso-contour of circle should be one closed curve through all " << points.size() << " crossings.");
+		}
+		for (float2 pt : points.data) {
+			bool vertical = std::abs(pt.x - std::round(pt.x)) < std::abs(pt.y - std::round(pt.y));
+			int i = vertical ? (int)std::round(pt.x) : (int)std::floor(pt.x);
+			int j = vertical ? (int)std::floor(pt.y) : (int)std::round(pt.y);
+			float2& ref = expected[i + j * W];
+			if ((vertical ? ref.y : ref.x) < 0.0f || std::abs((vertical ? pt.y - ref.y : pt.x - ref.x)) > 1E-4f) {
+				throw std::runtime_error(MakeString() << "Iso-contour crossing " << pt << " does not match the reference crossing " << ref);
+			}
+			//Each reference crossing is matched once.
+			(vertical ? ref.y : ref.x) = -1.0f;
+			if (std::abs(distance(pt, center) - radius) > 1E-2f) {
+				throw std::runtime_error(MakeString() << "Iso-contour crossing " << pt << " is off the circle by " << distance(pt, center) - radius);
+			}
+		}
+		return true;
+	}
+	bool SANITY_CHECK_DELAUNAY() {
+		const int N = 100000;
+		const int D = 1000;
+		std::vector<float2> samples(N);
+		for (int n = 0; n < N; n++) {
+			samples[n] = float2(RandomUniform(0.0f, 1.0f), RandomUniform(0.0f, 1.0f));
+		}
+		//Corners of a diagonal constraint and a point exactly on it.
+		samples[0] = float2(0.0f, 0.0f);
+		samples[1] = float2(1.0f, 1.0f);
+		samples[2] = float2(0.5f, 0.5f);
+		//The last points repeat earlier ones, and only one of each pair may be referenced.
+		for (int n = N - D; n < N; n++) {
+			samples[n] = samples[n - N / 2];
+		}
+		std::vector<uint2> constraints = { uint2(0, 1) };
+		std::vector<uint3> tris;
+		//Serial insertion, then the parallel strips with and without the constraint.
+		for (int pass = 0; pass < 3; pass++) {
+			Delaunay delaunay((pass == 0) ? N : 4096);
+			if (pass < 2) {
+				delaunay.solve(samples, tris);
+			} else {
+				delaunay.solve(samples, constraints, tris);
+			}
+			std::set<std::pair<uint32_t, uint32_t>> edges;
+			std::vector<char> referenced(N, 0);
+			for (uint3 tri : tris) {
+				double2 u = double2(samples[tri.y] - samples[tri.x]), v = double2(samples[tri.z] - samples[tri.x]);
+				if (u.x * v.y - u.y * v.x >= 0.0) {
+					throw std::runtime_error(MakeString() << "Delaunay triangle " << tri << " has the wrong winding.");
+				}
+				for (int i = 0; i < 3; i++) {
+					referenced[tri[i]] = 1;
+					if (!edges.insert(std::make_pair(tri[i], tri[(i + 1) % 3])).second) {
+						throw std::runtime_error(MakeString() << "Delaunay triangulation is not manifold at " << tri);
+					}
+				}
+			}
+			for (int n = N - D; n < N; n++) {
+				if (referenced[n] + referenced[n - N / 2] != 1) {
+					throw std::runtime_error(MakeString() << "Delaunay triangulation references " << referenced[n] + referenced[n - N / 2] << " copies of point " << n);
+				}
+			}
+			int hull = 0;
+			for (const std::pair<uint32_t, uint32_t>& e : edges) {
+				if (edges.find(std::make_pair(e.second, e.first)) == edges.end())
+					hull++;
+			}
+			int unique = N - D;
+			if ((int)tris.size() != 2 * unique - 2 - hull) {
+				throw std::runtime_error(MakeString() << "Delaunay triangulation has " << tris.size() << " triangles, expected " << 2 * unique - 2 - hull);
+			}
+			if (pass == 2) {
+				for (uint2 seg : { uint2(0, 2), uint2(2, 1) }) {
+					if (edges.find(std::make_pair(seg.x, seg.y)) == edges.end() && edges.find(std::make_pair(seg.y, seg.x)) == edges.end()) {
+						throw std::runtime_error(MakeString() << "Delaunay triangulation is missing constraint " << seg);
+					}
+				}
+			} else {
+				//No point may lie inside the circumcircle of a triangle, checked exactly on a sample of triangles.
+				for (size_t t = 0; t < tris.size(); t += tris.size() / 100) {
+					const uint3& tri = tris[t];
+					for (int n = 0; n < N; n++) {
+						if (InCircle(samples[tri.x], samples[tri.z], samples[tri.y], samples[n]) > 0) {
+							throw std::runtime_error(MakeString() << "Delaunay triangle " << tri << " has point " << n << " inside its circumcircle.");
+						}
+					}
+				}
+			}
+			std::cout << "Delaunay " << unique << " vertexes " << tris.size() << " triangles " << hull << " hull edges" << std::endl;
+		}
+		return true;
+	}
+	bool SANITY_CHECK_SPARSE_VOLUME() {
+		Volume1f sdfVol;
+		MonkeyDistanceVolume(sdfVol, 256);
+		SparseVolume1f sparseVol(0, 0, 0, float1(3.0f));
+		sparseVol.fromDense(sdfVol);
+		std::cout << "Sparse volume " << sparseVol.dimensions() << " leaves: " << sparseVol.leafCount() << " tiles: " << sparseVol.tileCount() << " active: " << sparseVol.activeCount() << std::endl;
+		Volume1f denseVol;
+		sparseVol.toDense(denseVol);
+		if (denseVol.data != sdfVol.data) {
+			throw std::runtime_error("Sparse volume does not match dense volume.");
+		}
+		SparseVolume1f distVol;
+		DistanceField3f df3;
+		df3.solve(sparseVol, distVol, 10.0f);
+		distVol.writeToXML("vol_sparse_df.xml");
+		(distVol - sparseVol).writeToXML("vol_sparse_diff.xml");
+		return true;
+	}
+	bool SANITY_CHECK_BINARY_FILE() {
+		Mesh mesh;
+		mesh.load(AlloyDefaultContext()->getFullPath("models/armadillo.ply"));
+		Volume1f vol(64, 64, 64);
+		for (int k = 0; k < vol.slices; k++) {
+			for (int j = 0; j < vol.cols; j++) {
+				for (int i = 0; i < vol.rows; i++) {
+					vol(i, j, k) = float1(std::sin(0.1f * i) * std::cos(0.2f * j) + 0.01f * k);
+				}
+			}
+		}
+		const BinaryCompression compressions[3] = { BinaryCompression::Raw, BinaryCompression::LZ4, BinaryCompression::ShuffleLZ4 };
+		for (BinaryCompression compression : compressions) {
+			WriteBinaryMeshToFile("armadillo.alyb", mesh, compression);
+			Mesh copy;
+			ReadMeshFromFile("armadillo.alyb", copy);
+			if (copy.vertexLocations.data != mesh.vertexLocations.data || copy.vertexNormals.data != mesh.vertexNormals.data
+					|| copy.triIndexes.data != mesh.triIndexes.data) {
+				throw std::runtime_error("Binary mesh does not match the original.");
+			}
+			MappedBinaryFile file("armadillo.alyb");
+			for (const BinarySection& section : file.getSections()) {
+				std::cout << "Section " << section.name << " " << section.type << "x" << section.channels << " " << section.count
+						<< " stored " << FormatSize(section.storedSize) << " of " << FormatSize(section.size()) << std::endl;
+				if (!file.verify(section.name)) {
+					throw std::runtime_error(MakeString() << "Binary section " << section.name << " failed verification.");
+				}
+			}
+			if (compression == BinaryCompression::Raw) {
+				const float3* pts = file.view<float, 3>("vertexLocations");
+				if (pts[mesh.vertexLocations.size() - 1] != mesh.vertexLocations.data.back()) {
+					throw std::runtime_error("Mapped vertex locations do not match.");
+				}
+			}
+			BinaryFileWriter writer("volume.alyb");
+			writer.write("volume", vol, compression);
+			writer.close();
+			Volume1f volCopy;
+			file.open("volume.alyb");
+			file.read("volume", volCopy);
+			if (volCopy.data != vol.data || volCopy.slices != vol.slices) {
+				throw std::runtime_error("Binary volume does not match the original.");
+			}
+		}
+		return true;
+	}
+	bool SANITY_CHECK_TILED_IMAGE() {
+		ImageRGBA img;
+		ReadImageFromFile(AlloyDefaultContext()->getFullPath("images/sfmarket.png"), img);
+		WriteTiledImageToFile("sfmarket.alyb", img, 64);
+		TiledImageRGBA tiled("sfmarket.alyb", 16 * 64 * 64 * sizeof(RGBA));
+		std::cout << "Tiled image " << tiled.getWidth() << "x" << tiled.getHeight() << " with " << tiled.getLevels() << " levels" << std::endl;
+		ImageRGBA crop, expected;
+		int2 pos(img.width / 3, img.height / 4);
+		int2 dims(img.width / 2, img.height / 2);
+		Crop(tiled, crop, pos, dims);
+		Crop(img, expected, pos, dims);
+		if (crop.data != expected.data)
+			throw std::runtime_error("Tiled crop does not match the image.");
+		if (tiled.getCacheSize() > 16 * 64 * 64 * sizeof(RGBA))
+			throw std::runtime_error("Tile cache exceeded its budget.");
+		ImageRGBA down;
+		DownSample(img, expected);
+		DownSample(tiled, "sfmarket_down.alyb");
+		TiledImageRGBA tiledDown("sfmarket_down.alyb");
+		Crop(tiledDown, down, int2(0, 0), int2(tiledDown.getWidth(), tiledDown.getHeight()));
+		if (down.data != expected.data)
+			throw std::runtime_error("Tiled down sample does not match the image.");
+		ImageRGBA smooth;
+		Smooth(img, expected, 2.0, 2.0);
+		Smooth(tiled, smooth, pos, dims, 2.0, 2.0);
+		for (int j = 0; j < dims.y; j++) {
+			for (int i = 0; i < dims.x; i++) {
+				if (smooth(i, j) != expected(pos.x + i, pos.y + j))
+					throw std::runtime_error("Tiled smooth does not match the image.");
+			}
+		}
+		WriteImageToFile("sfmarket_tiled_smooth.png", smooth);
+		//A tile that fails inside the parallel loop must reach the caller instead of terminating.
+		bool caught = false;
+		try {
+			WriteTiledImageToFile<uint8_t, 4, ImageType::UBYTE>("sfmarket_error.alyb", img.width, img.height,
+				[&](ImageRGBA& tile, int2 p, int2 d) {
+				if (p.x > 0 && p.y > 0)
+					throw std::runtime_error("Tile could not be made.");
+				Crop(img, tile, p, d);
+			}, 64);
+		} catch (const std::runtime_error&) {
+			caught = true;
+		}
+		if (!caught)
+			throw std::runtime_error("Tile error was not rethrown.");
+		return true;
+	}
+	bool SANITY_CHECK_INTEGRAL_IMAGE() {
+		ImageRGBA img;
+		ReadImageFromFile(AlloyDefaultContext()->getFullPath("images/sfmarket.png"), img);
+		const int r = 25;
+		ImageRGBA box;
+		BoxFilter(img, box, r);
+		for (int j = 0; j < img.height; j += 97) {
+			for (int i = 0; i < img.width; i += 89) {
+				double4 sum(0.0);
+				int n = 0;
+				for (int y = std::max(j - r, 0); y <= std::min(j + r, img.height - 1); y++) {
+					for (int x = std::max(i - r, 0); x <= std::min(i + r, img.width - 1); x++) {
+						sum += double4(img(x, y));
+						n++;
+					}
+				}
+				sum /= (double) n;
+				for (int c = 0; c < 4; c++) {
+					if (std::floor(sum[c] + 0.5) != box(i, j)[c])
+						throw std::runtime_error(MakeString() << "Box filter does not match at " << int2(i, j));
+				}
+			}
+		}
+		WriteImageToFile("sfmarket_box.png", box);
+		Image1f gray(img.width, img.height), mean, variance, ncc;
+		for (int j = 0; j < img.height; j++) {
+			for (int i = 0; i < img.width; i++) {
+				RGBA c = img(i, j);
+				gray(i, j).x = (c.x + c.y + c.z) / (3 * 255.0f);
+			}
+		}
+		LocalVariance(gray, mean, variance, 3, 3);
+		NormalizedCrossCorrelation(gray, gray, ncc, 3, 3);
+		for (int j = 0; j < img.height; j++) {
+			for (int i = 0; i < img.width; i++) {
+				if (variance(i, j).x > 1E-4f && std::abs(ncc(i, j).x - 1.0f) > 1E-3f)
+					throw std::runtime_error(MakeString() << "Self correlation is not one at " << int2(i, j));
+			}
+		}
+		//Squares of large 32-bit values overflow 64-bit integer sums, so their variance must be accumulated in double.
+		Image1i large(16, 16);
+		Image1f largeMean, largeVariance;
+		for (int j = 0; j < large.height; j++) {
+			for (int i = 0; i < large.width; i++) {
+				large(i, j).x = ((i + j) % 2 == 0) ? 2000000000 : 0;
+			}
+		}
+		LocalVariance(large, largeMean, largeVariance, 1, 1);
+		for (int j = 0; j < large.height; j++) {
+			for (int i = 0; i < large.width; i++) {
+				double sum = 0.0, sumSq = 0.0;
+				int n = 0;
+				for (int y = std::max(j - 1, 0); y <= std::min(j + 1, large.height - 1); y++) {
+					for (int x = std::max(i - 1, 0); x <= std::min(i + 1, large.width - 1); x++) {
+						sum += large(x, y).x;
+						sumSq += (double) large(x, y).x * large(x, y).x;
+						n++;
+					}
+				}
+				double var = sumSq / n - (sum / n) * (sum / n);
+				if (std::abs(var - largeVariance(i, j).x) > 1E-5 * var)
+					throw std::runtime_error(MakeString() << "Variance of 32-bit image does not match at " << int2(i, j));
+			}
+		}
+		Volume1f vol(32, 24, 16), smooth;
+		for (int k = 0; k < vol.slices; k++) {
+			for (int j = 0; j < vol.cols; j++) {
+				for (int i = 0; i < vol.rows; i++) {
+					vol(i, j, k).x = (float) ((i * 7 + j * 13 + k * 29) % 17);
+				}
+			}
+		}
+		BoxFilter(vol, smooth, 2, 1, 3);
+		for (int k = 0; k < vol.slices; k++) {
+			for (int j = 0; j < vol.cols; j++) {
+				for (int i = 0; i < vol.rows; i++) {
+					double sum = 0.0;
+					int n = 0;
+					for (int z = std::max(k - 3, 0); z <= std::min(k + 3, vol.slices - 1); z++) {
+						for (int y = std::max(j - 1, 0); y <= std::min(j + 1, vol.cols - 1); y++) {
+							for (int x = std::max(i - 2, 0); x <= std::min(i + 2, vol.rows - 1); x++) {
+								sum += vol(x, y, z).x;
+								n++;
+							}
+						}
+					}
+					if (std::abs(sum / n - smooth(i, j, k).x) > 1E-4)
+						throw std::runtime_error(MakeString() << "Volume box filter does not match at " << int3(i, j, k));
+				}
+			}
+		}
+		return true;
+	}
 	bool SANITY_CHECK_KDTREE() {
 		Mesh mesh;
 		mesh.load(AlloyDefaultContext()->getFullPath("models/monkey.ply"));
@@ -555,6 +1134,63 @@ namespace aly {
 		rgba.writeToXML("closest_clamped.xml");
 		return true;
 	}
+	bool SANITY_CHECK_KDTREE_PLANES() {
+		//Unit cube. Every ray below lies in the plane of a face, with a zero direction component on the origin's slab.
+		Mesh mesh;
+		for (int n = 0; n < 8; n++) {
+			mesh.vertexLocations.push_back(float3((float)(n & 1), (float)((n >> 1) & 1), (float)((n >> 2) & 1)));
+		}
+		mesh.quadIndexes.push_back(uint4(0, 2, 3, 1));
+		mesh.quadIndexes.push_back(uint4(4, 5, 7, 6));
+		mesh.quadIndexes.push_back(uint4(0, 1, 5, 4));
+		mesh.quadIndexes.push_back(uint4(2, 6, 7, 3));
+		mesh.quadIndexes.push_back(uint4(0, 4, 6, 2));
+		mesh.quadIndexes.push_back(uint4(1, 3, 7, 5));
+		Intersector intersector(mesh);
+		std::vector<float3> orgs, dirs;
+		for (int planeAxis = 0; planeAxis < 3; planeAxis++) {
+			for (int travelAxis = 0; travelAxis < 3; travelAxis++) {
+				if (travelAxis == planeAxis)
+					continue;
+				int otherAxis = 3 - planeAxis - travelAxis;
+				for (float plane : { 0.0f, 1.0f }) {
+					for (float offset : { 0.25f, 0.5f, 0.75f }) {
+						for (float sgn : { 1.0f, -1.0f }) {
+							for (float zero : { 0.0f, -0.0f }) {
+								float3 org, dir;
+								org[planeAxis] = plane;
+								org[otherAxis] = offset;
+								org[travelAxis] = (sgn > 0) ? -1.0f : 2.0f;
+								dir[planeAxis] = zero;
+								dir[otherAxis] = zero;
+								dir[travelAxis] = sgn;
+								orgs.push_back(org);
+								dirs.push_back(dir);
+							}
+						}
+					}
+				}
+			}
+		}
+		SIMDInstructionSet simd = GetSIMDInstructionSet();
+		for (SIMDInstructionSet set : { SIMDInstructionSet::Scalar, simd }) {
+			SetSIMDInstructionSet(set);
+			IntersectorHits hits;
+			intersector.intersectRays(orgs, dirs, hits);
+			for (size_t n = 0; n < orgs.size(); n++) {
+				float3 lastPoint;
+				KDTriangle* lastTriangle;
+				double d = intersector.intersectRayDistance(orgs[n], dirs[n], lastPoint, lastTriangle);
+				if (std::abs(hits.distances[n] - 1.0f) > 1E-5f || std::abs(d - 1.0) > 1E-5) {
+					SetSIMDInstructionSet(simd);
+					throw std::runtime_error(MakeString() << set << " ray " << orgs[n] << " " << dirs[n] << " hit at " << hits.distances[n] << " and " << d << ", expected 1.");
+				}
+			}
+			std::cout << set << " in-plane rays " << orgs.size() << " hit" << std::endl;
+		}
+		SetSIMDInstructionSet(simd);
+		return true;
+	}
 	bool SANITY_CHECK_IMAGE_PROCESSING() {
 		ImageRGBAf img;
 		ImageRGBAf laplacian;
@@ -620,6 +1256,30 @@ namespace aly {
 		gX.writeToXML("gradient_x.xml");
 		gY.writeToXML("gradient_y.xml");
 
+		ImageRGBAf recursive;
+		SmoothSeparable(img, smoothed, 8.0, 8.0);
+		SmoothRecursive(img, recursive, 8.0, 8.0);
+		std::cout << "Separable vs. recursive smoothing error " << (smoothed - recursive).max() << std::endl;
+		WriteImageToFile("smoothed_recursive.png", recursive);
+		LaplacianSeparable(img, laplacian, 2.0, 2.0);
+		GradientSeparable(img, gX, gY, 2.0, 2.0);
+		laplacian.writeToXML("laplacian_separable.xml");
+		LaplacianPyramid<uint8_t, 4, ImageType::UBYTE> pyramid(img3, 0);
+		ImageRGBA collapsed;
+		pyramid.collapse(collapsed);
+		if (collapsed.data != img3.data)
+			throw std::runtime_error("Laplacian pyramid does not reconstruct the image.");
+		ImageRGBA sunsetFull, sunset, blended;
+		ReadImageFromFile(AlloyDefaultContext()->getFullPath("images/sfsunset.png"), sunsetFull);
+		Crop(sunsetFull, sunset, int2(0, 0), int2(img3.width, img3.height));
+		Image1f mask(img3.width, img3.height);
+		for (int j = 0; j < mask.height; j++) {
+			for (int i = 0; i < mask.width; i++) {
+				mask(i, j).x = (i < mask.width / 2) ? 1.0f : 0.0f;
+			}
+		}
+		MultibandBlend(img3, sunset, mask, blended);
+		WriteImageToFile("multiband_blend.png", blended);
 		return true;
 	}
 	bool SANITY_CHECK_ROBUST_SOLVE() {
@@ -723,6 +1383,25 @@ namespace aly {
 		std::cout << "Pyramid Poisson Blend" << std::endl;
 		PoissonBlend(src, out, 32, 6);
 		WriteImageToFile("poisson_blend_pyr.png", out);
+
+		std::cout << "Multigrid Laplace Fill" << std::endl;
+		Image4f rhs(w, h);
+		Image1ub unknowns(w, h);
+		rhs.set(float4(0.0f));
+		unknowns.set(ubyte1((uint8_t)0));
+		for (int i = 1; i < w - 1; i++) {
+			for (int j = 1; j < h - 1; j++) {
+				unknowns(i, j).x = (mask(i, j).w > 0.5f) ? 1 : 0;
+			}
+		}
+		out = tar;
+		MultigridPoisson2D multigrid(MultigridCycle::W);
+		double residual = multigrid.solve(rhs, unknowns, out, 32, 1E-10, [=](int cycle, double res) {
+			std::cout << "Cycle " << cycle << " residual " << res << std::endl;
+			return true;
+		});
+		std::cout << "Final residual " << residual << std::endl;
+		WriteImageToFile("laplace_fill_multigrid.png", out);
 		std::cout << "Done!" << std::endl;
 
 		return true;
@@ -763,6 +1442,16 @@ namespace aly {
 		Tile(ilist, compose, 4, 2);
 		WriteImageToFile("compose2.png", compose);
 		diff.writeToXML("image_diff.xml");
+		std::vector<ImageRGBAf> pyramid;
+		GaussianPyramid(img, pyramid, 4);
+		if (pyramid.size() != 4 || pyramid[1].data != imgDown.data)
+			throw std::runtime_error("Gaussian pyramid does not match down sampling.");
+		Volume1f vol(33, 20, 17);
+		vol.set(float1(0.5f));
+		Volume1f volDown = vol.downSample();
+		Volume1f volUp = volDown.upSample();
+		if (volDown.rows != 16 || volUp.slices != 16 || std::abs(volUp(3, 4, 5).x - 0.5f) > 1E-6f)
+			throw std::runtime_error("Volume pyramid does not preserve a constant volume.");
 		return true;
 	}
 	bool SANITY_CHECK_MESH_IO() {
@@ -779,6 +1468,12 @@ namespace aly {
 		ReadMeshFromFile("torus2.ply", tmpMesh);
 		WritePlyMeshToFile("torus3.ply", tmpMesh, false);
 		ReadMeshFromFile("torus3.ply", tmpMesh);
+		size_t triCount = tmpMesh.triIndexes.size();
+		WriteObjMeshToFile("torus4.obj", tmpMesh);
+		ReadMeshFromFile("torus4.obj", tmpMesh);
+		if (tmpMesh.triIndexes.size() != triCount || tmpMesh.textureMap.size() != 3 * triCount) {
+			throw std::runtime_error("OBJ round trip changed the mesh.");
+		}
 
 		tmpMesh.load(AlloyDefaultContext()->getFullPath("models/icosahedron.ply"));
 		tmpMesh.updateVertexNormals();
@@ -797,6 +1492,78 @@ namespace aly {
 		ReadMeshFromFile("icosahedron3.ply", tmpMesh);
 		return true;
 	}
+	bool SANITY_CHECK_PLY_IO() {
+		//Grid of quads with every other cell split into two triangles.
+		const int N = 300;
+		Mesh mesh;
+		for (int j = 0; j < N; j++) {
+			for (int i = 0; i < N; i++) {
+				mesh.vertexLocations.push_back(float3(i / (float)N, j / (float)N, RandomUniform(-0.1f, 0.1f)));
+				mesh.vertexNormals.push_back(normalize(float3(RandomUniform(-1.0f, 1.0f), RandomUniform(-1.0f, 1.0f), 1.0f)));
+				mesh.vertexColors.push_back(float4(RandomUniform(0.0f, 1.0f), RandomUniform(0.0f, 1.0f), RandomUniform(0.0f, 1.0f), 1.0f));
+			}
+		}
+		for (int j = 0; j < N - 1; j++) {
+			for (int i = 0; i < N - 1; i++) {
+				uint32_t v = (uint32_t)(i + j * N);
+				if ((i + j) % 2 == 0) {
+					mesh.quadIndexes.push_back(uint4(v, v + 1, v + N + 1, v + N));
+				} else {
+					mesh.triIndexes.push_back(uint3(v, v + 1, v + N + 1));
+					mesh.triIndexes.push_back(uint3(v, v + N + 1, v + N));
+				}
+			}
+		}
+		WritePlyMeshToFile("ply_bulk.ply", mesh, true);
+		WriteGenericPlyMeshToFile("ply_generic.ply", mesh, true);
+		std::ifstream bulkFile("ply_bulk.ply", std::ios::binary);
+		std::ifstream genericFile("ply_generic.ply", std::ios::binary);
+		std::vector<char> bulkBytes((std::istreambuf_iterator<char>(bulkFile)), std::istreambuf_iterator<char>());
+		std::vector<char> genericBytes((std::istreambuf_iterator<char>(genericFile)), std::istreambuf_iterator<char>());
+		if (bulkBytes != genericBytes) {
+			throw std::runtime_error(MakeString() << "Bulk PLY writer output (" << bulkBytes.size() << " bytes) differs from generic writer (" << genericBytes.size() << " bytes).");
+		}
+		Mesh bulkMesh, genericMesh;
+		ReadPlyMeshFromFile("ply_bulk.ply", bulkMesh);
+		ReadGenericPlyMeshFromFile("ply_bulk.ply", genericMesh);
+		for (const Mesh* loaded : { &bulkMesh, &genericMesh }) {
+			if (loaded->vertexLocations.data != mesh.vertexLocations.data || loaded->vertexNormals.data != mesh.vertexNormals.data
+					|| loaded->quadIndexes.data != mesh.quadIndexes.data || loaded->triIndexes.data != mesh.triIndexes.data) {
+				throw std::runtime_error("PLY round trip changed vertexes, normals or faces.");
+			}
+			if (loaded->vertexColors.size() != mesh.vertexColors.size()) {
+				throw std::runtime_error("PLY round trip changed the number of colors.");
+			}
+			//Colors are stored as 8 bit channels.
+			for (size_t n = 0; n < mesh.vertexColors.size(); n++) {
+				float4 c = mesh.vertexColors[n];
+				float4 expected((uint8_t)clamp(c.x * 255.0f, 0.0f, 255.0f) / 255.0f, (uint8_t)clamp(c.y * 255.0f, 0.0f, 255.0f) / 255.0f,
+						(uint8_t)clamp(c.z * 255.0f, 0.0f, 255.0f) / 255.0f, 1.0f);
+				if (loaded->vertexColors[n] != expected) {
+					throw std::runtime_error(MakeString() << "PLY round trip changed color " << n << " " << loaded->vertexColors[n] << " expected " << expected);
+				}
+			}
+		}
+		//Reading faces with the same counts into a used Mesh must not keep its old adjacency.
+		Mesh flipped = mesh;
+		for (uint3& tri : flipped.triIndexes.data) {
+			std::swap(tri.y, tri.z);
+		}
+		WritePlyMeshToFile("ply_flipped.ply", flipped, true);
+		Mesh fresh;
+		ReadPlyMeshFromFile("ply_flipped.ply", fresh);
+		bulkMesh.getAdjacency();
+		genericMesh.getAdjacency();
+		ReadPlyMeshFromFile("ply_flipped.ply", bulkMesh);
+		ReadGenericPlyMeshFromFile("ply_flipped.ply", genericMesh);
+		for (Mesh* loaded : { &bulkMesh, &genericMesh }) {
+			if (loaded->getAdjacency().opposite != fresh.getAdjacency().opposite) {
+				throw std::runtime_error("PLY reader kept the adjacency of the previous mesh.");
+			}
+		}
+		std::cout << "PLY round trip " << mesh.vertexLocations.size() << " vertexes " << mesh.quadIndexes.size() << " quads " << mesh.triIndexes.size() << " triangles" << std::endl;
+		return true;
+	}
 	bool SANITY_CHECK_SPARSE_SOLVE() {
 		SparseMatrix1f A(4, 3);
 		SparseMatrix1f B(3, 4);
@@ -889,6 +1656,68 @@ namespace aly {
 		});
 		return true;
 	}
+	bool SANITY_CHECK_SIMD() {
+		std::cout << "Supported instruction set " << GetSupportedSIMDInstructionSet() << std::endl;
+		std::mt19937 mt(817231);
+		std::uniform_real_distribution<float> fdist(-10.0f, 10.0f);
+		std::uniform_int_distribution<int> bdist(0, 255);
+		Image4f A(317, 211), B(317, 211);
+		ImageRGBA U(317, 211), V(317, 211);
+		for (int c = 0; c < 4; c++) {
+			for (size_t i = 0; i < A.size(); i++) {
+				A[i][c] = fdist(mt);
+				B[i][c] = fdist(mt) + 25.0f;
+				U[i][c] = (uint8_t) bdist(mt);
+				V[i][c] = (uint8_t) bdist(mt);
+			}
+		}
+		const float4 scalar(1.5f, -2.0f, 0.25f, 3.0f);
+		Image4f sum, diff, prod, quot, saxpy;
+		ImageRGBA bsum, bprod;
+		double dotAB = 0.0;
+		std::pair<float4, float4> range;
+		std::pair<ubyte4, ubyte4> brange;
+		bool ret = true;
+		const SIMDInstructionSet sets[3] = { SIMDInstructionSet::Scalar, SIMDInstructionSet::SSE2, SIMDInstructionSet::AVX2 };
+		for (SIMDInstructionSet set : sets) {
+			if (static_cast<int>(set) > static_cast<int>(GetSupportedSIMDInstructionSet())) {
+				continue;
+			}
+			SetSIMDInstructionSet(set);
+			Image4f out;
+			ScaleAdd(out, A, scalar, B);
+			if (set == SIMDInstructionSet::Scalar) {
+				sum = A + B;
+				diff = A - scalar;
+				prod = A * B;
+				quot = scalar / B;
+				saxpy = out;
+				bsum = U + V;
+				bprod = U * V;
+				dotAB = dot(A, B);
+				range = A.range();
+				brange = U.range();
+			} else {
+				//Element-wise results must match bit for bit, reductions only to rounding.
+				bool match = (sum.data == (A + B).data && diff.data == (A - scalar).data
+					&& prod.data == (A * B).data && quot.data == (scalar / B).data
+					&& saxpy.data == out.data && bsum.data == (U + V).data
+					&& bprod.data == (U * V).data && range == A.range() && brange == U.range()
+					&& std::abs(dotAB - dot(A, B)) < 1E-6 * std::abs(dotAB));
+				std::cout << set << " matches scalar kernels: " << ((match) ? "yes" : "no") << std::endl;
+				ret &= match;
+			}
+		}
+		SetSIMDInstructionSet(GetSupportedSIMDInstructionSet());
+		for (size_t i = 0; i < A.size(); i++) {
+			for (int c = 0; c < 4; c++) {
+				if (bprod[i][c] != (uint8_t) (U[i][c] * V[i][c]) || sum[i][c] != A[i][c] + B[i][c]) {
+					ret = false;
+				}
+			}
+		}
+		return ret;
+	}
 	bool SANITY_CHECK_MATH() {
 		try {
 			std::cout << "Sanity Check .." << std::endl;
@@ -1091,6 +1920,14 @@ namespace aly {
 		aly::WriteImageToFile("sfmarket_rgba_hdr.png", srcRGBAf);
 		aly::WriteImageToFile("sfmarket_rgb2_hdr.png", srcRGBf);
 		aly::WriteImageToFile("sfmarket_r_hdr.png", srcAf);
+
+		aly::WriteImageToRawFile("sfmarket_rgb.xml", srcRGB);
+		ImageRGB rawRGB;
+		aly::ReadImageFromRawFile("sfmarket_rgb.xml", rawRGB);
+		MappedImage<uint8_t, ImageType::UBYTE> mappedRGB("sfmarket_rgb.xml");
+		if (rawRGB.data != srcRGB.data || mappedRGB(10, 10, 1) != srcRGB(10, 10).y) {
+			throw std::runtime_error("Raw image does not match original.");
+		}
 		return true;
 	}
 	bool SANITY_CHECK_IMAGE() {
@@ -1223,6 +2060,27 @@ namespace aly {
 #ifndef WIN32
 	bool SANITY_CHECK_FILE_IO() {
 		try {
+			const std::string abc = "abc";
+			if (HashCode(abc.data(), abc.size(), HashMethod::SHA1) != "a9993e364706816aba3e25717850c26c9cd0d89d")
+				return false;
+			if (HashCode(abc.data(), abc.size(), HashMethod::XXH64) != "44bc2cf5ad770999")
+				return false;
+			std::vector<uint8_t> bytes(3 * (1 << 20) + 17);
+			for (size_t i = 0; i < bytes.size(); i++) {
+				bytes[i] = (uint8_t) ((i * 2654435761u) >> 13);
+			}
+			for (HashMethod method : { HashMethod::SHA1, HashMethod::SHA256, HashMethod::SHA512, HashMethod::XXH64 }) {
+				Hasher hasher(method);
+				for (size_t i = 0; i < bytes.size(); i += 1001) {
+					hasher.update(bytes.data() + i, std::min((size_t) 1001, bytes.size() - i));
+				}
+				std::string streamed = EncodeHash(hasher.final(), method);
+				std::cout << "Hash " << (int) method << " " << streamed << std::endl;
+				if (streamed != HashCode(bytes, method))
+					return false;
+				if (TreeHashCode(bytes.data(), bytes.size(), method, 1 << 20) == streamed)
+					return false;
+			}
 			std::cout << RemoveTrailingSlash("/usr/local/bin/") << "::"
 				<< RemoveTrailingSlash("/usr/local/bin/") << std::endl;
 			std::vector<std::string> files = GetDirectoryFileListing("./images/");
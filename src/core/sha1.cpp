@@ -37,8 +37,7 @@ SHA1::SHA1() {
 }
 
 void SHA1::update(const std::string &s) {
-	std::istringstream is(s);
-	update(is);
+	update((const unsigned char *) s.data(), s.size());
 }
 
 void SHA1::update(std::istream &is) {
@@ -54,11 +53,39 @@ void SHA1::update(std::istream &is) {
 	}
 }
 
+/*
+ * Hash raw bytes, transforming whole blocks in place without copying them.
+ */
+
+void SHA1::update(const unsigned char *data, size_t length) {
+	uint32_t block[BLOCK_INTS];
+	if (buffer.size() > 0) {
+		size_t fill = BLOCK_BYTES - buffer.size();
+		if (fill > length)
+			fill = length;
+		buffer.append((const char *) data, fill);
+		data += fill;
+		length -= fill;
+		if (buffer.size() < BLOCK_BYTES)
+			return;
+		buffer_to_block(buffer, block);
+		transform(block);
+		buffer.clear();
+	}
+	while (length >= BLOCK_BYTES) {
+		bytes_to_block(data, block);
+		transform(block);
+		data += BLOCK_BYTES;
+		length -= BLOCK_BYTES;
+	}
+	buffer.assign((const char *) data, length);
+}
+
 /*
  * Add padding and return the message digest.
  */
 
-std::string SHA1::final() {
+void SHA1::final(unsigned char *out) {
 	/* Total number of hashed bits */
 	uint64_t total_bits = (transforms * BLOCK_BYTES + buffer.size()) * 8;
 
@@ -84,16 +111,28 @@ std::string SHA1::final() {
 	block[BLOCK_INTS - 2] = (uint32_t)(total_bits >> 32);
 	transform(block);
 
-	/* Hex std::string */
-	std::ostringstream result;
+	/* Digest bytes, most significant first */
 	for (unsigned int i = 0; i < DIGEST_INTS; i++) {
-		result << std::hex << std::setfill('0') << std::setw(8);
-		result << (digest[i] & 0xffffffff);
+		out[4 * i + 0] = (unsigned char) (digest[i] >> 24);
+		out[4 * i + 1] = (unsigned char) (digest[i] >> 16);
+		out[4 * i + 2] = (unsigned char) (digest[i] >> 8);
+		out[4 * i + 3] = (unsigned char) digest[i];
 	}
 
 	/* Reset for next run */
 	reset();
+}
+
+std::string SHA1::final() {
+	unsigned char bytes[DIGEST_INTS * 4];
+	final(bytes);
 
+	/* Hex std::string */
+	std::ostringstream result;
+	for (unsigned int i = 0; i < DIGEST_INTS * 4; i++) {
+		result << std::hex << std::setfill('0') << std::setw(2);
+		result << (unsigned int) bytes[i];
+	}
 	return result.str();
 }
 
@@ -232,6 +271,15 @@ void SHA1::buffer_to_block(const std::string &buffer,
 	}
 }
 
+void SHA1::bytes_to_block(const unsigned char *bytes,
+		uint32_t block[BLOCK_BYTES]) {
+	for (unsigned int i = 0; i < BLOCK_INTS; i++) {
+		block[i] = (uint32_t) bytes[4 * i + 3] | (uint32_t) bytes[4 * i + 2] << 8
+				| (uint32_t) bytes[4 * i + 1] << 16
+				| (uint32_t) bytes[4 * i + 0] << 24;
+	}
+}
+
 void SHA1::read(std::istream &is, std::string &s, int max) {
 	std::vector<char> sbuf(max);
 	is.read(sbuf.data(), max);
@@ -80,8 +80,8 @@ bool ImageFeaturesEx::init(Composite& rootNode) {
 	workerTask = WorkerTaskPtr(new WorkerTask([=] {
 		ImageRGBA resultImg(leftImg.width,rightImg.height);
 		Daisy daisy;
-		DescriptorField leftDescriptors;
-		DescriptorField rightDescriptors;
+		DenseDescriptorField leftDescriptors;
+		DenseDescriptorField rightDescriptors;
 		textLabel->setLabel("Computing left image descriptors ...");
 		daisy.initialize(left);
 		daisy.getDescriptors(leftDescriptors, Normalization::Sift);
@@ -97,7 +97,7 @@ bool ImageFeaturesEx::init(Composite& rootNode) {
 				double bestScore = 0.0;
 				int bestOffset = 0;
 				for (int ii = std::max(i - shiftBound,0); ii <= i; ii++) {
-					double score = dot(leftDescriptors(i, j), rightDescriptors(ii, j));
+					double score = dot(leftDescriptors, int2(i, j), rightDescriptors, int2(ii, j));
 					if (score > bestScore) {
 						bestOffset = i - ii;
 						bestScore = score;
@@ -129,14 +129,26 @@ bool SANITY_CHECK() {
 	//SANITY_CHECK_UI();
 	//SANITY_CHECK_CEREAL();
 	//SANITY_CHECK_KDTREE();
+	//SANITY_CHECK_KDTREE_PLANES();
 	//SANITY_CHECK_PYRAMID();
 	//SANITY_CHECK_SPARSE_SOLVE();
 	//SANITY_CHECK_DENSE_SOLVE();
 	//SANITY_CHECK_DENSE_MATRIX();
 	//SANITY_CHECK_IMAGE_PROCESSING();
+	//SANITY_CHECK_SIMD();
 	//SANITY_CHECK_IMAGE_IO();
 	//SANITY_CHECK_ROBUST_SOLVE();
 	//SANITY_CHECK_SUBDIVIDE();
+	//SANITY_CHECK_MESH_ADJACENCY();
+	//SANITY_CHECK_PLY_IO();
+	//SANITY_CHECK_SPARSE_VOLUME();
+	//SANITY_CHECK_BINARY_FILE();
+	//SANITY_CHECK_TILED_IMAGE();
+	//SANITY_CHECK_INTEGRAL_IMAGE();
+	//SANITY_CHECK_DAISY();
+	//SANITY_CHECK_ISOSURFACE();
+	//SANITY_CHECK_ISOCONTOUR();
+	//SANITY_CHECK_DELAUNAY();
 	return ret;
 }
 int main(int argc, char *argv[]) {
@@ -390,8 +390,7 @@ namespace aly {
 		for (int k = 0; k < (int) fileNames.size(); k++) {
 			std::string file = AlloyDefaultContext()->getFullPath(fileNames[k]);
 			std::string txtFile = ReadTextFile(file);
-			std::vector<char> hashData(txtFile.begin(), txtFile.end());
-			hashCode[k] = HashCode(hashData, HashMethod::SHA256);
+			hashCode[k] = HashCode(txtFile.data(), txtFile.size(), HashMethod::SHA256);
 		}
 		return hashCode;
 	}
@@ -405,8 +404,7 @@ namespace aly {
 			ss << txtFile;
 		}
 		std::string hashString = ss.str();
-		std::vector<char> hashData(hashString.begin(), hashString.end());
-		std::string hashCode = aly::HashCode(hashData, HashMethod::SHA256);
+		std::string hashCode = aly::HashCode(hashString.data(), hashString.size(), HashMethod::SHA256);
 		std::string binaryName = aly::MakeString() << name << "." << hashCode.substr(0, 16) + ".bin";
 		std::string binaryPath = GetCurrentWorkingDirectory() + ALY_PATH_SEPARATOR+binaryName;
 		if (FileExists(binaryPath)) {